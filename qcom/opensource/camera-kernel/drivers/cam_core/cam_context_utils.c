@@ -40,6 +40,7 @@ int cam_context_buf_done_from_hw(struct cam_context *ctx,
 	struct cam_ctx_request *req;
 	struct cam_hw_done_event_data *done =
 		(struct cam_hw_done_event_data *)done_event_data;
+	int32_t sync_objs[CAM_CTX_CFG_MAX];
 	int rc;
 
 	if (!ctx || !done) {
@@ -100,10 +101,14 @@ int cam_context_buf_done_from_hw(struct cam_context *ctx,
 	}
 
 	for (j = 0; j < req->num_out_map_entries; j++) {
-		cam_sync_signal(req->out_map_entries[j].sync_id, result);
+		sync_objs[j] = req->out_map_entries[j].sync_id;
 		req->out_map_entries[j].sync_id = -1;
 	}
 
+	if (req->num_out_map_entries)
+		cam_sync_signal_batch(sync_objs, req->num_out_map_entries,
+			result);
+
 	if (cam_debug_ctx_req_list & ctx->dev_id)
 		CAM_INFO(CAM_CTXT,
 			"[%s][%d] : Moving req[%llu] from active_list to free_list",
@@ -11,6 +11,7 @@
 #include <linux/dma-buf.h>
 #include <linux/debugfs.h>
 #include <linux/version.h>
+#include <linux/percpu.h>
 #if IS_REACHABLE(CONFIG_DMABUF_HEAPS)
 #include <linux/mem-buf.h>
 #include <soc/qcom/secure_buffer.h>
@@ -28,6 +29,9 @@
 static struct cam_mem_table tbl;
 static atomic_t cam_mem_mgr_state = ATOMIC_INIT(CAM_MEM_MGR_UNINITIALIZED);
 
+/* where the next slot search starts on this cpu, the last slot it freed */
+static DEFINE_PER_CPU(int32_t, cam_mem_slot_hint);
+
 #if IS_REACHABLE(CONFIG_DMABUF_HEAPS)
 static void cam_mem_mgr_put_dma_heaps(void);
 static int cam_mem_mgr_get_dma_heaps(void);
@@ -156,9 +160,12 @@ int cam_mem_mgr_init(void)
 	/* We need to reserve slot 0 because 0 is invalid */
 	set_bit(0, tbl.bitmap);
 
+	BUILD_BUG_ON(CAM_MEM_BUFQ_MAX != (1 << CAM_MEM_MGR_SLOT_BITS));
+
 	for (i = 1; i < CAM_MEM_BUFQ_MAX; i++) {
 		tbl.bufq[i].fd = -1;
 		tbl.bufq[i].buf_handle = -1;
+		mutex_init(&tbl.bufq[i].q_lock);
 	}
 	mutex_init(&tbl.m_lock);
 
@@ -174,41 +181,84 @@ put_heaps:
 	return rc;
 }
 
+/*
+ * cam_mem_get_io_buf() reads a slot without q_lock. The handle is stored
+ * after the rest of the slot is filled in and cleared before the fd is
+ * reset, so a reader that sees the same handle before and after its fd
+ * based lookup knows the fd belonged to that buffer.
+ */
+static void cam_mem_util_publish_handle(int32_t idx, int32_t buf_handle)
+{
+	smp_store_release(&tbl.bufq[idx].buf_handle, buf_handle);
+}
+
+static void cam_mem_util_clear_handle(int32_t idx)
+{
+	WRITE_ONCE(tbl.bufq[idx].buf_handle, -1);
+	smp_wmb();
+}
+
 static int32_t cam_mem_get_slot(void)
 {
-	int32_t idx;
+	int32_t idx, start;
+	bool wrapped = false;
 
-	mutex_lock(&tbl.m_lock);
-	idx = find_first_zero_bit(tbl.bitmap, tbl.bits);
-	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
-		mutex_unlock(&tbl.m_lock);
-		return -ENOMEM;
+	/*
+	 * Claim a free bit without the table lock. The search starts at
+	 * this cpu's hint so concurrent allocators mostly probe different
+	 * words and a slot freed here is reused while still cache hot.
+	 */
+	start = raw_cpu_read(cam_mem_slot_hint);
+	if (start <= 0 || start >= CAM_MEM_BUFQ_MAX)
+		start = 1;
+
+	idx = start;
+	for (;;) {
+		idx = find_next_zero_bit(tbl.bitmap, CAM_MEM_BUFQ_MAX, idx);
+		if (wrapped && idx >= start)
+			return -ENOMEM;
+
+		if (idx >= CAM_MEM_BUFQ_MAX) {
+			wrapped = true;
+			idx = 1;
+			continue;
+		}
+
+		if (!test_and_set_bit_lock(idx, tbl.bitmap))
+			break;
+
+		idx++;
 	}
 
-	set_bit(idx, tbl.bitmap);
+	raw_cpu_write(cam_mem_slot_hint, idx + 1);
 	tbl.bufq[idx].active = true;
-	mutex_init(&tbl.bufq[idx].q_lock);
-	mutex_unlock(&tbl.m_lock);
 
 	return idx;
 }
 
-static void cam_mem_put_slot(int32_t idx)
+/* Called with the slot's q_lock held, after buf_handle was cleared */
+static void cam_mem_release_slot(int32_t idx)
 {
-	mutex_lock(&tbl.m_lock);
-	mutex_lock(&tbl.bufq[idx].q_lock);
 	tbl.bufq[idx].active = false;
 	tbl.bufq[idx].is_internal = false;
+	tbl.bufq[idx].gen++;
+}
+
+static void cam_mem_put_slot(int32_t idx)
+{
+	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_util_clear_handle(idx);
+	cam_mem_release_slot(idx);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
-	mutex_destroy(&tbl.bufq[idx].q_lock);
-	clear_bit(idx, tbl.bitmap);
-	mutex_unlock(&tbl.m_lock);
+	clear_bit_unlock(idx, tbl.bitmap);
+	raw_cpu_write(cam_mem_slot_hint, idx);
 }
 
 int cam_mem_get_io_buf(int32_t buf_handle, int32_t mmu_handle,
 	dma_addr_t *iova_ptr, size_t *len_ptr)
 {
 	int rc = 0, idx;
+	int32_t fd;
 
 	*len_ptr = 0;
 
@@ -217,41 +267,46 @@ int cam_mem_get_io_buf(int32_t buf_handle, int32_t mmu_handle,
 		return -EINVAL;
 	}
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(buf_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(buf_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0)
 		return -ENOENT;
 
 	if (!tbl.bufq[idx].active)
 		return -EAGAIN;
 
-	mutex_lock(&tbl.bufq[idx].q_lock);
-	if (buf_handle != tbl.bufq[idx].buf_handle) {
-		rc = -EINVAL;
-		goto handle_mismatch;
-	}
+	if (buf_handle != smp_load_acquire(&tbl.bufq[idx].buf_handle))
+		return -EINVAL;
+
+	fd = READ_ONCE(tbl.bufq[idx].fd);
 
 	if (CAM_MEM_MGR_IS_SECURE_HDL(buf_handle))
 		rc = cam_smmu_get_stage2_iova(mmu_handle,
-			tbl.bufq[idx].fd,
+			fd,
 			iova_ptr,
 			len_ptr);
 	else
 		rc = cam_smmu_get_iova(mmu_handle,
-			tbl.bufq[idx].fd,
+			fd,
 			iova_ptr,
 			len_ptr);
 	if (rc) {
 		CAM_ERR(CAM_MEM,
 			"fail to map buf_hdl:0x%x, mmu_hdl: 0x%x for fd:%d",
-			buf_handle, mmu_handle, tbl.bufq[idx].fd);
-		goto handle_mismatch;
+			buf_handle, mmu_handle, fd);
+		return rc;
+	}
+
+	/* the buffer was unmapped, and maybe remapped, under our lookup */
+	smp_rmb();
+	if (buf_handle != READ_ONCE(tbl.bufq[idx].buf_handle)) {
+		*len_ptr = 0;
+		return -EINVAL;
 	}
 
 	CAM_DBG(CAM_MEM,
 		"handle:0x%x fd:%d iova_ptr:%pK len_ptr:%llu",
-		mmu_handle, tbl.bufq[idx].fd, iova_ptr, *len_ptr);
-handle_mismatch:
-	mutex_unlock(&tbl.bufq[idx].q_lock);
+		mmu_handle, fd, iova_ptr, *len_ptr);
+
 	return rc;
 }
 EXPORT_SYMBOL(cam_mem_get_io_buf);
@@ -273,7 +328,7 @@ int cam_mem_get_cpu_buf(int32_t buf_handle, uintptr_t *vaddr_ptr, size_t *len)
 	if (!buf_handle || !vaddr_ptr || !len)
 		return -EINVAL;
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(buf_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(buf_handle);
 
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0)
 		return -EINVAL;
@@ -319,7 +374,7 @@ int cam_mem_mgr_cache_ops(struct cam_mem_cache_ops_cmd *cmd)
 	if (!cmd)
 		return -EINVAL;
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(cmd->buf_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(cmd->buf_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0)
 		return -EINVAL;
 
@@ -812,6 +867,7 @@ int cam_mem_mgr_alloc_and_map(struct cam_mem_mgr_alloc_cmd *cmd)
 {
 	int rc;
 	int32_t idx;
+	int32_t buf_handle;
 	struct dma_buf *dmabuf = NULL;
 	int fd = -1;
 	dma_addr_t hw_vaddr = 0;
@@ -892,10 +948,10 @@ int cam_mem_mgr_alloc_and_map(struct cam_mem_mgr_alloc_cmd *cmd)
 	tbl.bufq[idx].fd = fd;
 	tbl.bufq[idx].dma_buf = NULL;
 	tbl.bufq[idx].flags = cmd->flags;
-	tbl.bufq[idx].buf_handle = GET_MEM_HANDLE(idx, fd);
+	buf_handle = CAM_MEM_MGR_MAKE_HANDLE(idx, tbl.bufq[idx].gen, fd);
 	tbl.bufq[idx].is_internal = true;
 	if (cmd->flags & CAM_MEM_FLAG_PROTECTED_MODE)
-		CAM_MEM_MGR_SET_SECURE_HDL(tbl.bufq[idx].buf_handle, true);
+		CAM_MEM_MGR_SET_SECURE_HDL(buf_handle, true);
 
 	if (cmd->flags & CAM_MEM_FLAG_KMD_ACCESS) {
 		rc = cam_mem_util_map_cpu_va(dmabuf, &kvaddr, &klen);
@@ -919,6 +975,7 @@ int cam_mem_mgr_alloc_and_map(struct cam_mem_mgr_alloc_cmd *cmd)
 	tbl.bufq[idx].is_imported = false;
 	kref_init(&tbl.bufq[idx].krefcount);
 	tbl.bufq[idx].smmu_mapping_client = CAM_SMMU_MAPPING_USER;
+	cam_mem_util_publish_handle(idx, buf_handle);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	cmd->out.buf_handle = tbl.bufq[idx].buf_handle;
@@ -961,11 +1018,14 @@ static bool cam_mem_util_is_map_internal(int32_t fd)
 int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd *cmd)
 {
 	int32_t idx;
+	int32_t buf_handle;
 	int rc;
 	struct dma_buf *dmabuf;
 	dma_addr_t hw_vaddr = 0;
 	size_t len = 0;
 	bool is_internal = false;
+	struct timespec64 ts1, ts2;
+	long microsec = 0;
 
 	if (!atomic_read(&cam_mem_mgr_state)) {
 		CAM_ERR(CAM_MEM, "failed. mem_mgr not initialized");
@@ -989,6 +1049,9 @@ int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd *cmd)
 		return rc;
 	}
 
+	if (tbl.alloc_profile_enable)
+		CAM_GET_TIMESTAMP(ts1);
+
 	dmabuf = dma_buf_get(cmd->fd);
 	if (IS_ERR_OR_NULL((void *)(dmabuf))) {
 		CAM_ERR(CAM_MEM, "Failed to import dma_buf fd");
@@ -1026,9 +1089,9 @@ int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd *cmd)
 	tbl.bufq[idx].fd = cmd->fd;
 	tbl.bufq[idx].dma_buf = NULL;
 	tbl.bufq[idx].flags = cmd->flags;
-	tbl.bufq[idx].buf_handle = GET_MEM_HANDLE(idx, cmd->fd);
+	buf_handle = CAM_MEM_MGR_MAKE_HANDLE(idx, tbl.bufq[idx].gen, cmd->fd);
 	if (cmd->flags & CAM_MEM_FLAG_PROTECTED_MODE)
-		CAM_MEM_MGR_SET_SECURE_HDL(tbl.bufq[idx].buf_handle, true);
+		CAM_MEM_MGR_SET_SECURE_HDL(buf_handle, true);
 	tbl.bufq[idx].kmdvaddr = 0;
 
 	if (cmd->num_hdl > 0)
@@ -1045,6 +1108,7 @@ int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd *cmd)
 	tbl.bufq[idx].is_internal = is_internal;
 	kref_init(&tbl.bufq[idx].krefcount);
 	tbl.bufq[idx].smmu_mapping_client = CAM_SMMU_MAPPING_USER;
+	cam_mem_util_publish_handle(idx, buf_handle);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	cmd->out.buf_handle = tbl.bufq[idx].buf_handle;
@@ -1055,6 +1119,13 @@ int cam_mem_mgr_map(struct cam_mem_mgr_map_cmd *cmd)
 		cmd->fd, cmd->flags, cmd->num_hdl, idx, cmd->out.buf_handle,
 		tbl.bufq[idx].len);
 
+	if (tbl.alloc_profile_enable) {
+		CAM_GET_TIMESTAMP(ts2);
+		CAM_GET_TIMESTAMP_DIFF_IN_MICRO(ts1, ts2, microsec);
+		trace_cam_log_event("MemMapProfile", "size and time in micro",
+			len, microsec);
+	}
+
 	return rc;
 
 map_fail:
@@ -1165,24 +1236,24 @@ static int cam_mem_mgr_cleanup_table(void)
 			dma_buf_put(tbl.bufq[i].dma_buf);
 			tbl.bufq[i].dma_buf = NULL;
 		}
+		cam_mem_util_clear_handle(i);
 		tbl.bufq[i].fd = -1;
 		tbl.bufq[i].flags = 0;
-		tbl.bufq[i].buf_handle = -1;
 		tbl.bufq[i].vaddr = 0;
 		tbl.bufq[i].len = 0;
 		memset(tbl.bufq[i].hdls, 0,
 			sizeof(int32_t) * tbl.bufq[i].num_hdl);
 		tbl.bufq[i].num_hdl = 0;
 		tbl.bufq[i].dma_buf = NULL;
-		tbl.bufq[i].active = false;
-		tbl.bufq[i].is_internal = false;
+		cam_mem_release_slot(i);
 		mutex_unlock(&tbl.bufq[i].q_lock);
-		mutex_destroy(&tbl.bufq[i].q_lock);
+		/*
+		 * Free only the slots released here. cam_mem_get_slot() claims
+		 * bits without m_lock, so a slot it holds but has not made
+		 * active yet must stay claimed. Slot 0 stays reserved.
+		 */
+		clear_bit_unlock(i, tbl.bitmap);
 	}
-
-	bitmap_zero(tbl.bitmap, tbl.bits);
-	/* We need to reserve slot 0 because 0 is invalid */
-	set_bit(0, tbl.bitmap);
 	mutex_unlock(&tbl.m_lock);
 
 	return 0;
@@ -1190,15 +1261,19 @@ static int cam_mem_mgr_cleanup_table(void)
 
 void cam_mem_mgr_deinit(void)
 {
+	int i;
+
 	atomic_set(&cam_mem_mgr_state, CAM_MEM_MGR_UNINITIALIZED);
 	cam_mem_mgr_cleanup_table();
 	mutex_lock(&tbl.m_lock);
-	bitmap_zero(tbl.bitmap, tbl.bits);
 	kfree(tbl.bitmap);
 	tbl.bitmap = NULL;
 	tbl.dbg_buf_idx = -1;
 	mutex_unlock(&tbl.m_lock);
 	mutex_destroy(&tbl.m_lock);
+
+	for (i = 1; i < CAM_MEM_BUFQ_MAX; i++)
+		mutex_destroy(&tbl.bufq[i].q_lock);
 }
 
 static void cam_mem_util_unmap(struct kref *kref)
@@ -1209,13 +1284,19 @@ static void cam_mem_util_unmap(struct kref *kref)
 	enum cam_smmu_mapping_client client;
 	struct cam_mem_buf_queue *bufq =
 		container_of(kref, typeof(*bufq), krefcount);
+	struct timespec64 ts1, ts2;
+	long microsec = 0;
+	size_t len;
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(bufq->buf_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(bufq->buf_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
 		CAM_ERR(CAM_MEM, "Incorrect index");
 		return;
 	}
 
+	if (tbl.alloc_profile_enable)
+		CAM_GET_TIMESTAMP(ts1);
+
 	client = tbl.bufq[idx].smmu_mapping_client;
 
 	CAM_DBG(CAM_MEM, "Flags = %X idx %d", tbl.bufq[idx].flags, idx);
@@ -1260,8 +1341,8 @@ static void cam_mem_util_unmap(struct kref *kref)
 	}
 
 	mutex_lock(&tbl.bufq[idx].q_lock);
+	cam_mem_util_clear_handle(idx);
 	tbl.bufq[idx].flags = 0;
-	tbl.bufq[idx].buf_handle = -1;
 	tbl.bufq[idx].vaddr = 0;
 	memset(tbl.bufq[idx].hdls, 0,
 		sizeof(int32_t) * CAM_MEM_MMU_MAX_HANDLE);
@@ -1279,14 +1360,21 @@ static void cam_mem_util_unmap(struct kref *kref)
 	tbl.bufq[idx].dma_buf = NULL;
 	tbl.bufq[idx].is_imported = false;
 	tbl.bufq[idx].is_internal = false;
+	len = tbl.bufq[idx].len;
 	tbl.bufq[idx].len = 0;
 	tbl.bufq[idx].num_hdl = 0;
-	tbl.bufq[idx].active = false;
+	cam_mem_release_slot(idx);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
-	mutex_destroy(&tbl.bufq[idx].q_lock);
-	clear_bit(idx, tbl.bitmap);
+	clear_bit_unlock(idx, tbl.bitmap);
+	raw_cpu_write(cam_mem_slot_hint, idx);
 	mutex_unlock(&tbl.m_lock);
 
+	if (tbl.alloc_profile_enable) {
+		CAM_GET_TIMESTAMP(ts2);
+		CAM_GET_TIMESTAMP_DIFF_IN_MICRO(ts1, ts2, microsec);
+		trace_cam_log_event("MemUnmapProfile", "size and time in micro",
+			len, microsec);
+	}
 }
 
 void cam_mem_put_cpu_buf(int32_t buf_handle)
@@ -1299,7 +1387,7 @@ void cam_mem_put_cpu_buf(int32_t buf_handle)
 		return;
 	}
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(buf_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(buf_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
 		CAM_ERR(CAM_MEM, "idx: %d not valid", idx);
 		return;
@@ -1342,7 +1430,7 @@ int cam_mem_mgr_release(struct cam_mem_mgr_release_cmd *cmd)
 		return -EINVAL;
 	}
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(cmd->buf_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(cmd->buf_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
 		CAM_ERR(CAM_MEM, "Incorrect index %d extracted from mem handle",
 			idx);
@@ -1462,11 +1550,10 @@ int cam_mem_mgr_request_mem(struct cam_mem_mgr_request_desc *inp,
 	}
 
 	mutex_lock(&tbl.bufq[idx].q_lock);
-	mem_handle = GET_MEM_HANDLE(idx, ion_fd);
+	mem_handle = CAM_MEM_MGR_MAKE_HANDLE(idx, tbl.bufq[idx].gen, ion_fd);
 	tbl.bufq[idx].dma_buf = buf;
 	tbl.bufq[idx].fd = -1;
 	tbl.bufq[idx].flags = inp->flags;
-	tbl.bufq[idx].buf_handle = mem_handle;
 	tbl.bufq[idx].kmdvaddr = kvaddr;
 
 	tbl.bufq[idx].vaddr = iova;
@@ -1478,6 +1565,7 @@ int cam_mem_mgr_request_mem(struct cam_mem_mgr_request_desc *inp,
 	tbl.bufq[idx].is_imported = false;
 	kref_init(&tbl.bufq[idx].krefcount);
 	tbl.bufq[idx].smmu_mapping_client = CAM_SMMU_MAPPING_KERNEL;
+	cam_mem_util_publish_handle(idx, mem_handle);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	out->kva = kvaddr;
@@ -1515,7 +1603,7 @@ int cam_mem_mgr_release_mem(struct cam_mem_mgr_memory_desc *inp)
 		return -EINVAL;
 	}
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(inp->mem_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(inp->mem_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
 		CAM_ERR(CAM_MEM, "Incorrect index extracted from mem handle");
 		return -EINVAL;
@@ -1613,11 +1701,10 @@ int cam_mem_mgr_reserve_memory_region(struct cam_mem_mgr_request_desc *inp,
 	}
 
 	mutex_lock(&tbl.bufq[idx].q_lock);
-	mem_handle = GET_MEM_HANDLE(idx, ion_fd);
+	mem_handle = CAM_MEM_MGR_MAKE_HANDLE(idx, tbl.bufq[idx].gen, ion_fd);
 	tbl.bufq[idx].fd = -1;
 	tbl.bufq[idx].dma_buf = buf;
 	tbl.bufq[idx].flags = inp->flags;
-	tbl.bufq[idx].buf_handle = mem_handle;
 	tbl.bufq[idx].kmdvaddr = 0;
 
 	tbl.bufq[idx].vaddr = iova;
@@ -1629,6 +1716,7 @@ int cam_mem_mgr_reserve_memory_region(struct cam_mem_mgr_request_desc *inp,
 	tbl.bufq[idx].is_imported = false;
 	kref_init(&tbl.bufq[idx].krefcount);
 	tbl.bufq[idx].smmu_mapping_client = CAM_SMMU_MAPPING_KERNEL;
+	cam_mem_util_publish_handle(idx, mem_handle);
 	mutex_unlock(&tbl.bufq[idx].q_lock);
 
 	out->kva = 0;
@@ -1670,7 +1758,7 @@ int cam_mem_mgr_free_memory_region(struct cam_mem_mgr_memory_desc *inp)
 		return -EINVAL;
 	}
 
-	idx = CAM_MEM_MGR_GET_HDL_IDX(inp->mem_handle);
+	idx = CAM_MEM_MGR_GET_SLOT(inp->mem_handle);
 	if (idx >= CAM_MEM_BUFQ_MAX || idx <= 0) {
 		CAM_ERR(CAM_MEM, "Incorrect index extracted from mem handle");
 		return -EINVAL;
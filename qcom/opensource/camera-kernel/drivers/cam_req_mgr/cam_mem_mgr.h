@@ -17,6 +17,19 @@
 
 #define CAM_MEM_BUFQ_MAX 1024
 
+/*
+ * The low bits of the handle index field select the slot, the remaining
+ * bits carry the slot generation so a stale handle to a reused slot with
+ * the same fd is rejected.
+ */
+#define CAM_MEM_MGR_SLOT_BITS 10
+#define CAM_MEM_MGR_GEN_MASK \
+	((1 << (CAM_MEM_MGR_HDL_IDX_SIZE - CAM_MEM_MGR_SLOT_BITS)) - 1)
+#define CAM_MEM_MGR_GET_SLOT(hdl) ((hdl) & (CAM_MEM_BUFQ_MAX - 1))
+#define CAM_MEM_MGR_MAKE_HANDLE(idx, gen, fd) \
+	GET_MEM_HANDLE(((idx) | \
+	(((gen) & CAM_MEM_MGR_GEN_MASK) << CAM_MEM_MGR_SLOT_BITS)), fd)
+
 /* Enum for possible mem mgr states */
 enum cam_mem_mgr_state {
 	CAM_MEM_MGR_UNINITIALIZED,
@@ -33,11 +46,12 @@ enum cam_smmu_mapping_client {
  * struct cam_mem_buf_queue
  *
  * @dma_buf:     pointer to the allocated dma_buf in the table
- * @q_lock:      mutex lock for buffer
+ * @q_lock:      mutex lock for buffer, initialized once with the table
  * @hdls:        list of mapped handles
  * @num_hdl:     number of handles
  * @fd:          file descriptor of buffer
- * @buf_handle:  unique handle for buffer
+ * @buf_handle:  unique handle for buffer, published last on map and
+ *               cleared first on unmap for lockless readers
  * @align:       alignment for allocation
  * @len:         size of buffer
  * @flags:       attributes of buffer
@@ -49,6 +63,7 @@ enum cam_smmu_mapping_client {
  * @krefcount:      Reference counter to track whether the buffer is
  *                  mapped and in use
  * @smmu_mapping_client: Client buffer (User or kernel)
+ * @gen:         generation of the slot, advanced every time it is freed
  */
 struct cam_mem_buf_queue {
 	struct dma_buf *dma_buf;
@@ -67,12 +82,14 @@ struct cam_mem_buf_queue {
 	bool is_internal;
 	struct kref krefcount;
 	enum cam_smmu_mapping_client smmu_mapping_client;
+	uint32_t gen;
 };
 
 /**
  * struct cam_mem_table
  *
- * @m_lock: mutex lock for table
+ * @m_lock: mutex lock for table cleanup and unmap, slot allocation
+ *          only uses atomic bit operations on the bitmap
  * @bitmap: bitmap of the mem mgr utility
  * @bits: max bits of the utility
  * @bufq: array of buffers
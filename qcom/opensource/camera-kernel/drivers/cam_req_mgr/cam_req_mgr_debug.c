@@ -3,7 +3,9 @@
  * Copyright (c) 2016-2020, The Linux Foundation. All rights reserved.
  */
 
+#include <linux/seq_file.h>
 #include "cam_req_mgr_debug.h"
+#include "cam_req_mgr_workq.h"
 
 #define MAX_SESS_INFO_LINE_BUFF_LEN 256
 
@@ -111,6 +113,47 @@ static const struct file_operations session_info = {
 	.write = session_info_write,
 };
 
+static int workq_latency_show(struct seq_file *s, void *unused)
+{
+	int i, j, k;
+	struct cam_req_mgr_core_device *core_dev = s->private;
+	struct cam_req_mgr_core_session *session;
+	struct cam_req_mgr_core_link *link;
+	struct cam_req_mgr_core_workq *workq;
+
+	seq_printf(s, "%-10s %4s %8s", "link_hdl", "prio", "stolen");
+	for (k = 0; k < CAM_WORKQ_LAT_HIST_BUCKETS - 1; k++)
+		seq_printf(s, " <%7uus", CAM_WORKQ_LAT_HIST_BASE_US << k);
+	seq_puts(s, "      more\n");
+
+	mutex_lock(&core_dev->crm_lock);
+	list_for_each_entry(session, &core_dev->session_head, entry) {
+		/* links can be released from the middle of the array */
+		mutex_lock(&session->lock);
+		for (i = 0; i < MAXIMUM_LINKS_PER_SESSION; i++) {
+			link = session->links[i];
+			if (!link || !link->workq)
+				continue;
+
+			workq = link->workq;
+			for (j = 0; j < CRM_TASK_PRIORITY_MAX; j++) {
+				seq_printf(s, "0x%-8x %4d %8u",
+					link->link_hdl, j,
+					workq->stolen_cnt[j]);
+				for (k = 0; k < CAM_WORKQ_LAT_HIST_BUCKETS; k++)
+					seq_printf(s, " %10u",
+						workq->lat_hist[j][k]);
+				seq_puts(s, "\n");
+			}
+		}
+		mutex_unlock(&session->lock);
+	}
+	mutex_unlock(&core_dev->crm_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(workq_latency);
+
 static struct dentry *debugfs_root;
 int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 {
@@ -132,6 +175,8 @@ int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 		debugfs_root, core_dev, &bubble_recovery);
 	debugfs_create_u32("delay_detect_count", 0644,
 		debugfs_root, &cam_debug_mgr_delay_detect);
+	debugfs_create_file("workq_latency", 0444, debugfs_root,
+		core_dev, &workq_latency_fops);
 end:
 	return rc;
 }
@@ -84,41 +84,112 @@ static int cam_req_mgr_process_task(struct crm_workq_task *task)
 	return 0;
 }
 
+static void cam_req_mgr_workq_account_task(
+	struct cam_req_mgr_core_workq *workq, struct crm_workq_task *task,
+	bool stolen)
+{
+	int64_t  lat_us;
+	uint32_t bucket = 0;
+
+	lat_us = ktime_us_delta(ktime_get(), task->enq_ts);
+	while (bucket < CAM_WORKQ_LAT_HIST_BUCKETS - 1 &&
+		lat_us >= (CAM_WORKQ_LAT_HIST_BASE_US << bucket))
+		bucket++;
+
+	/* Only the worker holding CAM_WORKQ_STATE_RUNNING gets here */
+	workq->lat_hist[task->priority][bucket]++;
+	if (stolen)
+		workq->stolen_cnt[task->priority]++;
+}
+
 /**
- * cam_req_mgr_process_workq() - main loop handling
- * @w: workqueue task pointer
+ * cam_req_mgr_workq_drain() - run enqueued tasks until the lists are empty
+ * @workq : workq to drain
+ * @stolen: true if called from the steal worker
+ *
+ * Either the local or the steal worker may get here first, the other
+ * one backs off on CAM_WORKQ_STATE_RUNNING so tasks of a workq never
+ * run concurrently. After each task the lists are rescanned from
+ * CRM_TASK_PRIORITY_0 so a trigger enqueued meanwhile runs next.
  */
-static void cam_req_mgr_process_workq(struct work_struct *w)
+static void cam_req_mgr_workq_drain(struct cam_req_mgr_core_workq *workq,
+	bool stolen)
 {
-	struct cam_req_mgr_core_workq *workq = NULL;
 	struct crm_workq_task         *task;
-	int32_t                        i = CRM_TASK_PRIORITY_0;
+	int32_t                        i;
 	unsigned long                  flags = 0;
 
-	if (!w) {
-		CAM_ERR(CAM_CRM, "NULL task pointer can not schedule");
+again:
+	if (test_and_set_bit_lock(CAM_WORKQ_STATE_RUNNING, &workq->state))
 		return;
-	}
-	workq = (struct cam_req_mgr_core_workq *)
-		container_of(w, struct cam_req_mgr_core_workq, work);
 
 	cam_req_mgr_thread_switch_delay_detect(workq->workq_scheduled_ts);
-	while (i < CRM_TASK_PRIORITY_MAX) {
+	for (;;) {
+		task = NULL;
 		WORKQ_ACQUIRE_LOCK(workq, flags);
-		while (!list_empty(&workq->task.process_head[i])) {
+		for (i = CRM_TASK_PRIORITY_0; i < CRM_TASK_PRIORITY_MAX; i++) {
+			if (list_empty(&workq->task.process_head[i]))
+				continue;
 			task = list_first_entry(&workq->task.process_head[i],
 				struct crm_workq_task, entry);
 			atomic_sub(1, &workq->task.pending_cnt);
 			list_del_init(&task->entry);
-			WORKQ_RELEASE_LOCK(workq, flags);
-			cam_req_mgr_process_task(task);
-			CAM_DBG(CAM_CRM, "processed task %pK free_cnt %d",
-				task, atomic_read(&workq->task.free_cnt));
-			WORKQ_ACQUIRE_LOCK(workq, flags);
+			break;
 		}
 		WORKQ_RELEASE_LOCK(workq, flags);
-		i++;
+		if (!task)
+			break;
+
+		cam_req_mgr_workq_account_task(workq, task, stolen);
+		cam_req_mgr_process_task(task);
+		CAM_DBG(CAM_CRM, "processed task %pK free_cnt %d stolen %d",
+			task, atomic_read(&workq->task.free_cnt), stolen);
+	}
+
+	clear_bit_unlock(CAM_WORKQ_STATE_RUNNING, &workq->state);
+	/*
+	 * A task enqueued after the last scan may have had its work
+	 * backed off while we still held the bit, pick it up here.
+	 */
+	smp_mb__after_atomic();
+	if (atomic_read(&workq->task.pending_cnt))
+		goto again;
+}
+
+/**
+ * cam_req_mgr_process_workq() - main loop handling
+ * @w: workqueue task pointer
+ */
+static void cam_req_mgr_process_workq(struct work_struct *w)
+{
+	struct cam_req_mgr_core_workq *workq = NULL;
+
+	if (!w) {
+		CAM_ERR(CAM_CRM, "NULL task pointer can not schedule");
+		return;
+	}
+	workq = (struct cam_req_mgr_core_workq *)
+		container_of(w, struct cam_req_mgr_core_workq, work);
+
+	cam_req_mgr_workq_drain(workq, false);
+}
+
+/**
+ * cam_req_mgr_process_workq_steal() - steal worker, runs on an idle CPU
+ * @w: workqueue task pointer
+ */
+static void cam_req_mgr_process_workq_steal(struct work_struct *w)
+{
+	struct cam_req_mgr_core_workq *workq = NULL;
+
+	if (!w) {
+		CAM_ERR(CAM_CRM, "NULL task pointer can not schedule");
+		return;
 	}
+	workq = (struct cam_req_mgr_core_workq *)
+		container_of(w, struct cam_req_mgr_core_workq, steal_work);
+
+	cam_req_mgr_workq_drain(workq, true);
 }
 
 int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
@@ -158,6 +229,7 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 			goto end;
 		}
 
+	task->enq_ts = ktime_get();
 	list_add_tail(&task->entry,
 		&workq->task.process_head[task->priority]);
 
@@ -165,8 +237,10 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 	CAM_DBG(CAM_CRM, "enq task %pK pending_cnt %d",
 		task, atomic_read(&workq->task.pending_cnt));
 
-	workq->workq_scheduled_ts = ktime_get();
+	workq->workq_scheduled_ts = task->enq_ts;
 	queue_work(workq->job, &workq->work);
+	if (workq->steal_job && task->priority == CRM_TASK_PRIORITY_0)
+		queue_work(workq->steal_job, &workq->steal_work);
 	WORKQ_RELEASE_LOCK(workq, flags);
 end:
 	return rc;
@@ -180,6 +254,7 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 	struct crm_workq_task  *task;
 	struct cam_req_mgr_core_workq *crm_workq = NULL;
 	char buf[128] = "crm_workq-";
+	char steal_buf[128] = "crm_steal-";
 
 	if (!*workq) {
 		crm_workq = kzalloc(sizeof(struct cam_req_mgr_core_workq),
@@ -187,7 +262,12 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 		if (crm_workq == NULL)
 			return -ENOMEM;
 
-		wq_flags |= WQ_UNBOUND;
+		/*
+		 * In steal mode the main workq is per-CPU so tasks run on
+		 * the CPU that enqueued them, idle CPUs get steal_job.
+		 */
+		if (!(flags & CAM_WORKQ_FLAG_STEAL))
+			wq_flags |= WQ_UNBOUND;
 		if (flags & CAM_WORKQ_FLAG_HIGH_PRIORITY)
 			wq_flags |= WQ_HIGHPRI;
 
@@ -203,8 +283,21 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 			return -ENOMEM;
 		}
 
+		if (flags & CAM_WORKQ_FLAG_STEAL) {
+			strlcat(steal_buf, name, sizeof(steal_buf));
+			crm_workq->steal_job = alloc_workqueue(steal_buf,
+				WQ_UNBOUND | (wq_flags & WQ_HIGHPRI), 1, NULL);
+			if (!crm_workq->steal_job) {
+				destroy_workqueue(crm_workq->job);
+				kfree(crm_workq);
+				return -ENOMEM;
+			}
+		}
+
 		/* Workq attributes initialization */
 		INIT_WORK(&crm_workq->work, cam_req_mgr_process_workq);
+		INIT_WORK(&crm_workq->steal_work,
+			cam_req_mgr_process_workq_steal);
 		spin_lock_init(&crm_workq->lock_bh);
 		CAM_DBG(CAM_CRM, "LOCK_DBG workq %s lock %pK",
 			name, &crm_workq->lock_bh);
@@ -223,6 +316,9 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 			CAM_WARN(CAM_CRM, "Insufficient memory %zu",
 				sizeof(struct crm_workq_task) *
 				crm_workq->task.num_task);
+			if (crm_workq->steal_job)
+				destroy_workqueue(crm_workq->steal_job);
+			destroy_workqueue(crm_workq->job);
 			kfree(crm_workq);
 			return -ENOMEM;
 		}
@@ -245,16 +341,20 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 void cam_req_mgr_workq_destroy(struct cam_req_mgr_core_workq **crm_workq)
 {
 	unsigned long flags = 0;
-	struct workqueue_struct   *job;
+	struct workqueue_struct   *job, *steal_job;
 
 	CAM_DBG(CAM_CRM, "destroy workque %pK", crm_workq);
 	if (*crm_workq) {
 		WORKQ_ACQUIRE_LOCK(*crm_workq, flags);
 		if ((*crm_workq)->job) {
 			job = (*crm_workq)->job;
+			steal_job = (*crm_workq)->steal_job;
 			(*crm_workq)->job = NULL;
+			(*crm_workq)->steal_job = NULL;
 			WORKQ_RELEASE_LOCK(*crm_workq, flags);
 			destroy_workqueue(job);
+			if (steal_job)
+				destroy_workqueue(steal_job);
 		} else {
 			WORKQ_RELEASE_LOCK(*crm_workq, flags);
 		}
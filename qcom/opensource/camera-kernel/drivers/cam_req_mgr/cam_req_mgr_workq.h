@@ -26,12 +26,31 @@
  */
 #define CAM_WORKQ_FLAG_SERIAL                    (1 << 1)
 
+/*
+ * Run tasks on a per-CPU workqueue local to the enqueuing CPU, and
+ * let an idle CPU steal CRM_TASK_PRIORITY_0 tasks if the local worker
+ * has not picked them up. Tasks of one workq still run one at a time,
+ * in priority then enqueue order.
+ */
+#define CAM_WORKQ_FLAG_STEAL                     (1 << 2)
+
 /*
  * Response time threshold in ms beyond which it is considered
  * as workq scheduling/processing delay.
  */
 #define CAM_WORKQ_RESPONSE_TIME_THRESHOLD   5
 
+/*
+ * Enqueue to run latency histogram buckets, bucket 0 counts tasks
+ * run within CAM_WORKQ_LAT_HIST_BASE_US and each next bucket doubles
+ * the bound. The last bucket counts everything slower.
+ */
+#define CAM_WORKQ_LAT_HIST_BUCKETS          8
+#define CAM_WORKQ_LAT_HIST_BASE_US          64
+
+/* Bit in workq state set while a worker is draining the task lists */
+#define CAM_WORKQ_STATE_RUNNING             0
+
 
 /* Task priorities, lower the number higher the priority*/
 enum crm_task_priority {
@@ -59,6 +78,7 @@ enum crm_workq_context {
  * @priv       : when task is enqueuer caller can attach priv along which
  *               it will get in process callback
  * @ret        : return value in future to use for blocking calls
+ * @enq_ts     : time the task was enqueued, for the latency histogram
  */
 struct crm_workq_task {
 	int32_t                    priority;
@@ -69,12 +89,18 @@ struct crm_workq_task {
 	uint8_t                    cancel;
 	void                      *priv;
 	int32_t                    ret;
+	ktime_t                    enq_ts;
 };
 
 /** struct cam_req_mgr_core_workq
  * @work              : work token used by workqueue
  * @job               : workqueue internal job struct
  * @workq_scheduled_ts: workqueue scheduled timestamp
+ * @steal_work        : work token queued on steal_job for idle CPUs
+ * @steal_job         : unbound workqueue used with CAM_WORKQ_FLAG_STEAL
+ * @state             : CAM_WORKQ_STATE_* bits
+ * @lat_hist          : enqueue to run latency histogram per priority
+ * @stolen_cnt        : num of tasks run from steal_work per priority
  * task -
  * @lock_bh           : lock for task structs
  * @in_irq            : set true if workque can be used in irq context
@@ -91,6 +117,12 @@ struct cam_req_mgr_core_workq {
 	spinlock_t                 lock_bh;
 	uint32_t                   in_irq;
 	ktime_t                    workq_scheduled_ts;
+	struct work_struct         steal_work;
+	struct workqueue_struct   *steal_job;
+	unsigned long              state;
+	uint32_t                   lat_hist[CRM_TASK_PRIORITY_MAX]
+					[CAM_WORKQ_LAT_HIST_BUCKETS];
+	uint32_t                   stolen_cnt[CRM_TASK_PRIORITY_MAX];
 
 	/* tasks */
 	struct {
@@ -114,7 +146,7 @@ struct cam_req_mgr_core_workq {
  * @workq    : Double pointer worker
  * @in_irq   : Set to one if workq might be used in irq context
  * @flags    : Bitwise OR of Flags for workq behavior.
- *             e.g. CAM_REQ_MGR_WORKQ_HIGH_PRIORITY | CAM_REQ_MGR_WORKQ_SERIAL
+ *             e.g. CAM_WORKQ_FLAG_HIGH_PRIORITY | CAM_WORKQ_FLAG_SERIAL
  * This function will allocate and create workqueue and pass
  * the workq pointer to caller.
  */
@@ -1197,6 +1197,7 @@ int cam_sensor_apply_settings(struct cam_sensor_ctrl_t *s_ctrl,
 	uint64_t top = 0, del_req_id = 0;
 	struct i2c_settings_array *i2c_set = NULL;
 	struct i2c_settings_list *i2c_list;
+	ktime_t start;
 
 	if (req_id == 0) {
 		switch (opcode) {
@@ -1222,6 +1223,9 @@ int cam_sensor_apply_settings(struct cam_sensor_ctrl_t *s_ctrl,
 			return 0;
 		}
 		if (i2c_set->is_settings_valid == 1) {
+			start = ktime_get();
+			memset(&s_ctrl->io_master_info.stats, 0,
+				sizeof(s_ctrl->io_master_info.stats));
 			list_for_each_entry(i2c_list,
 				&(i2c_set->list_head), list) {
 				rc = cam_sensor_i2c_modes_util(
@@ -1234,6 +1238,13 @@ int cam_sensor_apply_settings(struct cam_sensor_ctrl_t *s_ctrl,
 					return rc;
 				}
 			}
+			CAM_DBG(CAM_SENSOR,
+				"sensor_id:0x%x opcode:%d regs:%u xfers:%u burst_regs:%u time:%lldus",
+				s_ctrl->sensordata->slave_info.sensor_id,
+				opcode, s_ctrl->io_master_info.stats.num_regs,
+				s_ctrl->io_master_info.stats.num_xfers,
+				s_ctrl->io_master_info.stats.num_burst_regs,
+				ktime_us_delta(ktime_get(), start));
 		}
 	} else {
 		offset = req_id % MAX_PER_FRAME_ARRAY;
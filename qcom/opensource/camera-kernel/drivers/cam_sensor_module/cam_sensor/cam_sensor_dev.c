@@ -154,6 +154,7 @@ static int32_t cam_sensor_driver_i2c_probe(struct i2c_client *client,
 	/* Initialize sensor device type */
 	s_ctrl->of_node = client->dev.of_node;
 	s_ctrl->io_master_info.master_type = I2C_MASTER;
+	s_ctrl->io_master_info.burst_write = true;
 	s_ctrl->is_probe_succeed = 0;
 	s_ctrl->last_flush_req = 0;
 
@@ -289,6 +290,7 @@ static int32_t cam_sensor_driver_platform_probe(
 	s_ctrl->pdev = pdev;
 
 	s_ctrl->io_master_info.master_type = CCI_MASTER;
+	s_ctrl->io_master_info.burst_write = true;
 
 	rc = cam_sensor_parse_dt(s_ctrl);
 	if (rc < 0) {
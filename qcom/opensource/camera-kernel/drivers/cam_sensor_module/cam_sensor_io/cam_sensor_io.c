@@ -6,6 +6,20 @@
 #include "cam_sensor_io.h"
 #include "cam_sensor_i2c.h"
 
+/*
+ * Minimum run of consecutive registers sent as one transfer. Each CCI
+ * table write waits for the queue to drain, so runs must be long enough
+ * to pay for splitting the table. Each QUP register is its own transfer,
+ * so any run helps there.
+ */
+#define CAMERA_IO_CCI_BURST_MIN_REGS 32
+#define CAMERA_IO_I2C_BURST_MIN_REGS 2
+
+static bool sensor_io_burst = true;
+module_param(sensor_io_burst, bool, 0644);
+MODULE_PARM_DESC(sensor_io_burst,
+	"Let image sensors send consecutive register runs as burst transfers");
+
 int32_t camera_io_dev_poll(struct camera_io_master *io_master_info,
 	uint32_t addr, uint16_t data, uint32_t data_mask,
 	enum camera_sensor_i2c_type addr_type,
@@ -115,20 +129,12 @@ int32_t camera_io_dev_read_seq(struct camera_io_master *io_master_info,
 	return 0;
 }
 
-int32_t camera_io_dev_write(struct camera_io_master *io_master_info,
+static int32_t camera_io_dev_write_table(
+	struct camera_io_master *io_master_info,
 	struct cam_sensor_i2c_reg_setting *write_setting)
 {
-	if (!write_setting || !io_master_info) {
-		CAM_ERR(CAM_SENSOR,
-			"Input parameters not valid ws: %pK ioinfo: %pK",
-			write_setting, io_master_info);
-		return -EINVAL;
-	}
-
-	if (!write_setting->reg_setting) {
-		CAM_ERR(CAM_SENSOR, "Invalid Register Settings");
-		return -EINVAL;
-	}
+	io_master_info->stats.num_regs += write_setting->size;
+	io_master_info->stats.num_xfers++;
 
 	if (io_master_info->master_type == CCI_MASTER) {
 		return cam_cci_i2c_write_table(io_master_info,
@@ -146,6 +152,131 @@ int32_t camera_io_dev_write(struct camera_io_master *io_master_info,
 	}
 }
 
+/*
+ * Number of registers from reg with consecutive addresses and no delay,
+ * which the sensor can take as one auto-increment write.
+ */
+static uint32_t camera_io_dev_run_len(struct cam_sensor_i2c_reg_array *reg,
+	uint32_t size)
+{
+	uint32_t i;
+
+	if (reg[0].delay)
+		return 1;
+
+	for (i = 1; i < size; i++) {
+		if (reg[i].delay || reg[i].reg_addr != reg[i - 1].reg_addr + 1)
+			break;
+	}
+
+	return i;
+}
+
+/*
+ * Split a random write table into runs sent with
+ * camera_io_dev_write_continuous() and the registers in between, which
+ * still go out as random writes. CCI gets MSM_CCI_I2C_WRITE_SEQ since
+ * its BURST mode does not advance the address across packets unless the
+ * hw supports seq write continuation. The table delay is applied once,
+ * after the last register.
+ */
+static int32_t camera_io_dev_write_runs(
+	struct camera_io_master *io_master_info,
+	struct cam_sensor_i2c_reg_setting *write_setting,
+	uint32_t min_run)
+{
+	int32_t rc = 0;
+	uint32_t i = 0, start = 0, run;
+	uint8_t flag;
+	struct cam_sensor_i2c_reg_array *reg = write_setting->reg_setting;
+	struct cam_sensor_i2c_reg_setting seg = *write_setting;
+
+	flag = (io_master_info->master_type == CCI_MASTER) ?
+		CAM_SENSOR_I2C_WRITE_SEQ : CAM_SENSOR_I2C_WRITE_BURST;
+	seg.delay = 0;
+
+	while (i < write_setting->size) {
+		run = camera_io_dev_run_len(&reg[i], write_setting->size - i);
+		if (run < min_run) {
+			i += run;
+			continue;
+		}
+
+		if (i > start) {
+			seg.reg_setting = &reg[start];
+			seg.size = i - start;
+			rc = camera_io_dev_write_table(io_master_info, &seg);
+			if (rc < 0)
+				return rc;
+		}
+
+		seg.reg_setting = &reg[i];
+		seg.size = run;
+		rc = camera_io_dev_write_continuous(io_master_info, &seg, flag);
+		if (rc < 0)
+			return rc;
+
+		i += run;
+		start = i;
+	}
+
+	if (i > start) {
+		seg.reg_setting = &reg[start];
+		seg.size = i - start;
+		rc = camera_io_dev_write_table(io_master_info, &seg);
+		if (rc < 0)
+			return rc;
+	}
+
+	if (write_setting->delay > 20)
+		msleep(write_setting->delay);
+	else if (write_setting->delay)
+		usleep_range(write_setting->delay * 1000, (write_setting->delay
+			* 1000) + 1000);
+
+	return rc;
+}
+
+int32_t camera_io_dev_write(struct camera_io_master *io_master_info,
+	struct cam_sensor_i2c_reg_setting *write_setting)
+{
+	uint32_t min_run;
+
+	if (!write_setting || !io_master_info) {
+		CAM_ERR(CAM_SENSOR,
+			"Input parameters not valid ws: %pK ioinfo: %pK",
+			write_setting, io_master_info);
+		return -EINVAL;
+	}
+
+	if (!write_setting->reg_setting) {
+		CAM_ERR(CAM_SENSOR, "Invalid Register Settings");
+		return -EINVAL;
+	}
+
+	/*
+	 * Only image sensors opt in, and only byte data auto-increments one
+	 * register per entry, wider data types keep the per-register path.
+	 */
+	if (sensor_io_burst && io_master_info->burst_write &&
+		write_setting->data_type == CAMERA_SENSOR_I2C_TYPE_BYTE &&
+		(write_setting->addr_type == CAMERA_SENSOR_I2C_TYPE_BYTE ||
+		write_setting->addr_type == CAMERA_SENSOR_I2C_TYPE_WORD)) {
+		if (io_master_info->master_type == CCI_MASTER)
+			min_run = CAMERA_IO_CCI_BURST_MIN_REGS;
+		else if (io_master_info->master_type == I2C_MASTER)
+			min_run = CAMERA_IO_I2C_BURST_MIN_REGS;
+		else
+			min_run = 0;
+
+		if (min_run && write_setting->size >= min_run)
+			return camera_io_dev_write_runs(io_master_info,
+				write_setting, min_run);
+	}
+
+	return camera_io_dev_write_table(io_master_info, write_setting);
+}
+
 int32_t camera_io_dev_write_continuous(struct camera_io_master *io_master_info,
 	struct cam_sensor_i2c_reg_setting *write_setting,
 	uint8_t cam_sensor_i2c_write_flag)
@@ -162,6 +293,10 @@ int32_t camera_io_dev_write_continuous(struct camera_io_master *io_master_info,
 		return -EINVAL;
 	}
 
+	io_master_info->stats.num_regs += write_setting->size;
+	io_master_info->stats.num_burst_regs += write_setting->size;
+	io_master_info->stats.num_xfers++;
+
 	if (io_master_info->master_type == CCI_MASTER) {
 		return cam_cci_i2c_write_continuous_table(io_master_info,
 			write_setting, cam_sensor_i2c_write_flag);
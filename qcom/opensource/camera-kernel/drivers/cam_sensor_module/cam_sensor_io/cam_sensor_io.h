@@ -14,17 +14,32 @@
 #define I2C_MASTER 2
 #define SPI_MASTER 3
 
+/**
+ * @num_regs: registers written
+ * @num_xfers: write tables handed to the CCI/QUP/SPI driver
+ * @num_burst_regs: registers written as part of a burst/seq transfer
+ */
+struct camera_io_write_stats {
+	uint32_t num_regs;
+	uint32_t num_xfers;
+	uint32_t num_burst_regs;
+};
+
 /**
  * @master_type: CCI master type
  * @client: I2C client information structure
  * @cci_client: CCI client information structure
  * @spi_client: SPI client information structure
+ * @stats: write counters, cleared by the user for each report
+ * @burst_write: split write tables into burst transfers, image sensors only
  */
 struct camera_io_master {
 	int master_type;
 	struct i2c_client *client;
 	struct cam_sensor_cci_client *cci_client;
 	struct cam_sensor_spi_client *spi_client;
+	struct camera_io_write_stats stats;
+	bool burst_write;
 };
 
 /**
@@ -75,7 +90,9 @@ int32_t camera_io_release(struct camera_io_master *io_master_info);
  * @io_master_info: I2C/SPI master information
  * @write_setting: write settings information
  *
- * This API abstracts write functionality based on master type
+ * This API abstracts write functionality based on master type. On CCI
+ * and I2C masters runs of consecutive byte registers are sent as one
+ * sequential/burst transfer.
  */
 int32_t camera_io_dev_write(struct camera_io_master *io_master_info,
 	struct cam_sensor_i2c_reg_setting *write_setting);
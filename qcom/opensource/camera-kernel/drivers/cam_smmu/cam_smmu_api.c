@@ -15,6 +15,8 @@
 #include <linux/workqueue.h>
 #include <linux/genalloc.h>
 #include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/seq_file.h>
 #include <linux/dma-iommu.h>
 #include <soc/qcom/secure_buffer.h>
 
@@ -45,6 +47,12 @@
 	div_u64_rem(atomic64_add_return(1, head),\
 	CAM_SMMU_MONITOR_MAX_ENTRIES, (ret))
 
+/* per context bank buckets for the fd and dma_buf indexes */
+#define CAM_SMMU_BUF_HASH_BITS 6
+/* lookups by entries compared, the last bin counts that many or more */
+#define CAM_SMMU_LOOKUP_HIST_BINS 8
+#define CAM_SMMU_BUF_KEY(buf) ((unsigned long)(buf))
+
 static int g_num_pf_handled = 4;
 module_param(g_num_pf_handled, int, 0644);
 
@@ -145,6 +153,11 @@ struct cam_context_bank_info {
 
 	struct list_head smmu_buf_list;
 	struct list_head smmu_buf_kernel_list;
+	/* non-secure mappings of the two lists, keyed by ion_fd / dma_buf */
+	DECLARE_HASHTABLE(buf_fd_hash, CAM_SMMU_BUF_HASH_BITS);
+	DECLARE_HASHTABLE(buf_kernel_hash, CAM_SMMU_BUF_HASH_BITS);
+	u64 lookup_hist[CAM_SMMU_LOOKUP_HIST_BINS];
+	u64 lookup_miss;
 	struct mutex lock;
 	int handle;
 	enum cam_smmu_ops_param state;
@@ -200,6 +213,7 @@ struct cam_dma_buff_info {
 	int ref_count;
 	dma_addr_t paddr;
 	struct list_head list;
+	struct hlist_node hnode;
 	int ion_fd;
 	size_t len;
 	size_t phys_len;
@@ -868,6 +882,11 @@ void cam_smmu_reset_iommu_table(enum cam_smmu_init_dir ops)
 		iommu_cb_set.cb_info[i].handle = HANDLE_INIT;
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_list);
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_kernel_list);
+		hash_init(iommu_cb_set.cb_info[i].buf_fd_hash);
+		hash_init(iommu_cb_set.cb_info[i].buf_kernel_hash);
+		memset(iommu_cb_set.cb_info[i].lookup_hist, 0,
+			sizeof(iommu_cb_set.cb_info[i].lookup_hist));
+		iommu_cb_set.cb_info[i].lookup_miss = 0;
 		iommu_cb_set.cb_info[i].state = CAM_SMMU_DETACH;
 		iommu_cb_set.cb_info[i].dev = NULL;
 		iommu_cb_set.cb_info[i].cb_count = 0;
@@ -1119,6 +1138,56 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_virt_address(int idx,
 	return NULL;
 }
 
+static void cam_smmu_account_lookup(struct cam_context_bank_info *cb_info,
+	uint32_t probes, bool found)
+{
+	if (probes >= CAM_SMMU_LOOKUP_HIST_BINS)
+		probes = CAM_SMMU_LOOKUP_HIST_BINS - 1;
+
+	cb_info->lookup_hist[probes]++;
+	if (!found)
+		cb_info->lookup_miss++;
+}
+
+/*
+ * Both lookups run under the context bank lock. Mappings are added at the
+ * head of their bucket, so a duplicate key resolves to the newest mapping
+ * exactly as the list walk did.
+ */
+static struct cam_dma_buff_info *cam_smmu_lookup_fd(int idx, int ion_fd)
+{
+	struct cam_context_bank_info *cb_info = &iommu_cb_set.cb_info[idx];
+	struct cam_dma_buff_info *mapping;
+	uint32_t probes = 0;
+
+	hash_for_each_possible(cb_info->buf_fd_hash, mapping, hnode, ion_fd) {
+		probes++;
+		if (mapping->ion_fd == ion_fd)
+			break;
+	}
+
+	cam_smmu_account_lookup(cb_info, probes, mapping != NULL);
+	return mapping;
+}
+
+static struct cam_dma_buff_info *cam_smmu_lookup_dma_buf(int idx,
+	struct dma_buf *buf)
+{
+	struct cam_context_bank_info *cb_info = &iommu_cb_set.cb_info[idx];
+	struct cam_dma_buff_info *mapping;
+	uint32_t probes = 0;
+
+	hash_for_each_possible(cb_info->buf_kernel_hash, mapping, hnode,
+		CAM_SMMU_BUF_KEY(buf)) {
+		probes++;
+		if (mapping->buf == buf)
+			break;
+	}
+
+	cam_smmu_account_lookup(cb_info, probes, mapping != NULL);
+	return mapping;
+}
+
 static struct cam_dma_buff_info *cam_smmu_find_mapping_by_ion_index(int idx,
 	int ion_fd)
 {
@@ -1129,13 +1198,10 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_ion_index(int idx,
 		return NULL;
 	}
 
-	list_for_each_entry(mapping,
-			&iommu_cb_set.cb_info[idx].smmu_buf_list,
-			list) {
-		if (mapping->ion_fd == ion_fd) {
-			CAM_DBG(CAM_SMMU, "find ion_fd %d", ion_fd);
-			return mapping;
-		}
+	mapping = cam_smmu_lookup_fd(idx, ion_fd);
+	if (mapping) {
+		CAM_DBG(CAM_SMMU, "find ion_fd %d", ion_fd);
+		return mapping;
 	}
 
 	CAM_ERR(CAM_SMMU, "Error: Cannot find entry by index %d", idx);
@@ -1153,13 +1219,10 @@ static struct cam_dma_buff_info *cam_smmu_find_mapping_by_dma_buf(int idx,
 		return NULL;
 	}
 
-	list_for_each_entry(mapping,
-			&iommu_cb_set.cb_info[idx].smmu_buf_kernel_list,
-			list) {
-		if (mapping->buf == buf) {
-			CAM_DBG(CAM_SMMU, "find dma_buf %pK", buf);
-			return mapping;
-		}
+	mapping = cam_smmu_lookup_dma_buf(idx, buf);
+	if (mapping) {
+		CAM_DBG(CAM_SMMU, "find dma_buf %pK", buf);
+		return mapping;
 	}
 
 	CAM_ERR(CAM_SMMU, "Error: Cannot find entry by index %d", idx);
@@ -2170,6 +2233,8 @@ static int cam_smmu_map_buffer_and_add_to_list(int idx, int ion_fd,
 	/* add to the list */
 	list_add(&mapping_info->list,
 		&iommu_cb_set.cb_info[idx].smmu_buf_list);
+	hash_add(iommu_cb_set.cb_info[idx].buf_fd_hash, &mapping_info->hnode,
+		ion_fd);
 
 	cam_smmu_update_monitor_array(&iommu_cb_set.cb_info[idx], true,
 		mapping_info);
@@ -2198,6 +2263,8 @@ static int cam_smmu_map_kernel_buffer_and_add_to_list(int idx,
 	/* add to the list */
 	list_add(&mapping_info->list,
 		&iommu_cb_set.cb_info[idx].smmu_buf_kernel_list);
+	hash_add(iommu_cb_set.cb_info[idx].buf_kernel_hash,
+		&mapping_info->hnode, CAM_SMMU_BUF_KEY(buf));
 
 	cam_smmu_update_monitor_array(&iommu_cb_set.cb_info[idx], true,
 		mapping_info);
@@ -2290,6 +2357,7 @@ static int cam_smmu_unmap_buf_and_remove_from_list(
 	mapping_info->buf = NULL;
 
 	list_del_init(&mapping_info->list);
+	hash_del(&mapping_info->hnode);
 
 	/* free one buffer */
 	kfree(mapping_info);
@@ -2301,13 +2369,11 @@ static enum cam_smmu_buf_state cam_smmu_check_fd_in_list(int idx,
 {
 	struct cam_dma_buff_info *mapping;
 
-	list_for_each_entry(mapping,
-		&iommu_cb_set.cb_info[idx].smmu_buf_list, list) {
-		if (mapping->ion_fd == ion_fd) {
-			*paddr_ptr = mapping->paddr;
-			*len_ptr = mapping->len;
-			return CAM_SMMU_BUFF_EXIST;
-		}
+	mapping = cam_smmu_lookup_fd(idx, ion_fd);
+	if (mapping) {
+		*paddr_ptr = mapping->paddr;
+		*len_ptr = mapping->len;
+		return CAM_SMMU_BUFF_EXIST;
 	}
 
 	return CAM_SMMU_BUFF_NOT_EXIST;
@@ -2318,13 +2384,11 @@ static enum cam_smmu_buf_state cam_smmu_check_dma_buf_in_list(int idx,
 {
 	struct cam_dma_buff_info *mapping;
 
-	list_for_each_entry(mapping,
-		&iommu_cb_set.cb_info[idx].smmu_buf_kernel_list, list) {
-		if (mapping->buf == buf) {
-			*paddr_ptr = mapping->paddr;
-			*len_ptr = mapping->len;
-			return CAM_SMMU_BUFF_EXIST;
-		}
+	mapping = cam_smmu_lookup_dma_buf(idx, buf);
+	if (mapping) {
+		*paddr_ptr = mapping->paddr;
+		*len_ptr = mapping->len;
+		return CAM_SMMU_BUFF_EXIST;
 	}
 
 	return CAM_SMMU_BUFF_NOT_EXIST;
@@ -4077,6 +4141,41 @@ cb_init_fail:
 	return rc;
 }
 
+static int cam_smmu_lookup_hist_show(struct seq_file *m, void *unused)
+{
+	struct cam_context_bank_info *cb_info;
+	int i, j;
+
+	seq_printf(m, "%-16s %12s %10s", "cb", "lookups", "misses");
+	for (j = 0; j < CAM_SMMU_LOOKUP_HIST_BINS; j++)
+		seq_printf(m, " %9d%s", j,
+			(j == CAM_SMMU_LOOKUP_HIST_BINS - 1) ? "+" : " ");
+	seq_puts(m, "\n");
+
+	for (i = 0; i < iommu_cb_set.cb_num; i++) {
+		u64 hist[CAM_SMMU_LOOKUP_HIST_BINS], total = 0, miss;
+
+		cb_info = &iommu_cb_set.cb_info[i];
+		mutex_lock(&cb_info->lock);
+		memcpy(hist, cb_info->lookup_hist, sizeof(hist));
+		miss = cb_info->lookup_miss;
+		mutex_unlock(&cb_info->lock);
+
+		for (j = 0; j < CAM_SMMU_LOOKUP_HIST_BINS; j++)
+			total += hist[j];
+
+		seq_printf(m, "%-16s %12llu %10llu",
+			cb_info->name[0] ? cb_info->name[0] : "-",
+			total, miss);
+		for (j = 0; j < CAM_SMMU_LOOKUP_HIST_BINS; j++)
+			seq_printf(m, " %10llu", hist[j]);
+		seq_puts(m, "\n");
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cam_smmu_lookup_hist);
+
 static int cam_smmu_create_debug_fs(void)
 {
 	int rc = 0;
@@ -4095,6 +4194,8 @@ static int cam_smmu_create_debug_fs(void)
 		iommu_cb_set.dentry, &iommu_cb_set.cb_dump_enable);
 	debugfs_create_bool("map_profile_enable", 0644,
 		iommu_cb_set.dentry, &iommu_cb_set.map_profile_enable);
+	debugfs_create_file("lookup_hist", 0444,
+		iommu_cb_set.dentry, NULL, &cam_smmu_lookup_hist_fops);
 end:
 	return rc;
 }
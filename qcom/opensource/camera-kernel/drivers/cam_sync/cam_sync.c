@@ -14,6 +14,7 @@
 #include "cam_common_util.h"
 #include "cam_compat.h"
 #include "cam_req_mgr_workq.h"
+#include "cam_trace.h"
 
 #ifdef CONFIG_MSM_GLOBAL_SYNX
 #include <synx_api.h>
@@ -27,6 +28,21 @@ struct sync_device *sync_dev;
  */
 static bool trigger_cb_without_switch;
 
+/* Latency is only measured while the cam_sync_obj tracepoint is enabled */
+static inline u64 cam_sync_trace_start(void)
+{
+	return trace_cam_sync_obj_enabled() ? ktime_get_ns() : 0;
+}
+
+/* num_objs: fences signaled or merged, a batch reports its first in sync_obj */
+static inline void cam_sync_trace_end(const char *op, int32_t sync_obj,
+	uint32_t num_objs, uint32_t status, u64 start_ns)
+{
+	if (start_ns)
+		trace_cam_sync_obj(op, sync_obj, num_objs, status,
+			ktime_get_ns() - start_ns);
+}
+
 static void cam_sync_print_fence_table(void)
 {
 	int idx;
@@ -49,20 +65,17 @@ int cam_sync_create(int32_t *sync_obj, const char *name)
 {
 	int rc;
 	long idx;
-	bool bit;
+	u64 start_ns = cam_sync_trace_start();
 
-	do {
-		idx = find_first_zero_bit(sync_dev->bitmap, CAM_SYNC_MAX_OBJS);
-		if (idx >= CAM_SYNC_MAX_OBJS) {
-			CAM_ERR(CAM_SYNC,
-				"Error: Unable to create sync idx = %d reached max!",
-				idx);
-			cam_sync_print_fence_table();
-			return -ENOMEM;
-		}
-		CAM_DBG(CAM_SYNC, "Index location available at idx: %ld", idx);
-		bit = test_and_set_bit(idx, sync_dev->bitmap);
-	} while (bit);
+	rc = cam_sync_util_find_and_set_empty_row(sync_dev, &idx);
+	if (rc) {
+		CAM_ERR(CAM_SYNC,
+			"Error: Unable to create sync, reached max %d!",
+			CAM_SYNC_MAX_OBJS);
+		cam_sync_print_fence_table();
+		return -ENOMEM;
+	}
+	CAM_DBG(CAM_SYNC, "Index location available at idx: %ld", idx);
 
 	spin_lock_bh(&sync_dev->row_spinlocks[idx]);
 	rc = cam_sync_init_row(sync_dev->sync_table, idx, name,
@@ -79,6 +92,7 @@ int cam_sync_create(int32_t *sync_obj, const char *name)
 	CAM_DBG(CAM_SYNC, "sync_obj: %i", *sync_obj);
 	spin_unlock_bh(&sync_dev->row_spinlocks[idx]);
 
+	cam_sync_trace_end("create", *sync_obj, 1, 0, start_ns);
 	return rc;
 }
 
@@ -184,13 +198,15 @@ int cam_sync_deregister_callback(sync_callback cb_func,
 	return found ? 0 : -ENOENT;
 }
 
-int cam_sync_signal(int32_t sync_obj, uint32_t status)
+/*
+ * Signals one row. If this drops its last reference, the row's parents are
+ * moved to @parents for cam_sync_signal_parents() to update once the row
+ * lock is released.
+ */
+static int cam_sync_signal_row(int32_t sync_obj, uint32_t status,
+	struct list_head *parents)
 {
 	struct sync_table_row *row = NULL;
-	struct sync_table_row *parent_row = NULL;
-	struct sync_parent_info *parent_info, *temp_parent_info;
-	struct list_head parents_list;
-	int rc = 0;
 
 	if (sync_obj >= CAM_SYNC_MAX_OBJS || sync_obj <= 0) {
 		CAM_ERR(CAM_SYNC, "Error: Out of range sync obj (0 <= %d < %d)",
@@ -240,56 +256,113 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 	row->state = status;
 	cam_sync_util_dispatch_signaled_cb(sync_obj, status);
 
-	/* copy parent list to local and release child lock */
-	INIT_LIST_HEAD(&parents_list);
-	list_splice_init(&row->parents_list, &parents_list);
+	/* move parent list to the caller and release child lock */
+	list_splice_tail_init(&row->parents_list, parents);
 	spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
 
-	if (list_empty(&parents_list))
-		return 0;
+	return 0;
+}
+
+/*
+ * Every entry of @parents stands for one signaled child. Entries for the
+ * same parent are applied under a single hold of the parent's lock, so a
+ * merged fence over a whole batch is updated and dispatched once.
+ */
+static void cam_sync_signal_parents(struct list_head *parents,
+	uint32_t status)
+{
+	struct sync_table_row *parent_row = NULL;
+	struct sync_parent_info *parent_info, *next, *temp_parent_info;
+	int32_t parent_id;
+	int rc;
+
+	while (!list_empty(parents)) {
+		parent_info = list_first_entry(parents,
+			struct sync_parent_info, list);
+		parent_id = parent_info->sync_id;
+		parent_row = sync_dev->sync_table + parent_id;
+
+		spin_lock_bh(&sync_dev->row_spinlocks[parent_id]);
+		rc = 0;
+		list_for_each_entry_safe(next, temp_parent_info, parents,
+			list) {
+			if (next->sync_id != parent_id)
+				continue;
+
+			list_del_init(&next->list);
+			kfree(next);
+			if (rc)
+				continue;
+
+			parent_row->remaining--;
+			rc = cam_sync_util_update_parent_state(
+				parent_row,
+				status);
+			if (rc)
+				CAM_ERR(CAM_SYNC, "Invalid parent state %d",
+					parent_row->state);
+		}
+
+		if (!rc && !parent_row->remaining)
+			cam_sync_util_dispatch_signaled_cb(
+				parent_id, parent_row->state);
+
+		spin_unlock_bh(&sync_dev->row_spinlocks[parent_id]);
+	}
+}
+
+int cam_sync_signal(int32_t sync_obj, uint32_t status)
+{
+	struct list_head parents_list;
+	u64 start_ns = cam_sync_trace_start();
+	int rc;
+
+	INIT_LIST_HEAD(&parents_list);
+	rc = cam_sync_signal_row(sync_obj, status, &parents_list);
+	if (rc)
+		return rc;
 
 	/*
 	 * Now iterate over all parents of this object and if they too need to
 	 * be signaled dispatch cb's
 	 */
-	list_for_each_entry_safe(parent_info,
-		temp_parent_info,
-		&parents_list,
-		list) {
-		parent_row = sync_dev->sync_table + parent_info->sync_id;
-		spin_lock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
-		parent_row->remaining--;
+	cam_sync_signal_parents(&parents_list, status);
 
-		rc = cam_sync_util_update_parent_state(
-			parent_row,
-			status);
-		if (rc) {
-			CAM_ERR(CAM_SYNC, "Invalid parent state %d",
-				parent_row->state);
-			spin_unlock_bh(
-				&sync_dev->row_spinlocks[parent_info->sync_id]);
-			kfree(parent_info);
-			continue;
-		}
+	cam_sync_trace_end("signal", sync_obj, 1, status, start_ns);
+	return 0;
+}
 
-		if (!parent_row->remaining)
-			cam_sync_util_dispatch_signaled_cb(
-				parent_info->sync_id, parent_row->state);
+int cam_sync_signal_batch(int32_t *sync_objs, uint32_t num_objs,
+	uint32_t status)
+{
+	struct list_head parents_list;
+	u64 start_ns = cam_sync_trace_start();
+	uint32_t i;
+	int rc, first_rc = 0;
+
+	if (!sync_objs || !num_objs)
+		return -EINVAL;
 
-		spin_unlock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
-		list_del_init(&parent_info->list);
-		kfree(parent_info);
+	INIT_LIST_HEAD(&parents_list);
+	for (i = 0; i < num_objs; i++) {
+		rc = cam_sync_signal_row(sync_objs[i], status, &parents_list);
+		if (rc && !first_rc)
+			first_rc = rc;
 	}
 
-	return 0;
+	cam_sync_signal_parents(&parents_list, status);
+
+	cam_sync_trace_end("signal_batch", sync_objs[0], num_objs, status,
+		start_ns);
+	return first_rc;
 }
 
 int cam_sync_merge(int32_t *sync_obj, uint32_t num_objs, int32_t *merged_obj)
 {
 	int rc;
 	long idx = 0;
-	bool bit;
 	int i = 0;
+	u64 start_ns = cam_sync_trace_start();
 
 	if (!sync_obj || !merged_obj) {
 		CAM_ERR(CAM_SYNC, "Invalid pointer(s)");
@@ -315,12 +388,8 @@ int cam_sync_merge(int32_t *sync_obj, uint32_t num_objs, int32_t *merged_obj)
 			return rc;
 		}
 	}
-	do {
-		idx = find_first_zero_bit(sync_dev->bitmap, CAM_SYNC_MAX_OBJS);
-		if (idx >= CAM_SYNC_MAX_OBJS)
-			return -ENOMEM;
-		bit = test_and_set_bit(idx, sync_dev->bitmap);
-	} while (bit);
+	if (cam_sync_util_find_and_set_empty_row(sync_dev, &idx))
+		return -ENOMEM;
 
 	spin_lock_bh(&sync_dev->row_spinlocks[idx]);
 	rc = cam_sync_init_group_object(sync_dev->sync_table,
@@ -337,6 +406,7 @@ int cam_sync_merge(int32_t *sync_obj, uint32_t num_objs, int32_t *merged_obj)
 	*merged_obj = idx;
 	spin_unlock_bh(&sync_dev->row_spinlocks[idx]);
 
+	cam_sync_trace_end("merge", *merged_obj, num_objs, 0, start_ns);
 	return 0;
 }
 
@@ -382,8 +452,14 @@ int cam_sync_put_obj_ref(int32_t sync_obj)
 
 int cam_sync_destroy(int32_t sync_obj)
 {
+	u64 start_ns = cam_sync_trace_start();
+	int rc;
+
 	CAM_DBG(CAM_SYNC, "sync_obj: %i", sync_obj);
-	return cam_sync_deinit_object(sync_dev->sync_table, sync_obj);
+	rc = cam_sync_deinit_object(sync_dev->sync_table, sync_obj);
+
+	cam_sync_trace_end("destroy", sync_obj, 1, 0, start_ns);
+	return rc;
 }
 
 int cam_sync_check_valid(int32_t sync_obj)
@@ -81,6 +81,24 @@ int cam_sync_deregister_callback(sync_callback cb_func,
  */
 int cam_sync_signal(int32_t sync_obj, uint32_t status);
 
+/**
+ * @brief: Signals an array of sync objects with the same status
+ *
+ * Equivalent to calling cam_sync_signal() for each object, except that a
+ * group object merged from several of them is updated once for the whole
+ * batch instead of once per child.
+ *
+ * @param sync_objs: Array of sync objects to signal
+ * @param num_objs: Number of entries in sync_objs
+ * @param status: Status of the signaling. Can be either SYNC_SIGNAL_ERROR or
+ * SYNC_SIGNAL_SUCCESS.
+ *
+ * @return Status of operation. First error met, all objects are still
+ * attempted. Zero otherwise.
+ */
+int cam_sync_signal_batch(int32_t *sync_objs, uint32_t num_objs,
+	uint32_t status);
+
 /**
  * @brief: Merges multiple sync objects
  *
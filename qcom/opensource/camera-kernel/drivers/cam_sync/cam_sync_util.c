@@ -9,20 +9,40 @@
 int cam_sync_util_find_and_set_empty_row(struct sync_device *sync_dev,
 	long *idx)
 {
-	int rc = 0;
+	long start, i;
+	bool wrapped = false;
 
-	mutex_lock(&sync_dev->table_lock);
+	/*
+	 * The hint is the row after the last one handed out, or the last
+	 * one released, so creating fences at a high rate does not rescan
+	 * the busy head of the table every time. Row 0 is always set.
+	 */
+	start = READ_ONCE(sync_dev->alloc_hint);
+	if (start <= 0 || start >= CAM_SYNC_MAX_OBJS)
+		start = 1;
+
+	i = start;
+	for (;;) {
+		i = find_next_zero_bit(sync_dev->bitmap, CAM_SYNC_MAX_OBJS, i);
+		if (wrapped && i >= start)
+			return -1;
+
+		if (i >= CAM_SYNC_MAX_OBJS) {
+			wrapped = true;
+			i = 1;
+			continue;
+		}
 
-	*idx = find_first_zero_bit(sync_dev->bitmap, CAM_SYNC_MAX_OBJS);
+		if (!test_and_set_bit(i, sync_dev->bitmap))
+			break;
 
-	if (*idx < CAM_SYNC_MAX_OBJS)
-		set_bit(*idx, sync_dev->bitmap);
-	else
-		rc = -1;
+		i++;
+	}
 
-	mutex_unlock(&sync_dev->table_lock);
+	WRITE_ONCE(sync_dev->alloc_hint, i + 1);
+	*idx = i;
 
-	return rc;
+	return 0;
 }
 
 int cam_sync_init_row(struct sync_table_row *table,
@@ -275,6 +295,7 @@ int cam_sync_deinit_object(struct sync_table_row *table, uint32_t idx)
 
 	memset(row, 0, sizeof(*row));
 	clear_bit(idx, sync_dev->bitmap);
+	WRITE_ONCE(sync_dev->alloc_hint, idx);
 	INIT_LIST_HEAD(&row->callback_list);
 	INIT_LIST_HEAD(&row->parents_list);
 	INIT_LIST_HEAD(&row->children_list);
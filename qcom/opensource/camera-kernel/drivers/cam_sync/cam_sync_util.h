@@ -15,7 +15,7 @@ extern struct sync_device *sync_dev;
 
 /**
  * @brief: Finds an empty row in the sync table and sets its corresponding bit
- * in the bit array
+ * in the bit array. Lockless, the search starts at sync_dev->alloc_hint
  *
  * @param sync_dev : Pointer to the sync device instance
  * @param idx      : Pointer to an long containing the index found in the bit
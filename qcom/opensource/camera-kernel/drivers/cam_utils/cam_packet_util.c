@@ -6,10 +6,43 @@
 
 #include <linux/types.h>
 #include <linux/slab.h>
+#include <linux/module.h>
+#include <linux/timekeeping.h>
 
 #include "cam_mem_mgr.h"
 #include "cam_packet_util.h"
 #include "cam_debug_util.h"
+#include "cam_trace.h"
+
+/* emit a cam_log_event trace with the patch time of every packet */
+static uint patch_profile;
+module_param(patch_profile, uint, 0644);
+
+/*
+ * Distinct src and dst handles remembered while patching one packet. The
+ * cache lives on the ioctl stack, so keep it to a few hundred bytes.
+ */
+#define CAM_PACKET_PATCH_SRC_MAX 8
+#define CAM_PACKET_PATCH_DST_MAX 4
+
+struct cam_packet_patch_src {
+	int32_t    buf_hdl;
+	dma_addr_t iova;
+	size_t     len;
+};
+
+struct cam_packet_patch_dst {
+	int32_t    buf_hdl;
+	uintptr_t  cpu_addr;
+	size_t     len;
+};
+
+struct cam_packet_patch_cache {
+	struct cam_packet_patch_src src[CAM_PACKET_PATCH_SRC_MAX];
+	struct cam_packet_patch_dst dst[CAM_PACKET_PATCH_DST_MAX];
+	uint32_t                    num_src;
+	uint32_t                    num_dst;
+};
 
 int cam_packet_util_get_cmd_mem_addr(int handle, uint32_t **buf_addr,
 	size_t *len)
@@ -217,10 +250,98 @@ void cam_packet_dump_patch_info(struct cam_packet *packet,
 	}
 }
 
+static int cam_packet_util_patch_get_src(
+	struct cam_packet_patch_cache *cache, int32_t buf_hdl,
+	int32_t iommu_hdl, int32_t sec_mmu_hdl,
+	dma_addr_t *iova_addr, size_t *len)
+{
+	struct cam_packet_patch_src *src;
+	int32_t hdl;
+	uint32_t i;
+	int rc;
+
+	for (i = 0; i < cache->num_src; i++) {
+		if (cache->src[i].buf_hdl == buf_hdl) {
+			*iova_addr = cache->src[i].iova;
+			*len = cache->src[i].len;
+			return 0;
+		}
+	}
+
+	hdl = cam_mem_is_secure_buf(buf_hdl) ? sec_mmu_hdl : iommu_hdl;
+	rc = cam_mem_get_io_buf(buf_hdl, hdl, iova_addr, len);
+	if (rc < 0)
+		return rc;
+
+	if (cache->num_src < CAM_PACKET_PATCH_SRC_MAX) {
+		src = &cache->src[cache->num_src++];
+		src->buf_hdl = buf_hdl;
+		src->iova = *iova_addr;
+		src->len = *len;
+	}
+
+	return 0;
+}
+
+/*
+ * A cached dst buffer keeps the reference taken by cam_mem_get_cpu_buf()
+ * until cam_packet_util_patch_put_dst() at the end of the packet. Once the
+ * cache is full, *cached is false and the caller puts the buffer itself.
+ */
+static int cam_packet_util_patch_get_dst(
+	struct cam_packet_patch_cache *cache, int32_t buf_hdl,
+	uintptr_t *cpu_addr, size_t *len, bool *cached)
+{
+	struct cam_packet_patch_dst *dst;
+	uint32_t i;
+	int rc;
+
+	for (i = 0; i < cache->num_dst; i++) {
+		if (cache->dst[i].buf_hdl == buf_hdl) {
+			*cpu_addr = cache->dst[i].cpu_addr;
+			*len = cache->dst[i].len;
+			*cached = true;
+			return 0;
+		}
+	}
+
+	*cached = false;
+	rc = cam_mem_get_cpu_buf(buf_hdl, cpu_addr, len);
+	if (rc < 0)
+		return rc;
+
+	if (!*cpu_addr || !*len) {
+		cam_mem_put_cpu_buf(buf_hdl);
+		return -EINVAL;
+	}
+
+	if (cache->num_dst < CAM_PACKET_PATCH_DST_MAX) {
+		dst = &cache->dst[cache->num_dst++];
+		dst->buf_hdl = buf_hdl;
+		dst->cpu_addr = *cpu_addr;
+		dst->len = *len;
+		*cached = true;
+	}
+
+	return 0;
+}
+
+static void cam_packet_util_patch_put_dst(
+	struct cam_packet_patch_cache *cache)
+{
+	uint32_t i;
+
+	for (i = 0; i < cache->num_dst; i++)
+		cam_mem_put_cpu_buf(cache->dst[i].buf_hdl);
+
+	cache->num_dst = 0;
+}
+
 int cam_packet_util_process_patches(struct cam_packet *packet,
 	int32_t iommu_hdl, int32_t sec_mmu_hdl)
 {
 	struct cam_patch_desc *patch_desc = NULL;
+	struct cam_packet_patch_cache cache;
 	dma_addr_t iova_addr;
 	uintptr_t  cpu_addr = 0;
 	uint32_t   temp;
@@ -228,9 +349,10 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 	uint32_t  *src_buf_iova_addr;
 	size_t     dst_buf_len;
 	size_t     src_buf_size;
+	bool       dst_cached;
+	u64        start_ns = 0;
 	int        i;
 	int        rc = 0;
-	int32_t    hdl;
 
 	/* process patch descriptor */
 	patch_desc = (struct cam_patch_desc *)
@@ -240,23 +362,29 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 			(void *)packet, (void *)patch_desc,
 			sizeof(struct cam_patch_desc));
 
+	if (patch_profile)
+		start_ns = ktime_get_ns();
+
+	cache.num_src = 0;
+	cache.num_dst = 0;
+
 	for (i = 0; i < packet->num_patches; i++) {
-		hdl = cam_mem_is_secure_buf(patch_desc[i].src_buf_hdl) ?
-			sec_mmu_hdl : iommu_hdl;
-		rc = cam_mem_get_io_buf(patch_desc[i].src_buf_hdl,
-			hdl, &iova_addr, &src_buf_size);
+		rc = cam_packet_util_patch_get_src(&cache,
+			patch_desc[i].src_buf_hdl, iommu_hdl, sec_mmu_hdl,
+			&iova_addr, &src_buf_size);
 		if (rc < 0) {
 			CAM_ERR(CAM_UTIL, "unable to get src buf address");
-			return rc;
+			goto end;
 		}
 		src_buf_iova_addr = (uint32_t *)iova_addr;
 		temp = iova_addr;
 
-		rc = cam_mem_get_cpu_buf(patch_desc[i].dst_buf_hdl,
-			&cpu_addr, &dst_buf_len);
-		if (rc < 0 || !cpu_addr || (dst_buf_len == 0)) {
+		rc = cam_packet_util_patch_get_dst(&cache,
+			patch_desc[i].dst_buf_hdl, &cpu_addr, &dst_buf_len,
+			&dst_cached);
+		if (rc < 0) {
 			CAM_ERR(CAM_UTIL, "unable to get dst buf address");
-			return rc;
+			goto end;
 		}
 		dst_cpu_addr = (uint32_t *)cpu_addr;
 
@@ -267,16 +395,20 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 		if ((size_t)patch_desc[i].src_offset >= src_buf_size) {
 			CAM_ERR(CAM_UTIL,
 				"Invalid src buf patch offset");
-			return -EINVAL;
-		}
-
-		if ((dst_buf_len < sizeof(void *)) ||
+			rc = -EINVAL;
+		} else if ((dst_buf_len < sizeof(void *)) ||
 			((dst_buf_len - sizeof(void *)) <
 			(size_t)patch_desc[i].dst_offset)) {
 			CAM_ERR(CAM_UTIL,
 				"Invalid dst buf patch offset");
-			cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
-			return -EINVAL;
+			rc = -EINVAL;
+		}
+
+		if (rc) {
+			if (!dst_cached)
+				cam_mem_put_cpu_buf(
+					(int32_t)patch_desc[i].dst_buf_hdl);
+			goto end;
 		}
 
 		dst_cpu_addr = (uint32_t *)((uint8_t *)dst_cpu_addr +
@@ -289,9 +421,18 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 			"patch is done for dst %pK with src %pK value %llx",
 			dst_cpu_addr, src_buf_iova_addr,
 			*((uint64_t *)dst_cpu_addr));
-		cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
+		if (!dst_cached)
+			cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
 	}
 
+end:
+	cam_packet_util_patch_put_dst(&cache);
+
+	if (patch_profile)
+		trace_cam_log_event("PatchProfile",
+			"patches and time in ns", packet->num_patches,
+			ktime_get_ns() - start_ns);
+
 	return rc;
 }
 
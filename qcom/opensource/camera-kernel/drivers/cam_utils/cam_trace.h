@@ -353,6 +353,31 @@ TRACE_EVENT(cam_cdm_cb,
 	)
 );
 
+TRACE_EVENT(cam_sync_obj,
+	TP_PROTO(const char *op, int32_t sync_obj, uint32_t num_objs,
+		uint32_t status, uint64_t latency_ns),
+	TP_ARGS(op, sync_obj, num_objs, status, latency_ns),
+	TP_STRUCT__entry(
+		__string(op, op)
+		__field(int32_t, sync_obj)
+		__field(uint32_t, num_objs)
+		__field(uint32_t, status)
+		__field(uint64_t, latency_ns)
+	),
+	TP_fast_assign(
+		__assign_str(op, op);
+		__entry->sync_obj = sync_obj;
+		__entry->num_objs = num_objs;
+		__entry->status = status;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk(
+		"SYNC: %s sync_obj=%d num_objs=%u status=%u latency_ns=%llu",
+			__get_str(op), __entry->sync_obj, __entry->num_objs,
+			__entry->status, __entry->latency_ns
+	)
+);
+
 #endif /* _CAM_TRACE_H */
 
 /* This part must be outside protection */
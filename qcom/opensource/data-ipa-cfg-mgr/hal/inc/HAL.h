@@ -169,6 +169,11 @@ public:
             uint64_t /* limitBytes */,
             setDataWarningAndLimit_cb /* hidl_cb */);
 
+    /* IBase, lshal debug: dumps the HAL call log */
+    Return<void> debug(
+            const hidl_handle& /* fd */,
+            const hidl_vec<hidl_string>& /* options */) override;
+
 private:
     typedef struct BoolResult {
         bool success;
@@ -29,45 +29,73 @@
 #ifndef _LOCAL_LOG_BUFFER_H_
 #define _LOCAL_LOG_BUFFER_H_
 /* External Includes */
-#include <deque>
-#include <sstream>
+#include <mutex>
+#include <stdint.h>
 #include <string>
 #include <sys/types.h>
 #include <vector>
 
 /* Namespace pollution avoidance */
-using ::std::deque;
+using ::std::mutex;
 using ::std::string;
-using ::std::stringstream;
 using ::std::vector;
 
 
 class LocalLogBuffer {
 public:
+    /* Fixed size record of one HAL call.  Arguments and results are kept
+     * raw (strings are cut to fit) and only turned into text on dump, so
+     * logging a call does not allocate.
+     */
     class FunctionLog {
     public:
-        FunctionLog(string /* funcName */);
-        FunctionLog(const FunctionLog& /* other */);
-        void addArg(string /* kw */, string /* arg */);
-        void addArg(string /* kw */, vector<string> /* args */);
-        void addArg(string /* kw */, uint64_t /* arg */);
-        void setResult(bool /* success */, string /* msg */);
-        void setResult(vector<unsigned int> /* ret */);
+        FunctionLog(const char* /* funcName */);
+        void addArg(const char* /* kw */, const char* /* arg */);
+        void addArg(const char* /* kw */, const string& /* arg */);
+        void addArg(const char* /* kw */, const vector<string>& /* args */);
+        void addArg(const char* /* kw */, uint64_t /* arg */);
+        void setResult(bool /* success */, const string& /* msg */);
+        void setResult(const vector<unsigned int>& /* ret */);
         void setResult(uint64_t /* rx */, uint64_t /* tx */);
-        string toString();
+        string toString() const;
     private:
-        void maybeAddArgsComma();
-        const string mName;
-        bool mArgsProvided;
-        stringstream mSSArgs;
-        stringstream mSSReturn;
+        static const size_t MAX_ARGS = 4;
+        static const size_t MAX_RET = 4;
+        static const size_t STR_LEN = 64;
+
+        enum ArgType { ARG_STR, ARG_U64 };
+        enum RetType { RET_NONE, RET_BOOL, RET_VEC, RET_RXTX };
+
+        struct Arg {
+            const char* kw;
+            ArgType type;
+            uint64_t u64;
+            char str[STR_LEN];
+        };
+
+        Arg* nextArg(const char* /* kw */);
+        static size_t append(char* /* dst */, size_t /* off */, const char* /* src */);
+
+        const char* mName;
+        size_t mNumArgs;
+        Arg mArgs[MAX_ARGS];
+        RetType mRetType;
+        bool mSuccess;
+        size_t mNumRet;
+        uint64_t mRet[MAX_RET];
+        char mMsg[STR_LEN];
     }; /* FunctionLog */
     LocalLogBuffer(string /* name */, int /* maxLogs */);
-    void addLog(FunctionLog /* log */);
+    void addLog(const FunctionLog& /* log */);
     void toLogcat();
+    void toFd(int /* fd */);
 private:
-    deque<FunctionLog> mLogs;
+    /* Ring of mMaxLogs records, allocated once */
+    vector<FunctionLog> mLogs;
+    size_t mNext;
+    size_t mCount;
+    mutex mLock;
     const string mName;
     const size_t mMaxLogs;
 }; /* LocalLogBuffer */
-#endif /* _LOCAL_LOG_BUFFER_H_ */
\ No newline at end of file
+#endif /* _LOCAL_LOG_BUFFER_H_ */
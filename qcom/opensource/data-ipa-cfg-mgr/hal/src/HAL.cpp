@@ -446,7 +446,7 @@ Return<void> HAL::getForwardedStats
     getForwardedStats_cb hidl_cb
 ) {
     LocalLogBuffer::FunctionLog fl(__func__);
-    fl.addArg("upstream", upstream);
+    fl.addArg("upstream", upstream.c_str());
 
     OffloadStatistics ret;
     RET ipaReturn = mIPA->getStats(upstream.c_str(), true, ret);
@@ -477,7 +477,7 @@ Return<void> HAL::setDataLimit
     setDataLimit_cb hidl_cb
 ) {
     LocalLogBuffer::FunctionLog fl(__func__);
-    fl.addArg("upstream", upstream);
+    fl.addArg("upstream", upstream.c_str());
     fl.addArg("limit", limit);
 
     if (!isInitialized()) {
@@ -509,9 +509,9 @@ Return<void> HAL::setUpstreamParameters
     vector<string> v6GwStrs = convertHidlStrToStdStr(v6Gws);
 
     LocalLogBuffer::FunctionLog fl(__func__);
-    fl.addArg("iface", iface);
-    fl.addArg("v4Addr", v4Addr);
-    fl.addArg("v4Gw", v4Gw);
+    fl.addArg("iface", iface.c_str());
+    fl.addArg("v4Addr", v4Addr.c_str());
+    fl.addArg("v4Gw", v4Gw.c_str());
     fl.addArg("v6Gws", v6GwStrs);
 
     PrefixParser v4AddrParser;
@@ -568,8 +568,8 @@ Return<void> HAL::addDownstream
     addDownstream_cb hidl_cb
 ) {
     LocalLogBuffer::FunctionLog fl(__func__);
-    fl.addArg("iface", iface);
-    fl.addArg("prefix", prefix);
+    fl.addArg("iface", iface.c_str());
+    fl.addArg("prefix", prefix.c_str());
 
     PrefixParser prefixParser;
 
@@ -602,8 +602,8 @@ Return<void> HAL::removeDownstream
     removeDownstream_cb hidl_cb
 ) {
     LocalLogBuffer::FunctionLog fl(__func__);
-    fl.addArg("iface", iface);
-    fl.addArg("prefix", prefix);
+    fl.addArg("iface", iface.c_str());
+    fl.addArg("prefix", prefix.c_str());
 
     PrefixParser prefixParser;
 
@@ -637,7 +637,7 @@ Return<void> HAL::setDataWarningAndLimit
     setDataWarningAndLimit_cb hidl_cb
 ) {
     LocalLogBuffer::FunctionLog fl(__func__);
-    fl.addArg("upstream", upstream);
+    fl.addArg("upstream", upstream.c_str());
     fl.addArg("warningBytes", warningBytes);
     fl.addArg("limitBytes", limitBytes);
 
@@ -659,3 +659,19 @@ Return<void> HAL::setDataWarningAndLimit
     mLogs.addLog(fl);
     return Void();
 } /* setDataWarningAndLimit */
+
+/* ------------------------------- IBase ------------------------------------ */
+Return<void> HAL::debug
+(
+    const hidl_handle& fd,
+    const hidl_vec<hidl_string>& /* options */
+) {
+    if (fd == nullptr || fd->numFds < 1) {
+        ALOGE("debug() needs a file descriptor");
+        return Void();
+    }
+
+    /* The call log is only formatted here */
+    mLogs.toFd(fd->data[0]);
+    return Void();
+} /* debug */
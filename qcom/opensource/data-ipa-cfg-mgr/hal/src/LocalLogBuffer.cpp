@@ -30,7 +30,9 @@
 
 /* External Includes */
 #include <cutils/log.h>
-#include <deque>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
 #include <string>
 #include <sys/types.h>
 #include <vector>
@@ -39,88 +41,174 @@
 #include "LocalLogBuffer.h"
 
 /* Namespace pollution avoidance */
-using ::std::deque;
+using ::std::lock_guard;
 using ::std::string;
 using ::std::vector;
 
 
-LocalLogBuffer::FunctionLog::FunctionLog(string funcName) : mName(funcName) {
-    mArgsProvided = false;
+LocalLogBuffer::FunctionLog::FunctionLog(const char* funcName) : mName(funcName) {
+    mNumArgs = 0;
+    mRetType = RET_NONE;
+    mSuccess = false;
+    mNumRet = 0;
+    mMsg[0] = '\0';
 } /* FunctionLog */
 
-LocalLogBuffer::FunctionLog::FunctionLog(const FunctionLog& other) :
-        mName(other.mName) {
-    mArgsProvided = other.mArgsProvided;
-    /* Is this right? How do you copy stringstreams without wizardry? */
-    mSSArgs.str(other.mSSArgs.str());
-    mSSReturn.str(other.mSSReturn.str());
-} /* FunctionLog */
+/* Copy as much of src as fits after off, returns the new end */
+size_t LocalLogBuffer::FunctionLog::append(char* dst, size_t off, const char* src) {
+    size_t len = strnlen(src, STR_LEN);
+
+    if (off + len >= STR_LEN) {
+        len = STR_LEN - 1 - off;
+        memcpy(dst + off, src, len);
+        /* mark the cut */
+        if (len >= 3)
+            memcpy(dst + STR_LEN - 4, "...", 3);
+    } else {
+        memcpy(dst + off, src, len);
+    }
+    dst[off + len] = '\0';
+    return off + len;
+} /* append */
+
+LocalLogBuffer::FunctionLog::Arg* LocalLogBuffer::FunctionLog::nextArg(const char* kw) {
+    if (mNumArgs >= MAX_ARGS)
+        return nullptr;
+    Arg* arg = &mArgs[mNumArgs++];
+    arg->kw = kw;
+    arg->str[0] = '\0';
+    return arg;
+} /* nextArg */
+
+void LocalLogBuffer::FunctionLog::addArg(const char* kw, const char* arg) {
+    Arg* a = nextArg(kw);
+    if (a == nullptr)
+        return;
+    a->type = ARG_STR;
+    append(a->str, 0, arg);
+} /* addArg */
 
-void LocalLogBuffer::FunctionLog::addArg(string kw, string arg) {
-    maybeAddArgsComma();
-    mSSArgs << kw << "=" << arg;
+void LocalLogBuffer::FunctionLog::addArg(const char* kw, const string& arg) {
+    addArg(kw, arg.c_str());
 } /* addArg */
 
-void LocalLogBuffer::FunctionLog::addArg(string kw, vector<string> args) {
-    maybeAddArgsComma();
-    mSSArgs << kw << "=[";
-    for (size_t i = 0; i < args.size(); i++) {
-        mSSArgs << args[i];
+void LocalLogBuffer::FunctionLog::addArg(const char* kw, const vector<string>& args) {
+    Arg* a = nextArg(kw);
+    if (a == nullptr)
+        return;
+    a->type = ARG_STR;
+    size_t off = append(a->str, 0, "[");
+    for (size_t i = 0; i < args.size() && off < STR_LEN - 1; i++) {
+        off = append(a->str, off, args[i].c_str());
         if (i < (args.size() - 1))
-            mSSArgs << ", ";
+            off = append(a->str, off, ", ");
     }
-    mSSArgs << "]";
+    append(a->str, off, "]");
 } /* addArg */
 
-void LocalLogBuffer::FunctionLog::addArg(string kw, uint64_t arg) {
-    maybeAddArgsComma();
-    mSSArgs << kw << "=" << arg;
+void LocalLogBuffer::FunctionLog::addArg(const char* kw, uint64_t arg) {
+    Arg* a = nextArg(kw);
+    if (a == nullptr)
+        return;
+    a->type = ARG_U64;
+    a->u64 = arg;
 } /* addArg */
 
-void LocalLogBuffer::FunctionLog::maybeAddArgsComma() {
-    if (!mArgsProvided) {
-        mArgsProvided = true;
-    } else {
-        mSSArgs << ", ";
-    }
-} /* maybeAddArgsComma */
-
-void LocalLogBuffer::FunctionLog::setResult(bool success, string msg) {
-    mSSReturn << "[" << ((success) ? "success" : "failure") << ", " << msg
-              << "]";
+void LocalLogBuffer::FunctionLog::setResult(bool success, const string& msg) {
+    mRetType = RET_BOOL;
+    mSuccess = success;
+    append(mMsg, 0, msg.c_str());
 } /* setResult */
 
-void LocalLogBuffer::FunctionLog::setResult(vector<unsigned int> ret) {
-    mSSReturn << "[";
-    for (size_t i = 0; i < ret.size(); i++) {
-        mSSReturn << ret[i];
-        if (i < (ret.size() - 1))
-            mSSReturn << ", ";
-    }
-    mSSReturn << "]";
+void LocalLogBuffer::FunctionLog::setResult(const vector<unsigned int>& ret) {
+    mRetType = RET_VEC;
+    mNumRet = (ret.size() < MAX_RET) ? ret.size() : MAX_RET;
+    for (size_t i = 0; i < mNumRet; i++)
+        mRet[i] = ret[i];
 } /* setResult */
 
 void LocalLogBuffer::FunctionLog::setResult(uint64_t rx, uint64_t tx) {
-    mSSReturn << "[rx=" << rx << ", tx=" << tx << "]";
+    mRetType = RET_RXTX;
+    mNumRet = 2;
+    mRet[0] = rx;
+    mRet[1] = tx;
 } /* setResult */
 
-string LocalLogBuffer::FunctionLog::toString() {
-    stringstream ret;
-    ret << mName << "(" << mSSArgs.str() << ") returned " << mSSReturn.str();
-    return ret.str();
+string LocalLogBuffer::FunctionLog::toString() const {
+    char num[24];
+    string ret(mName);
+
+    ret += "(";
+    for (size_t i = 0; i < mNumArgs; i++) {
+        if (i > 0)
+            ret += ", ";
+        ret += mArgs[i].kw;
+        ret += "=";
+        if (mArgs[i].type == ARG_U64) {
+            snprintf(num, sizeof(num), "%" PRIu64, mArgs[i].u64);
+            ret += num;
+        } else {
+            ret += mArgs[i].str;
+        }
+    }
+    ret += ") returned ";
+
+    switch (mRetType) {
+        case RET_BOOL:
+            ret += (mSuccess) ? "[success, " : "[failure, ";
+            ret += mMsg;
+            ret += "]";
+            break;
+        case RET_VEC:
+            ret += "[";
+            for (size_t i = 0; i < mNumRet; i++) {
+                snprintf(num, sizeof(num), "%" PRIu64, mRet[i]);
+                ret += num;
+                if (i < (mNumRet - 1))
+                    ret += ", ";
+            }
+            ret += "]";
+            break;
+        case RET_RXTX:
+            snprintf(num, sizeof(num), "%" PRIu64, mRet[0]);
+            ret += "[rx=";
+            ret += num;
+            snprintf(num, sizeof(num), "%" PRIu64, mRet[1]);
+            ret += ", tx=";
+            ret += num;
+            ret += "]";
+            break;
+        case RET_NONE:
+            break;
+    }
+    return ret;
 } /* toString */
 
-LocalLogBuffer::LocalLogBuffer(string name, int maxLogs) : mName(name),
-        mMaxLogs(maxLogs) {
+LocalLogBuffer::LocalLogBuffer(string name, int maxLogs) :
+        mLogs((maxLogs > 0) ? maxLogs : 1, FunctionLog("")), mNext(0), mCount(0),
+        mName(name), mMaxLogs((maxLogs > 0) ? maxLogs : 1) {
 } /* LocalLogBuffer */
 
-void LocalLogBuffer::addLog(FunctionLog log) {
-    while (mLogs.size() > mMaxLogs)
-        mLogs.pop_front();
-    mLogs.push_back(log);
+void LocalLogBuffer::addLog(const FunctionLog& log) {
+    lock_guard<mutex> lock(mLock);
+    mLogs[mNext] = log;
+    mNext = (mNext + 1) % mMaxLogs;
+    if (mCount < mMaxLogs)
+        mCount++;
 } /* addLog */
 
 void LocalLogBuffer::toLogcat() {
-    for (size_t i = 0; i < mLogs.size(); i++)
-        ALOGD("%s: %s", mName.c_str(), mLogs[i].toString().c_str());
+    lock_guard<mutex> lock(mLock);
+    size_t first = (mNext + mMaxLogs - mCount) % mMaxLogs;
+    for (size_t i = 0; i < mCount; i++)
+        ALOGD("%s: %s", mName.c_str(),
+                mLogs[(first + i) % mMaxLogs].toString().c_str());
 } /* toLogcat */
+
+void LocalLogBuffer::toFd(int fd) {
+    lock_guard<mutex> lock(mLock);
+    size_t first = (mNext + mMaxLogs - mCount) % mMaxLogs;
+    dprintf(fd, "%s (last %zu of %zu):\n", mName.c_str(), mCount, mMaxLogs);
+    for (size_t i = 0; i < mCount; i++)
+        dprintf(fd, "  %s\n", mLogs[(first + i) % mMaxLogs].toString().c_str());
+} /* toFd */
@@ -40,6 +40,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IPA_CONNTRACK_MESSAGE_H
 
 #include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
 #include "IPACM_Defs.h"
 
 
@@ -60,6 +62,23 @@ typedef struct cmd_s
 	ipacm_cmd_q_data data;
 }cmd_t;
 
+/* Number of preallocated message slots per queue, must be a power of 2 */
+#define IPACM_CMDQ_RING_SIZE 1024
+/* Number of log2(usec) buckets of the enqueue-to-callback latency histogram */
+#define IPACM_CMDQ_LAT_BUCKETS 24
+/* Number of processed events between two queue statistics reports */
+#define IPACM_CMDQ_STATS_INTERVAL 4096
+
+/* Preallocated ring slot, seq implements the per-slot handoff between
+ * producers and the consumer (bounded MPSC ring). */
+typedef struct _ipacm_cmdq_slot
+{
+	uint32_t seq;
+	cmd_t evt;
+	uint64_t enq_ts_us;
+} ipacm_cmdq_slot;
+
+/* Overflow list node, only used once the ring is full */
 class Message
 {
 private:
@@ -67,37 +86,60 @@ private:
 
 public:
 	cmd_t evt;
+	uint64_t enq_ts_us;
 
 	Message()
 	{
 		m_next = NULL;
 		evt.callback_ptr = NULL;
+		enq_ts_us = 0;
 	}
 	~Message() { }
 	void setnext(Message *item) { m_next = item; }
 	Message* getnext()       { return m_next; }
 };
 
+typedef struct _ipacm_cmdq_stats
+{
+	uint64_t events;
+	uint32_t overflow;
+	uint64_t window_start_us;
+	uint32_t lat_hist[IPACM_CMDQ_LAT_BUCKETS];
+} ipacm_cmdq_stats;
+
 class MessageQueue
 {
 
 private:
+	/* bounded MPSC ring, producers claim slots with CAS on tail */
+	ipacm_cmdq_slot ring[IPACM_CMDQ_RING_SIZE];
+	uint32_t ring_head;
+	uint32_t ring_tail;
+
+	/* fallback when ring is full, guarded by overflow_lock */
+	pthread_mutex_t overflow_lock;
 	Message *Head;
 	Message *Tail;
-	Message* dequeue(void);
+	uint32_t overflow_cnt;
+
+	bool dequeue(cmd_t *evt, uint64_t *enq_ts_us);
+	bool ring_enqueue(const cmd_t *evt, uint64_t ts);
+	bool ring_dequeue(cmd_t *evt, uint64_t *enq_ts_us);
+	bool overflow_enqueue(const cmd_t *evt, uint64_t ts);
+	bool overflow_dequeue(cmd_t *evt, uint64_t *enq_ts_us);
+
 	static MessageQueue *inst_internal;
 	static MessageQueue *inst_external;
 
-	MessageQueue()
-	{
-		Head = NULL;
-		Tail = NULL;
-	}
+	static uint64_t now_us(void);
+	static void update_stats(uint64_t enq_ts_us);
+
+	MessageQueue();
 
 public:
 
 	~MessageQueue() { }
-	void enqueue(Message *item);
+	int enqueue(const cmd_t *evt);
 
 	static void* Process(void *);
 	static MessageQueue* getInstanceInternal();
@@ -42,6 +42,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "IPACM_Conntrack_NATApp.h"
 #include "IPACM_EvtDispatcher.h"
 #include "IPACM_Defs.h"
+#include "IPACM_ConntrackFilter.h"
 
 #ifndef IPACM_DEBUG
 #define IPACM_DEBUG
@@ -57,8 +58,20 @@ extern "C"
 using namespace std;
 
 #define UDP_TIMEOUT_UPDATE 20
+/* log the NAT hash histograms every this many UDP timestamp updates */
+#define NAT_HASH_STATS_CYCLES 15
 #define BROADCAST_IPV4_ADDR 0xFFFFFFFF
 
+/* conntrack events which passed the socket filters, and how many of
+   those the NAT path still ignored */
+typedef struct
+{
+	uint32_t tcp_received;
+	uint32_t udp_received;
+	uint32_t ignored;
+	uint32_t filter_updates;
+} ipacm_ct_evt_stats;
+
 class IPACM_ConntrackClient
 {
 
@@ -67,11 +80,15 @@ private:
 
    struct nfct_handle *tcp_hdl;
    struct nfct_handle *udp_hdl;
-   struct nfct_filter *tcp_filter;
-   struct nfct_filter *udp_filter;
-   static int IPA_Conntrack_Filters_Ignore_Local_Addrs(struct nfct_filter *filter);
-   static int IPA_Conntrack_Filters_Ignore_Bridge_Addrs(struct nfct_filter *filter);
-   static int IPA_Conntrack_Filters_Ignore_Local_Iface(struct nfct_filter *, ipacm_event_iface_up *);
+   /* shared by the tcp and udp sockets, each gets its own program */
+   IPACM_ConntrackFilter ct_filter;
+   pthread_mutex_t ct_filter_lock;
+   bool ct_filter_local_added;
+   static int IPA_Conntrack_Filters_Ignore_Local_Addrs(IPACM_ConntrackFilter *filter);
+   static int IPA_Conntrack_Filters_Ignore_Bridge_Addrs(IPACM_ConntrackFilter *filter);
+   static int IPA_Conntrack_Filters_Ignore_Local_Iface(IPACM_ConntrackFilter *, ipacm_event_iface_up *);
+   static int IPA_Conntrack_Filter_Attach(struct nfct_handle *hdl, uint8_t l4proto);
+   static void UpdateFilters(struct nfct_handle *hdl, uint8_t l4proto, void *param, bool isWan);
    IPACM_ConntrackClient();
 
 public:
@@ -92,6 +109,7 @@ public:
    static IPACM_ConntrackClient* GetInstance();
 
    static void UNRegisterWithConnTrack(void);
+   static ipacm_ct_evt_stats ct_stats;
    int fd_tcp;
    int fd_udp;
 
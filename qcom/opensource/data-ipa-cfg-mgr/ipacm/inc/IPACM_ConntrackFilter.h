@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_ConntrackFilter.h
+
+	@brief
+	This file declares the socket filter of the conntrack event sockets. It
+	drops, in the kernel, the conntrack events the NAT path would discard
+	after copying them to user space.
+
+*/
+#ifndef IPACM_CONNTRACK_FILTER_BPF_H
+#define IPACM_CONNTRACK_FILTER_BPF_H
+
+#include <stdint.h>
+#include <linux/filter.h>
+#include "IPACM_Xml.h"
+
+#define IPACM_CT_FLT_MAX_ADDRS 64
+#define IPACM_CT_FLT_MAX_INSNS 512
+
+class IPACM_ConntrackFilter
+{
+public:
+	IPACM_ConntrackFilter();
+
+	/* ignore connections to/from a local interface and to its broadcast address */
+	void IgnoreLocalIface(uint32_t ipv4_addr, uint32_t addr_mask);
+
+	/* ignore connections to/from ipv4_addr */
+	void IgnoreAddr(uint32_t ipv4_addr);
+
+	/* with a WAN address set, only connections that are NATed or
+	 * originate from/terminate at the WAN address pass, 0 disables */
+	void SetWanAddr(uint32_t ipv4_addr);
+
+	void SetAlgPorts(const ipacm_alg *ports, int cnt);
+
+	/* build the program for l4proto (tcp states are fixed) and attach it to fd */
+	int Attach(int fd, uint8_t l4proto);
+
+	/* build only, returns the number of instructions or -1 */
+	int Build(uint8_t l4proto, struct sock_filter *code, int max);
+
+private:
+	uint32_t ignore_src[IPACM_CT_FLT_MAX_ADDRS];
+	int num_ignore_src;
+	uint32_t ignore_dst[IPACM_CT_FLT_MAX_ADDRS];
+	int num_ignore_dst;
+	uint32_t wan_addr;
+	ipacm_alg alg_ports[IPA_MAX_ALG_ENTRIES];
+	int num_alg_ports;
+
+	static void AddUnique(uint32_t *list, int *cnt, uint32_t addr);
+};
+
+#endif /* IPACM_CONNTRACK_FILTER_BPF_H */
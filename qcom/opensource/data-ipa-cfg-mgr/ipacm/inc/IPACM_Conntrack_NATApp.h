@@ -31,6 +31,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>  /* for stderror */
 #include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
 #include <cstdio>  /* for perror */
 
 #include "IPACM_Config.h"
@@ -44,6 +46,14 @@ extern "C"
 
 #define MAX_TEMP_ENTRIES 25
 
+/* Number of per-client (private ip) buckets of the nat cache, power of 2 */
+#define NAT_CLNT_BUCKETS 256
+#define NAT_SLOT_NONE (-1)
+
+/* Rule adds/deletes per NAT DMA commit and the longest one may wait */
+#define NAT_BATCH_MAX_RULES 9
+#define NAT_BATCH_MAX_DELAY_MS 5
+
 #define IPACM_TCP_FULL_FILE_NAME  "/proc/sys/net/ipv4/netfilter/ip_conntrack_tcp_timeout_established"
 #define IPACM_UDP_FULL_FILE_NAME   "/proc/sys/net/ipv4/netfilter/ip_conntrack_udp_timeout_stream"
 
@@ -79,6 +89,18 @@ private:
 
 	nat_table_entry *cache;
 	nat_table_entry temp[MAX_TEMP_ENTRIES];
+
+	/* open addressing (linear probing) index of cache slots on the 5-tuple */
+	int32_t *hash_tbl;
+	uint32_t hash_mask;
+	/* cache slot permutation, slot_order[0..curCnt-1] are in use */
+	int32_t *slot_order;
+	int32_t *slot_pos;
+	/* per-client lists of cache slots, hashed on private ip */
+	int32_t clnt_head[NAT_CLNT_BUCKETS];
+	int32_t *clnt_next;
+	int32_t *clnt_prev;
+
 	uint32_t pub_ip_addr;
 	uint32_t pub_ip_addr_pre;
 	uint32_t nat_table_hdl;
@@ -87,6 +109,9 @@ private:
 
 	int curCnt, max_entries;
 
+	/* cmdq and the udp timeout thread both change cache and its indexes */
+	pthread_mutex_t cache_lock;
+
 	const char* mem_type;
 
 	ipacm_alg *pALGPorts;
@@ -108,10 +133,16 @@ private:
 
 	void UpdateCTUdpTs(nat_table_entry *, uint32_t);
 	bool ChkForDup(const nat_table_entry *);
+	static uint32_t HashTuple(const nat_table_entry *);
+	static uint32_t HashClnt(uint32_t);
+	int FindEntry(const nat_table_entry *);
+	int AllocEntry(const nat_table_entry *);
+	void FreeEntry(int);
 	bool isAlgPort(uint8_t, uint16_t);
 	void Reset();
 	bool isPwrSaveIf(uint32_t);
 	uint32_t GenerateMetdata(uint8_t mux_id);
+	static void DumpHashHist(const char *, const uint32_t *);
 
 public:
 	static NatApp* GetInstance();
@@ -128,6 +159,7 @@ public:
 	int DelConnection(const uint32_t);
 
 	void UpdateUDPTimeStamp();
+	void DumpHashStats();
 
 	int UpdatePwrSaveIf(uint32_t);
 	int ResetPwrSaveIf(uint32_t);
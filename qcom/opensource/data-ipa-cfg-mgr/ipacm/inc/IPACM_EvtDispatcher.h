@@ -49,11 +49,21 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 typedef struct _cmd_evts
 {
 	ipa_cm_event_id event;
-	IPACM_Listener *obj;
+	IPACM_Listener *obj; /* NULL once deregistered during dispatch */
 	//int ipa_interface_index;
 	_cmd_evts *next;
 }  cmd_evts;
 
+/* Per-event subscriber list, indexed by ipa_cm_event_id */
+typedef struct _cmd_evts_list
+{
+	cmd_evts *head;
+	cmd_evts *tail;
+}  cmd_evts_list;
+
+/* Callbacks slower than this are reported with the listener pointer */
+#define IPACM_EVT_SLOW_DISPATCH_US 10000
+
 
 
 class IPACM_EvtDispatcher
@@ -70,7 +80,12 @@ public:
 	static void ProcessEvt(ipacm_cmd_q_data *);
 
 private:
-	static cmd_evts *head;
+	static cmd_evts_list subscribers[IPACM_EVENT_MAX];
+	/* nesting level of ProcessEvt, nodes are only freed at level 0 */
+	static int dispatch_depth;
+	static bool has_stale;
+
+	static void purge_stale(void);
 };
 
 #endif /* IPACM_EvtDispatcher_H */
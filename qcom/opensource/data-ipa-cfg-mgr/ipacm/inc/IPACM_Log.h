@@ -47,6 +47,7 @@ extern "C"
 #endif
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <syslog.h>
 
@@ -55,8 +56,10 @@ extern "C"
 #ifdef FEATURE_IPA_ANDROID
 #include <android/log.h>
 #define IPACMLOG_FILE "/dev/socket/ipacm_log_file"
+#define IPACMLOG_RING_FILE "/data/vendor/ipa/ipacm_log_ring"
 #else/* defined(FEATURE_IPA_ANDROID) */
 #define IPACMLOG_FILE "/etc/ipacm_log_file"
+#define IPACMLOG_RING_FILE "/etc/ipacm_log_ring"
 #endif /* defined(NOT FEATURE_IPA_ANDROID)*/
 
 typedef struct ipacm_log_buffer_s {
@@ -65,45 +68,110 @@ typedef struct ipacm_log_buffer_s {
 
 void ipacm_log_send( void * user_data);
 
-static char buffer_send[MAX_BUF_LEN];
-static char dmesg_cmd[MAX_BUF_LEN];
+/*
+ * Binary log ring, a file mapped by ipacm and by ipacm_log_reader.
+ *
+ * Each IPACMERR/IPACMDBG_H call site registers its prefix, location and
+ * format once in the format table. After that a log call only copies the
+ * format id, a timestamp and the raw arguments into the ring. The reader
+ * formats the records. When the ring is full the record is dropped and
+ * counted, producers never wait for the reader.
+ */
+#define IPACM_LOG_RING_MAGIC     0x49504c52 /* "IPLR" */
+#define IPACM_LOG_RING_VERSION   1
+#define IPACM_LOG_RING_SIZE      (256 * 1024) /* record area, power of 2 */
+#define IPACM_LOG_RING_MAX_FMT   4096
+#define IPACM_LOG_RING_HEAP_SIZE (384 * 1024) /* format and location strings */
+#define IPACM_LOG_RING_MAX_ARGS  12
+#define IPACM_LOG_RING_MAX_STR   64 /* longer %s arguments are cut */
+#define IPACM_LOG_RING_PAD       0x80000000 /* record len flag, skip to wrap */
+
+/* values of a call site's format id before/without registration */
+#define IPACM_LOG_RING_UNREGISTERED (-1)
+#define IPACM_LOG_RING_TEXT         (-2) /* not encodable, use ipacm_log_send */
+
+typedef enum
+{
+	IPACM_LOG_ARG_INT = 1,
+	IPACM_LOG_ARG_LONG,
+	IPACM_LOG_ARG_LLONG,
+	IPACM_LOG_ARG_PTR,
+	IPACM_LOG_ARG_DBL,
+	IPACM_LOG_ARG_STR /* 8 byte length, then the bytes padded to 8 */
+} ipacm_log_arg_kind;
+
+typedef struct
+{
+	uint32_t valid;
+	uint32_t line;
+	uint32_t file_off; /* into the string heap */
+	uint32_t func_off;
+	uint32_t fmt_off;  /* prefix and format */
+	uint8_t nargs;
+	uint8_t kind[IPACM_LOG_RING_MAX_ARGS];
+	uint8_t reserved[3];
+} ipacm_log_ring_fmt_t;
+
+typedef struct
+{
+	uint32_t len;    /* 0 until the record is complete */
+	uint32_t fmt_id;
+	uint64_t ts_ns;  /* CLOCK_MONOTONIC */
+	uint64_t args[];
+} ipacm_log_ring_rec_t;
 
-#define IPACMDBG_DMESG(fmt, ...) memset(buffer_send, 0, MAX_BUF_LEN);\
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ring_size;
+	uint32_t max_fmt;
+	uint32_t heap_size;
+	uint32_t fmt_count;
+	uint32_t heap_used;
+	uint32_t reserved;
+	uint64_t head;    /* reserved by producers */
+	uint64_t tail;    /* consumed by the reader */
+	uint64_t dropped; /* records lost to a full ring */
+} ipacm_log_ring_hdr_t;
+
+/* map (create) the ring file, done lazily on the first log call */
+int ipacm_log_ring_init(const char *path, int create);
+ipacm_log_ring_hdr_t *ipacm_log_ring_get(void);
+void ipacm_log_ring_write(int *fmt_id, const char *prefix, const char *file,
+	int line, const char *func, const char *fmt, ...)
+	__attribute__((format(printf, 6, 7)));
+/* format and consume the pending records, returns how many */
+int ipacm_log_ring_drain(ipacm_log_ring_hdr_t *ring, FILE *out);
+
+#define IPACM_LOG_RING(prefix, fmt, ...) { \
+		static int ipacm_log_fmt_id = IPACM_LOG_RING_UNREGISTERED; \
+		ipacm_log_ring_write(&ipacm_log_fmt_id, prefix, __FILE__, __LINE__, __FUNCTION__, fmt, ##__VA_ARGS__); \
+	}
+
+#define IPACMDBG_DMESG(fmt, ...) { char buffer_send[MAX_BUF_LEN], dmesg_cmd[MAX_BUF_LEN];\
+								 memset(buffer_send, 0, MAX_BUF_LEN);\
 								 snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s: " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
 								 ipacm_log_send (buffer_send);\
 								 printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
 								 memset(dmesg_cmd, 0, MAX_BUF_LEN);\
 								 snprintf(dmesg_cmd, MAX_BUF_LEN, "echo %s > /dev/kmsg", buffer_send);\
-								 system(dmesg_cmd);
+								 system(dmesg_cmd); }
 #ifdef DEBUG
-#define PERROR_LOG(fmt)   memset(buffer_send, 0, MAX_BUF_LEN);\
-					  snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s()", __FILE__, __LINE__, __FUNCTION__);\
-					  ipacm_log_send (buffer_send); \
+#define PERROR_LOG(fmt)   IPACM_LOG_RING("", "%s", fmt); \
                       perror(fmt); \
 					__android_log_print(ANDROID_LOG_ERROR, "IPACM", fmt);
 
-#define IPACMERR_LOG(fmt, ...)	memset(buffer_send, 0, MAX_BUF_LEN);\
-							snprintf(buffer_send,MAX_BUF_LEN,"ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-							ipacm_log_send (buffer_send);\
-							printf("ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+#define IPACMERR_LOG(fmt, ...)	IPACM_LOG_RING("ERROR: ", fmt, ##__VA_ARGS__);\
 						__android_log_print(ANDROID_LOG_ERROR, "IPACM", "ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
-#define IPACMDBG_H_LOG(fmt, ...) memset(buffer_send, 0, MAX_BUF_LEN);\
-							 snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-							 ipacm_log_send (buffer_send);\
-							 printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+#define IPACMDBG_H_LOG(fmt, ...) IPACM_LOG_RING("", fmt, ##__VA_ARGS__);\
 					__android_log_print(ANDROID_LOG_DEBUG, "IPACM","%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
-#define PERROR(fmt)   memset(buffer_send, 0, MAX_BUF_LEN);\
-					  snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s()", __FILE__, __LINE__, __FUNCTION__);\
-					  ipacm_log_send (buffer_send); \
+#define PERROR(fmt)   IPACM_LOG_RING("", "%s", fmt); \
                       perror(fmt);
-#define IPACMERR(fmt, ...)	memset(buffer_send, 0, MAX_BUF_LEN);\
-							snprintf(buffer_send,MAX_BUF_LEN,"ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-							ipacm_log_send (buffer_send);\
-							printf("ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
-#define IPACMDBG_H(fmt, ...) memset(buffer_send, 0, MAX_BUF_LEN);\
-							 snprintf(buffer_send,MAX_BUF_LEN,"%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);\
-							 ipacm_log_send (buffer_send);\
-							 printf("%s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+/* ipacm_log_reader formats the ring, errors also go to logcat */
+#define IPACMERR(fmt, ...)	IPACM_LOG_RING("ERROR: ", fmt, ##__VA_ARGS__);\
+						__android_log_print(ANDROID_LOG_ERROR, "IPACM", "ERROR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
+#define IPACMDBG_H(fmt, ...) IPACM_LOG_RING("", fmt, ##__VA_ARGS__);
 #else
 #define PERROR(fmt)   perror(fmt)
 #define IPACMERR_LOG(fmt, ...)   printf("ERR: %s:%d %s() " fmt, __FILE__,  __LINE__, __FUNCTION__, ##__VA_ARGS__);
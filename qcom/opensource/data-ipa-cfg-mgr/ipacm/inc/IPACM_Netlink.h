@@ -99,6 +99,8 @@ extern "C"
 
 #define MAX_NUM_OF_FD 10
 #define IPA_NL_MSG_MAX_LEN (2048)
+#define IPA_NL_RECV_BATCH (16)
+#define IPA_NL_STATS_LOG_INTERVAL (1024)
 
 /*--------------------------------------------------------------------------- 
 	 Type representing enumeration of NetLink event indication messages
@@ -229,6 +231,20 @@ typedef struct ipa_nl_route_info_s {
 
 #define IPA_FLOW_TYPE_INVALID      (-1)
 
+/*---------------------------------------------------------------------------
+	 Counters of the NetLink receive path. Messages dropped by the socket
+	 filter never reach user space and are not part of these counters.
+---------------------------------------------------------------------------*/
+typedef struct
+{
+	uint64_t recv_batches;     /* recvmmsg calls that returned data */
+	uint64_t msgs_received;    /* netlink messages read from the socket */
+	uint64_t msgs_filtered;    /* messages decoded without posting an event */
+	uint64_t msgs_dispatched;  /* messages that posted at least one event */
+	uint64_t events_posted;    /* events posted to the command queue */
+	uint64_t recv_errors;      /* overruns, truncated or malformed datagrams */
+} ipa_nl_stats_t;
+
 typedef struct
 {
 	unsigned int type;
@@ -252,6 +268,9 @@ int ipa_nl_listener_init
 /*  Virtual function registered to receive incoming messages over the NETLINK routing socket*/
 int ipa_nl_recv_msg(int fd);
 
+/* snapshot of the NetLink receive counters */
+void ipa_nl_get_stats(ipa_nl_stats_t *stats);
+
 /* map mask value for ipv6 */
 int mask_v6(int index, uint32_t *mask);
 
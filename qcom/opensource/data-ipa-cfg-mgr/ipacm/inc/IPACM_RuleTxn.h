@@ -0,0 +1,99 @@
+/*
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_RuleTxn.h
+
+	@brief
+	This file declares the filtering/routing rule transaction, which holds
+	back the HW table commits of rule ioctls and issues them once per IP
+	family when the outermost transaction ends.
+
+*/
+#ifndef IPACM_RULETXN_H
+#define IPACM_RULETXN_H
+
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/msm_ipa.h>
+
+typedef enum
+{
+	IPACM_RULE_TXN_RT = 0,
+	IPACM_RULE_TXN_FLT,
+	IPACM_RULE_TXN_TBL_MAX
+} ipacm_rule_txn_tbl;
+
+/* What one (outermost) transaction did */
+typedef struct
+{
+	uint32_t rule_ioctls;       /* add/del/modify ioctls issued */
+	uint32_t commits_requested; /* commit=1 ioctls plus explicit Commit() calls */
+	uint32_t commits_issued;    /* IPA_IOC_COMMIT_FLT/RT issued on flush */
+	uint32_t commits_failed;    /* of those, the ones the driver refused */
+} ipacm_rule_txn_stats;
+
+/* Transactions are per thread and nest, only the outermost end() flushes */
+class IPACM_RuleTxn
+{
+public:
+	static void begin(void);
+	static void end(ipacm_rule_txn_stats *stats);
+
+	/* issue the commits held back so far, the transaction stays open,
+	 * returns false if any of them failed */
+	static bool flush(void);
+
+	static bool active(void);
+
+	/* account a rule ioctl, returns the commit value to pass to the kernel */
+	static uint8_t rule_op(ipacm_rule_txn_tbl tbl, enum ipa_ip_type ip, uint8_t commit, bool del);
+
+	/* returns true if an explicit Commit(ip) was folded into the transaction */
+	static bool defer_commit(ipacm_rule_txn_tbl tbl, enum ipa_ip_type ip);
+};
+
+/* Issue a rule ioctl, with its commit held back while a transaction is
+ * open. The caller's commit value is restored afterwards. */
+template <typename T>
+static inline int ipacm_rule_txn_ioctl(int fd, unsigned long req, ipacm_rule_txn_tbl tbl, T const *table)
+{
+	T *t = const_cast<T *>(table);
+	uint8_t commit = t->commit;
+	int ret;
+
+	t->commit = IPACM_RuleTxn::rule_op(tbl, t->ip, commit,
+		req == IPA_IOC_DEL_FLT_RULE || req == IPA_IOC_DEL_RT_RULE);
+	ret = ioctl(fd, req, t);
+	t->commit = commit;
+
+	return ret;
+}
+
+#endif /* IPACM_RULETXN_H */
@@ -64,6 +64,16 @@ if (!(a)) {                                                 \
   
 /* Max allowed size of the XML file (2 MB) */
 #define IPACM_XML_MAX_FILESIZE               (2 << 20)
+
+/* Parsed XML configs are cached here, keyed by a hash of the XML content.
+   Bump the version whenever parsing or the config structures change. */
+#ifdef FEATURE_IPA_ANDROID
+#define IPACM_XML_CACHE_DIR                  "/data/vendor/ipa/xml_cache/"
+#else
+#define IPACM_XML_CACHE_DIR                  "/etc/ipacm_xml_cache/"
+#endif
+#define IPACM_XML_CACHE_MAGIC                0x4358434D /* "MCXC" */
+#define IPACM_XML_CACHE_VERSION              1
 #define IPACM_MAX_FIREWALL_ENTRIES            50
 #define IPACM_MAX_FILTER_CFG_ENTRIES          10
 #define IPACM_IPV6_ADDR_LEN                   16
@@ -38,16 +38,50 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 #include <string.h>
+#include <time.h>
+#include <sched.h>
 #include "IPACM_CmdQueue.h"
 #include "IPACM_Log.h"
 #include "IPACM_Iface.h"
 
-pthread_mutex_t mutex    = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t  cond_var = PTHREAD_COND_INITIALIZER;
+/* Counts the events pending in both queues; sem_post only enters the
+ * kernel when the consumer is actually sleeping in sem_wait. */
+static sem_t cmdq_pending;
+static pthread_once_t cmdq_once = PTHREAD_ONCE_INIT;
+static ipacm_cmdq_stats cmdq_stats;
 
 MessageQueue* MessageQueue::inst_internal = NULL;
 MessageQueue* MessageQueue::inst_external = NULL;
 
+static void cmdq_init_once(void)
+{
+	if(sem_init(&cmdq_pending, 0, 0) != 0)
+	{
+		IPACMERR("unable to init cmd queue semaphore\n");
+	}
+}
+
+MessageQueue::MessageQueue()
+{
+	uint32_t i;
+
+	pthread_once(&cmdq_once, cmdq_init_once);
+
+	for(i = 0; i < IPACM_CMDQ_RING_SIZE; i++)
+	{
+		ring[i].seq = i;
+		ring[i].evt.callback_ptr = NULL;
+		ring[i].enq_ts_us = 0;
+	}
+	ring_head = 0;
+	ring_tail = 0;
+
+	pthread_mutex_init(&overflow_lock, NULL);
+	Head = NULL;
+	Tail = NULL;
+	overflow_cnt = 0;
+}
+
 MessageQueue* MessageQueue::getInstanceInternal()
 {
 	if(inst_internal == NULL)
@@ -78,50 +112,222 @@ MessageQueue* MessageQueue::getInstanceExternal()
 	return inst_external;
 }
 
-void MessageQueue::enqueue(Message *item)
+uint64_t MessageQueue::now_us(void)
 {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool MessageQueue::ring_enqueue(const cmd_t *evt, uint64_t ts)
+{
+	ipacm_cmdq_slot *slot;
+	uint32_t pos, seq;
+	int32_t diff;
+
+	pos = __atomic_load_n(&ring_tail, __ATOMIC_RELAXED);
+	while(1)
+	{
+		slot = &ring[pos & (IPACM_CMDQ_RING_SIZE - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		diff = (int32_t)(seq - pos);
+		if(diff == 0)
+		{
+			/* slot is free for this lap, try to claim it */
+			if(__atomic_compare_exchange_n(&ring_tail, &pos, pos + 1, true,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+		else if(diff < 0)
+		{
+			/* consumer has not released this slot yet, ring is full */
+			return false;
+		}
+		else
+		{
+			pos = __atomic_load_n(&ring_tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(&slot->evt, evt, sizeof(cmd_t));
+	slot->enq_ts_us = ts;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool MessageQueue::ring_dequeue(cmd_t *evt, uint64_t *enq_ts_us)
+{
+	ipacm_cmdq_slot *slot;
+	uint32_t pos = ring_head;
+
+	slot = &ring[pos & (IPACM_CMDQ_RING_SIZE - 1)];
+	if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+	{
+		/* empty, or the producer owning this slot is still copying */
+		return false;
+	}
+
+	memcpy(evt, &slot->evt, sizeof(cmd_t));
+	*enq_ts_us = slot->enq_ts_us;
+	ring_head = pos + 1;
+	__atomic_store_n(&slot->seq, pos + IPACM_CMDQ_RING_SIZE, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool MessageQueue::overflow_enqueue(const cmd_t *evt, uint64_t ts)
+{
+	Message *item = new Message();
+
+	if(item == NULL)
+	{
+		IPACMERR("unable to create new message item\n");
+		return false;
+	}
+	memcpy(&item->evt, evt, sizeof(cmd_t));
+	item->enq_ts_us = ts;
+
+	pthread_mutex_lock(&overflow_lock);
 	if(!Head)
 	{
-		Tail = item;
 		Head = item;
 	}
 	else
 	{
-		if(Tail == NULL)
+		Tail->setnext(item);
+	}
+	Tail = item;
+	__atomic_add_fetch(&overflow_cnt, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&overflow_lock);
+	return true;
+}
+
+bool MessageQueue::overflow_dequeue(cmd_t *evt, uint64_t *enq_ts_us)
+{
+	Message *item;
+
+	if(__atomic_load_n(&overflow_cnt, __ATOMIC_ACQUIRE) == 0)
+	{
+		return false;
+	}
+
+	pthread_mutex_lock(&overflow_lock);
+	item = Head;
+	if(item != NULL)
+	{
+		Head = item->getnext();
+		if(Head == NULL)
 		{
-			IPACMDBG("Tail is null\n");
-			Head->setnext(item);
+			Tail = NULL;
 		}
-		else
+		__atomic_sub_fetch(&overflow_cnt, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&overflow_lock);
+
+	if(item == NULL)
+	{
+		return false;
+	}
+
+	memcpy(evt, &item->evt, sizeof(cmd_t));
+	*enq_ts_us = item->enq_ts_us;
+	delete item;
+	return true;
+}
+
+int MessageQueue::enqueue(const cmd_t *evt)
+{
+	uint64_t ts = now_us();
+
+	/* Once an event spilled to the overflow list, keep using it until the
+	 * consumer drained it so that events are not reordered. The overflow
+	 * list is what keeps the consumer thread itself from blocking when it
+	 * posts internal events into a full ring. */
+	if(__atomic_load_n(&overflow_cnt, __ATOMIC_ACQUIRE) != 0 ||
+		!ring_enqueue(evt, ts))
+	{
+		if(!overflow_enqueue(evt, ts))
 		{
-			Tail->setnext(item);
+			return IPACM_FAILURE;
 		}
-		Tail = item;
+		__atomic_add_fetch(&cmdq_stats.overflow, 1, __ATOMIC_RELAXED);
+	}
+
+	if(sem_post(&cmdq_pending) != 0)
+	{
+		IPACMERR("unable to post cmd queue semaphore\n");
+		return IPACM_FAILURE;
 	}
+	return IPACM_SUCCESS;
 }
 
+bool MessageQueue::dequeue(cmd_t *evt, uint64_t *enq_ts_us)
+{
+	if(ring_dequeue(evt, enq_ts_us))
+	{
+		return true;
+	}
+	return overflow_dequeue(evt, enq_ts_us);
+}
 
-Message* MessageQueue::dequeue(void)
+void MessageQueue::update_stats(uint64_t enq_ts_us)
 {
-	if(Head == NULL)
+	uint64_t now = now_us(), lat = now - enq_ts_us, cnt, acc;
+	uint32_t bucket = 0, i;
+
+	while(lat > 1 && bucket < IPACM_CMDQ_LAT_BUCKETS - 1)
 	{
-		return NULL;
+		lat >>= 1;
+		bucket++;
 	}
-	else
+	cmdq_stats.lat_hist[bucket]++;
+	cmdq_stats.events++;
+
+	if(cmdq_stats.window_start_us == 0)
+	{
+		cmdq_stats.window_start_us = now;
+	}
+
+	if(cmdq_stats.events % IPACM_CMDQ_STATS_INTERVAL != 0)
 	{
-		Message *tmp = Head;
-		Head = Head->getnext();
+		return;
+	}
 
-		return tmp;
+	/* p99 upper bound from the log2 histogram */
+	cnt = 0;
+	acc = 0;
+	for(i = 0; i < IPACM_CMDQ_LAT_BUCKETS; i++)
+	{
+		cnt += cmdq_stats.lat_hist[i];
 	}
-}
+	for(i = 0; i < IPACM_CMDQ_LAT_BUCKETS; i++)
+	{
+		acc += cmdq_stats.lat_hist[i];
+		if(acc * 100 >= cnt * 99)
+		{
+			break;
+		}
+	}
+
+	IPACMDBG_H("cmd queue: %llu events, %llu events/s, p99 latency < %llu us, overflow %u\n",
+		(unsigned long long)cmdq_stats.events,
+		(unsigned long long)(IPACM_CMDQ_STATS_INTERVAL * 1000000ULL /
+			(now - cmdq_stats.window_start_us + 1)),
+		(unsigned long long)(1ULL << (i + 1)),
+		__atomic_load_n(&cmdq_stats.overflow, __ATOMIC_RELAXED));
 
+	memset(cmdq_stats.lat_hist, 0, sizeof(cmdq_stats.lat_hist));
+	cmdq_stats.window_start_us = now;
+}
 
 void* MessageQueue::Process(void *param)
 {
 	MessageQueue *MsgQueueInternal = NULL;
 	MessageQueue *MsgQueueExternal = NULL;
-	Message *item = NULL;
+	cmd_t item;
+	uint64_t enq_ts_us = 0;
 	param = NULL;
 	const char *eventName = NULL;
 
@@ -143,73 +349,43 @@ void* MessageQueue::Process(void *param)
 
 	while(1)
 	{
-		if(pthread_mutex_lock(&mutex) != 0)
+		/* one token per posted event, sleeps only when both queues are empty */
+		if(sem_wait(&cmdq_pending) != 0)
 		{
-			IPACMERR("unable to lock the mutex\n");
-			return NULL;
+			continue;
 		}
 
-		item = MsgQueueInternal->dequeue();
-		if(item == NULL)
+		/* the token may belong to a later slot while an earlier producer
+		 * is still copying into its own, spin until that one is published */
+		while(1)
 		{
-			item = MsgQueueExternal->dequeue();
-			if(item)
+			if(MsgQueueInternal->dequeue(&item, &enq_ts_us))
 			{
-				eventName = IPACM_Iface::ipacmcfg->getEventName(item->evt.data.event);
+				eventName = IPACM_Iface::ipacmcfg->getEventName(item.data.event);
 				if (eventName != NULL)
 				{
-					IPACMDBG("Get event %s from external queue.\n",
-							eventName);
+					IPACMDBG("Get event %s from internal queue.\n",
+						eventName);
 				}
+				break;
 			}
-		}
-		else
-		{
-			eventName = IPACM_Iface::ipacmcfg->getEventName(item->evt.data.event);
-			if (eventName != NULL)
-			{
-				IPACMDBG("Get event %s from internal queue.\n",
-					eventName);
-			}
-		}
-
-		if(item == NULL)
-		{
-			IPACMDBG("Waiting for Message\n");
 
-			if(pthread_cond_wait(&cond_var, &mutex) != 0)
+			if(MsgQueueExternal->dequeue(&item, &enq_ts_us))
 			{
-				IPACMERR("unable to lock the mutex\n");
-
-				if(pthread_mutex_unlock(&mutex) != 0)
+				eventName = IPACM_Iface::ipacmcfg->getEventName(item.data.event);
+				if (eventName != NULL)
 				{
-					IPACMERR("unable to unlock the mutex\n");
-					return NULL;
+					IPACMDBG("Get event %s from external queue.\n",
+							eventName);
 				}
-
-				return NULL;
-			}
-
-			if(pthread_mutex_unlock(&mutex) != 0)
-			{
-				IPACMERR("unable to unlock the mutex\n");
-				return NULL;
+				break;
 			}
-
+			sched_yield();
 		}
-		else
-		{
-			if(pthread_mutex_unlock(&mutex) != 0)
-			{
-				IPACMERR("unable to unlock the mutex\n");
-				return NULL;
-			}
 
-			IPACMDBG("Processing item %pK event ID: %d\n",item,item->evt.data.event);
-			item->evt.callback_ptr(&item->evt.data);
-			delete item;
-			item = NULL;
-		}
+		IPACMDBG("Processing event ID: %d\n", item.data.event);
+		item.callback_ptr(&item.data);
+		update_stats(enq_ts_us);
 
 	} /* Go forever until a termination indication is received */
 
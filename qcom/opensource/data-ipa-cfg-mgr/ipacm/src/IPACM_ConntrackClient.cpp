@@ -46,6 +46,7 @@ extern IPACM_EvtDispatcher cm_dis;
 extern void ParseCTMessage(struct nf_conntrack *ct);
 
 IPACM_ConntrackClient *IPACM_ConntrackClient::pInstance = NULL;
+ipacm_ct_evt_stats IPACM_ConntrackClient::ct_stats;
 IPACM_ConntrackListener *CtList = NULL;
 
 /* ================================
@@ -58,8 +59,8 @@ IPACM_ConntrackClient::IPACM_ConntrackClient()
 
 	tcp_hdl = NULL;
 	udp_hdl = NULL;
-	tcp_filter = NULL;
-	udp_filter = NULL;
+	pthread_mutex_init(&ct_filter_lock, NULL);
+	ct_filter_local_added = false;
 	fd_tcp = -1;
 	fd_udp = -1;
 	subscrips_tcp = NF_NETLINK_CONNTRACK_UPDATE | NF_NETLINK_CONNTRACK_DESTROY;
@@ -71,24 +72,6 @@ IPACM_ConntrackClient* IPACM_ConntrackClient::GetInstance()
 	if(pInstance == NULL)
 	{
 		pInstance = new IPACM_ConntrackClient();
-
-		pInstance->udp_filter = nfct_filter_create();
-		if(pInstance->udp_filter == NULL)
-		{
-			IPACMERR("unable to create UDP filter\n");
-			delete pInstance;
-			return NULL;
-		}
-		IPACMDBG("Created UDP filter\n");
-
-		pInstance->tcp_filter = nfct_filter_create();
-		if(pInstance->tcp_filter == NULL)
-		{
-			IPACMERR("unable to create TCP filter\n");
-			delete pInstance;
-			return NULL;
-		}
-		IPACMDBG("Created TCP filter\n");
 	}
 
 	return pInstance;
@@ -108,6 +91,15 @@ int IPACM_ConntrackClient::IPAConntrackEventCB
 
 	IPACMDBG("Event callback called with msgtype: %d\n",type);
 
+	if(nfct_get_attr_u8(ct, ATTR_ORIG_L4PROTO) == IPPROTO_TCP)
+	{
+		ct_stats.tcp_received++;
+	}
+	else
+	{
+		ct_stats.udp_received++;
+	}
+
 	/* Retrieve ip type */
 	ip_type = nfct_get_attr_u8(ct, ATTR_REPL_L3PROTO);
 
@@ -159,7 +151,7 @@ IGNORE:
 
 int IPACM_ConntrackClient::IPA_Conntrack_Filters_Ignore_Bridge_Addrs
 (
-	 struct nfct_filter *filter
+	 IPACM_ConntrackFilter *filter
 )
 {
 	int fd;
@@ -199,73 +191,23 @@ int IPACM_ConntrackClient::IPA_Conntrack_Filters_Ignore_Bridge_Addrs
 	ipv4_addr = ntohl(((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr.s_addr);
 	close(fd);
 
-	/* ignore whatever is destined to or originates from broadcast ip address */
-	struct nfct_filter_ipv4 filter_ipv4;
-
-	filter_ipv4.addr = ipv4_addr;
-	filter_ipv4.mask = 0xffffffff;
-
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_DST_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_DST_IPV4, &filter_ipv4);
-
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_SRC_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_SRC_IPV4, &filter_ipv4);
+	/* ignore whatever is destined to or originates from bridge ip address */
+	filter->IgnoreAddr(ipv4_addr);
 
 	return 0;
 }
 
 int IPACM_ConntrackClient::IPA_Conntrack_Filters_Ignore_Local_Iface
 (
-	 struct nfct_filter *filter,
+	 IPACM_ConntrackFilter *filter,
 	 ipacm_event_iface_up *param
 )
 {
-	struct nfct_filter_ipv4 filter_ipv4;
-
-	filter_ipv4.addr = param->ipv4_addr;
-	filter_ipv4.mask = 0xffffffff;
-
-	/* ignore whatever is destined to local interfaces */
-	IPACMDBG("Ignore connections destinated to interface %s", param->ifname);
+	/* ignore whatever is destined to or orignated from local interfaces,
+	   and whatever is destined to their broadcast address */
+	IPACMDBG("Ignore connections destinated to/orignated from interface %s", param->ifname);
 	iptodot("with ipv4 address", param->ipv4_addr);
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_DST_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_DST_IPV4, &filter_ipv4);
-
-	IPACMDBG("Ignore connections orignated from interface %s", param->ifname);
-	iptodot("with ipv4 address", filter_ipv4.addr);
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_SRC_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_SRC_IPV4, &filter_ipv4);
-
-	/* Retrieve broadcast address */
-	/* Intialize with 255.255.255.255 */
-	uint32_t bc_ip_addr = 0xFFFFFFFF;
-
-	/* calculate broadcast address from addr and addr_mask */
-	bc_ip_addr = (bc_ip_addr & (~param->addr_mask));
-	bc_ip_addr = (bc_ip_addr | (param->ipv4_addr & param->addr_mask));
-
-	/* netfitler expecting in host-byte order */
-	filter_ipv4.addr = bc_ip_addr;
-	filter_ipv4.mask = 0xffffffff;
-
-	iptodot("with broadcast address", filter_ipv4.addr);
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_DST_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_DST_IPV4, &filter_ipv4);
+	filter->IgnoreLocalIface(param->ipv4_addr, param->addr_mask);
 
 	return 0;
 }
@@ -274,38 +216,27 @@ int IPACM_ConntrackClient::IPA_Conntrack_Filters_Ignore_Local_Iface
 		 connections to and from local interfaces */
 int IPACM_ConntrackClient::IPA_Conntrack_Filters_Ignore_Local_Addrs
 (
-	 struct nfct_filter *filter
+	 IPACM_ConntrackFilter *filter
 )
 {
-	struct nfct_filter_ipv4 filter_ipv4;
-
 	/* ignore whatever is destined to or originates from broadcast ip address */
-	filter_ipv4.addr = 0xffffffff;
-	filter_ipv4.mask = 0xffffffff;
-
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_DST_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_DST_IPV4, &filter_ipv4);
-
-	nfct_filter_set_logic(filter,
-												NFCT_FILTER_SRC_IPV4,
-												NFCT_FILTER_LOGIC_NEGATIVE);
-
-	nfct_filter_add_attr(filter, NFCT_FILTER_SRC_IPV4, &filter_ipv4);
+	filter->IgnoreAddr(BROADCAST_IPV4_ADDR);
 
 	return 0;
 } /* IPA_Conntrack_Filters_Ignore_Local_Addrs() */
 
-/* Initialize TCP Filter */
-int IPACM_ConntrackClient::IPA_Conntrack_TCP_Filter_Init(void)
+/* (Re)build the socket filter for l4proto from the current LAN/WAN state
+   and ALG port list, and attach it to the conntrack handle */
+int IPACM_ConntrackClient::IPA_Conntrack_Filter_Attach
+(
+	 struct nfct_handle *hdl,
+	 uint8_t l4proto
+)
 {
-	int ret = 0;
+	int ret, nALGPort;
+	ipacm_alg pALGPorts[IPA_MAX_ALG_ENTRIES];
 	IPACM_ConntrackClient *pClient;
 
-	IPACMDBG("\n");
-
 	pClient = IPACM_ConntrackClient::GetInstance();
 	if(pClient == NULL)
 	{
@@ -313,58 +244,54 @@ int IPACM_ConntrackClient::IPA_Conntrack_TCP_Filter_Init(void)
 		return -1;
 	}
 
-	ret = nfct_filter_set_logic(pClient->tcp_filter,
-															NFCT_FILTER_L4PROTO,
-															NFCT_FILTER_LOGIC_POSITIVE);
-	if(ret == -1)
+	nALGPort = IPACM_Iface::ipacmcfg->GetAlgPortCnt();
+	if(nALGPort > IPA_MAX_ALG_ENTRIES)
 	{
-		IPACMERR("Unable to set filter logic\n");
-		return -1;
+		nALGPort = IPA_MAX_ALG_ENTRIES;
 	}
+	if(nALGPort > 0)
+	{
+		IPACM_Iface::ipacmcfg->GetAlgPorts(nALGPort, pALGPorts);
+	}
+	pClient->ct_filter.SetAlgPorts(pALGPorts, nALGPort);
 
-	/* set protocol filters as tcp and udp */
-	nfct_filter_add_attr_u32(pClient->tcp_filter, NFCT_FILTER_L4PROTO, IPPROTO_TCP);
-
-
-	struct nfct_filter_proto tcp_proto_state;
-	tcp_proto_state.proto = IPPROTO_TCP;
-	tcp_proto_state.state = TCP_CONNTRACK_ESTABLISHED;
-
-	ret = nfct_filter_set_logic(pClient->tcp_filter,
-															NFCT_FILTER_L4PROTO_STATE,
-															NFCT_FILTER_LOGIC_POSITIVE);
-	if(ret == -1)
+	ret = pClient->ct_filter.Attach(nfct_fd(hdl), l4proto);
+	if(ret == 0)
 	{
-		IPACMERR("unable to set filter logic\n");
-		return -1;
+		ct_stats.filter_updates++;
 	}
-	nfct_filter_add_attr(pClient->tcp_filter,
-											 NFCT_FILTER_L4PROTO_STATE,
-											 &tcp_proto_state);
 
+	return ret;
+}
 
-	tcp_proto_state.proto = IPPROTO_TCP;
-	tcp_proto_state.state = TCP_CONNTRACK_FIN_WAIT;
-	ret = nfct_filter_set_logic(pClient->tcp_filter,
-															NFCT_FILTER_L4PROTO_STATE,
-															NFCT_FILTER_LOGIC_POSITIVE);
-	if(ret == -1)
+/* Initialize TCP Filter */
+int IPACM_ConntrackClient::IPA_Conntrack_TCP_Filter_Init(void)
+{
+	int ret;
+	IPACM_ConntrackClient *pClient;
+
+	IPACMDBG("\n");
+
+	pClient = IPACM_ConntrackClient::GetInstance();
+	if(pClient == NULL)
 	{
-		IPACMERR("unable to set filter logic\n");
+		IPACMERR("unable to get conntrack client instance\n");
 		return -1;
 	}
 
-	nfct_filter_add_attr(pClient->tcp_filter,
-											 NFCT_FILTER_L4PROTO_STATE,
-											 &tcp_proto_state);
-	return 0;
+	/* only tcp connections in established or fin_wait state */
+	pthread_mutex_lock(&pClient->ct_filter_lock);
+	ret = IPA_Conntrack_Filter_Attach(pClient->tcp_hdl, IPPROTO_TCP);
+	pthread_mutex_unlock(&pClient->ct_filter_lock);
+
+	return ret;
 }
 
 
 /* Initialize UDP Filter */
 int IPACM_ConntrackClient::IPA_Conntrack_UDP_Filter_Init(void)
 {
-	int ret = 0;
+	int ret;
 	IPACM_ConntrackClient *pClient = IPACM_ConntrackClient::GetInstance();
 	if(pClient == NULL)
 	{
@@ -372,22 +299,17 @@ int IPACM_ConntrackClient::IPA_Conntrack_UDP_Filter_Init(void)
 		return -1;
 	}
 
-	ret = nfct_filter_set_logic(pClient->udp_filter,
-															NFCT_FILTER_L4PROTO,
-															NFCT_FILTER_LOGIC_POSITIVE);
-	if(ret == -1)
-	{
-		IPACMERR("unable to set filter logic\n");
-	}
-	/* set protocol filters as tcp and udp */
-	nfct_filter_add_attr_u32(pClient->udp_filter, NFCT_FILTER_L4PROTO, IPPROTO_UDP);
+	pthread_mutex_lock(&pClient->ct_filter_lock);
+	ret = IPA_Conntrack_Filter_Attach(pClient->udp_hdl, IPPROTO_UDP);
+	pthread_mutex_unlock(&pClient->ct_filter_lock);
 
-	return 0;
+	return ret;
 }
 
 void* IPACM_ConntrackClient::UDPConnTimeoutUpdate(void *ptr)
 {
 	NatApp *nat_inst = NULL;
+	unsigned int cycles = 0;
 	ptr = NULL;
 #ifdef IPACM_DEBUG
 	IPACMDBG("\n");
@@ -403,6 +325,13 @@ void* IPACM_ConntrackClient::UDPConnTimeoutUpdate(void *ptr)
 	while(1)
 	{
 		nat_inst->UpdateUDPTimeStamp();
+		if(++cycles % NAT_HASH_STATS_CYCLES == 0)
+		{
+			nat_inst->DumpHashStats();
+			IPACMDBG_H("conntrack events: tcp %u udp %u received, %u ignored, %u filter updates\n",
+				ct_stats.tcp_received, ct_stats.udp_received,
+				ct_stats.ignored, ct_stats.filter_updates);
+		}
 		sleep(UDP_TIMEOUT_UPDATE);
 	} /* end of while(1) loop */
 
@@ -451,7 +380,7 @@ void* IPACM_ConntrackClient::TCPRegisterWithConnTrack(void *)
 		return NULL;
 	}
 
-	/* Initialize the filter */
+	/* Initialize the filter and attach it to net filter handler */
 	ret = IPA_Conntrack_TCP_Filter_Init();
 	if(ret == -1)
 	{
@@ -459,14 +388,6 @@ void* IPACM_ConntrackClient::TCPRegisterWithConnTrack(void *)
 		return NULL;
 	}
 
-	/* Attach the filter to net filter handler */
-	ret = nfct_filter_attach(nfct_fd(pClient->tcp_hdl), pClient->tcp_filter);
-	if(ret == -1)
-	{
-		IPACMDBG("unable to attach TCP filter\n");
-		return NULL;
-	}
-
 	/* Register callback with netfilter handler */
 	IPACMDBG_H("tcp handle:%pK, fd:%d\n", pClient->tcp_hdl, nfct_fd(pClient->tcp_hdl));
 #ifndef CT_OPT
@@ -497,10 +418,6 @@ ctcatch:
 
 	IPACMDBG("Exit from tcp thread\n");
 
-	/* destroy the filter.. this will not detach the filter */
-	nfct_filter_destroy(pClient->tcp_filter);
-	pClient->tcp_filter = NULL;
-
 	/* de-register the callback */
 	nfct_callback_unregister(pClient->tcp_hdl);
 	/* close the handle */
@@ -548,7 +465,7 @@ void* IPACM_ConntrackClient::UDPRegisterWithConnTrack(void *)
 		return NULL;
 	}
 
-	/* Initialize Filter */
+	/* Initialize the filter and attach it to net filter handler */
 	ret = IPA_Conntrack_UDP_Filter_Init();
 	if(-1 == ret)
 	{
@@ -556,14 +473,6 @@ void* IPACM_ConntrackClient::UDPRegisterWithConnTrack(void *)
 		return NULL;
 	}
 
-	/* Attach the filter to net filter handler */
-	ret = nfct_filter_attach(nfct_fd(pClient->udp_hdl), pClient->udp_filter);
-	if(ret == -1)
-	{
-		IPACMDBG("unable to attach the filter\n");
-		return NULL;
-	}
-
 	/* Register callback with netfilter handler */
 	IPACMDBG_H("udp handle:%pK, fd:%d\n", pClient->udp_hdl, nfct_fd(pClient->udp_hdl));
 	nfct_callback_register(pClient->udp_hdl,
@@ -588,10 +497,6 @@ ctcatch:
 
 	IPACMDBG("Exit from udp thread with ret: %d\n", ret);
 
-	/* destroy the filter.. this will not detach the filter */
-	nfct_filter_destroy(pClient->udp_filter);
-	pClient->udp_filter = NULL;
-
 	/* de-register the callback */
 	nfct_callback_unregister(pClient->udp_hdl);
 	/* close the handle */
@@ -620,12 +525,6 @@ void IPACM_ConntrackClient::UNRegisterWithConnTrack(void)
 		return;
 	}
 
-	/* destroy the TCP filter.. this will not detach the filter */
-	if (pClient->tcp_filter) {
-		nfct_filter_destroy(pClient->tcp_filter);
-		pClient->tcp_filter = NULL;
-	}
-
 	/* de-register the callback */
 	if (pClient->tcp_hdl) {
 		nfct_callback_unregister(pClient->tcp_hdl);
@@ -634,12 +533,6 @@ void IPACM_ConntrackClient::UNRegisterWithConnTrack(void)
 		pClient->tcp_hdl = NULL;
 	}
 
-	/* destroy the filter.. this will not detach the filter */
-	if (pClient->udp_filter) {
-		nfct_filter_destroy(pClient->udp_filter);
-		pClient->udp_filter = NULL;
-	}
-
 	/* de-register the callback */
 	if (pClient->udp_hdl) {
 		nfct_callback_unregister(pClient->udp_hdl);
@@ -654,9 +547,10 @@ void IPACM_ConntrackClient::UNRegisterWithConnTrack(void)
 	return;
 }
 
-void IPACM_ConntrackClient::UpdateUDPFilters(void *param, bool isWan)
+/* Update the LAN (isWan false) or WAN (isWan true, param NULL on WAN
+   down) state of the filters and re-attach the one of hdl */
+void IPACM_ConntrackClient::UpdateFilters(struct nfct_handle *hdl, uint8_t l4proto, void *param, bool isWan)
 {
-	static bool isIgnore = false;
 	int ret = 0;
 	IPACM_ConntrackClient *pClient = NULL;
 
@@ -667,44 +561,42 @@ void IPACM_ConntrackClient::UpdateUDPFilters(void *param, bool isWan)
 		return;
 	}
 
-	if(pClient->udp_filter == NULL)
-	{
-		 return;
-	}
-
+	pthread_mutex_lock(&pClient->ct_filter_lock);
 	if(!isWan)
 	{
-		IPA_Conntrack_Filters_Ignore_Local_Iface(pClient->udp_filter,
+		IPA_Conntrack_Filters_Ignore_Local_Iface(&pClient->ct_filter,
 																		 (ipacm_event_iface_up *)param);
 
-		if(!isIgnore)
+		if(!pClient->ct_filter_local_added)
 		{
-			IPA_Conntrack_Filters_Ignore_Bridge_Addrs(pClient->udp_filter);
-			IPA_Conntrack_Filters_Ignore_Local_Addrs(pClient->udp_filter);
-			isIgnore = true;
+			IPA_Conntrack_Filters_Ignore_Bridge_Addrs(&pClient->ct_filter);
+			IPA_Conntrack_Filters_Ignore_Local_Addrs(&pClient->ct_filter);
+			pClient->ct_filter_local_added = true;
 		}
 	}
+	else
+	{
+		pClient->ct_filter.SetWanAddr((param != NULL) ?
+			((ipacm_event_iface_up *)param)->ipv4_addr : 0);
+	}
 
-	/* Attach the filter to udp handle */
-	if(pClient->udp_hdl != NULL)
+	/* Attach the filter to the handle */
+	if(hdl != NULL)
 	{
-		IPACMDBG("attaching the filter to udp handle\n");
-		ret = nfct_filter_attach(nfct_fd(pClient->udp_hdl), pClient->udp_filter);
+		IPACMDBG("attaching the filter to proto %d handle\n", l4proto);
+		ret = IPA_Conntrack_Filter_Attach(hdl, l4proto);
 		if(ret == -1)
 		{
-			PERROR("unable to attach the filter to udp handle\n");
-			IPACMERR("udp handle:%pK, fd:%d Error: %d\n",pClient->udp_hdl, nfct_fd(pClient->udp_hdl), ret);
-			return;
+			IPACMERR("handle:%pK, fd:%d Error: %d\n", hdl, nfct_fd(hdl), ret);
 		}
 	}
+	pthread_mutex_unlock(&pClient->ct_filter_lock);
 
 	return;
 }
 
-void IPACM_ConntrackClient::UpdateTCPFilters(void *param, bool isWan)
+void IPACM_ConntrackClient::UpdateUDPFilters(void *param, bool isWan)
 {
-	static bool isIgnore = false;
-	int ret = 0;
 	IPACM_ConntrackClient *pClient = NULL;
 
 	pClient = IPACM_ConntrackClient::GetInstance();
@@ -714,35 +606,22 @@ void IPACM_ConntrackClient::UpdateTCPFilters(void *param, bool isWan)
 		return;
 	}
 
-	if(pClient->tcp_filter == NULL)
-		return;
-
-	if(!isWan)
-	{
-		IPA_Conntrack_Filters_Ignore_Local_Iface(pClient->tcp_filter,
-																	(ipacm_event_iface_up *)param);
+	UpdateFilters(pClient->udp_hdl, IPPROTO_UDP, param, isWan);
+	return;
+}
 
-		if(!isIgnore)
-		{
-			IPA_Conntrack_Filters_Ignore_Bridge_Addrs(pClient->udp_filter);
-			IPA_Conntrack_Filters_Ignore_Local_Addrs(pClient->udp_filter);
-			isIgnore = true;
-		}
-	}
+void IPACM_ConntrackClient::UpdateTCPFilters(void *param, bool isWan)
+{
+	IPACM_ConntrackClient *pClient = NULL;
 
-	/* Attach the filter to tcp handle */
-	if(pClient->tcp_hdl != NULL)
+	pClient = IPACM_ConntrackClient::GetInstance();
+	if(pClient == NULL)
 	{
-		IPACMDBG("attaching the filter to tcp handle\n");
-		ret = nfct_filter_attach(nfct_fd(pClient->tcp_hdl), pClient->tcp_filter);
-		if(ret == -1)
-		{
-			PERROR("unable to attach the filter to tcp handle\n");
-			IPACMERR("tcp handle:%pK, fd:%d Error: %d\n",pClient->tcp_hdl, nfct_fd(pClient->tcp_hdl), ret);
-			return;
-		}
+		IPACMERR("unable to retrieve conntrack client instance\n");
+		return;
 	}
 
-  return;
+	UpdateFilters(pClient->tcp_hdl, IPPROTO_TCP, param, isWan);
+	return;
 }
 
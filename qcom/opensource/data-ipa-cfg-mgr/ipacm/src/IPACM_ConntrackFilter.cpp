@@ -0,0 +1,395 @@
+/*
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_ConntrackFilter.cpp
+
+	@brief
+	This file implements the socket filter of the conntrack event sockets.
+
+	The program walks the ctnetlink attributes with the SKF_AD_NLATTR and
+	SKF_AD_NLATTR_NEST ancillary loads. Whenever an attribute it needs is
+	missing (or the skb is non-linear) the event is passed to user space.
+
+*/
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <linux/netfilter/nf_conntrack_common.h>
+#include <linux/netfilter/nf_conntrack_tcp.h>
+
+#include "IPACM_ConntrackFilter.h"
+#include "IPACM_Log.h"
+
+/* first ctnetlink attribute */
+#define CT_NFA_OFF (NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct nfgenmsg)))
+
+/* scratch memory slots */
+#define CT_M_ORIG   0   /* CTA_TUPLE_ORIG */
+#define CT_M_PROTO  1   /* CTA_TUPLE_ORIG/CTA_TUPLE_PROTO */
+#define CT_M_IP     2   /* CTA_TUPLE_ORIG/CTA_TUPLE_IP */
+#define CT_M_SRC    3   /* orig ipv4 src, host order */
+#define CT_M_DST    4   /* orig ipv4 dst, host order */
+
+#define CT_RET_ACCEPT 0xFFFFFFFF
+#define CT_RET_REJECT 0
+
+typedef struct
+{
+	struct sock_filter *code;
+	int len;
+	int max;
+	bool bad_jump;
+} ct_bpf_prog;
+
+static void ct_emit(ct_bpf_prog *p, uint16_t code, uint8_t jt, uint8_t jf, uint32_t k)
+{
+	if(p->len < p->max)
+	{
+		p->code[p->len].code = code;
+		p->code[p->len].jt = jt;
+		p->code[p->len].jf = jf;
+		p->code[p->len].k = k;
+	}
+	p->len++;
+}
+
+/* point the jt of the jump at idx to the next instruction emitted */
+static void ct_patch_jt(ct_bpf_prog *p, int idx)
+{
+	int off = p->len - idx - 1;
+
+	if(off > 255)
+	{
+		p->bad_jump = true;
+		return;
+	}
+	if(idx < p->max)
+	{
+		p->code[idx].jt = (uint8_t)off;
+	}
+}
+
+/* A = offset of the attribute 'type', either searched from offset A (top
+ * level) or inside the nested attribute at offset A, 0 if not found */
+static void ct_emit_find(ct_bpf_prog *p, bool nested, uint32_t type)
+{
+	ct_emit(p, BPF_LDX | BPF_W | BPF_IMM, 0, 0, type);
+	ct_emit(p, BPF_LD | BPF_W | BPF_ABS, 0, 0,
+		SKF_AD_OFF + (nested ? SKF_AD_NLATTR_NEST : SKF_AD_NLATTR));
+}
+
+static void ct_emit_accept_if_zero(ct_bpf_prog *p)
+{
+	ct_emit(p, BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0);
+	ct_emit(p, BPF_RET | BPF_K, 0, 0, CT_RET_ACCEPT);
+}
+
+/* A = payload of the attribute at offset A, network to host order */
+static void ct_emit_load_value(ct_bpf_prog *p, uint16_t size)
+{
+	ct_emit(p, BPF_MISC | BPF_TAX, 0, 0, 0);
+	ct_emit(p, BPF_LD | size | BPF_IND, 0, 0, NLA_HDRLEN);
+}
+
+/* reject if A equals any of vals */
+static void ct_emit_reject_list(ct_bpf_prog *p, const uint32_t *vals, int n)
+{
+	int i;
+
+	for(i = 0; i < n; i++)
+	{
+		ct_emit(p, BPF_JMP | BPF_JEQ | BPF_K, (uint8_t)(n - i), 0, vals[i]);
+	}
+	ct_emit(p, BPF_JMP | BPF_JA, 0, 0, 1);
+	ct_emit(p, BPF_RET | BPF_K, 0, 0, CT_RET_REJECT);
+}
+
+IPACM_ConntrackFilter::IPACM_ConntrackFilter()
+{
+	num_ignore_src = 0;
+	num_ignore_dst = 0;
+	wan_addr = 0;
+	num_alg_ports = 0;
+	memset(ignore_src, 0, sizeof(ignore_src));
+	memset(ignore_dst, 0, sizeof(ignore_dst));
+	memset(alg_ports, 0, sizeof(alg_ports));
+}
+
+void IPACM_ConntrackFilter::AddUnique(uint32_t *list, int *cnt, uint32_t addr)
+{
+	int i;
+
+	for(i = 0; i < *cnt; i++)
+	{
+		if(list[i] == addr)
+		{
+			return;
+		}
+	}
+
+	if(*cnt >= IPACM_CT_FLT_MAX_ADDRS)
+	{
+		IPACMERR("conntrack filter address list full, 0x%x not filtered\n", addr);
+		return;
+	}
+	list[(*cnt)++] = addr;
+}
+
+void IPACM_ConntrackFilter::IgnoreLocalIface(uint32_t ipv4_addr, uint32_t addr_mask)
+{
+	uint32_t bc_ip_addr;
+
+	AddUnique(ignore_dst, &num_ignore_dst, ipv4_addr);
+	AddUnique(ignore_src, &num_ignore_src, ipv4_addr);
+
+	/* broadcast address from addr and addr_mask */
+	bc_ip_addr = (0xFFFFFFFF & (~addr_mask)) | (ipv4_addr & addr_mask);
+	AddUnique(ignore_dst, &num_ignore_dst, bc_ip_addr);
+}
+
+void IPACM_ConntrackFilter::IgnoreAddr(uint32_t ipv4_addr)
+{
+	AddUnique(ignore_dst, &num_ignore_dst, ipv4_addr);
+	AddUnique(ignore_src, &num_ignore_src, ipv4_addr);
+}
+
+void IPACM_ConntrackFilter::SetWanAddr(uint32_t ipv4_addr)
+{
+	wan_addr = ipv4_addr;
+}
+
+void IPACM_ConntrackFilter::SetAlgPorts(const ipacm_alg *ports, int cnt)
+{
+	if(cnt < 0)
+	{
+		cnt = 0;
+	}
+	if(cnt > IPA_MAX_ALG_ENTRIES)
+	{
+		cnt = IPA_MAX_ALG_ENTRIES;
+	}
+	if(cnt > 0)
+	{
+		memcpy(alg_ports, ports, cnt * sizeof(ipacm_alg));
+	}
+	num_alg_ports = cnt;
+}
+
+int IPACM_ConntrackFilter::Build(uint8_t l4proto, struct sock_filter *code, int max)
+{
+	static const uint32_t tcp_states[] = {TCP_CONNTRACK_ESTABLISHED, TCP_CONNTRACK_FIN_WAIT};
+	uint32_t ports[IPA_MAX_ALG_ENTRIES];
+	int num_ports = 0, i, j0, j1, j2, j3;
+	ct_bpf_prog p;
+
+	p.code = code;
+	p.len = 0;
+	p.max = max;
+	p.bad_jump = false;
+
+	/* ctnetlink new/delete events, anything else passes */
+	ct_emit(&p, BPF_LD | BPF_H | BPF_ABS, 0, 0, offsetof(struct nlmsghdr, nlmsg_type));
+	ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 2, 0,
+		htons((NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_NEW));
+	ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 1, 0,
+		htons((NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_DELETE));
+	ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_ACCEPT);
+
+	/* l4 protocol of the original tuple */
+	ct_emit(&p, BPF_LD | BPF_W | BPF_IMM, 0, 0, CT_NFA_OFF);
+	ct_emit_find(&p, false, CTA_TUPLE_ORIG);
+	ct_emit_accept_if_zero(&p);
+	ct_emit(&p, BPF_ST, 0, 0, CT_M_ORIG);
+	ct_emit_find(&p, true, CTA_TUPLE_PROTO);
+	ct_emit_accept_if_zero(&p);
+	ct_emit(&p, BPF_ST, 0, 0, CT_M_PROTO);
+	ct_emit_find(&p, true, CTA_PROTO_NUM);
+	ct_emit_accept_if_zero(&p);
+	ct_emit_load_value(&p, BPF_B);
+	ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, l4proto);
+	ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_REJECT);
+
+	/* tcp: established and fin_wait only, destroy events carry no protoinfo */
+	if(l4proto == IPPROTO_TCP)
+	{
+		ct_emit(&p, BPF_LD | BPF_W | BPF_IMM, 0, 0, CT_NFA_OFF);
+		ct_emit_find(&p, false, CTA_PROTOINFO);
+		j0 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 0);
+		ct_emit_find(&p, true, CTA_PROTOINFO_TCP);
+		j1 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 0);
+		ct_emit_find(&p, true, CTA_PROTOINFO_TCP_STATE);
+		j2 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 0);
+		ct_emit_load_value(&p, BPF_B);
+		for(i = 0; i < (int)(sizeof(tcp_states) / sizeof(tcp_states[0])); i++)
+		{
+			ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K,
+				(uint8_t)(sizeof(tcp_states) / sizeof(tcp_states[0]) - i), 0, tcp_states[i]);
+		}
+		ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_REJECT);
+		ct_patch_jt(&p, j0);
+		ct_patch_jt(&p, j1);
+		ct_patch_jt(&p, j2);
+	}
+
+	/* the rest of the program looks at ipv4 only */
+	ct_emit(&p, BPF_LD | BPF_B | BPF_ABS, 0, 0, NLMSG_HDRLEN + offsetof(struct nfgenmsg, nfgen_family));
+	ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 1, 0, AF_INET);
+#ifdef CT_OPT
+	ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_ACCEPT);
+#else
+	ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_REJECT);
+#endif
+
+	/* original tuple addresses */
+	ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_ORIG);
+	ct_emit_find(&p, true, CTA_TUPLE_IP);
+	ct_emit_accept_if_zero(&p);
+	ct_emit(&p, BPF_ST, 0, 0, CT_M_IP);
+	ct_emit_find(&p, true, CTA_IP_V4_SRC);
+	ct_emit_accept_if_zero(&p);
+	ct_emit_load_value(&p, BPF_W);
+	ct_emit(&p, BPF_ST, 0, 0, CT_M_SRC);
+	ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_IP);
+	ct_emit_find(&p, true, CTA_IP_V4_DST);
+	ct_emit_accept_if_zero(&p);
+	ct_emit_load_value(&p, BPF_W);
+	ct_emit(&p, BPF_ST, 0, 0, CT_M_DST);
+
+	/* local interface, bridge and broadcast addresses */
+	if(num_ignore_src > 0)
+	{
+		ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_SRC);
+		ct_emit_reject_list(&p, ignore_src, num_ignore_src);
+	}
+	if(num_ignore_dst > 0)
+	{
+		ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_DST);
+		ct_emit_reject_list(&p, ignore_dst, num_ignore_dst);
+	}
+
+#ifndef CT_OPT
+	/* with the WAN up, connections which are neither NATed nor
+	 * from/to the WAN address are ignored by ProcessTCPorUDPMsg */
+	if(wan_addr != 0)
+	{
+		ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_SRC);
+		j0 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, wan_addr);
+		ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_DST);
+		j1 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, wan_addr);
+		ct_emit(&p, BPF_LD | BPF_W | BPF_IMM, 0, 0, CT_NFA_OFF);
+		ct_emit_find(&p, false, CTA_STATUS);
+		j2 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 0);
+		ct_emit_load_value(&p, BPF_W);
+		j3 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JSET | BPF_K, 0, 0, IPS_SRC_NAT | IPS_DST_NAT);
+		ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_REJECT);
+		ct_patch_jt(&p, j0);
+		ct_patch_jt(&p, j1);
+		ct_patch_jt(&p, j2);
+		ct_patch_jt(&p, j3);
+	}
+
+	/* ALG ports, NatApp::AddEntry checks the private and target ports,
+	 * which are the source ports of the original and reply tuples */
+	for(i = 0; i < num_alg_ports; i++)
+	{
+		if(alg_ports[i].protocol == l4proto)
+		{
+			ports[num_ports++] = alg_ports[i].port;
+		}
+	}
+	if(num_ports > 0)
+	{
+		ct_emit(&p, BPF_LD | BPF_MEM, 0, 0, CT_M_PROTO);
+		ct_emit_find(&p, true, CTA_PROTO_SRC_PORT);
+		j0 = p.len;
+		ct_emit(&p, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 0);
+		ct_emit_load_value(&p, BPF_H);
+		ct_emit_reject_list(&p, ports, num_ports);
+		ct_patch_jt(&p, j0);
+
+		ct_emit(&p, BPF_LD | BPF_W | BPF_IMM, 0, 0, CT_NFA_OFF);
+		ct_emit_find(&p, false, CTA_TUPLE_REPLY);
+		ct_emit_accept_if_zero(&p);
+		ct_emit_find(&p, true, CTA_TUPLE_PROTO);
+		ct_emit_accept_if_zero(&p);
+		ct_emit_find(&p, true, CTA_PROTO_SRC_PORT);
+		ct_emit_accept_if_zero(&p);
+		ct_emit_load_value(&p, BPF_H);
+		ct_emit_reject_list(&p, ports, num_ports);
+	}
+#endif
+
+	ct_emit(&p, BPF_RET | BPF_K, 0, 0, CT_RET_ACCEPT);
+
+	if(p.len > p.max || p.bad_jump)
+	{
+		IPACMERR("conntrack filter does not fit (%d insns, max %d)\n", p.len, p.max);
+		return -1;
+	}
+
+	return p.len;
+}
+
+int IPACM_ConntrackFilter::Attach(int fd, uint8_t l4proto)
+{
+	struct sock_filter code[IPACM_CT_FLT_MAX_INSNS];
+	struct sock_fprog prog;
+	int len;
+
+	len = Build(l4proto, code, IPACM_CT_FLT_MAX_INSNS);
+	if(len < 0)
+	{
+		return -1;
+	}
+
+	prog.len = (unsigned short)len;
+	prog.filter = code;
+	if(setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+	{
+		IPACMERR("unable to attach conntrack filter on fd %d (%d)\n", fd, errno);
+		return -1;
+	}
+
+	IPACMDBG_H("attached proto %d conntrack filter on fd %d: %d insns, %d/%d ignored src/dst, wan 0x%x\n",
+		l4proto, fd, len, num_ignore_src, num_ignore_dst, wan_addr);
+	return 0;
+}
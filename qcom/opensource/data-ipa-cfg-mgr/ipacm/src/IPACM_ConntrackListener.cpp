@@ -424,6 +424,10 @@ void IPACM_ConntrackListener::TriggerWANUp(void *in_param)
 	 wan_ipaddr = wanup_data->ipv4_addr;
 	 memcpy(wan_ifname, wanup_data->ifname, sizeof(wan_ifname));
 
+	 /* drop events of connections neither NATed nor to/from the new WAN address */
+	 IPACM_ConntrackClient::UpdateUDPFilters(wanup_data, true);
+	 IPACM_ConntrackClient::UpdateTCPFilters(wanup_data, true);
+
 	 if(nat_inst != NULL)
 	 {
 		 if (wanup_data->mux_id == 0)
@@ -525,6 +529,10 @@ void IPACM_ConntrackListener::TriggerWANDown(uint32_t wan_addr)
 
 		 WanUp = false;
 		 wan_ipaddr = 0;
+
+		 /* events are cached while the WAN is down, let them all through */
+		 IPACM_ConntrackClient::UpdateUDPFilters(NULL, true);
+		 IPACM_ConntrackClient::UpdateTCPFilters(NULL, true);
 	 }
 }
 
@@ -736,6 +744,7 @@ void IPACM_ConntrackListener::ProcessCTMessage(void *param)
 	 if(IPPROTO_UDP != l4proto && IPPROTO_TCP != l4proto)
 	 {
 			IPACMDBG("Received unexpected protocl %d conntrack message\n", l4proto);
+			IPACM_ConntrackClient::ct_stats.ignored++;
 	 }
 	 else
 	 {
@@ -1198,6 +1207,10 @@ bool IPACM_ConntrackListener::ProcessTCPorUDPMsg(
 	return cache_ct;
 
 IGNORE:
+	if(!cache_ct)
+	{
+		IPACM_ConntrackClient::ct_stats.ignored++;
+	}
 	IPACMDBG_H("ignoring below Nat Entry\n");
 	iptodot("ProcessTCPorUDPMsg(): target ip or dst ip", rule.target_ip);
 	IPACMDBG("target port or dst port: 0x%x Decimal:%d\n", rule.target_port, rule.target_port);
@@ -47,14 +47,42 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 	( strcasesame(mem_type, "HYBRID" ) || \
 	  strcasesame(mem_type, "SRAM" ) )
 
+/* Holds NatApp::cache_lock for the enclosing scope */
+class NatCacheGuard
+{
+public:
+	NatCacheGuard(pthread_mutex_t *lock) : m_lock(lock)
+	{
+		pthread_mutex_lock(m_lock);
+	}
+	~NatCacheGuard()
+	{
+		pthread_mutex_unlock(m_lock);
+	}
+private:
+	pthread_mutex_t *m_lock;
+};
+
 /* NatApp class Implementation */
 NatApp *NatApp::pInstance = NULL;
 NatApp::NatApp()
 {
+	pthread_mutexattr_t attr;
+
 	max_entries = 0;
 	mem_type = NULL;
 
 	cache = NULL;
+	hash_tbl = NULL;
+	hash_mask = 0;
+	slot_order = NULL;
+	slot_pos = NULL;
+	clnt_next = NULL;
+	clnt_prev = NULL;
+	for(int cnt = 0; cnt < NAT_CLNT_BUCKETS; cnt++)
+	{
+		clnt_head[cnt] = NAT_SLOT_NONE;
+	}
 
 	nat_table_hdl = 0;
 	pub_ip_addr = 0;
@@ -69,6 +97,13 @@ NatApp::NatApp()
 	ct_hdl = NULL;
 
 	memset(temp, 0, sizeof(temp));
+
+	/* recursive, UpdateCTUdpTs() and FlushTempEntries() re-enter the cache */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&cache_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
 	m_fd_ipa = open(IPA_DEVICE_NAME, O_RDWR);
 	if(m_fd_ipa < 0)
 	{
@@ -81,12 +116,14 @@ NatApp::~NatApp()
 	if (m_fd_ipa) {
 		close(m_fd_ipa);
 	}
+	pthread_mutex_destroy(&cache_lock);
 }
 
 int NatApp::Init(void)
 {
 	IPACM_Config *pConfig;
 	int size = 0;
+	uint32_t hash_size;
 
 	pConfig = IPACM_Config::GetInstance();
 	if(pConfig == NULL)
@@ -109,6 +146,38 @@ int NatApp::Init(void)
 	IPACMDBG("Allocated %d bytes for config manager nat cache\n", size);
 	memset(cache, 0, size);
 
+	/* keep the tuple index at most half full */
+	hash_size = 1;
+	while(hash_size < 2 * (uint32_t)max_entries)
+	{
+		hash_size <<= 1;
+	}
+	hash_mask = hash_size - 1;
+
+	hash_tbl = (int32_t *)malloc(sizeof(int32_t) * hash_size);
+	slot_order = (int32_t *)malloc(sizeof(int32_t) * max_entries);
+	slot_pos = (int32_t *)malloc(sizeof(int32_t) * max_entries);
+	clnt_next = (int32_t *)malloc(sizeof(int32_t) * max_entries);
+	clnt_prev = (int32_t *)malloc(sizeof(int32_t) * max_entries);
+	if(hash_tbl == NULL || slot_order == NULL || slot_pos == NULL ||
+		 clnt_next == NULL || clnt_prev == NULL)
+	{
+		IPACMERR("Unable to allocate memory for cache index\n");
+		goto fail;
+	}
+
+	for(uint32_t cnt = 0; cnt < hash_size; cnt++)
+	{
+		hash_tbl[cnt] = NAT_SLOT_NONE;
+	}
+	for(int cnt = 0; cnt < max_entries; cnt++)
+	{
+		slot_order[cnt] = cnt;
+		slot_pos[cnt] = cnt;
+		clnt_next[cnt] = NAT_SLOT_NONE;
+		clnt_prev[cnt] = NAT_SLOT_NONE;
+	}
+
 	nALGPort = pConfig->GetAlgPortCnt();
 	if(nALGPort > 0)
 	{
@@ -134,6 +203,12 @@ int NatApp::Init(void)
 		goto fail;
 	}
 
+	/* coalesce rule adds/deletes of connection storms into fewer DMA commands */
+	if(ipa_nat_set_batch_mode(NAT_BATCH_MAX_RULES, NAT_BATCH_MAX_DELAY_MS))
+	{
+		IPACMERR("Unable to enable nat rule batching, committing rules one by one\n");
+	}
+
 	return 0;
 
 fail:
@@ -141,6 +216,11 @@ fail:
 	{
 		free(cache);
 	}
+	free(hash_tbl);
+	free(slot_order);
+	free(slot_pos);
+	free(clnt_next);
+	free(clnt_prev);
 	if(pALGPorts != NULL)
 	{
 		free(pALGPorts);
@@ -173,9 +253,10 @@ uint32_t NatApp::GenerateMetdata(uint8_t mux_id)
 int NatApp::AddTable(uint32_t pub_ip, uint8_t mux_id)
 {
 	int ret;
-	int cnt = 0;
+	int cnt = 0, pos;
 	ipa_nat_ipv4_rule nat_rule;
 	IPACMDBG_H("%s() %d\n", __FUNCTION__, __LINE__);
+	NatCacheGuard guard(&cache_lock);
 
 	/* Not reset the cache wait it timeout by destroy event */
 #if 0
@@ -210,8 +291,10 @@ int NatApp::AddTable(uint32_t pub_ip, uint8_t mux_id)
 	if (pub_ip == pub_ip_addr_pre)
 	{
 		IPACMDBG("Restore the cache to ipa NAT-table\n");
-		for(cnt = 0; cnt < max_entries; cnt++)
+		/* walk backwards, FreeEntry() moves the last used slot into place */
+		for(pos = curCnt - 1; pos >= 0; pos--)
 		{
+			cnt = slot_order[pos];
 			if(cache[cnt].private_ip !=0)
 			{
 				memset(&nat_rule, 0 , sizeof(nat_rule));
@@ -225,8 +308,7 @@ int NatApp::AddTable(uint32_t pub_ip, uint8_t mux_id)
 				if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
 				{
 					IPACMERR("unable to add the rule delete from cache\n");
-					memset(&cache[cnt], 0, sizeof(cache[cnt]));
-					curCnt--;
+					FreeEntry(cnt);
 					continue;
 				}
 				cache[cnt].enabled = true;
@@ -272,9 +354,10 @@ void NatApp::Reset()
 
 int NatApp::DeleteTable(uint32_t pub_ip)
 {
-	int cnt = 0;
+	int cnt = 0, pos;
 	int ret;
 	IPACMDBG_H("%s() %d\n", __FUNCTION__, __LINE__);
+	NatCacheGuard guard(&cache_lock);
 
 	CHK_TBL_HDL();
 
@@ -286,8 +369,9 @@ int NatApp::DeleteTable(uint32_t pub_ip)
 	}
 
 	/* NAT tbl deleted, reset enabled bit */
-	for(cnt = 0; cnt < max_entries; cnt++)
+	for(pos = 0; pos < curCnt; pos++)
 	{
+		cnt = slot_order[pos];
 		cache[cnt].enabled = false;
 		/* send connections del info to pcie modem first */
 		if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
@@ -333,24 +417,161 @@ int NatApp::MoveTable(bool to_ddr)
 	return ret;
 }
 
+uint32_t NatApp::HashTuple(const nat_table_entry *rule)
+{
+	uint32_t h;
+
+	h = rule->private_ip * 0x9E3779B1;
+	h ^= rule->target_ip * 0x85EBCA77;
+	h ^= (((uint32_t)rule->private_port << 16) | rule->target_port) * 0xC2B2AE3D;
+	h ^= rule->protocol;
+
+	/* murmur3 finalizer */
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
+}
+
+uint32_t NatApp::HashClnt(uint32_t ip_addr)
+{
+	return ((ip_addr * 0x9E3779B1) >> 16) & (NAT_CLNT_BUCKETS - 1);
+}
+
+/* Return the cache slot holding the 5-tuple of rule, or NAT_SLOT_NONE */
+int NatApp::FindEntry(const nat_table_entry *rule)
+{
+	uint32_t i;
+	int32_t idx;
+
+	for(i = HashTuple(rule) & hash_mask; (idx = hash_tbl[i]) != NAT_SLOT_NONE;
+		i = (i + 1) & hash_mask)
+	{
+		if(cache[idx].private_ip == rule->private_ip &&
+			 cache[idx].target_ip == rule->target_ip &&
+			 cache[idx].private_port ==  rule->private_port  &&
+			 cache[idx].target_port == rule->target_port &&
+			 cache[idx].protocol == rule->protocol)
+		{
+			return idx;
+		}
+	}
+
+	return NAT_SLOT_NONE;
+}
+
+/* Take a free cache slot, fill in the 5-tuple of rule and index it */
+int NatApp::AllocEntry(const nat_table_entry *rule)
+{
+	uint32_t i;
+	int32_t idx, bkt;
+
+	if(curCnt >= max_entries)
+	{
+		return NAT_SLOT_NONE;
+	}
+
+	idx = slot_order[curCnt++];
+	memset(&cache[idx], 0, sizeof(cache[idx]));
+	cache[idx].private_ip = rule->private_ip;
+	cache[idx].target_ip = rule->target_ip;
+	cache[idx].private_port = rule->private_port;
+	cache[idx].target_port = rule->target_port;
+	cache[idx].protocol = rule->protocol;
+
+	for(i = HashTuple(rule) & hash_mask; hash_tbl[i] != NAT_SLOT_NONE;
+		i = (i + 1) & hash_mask);
+	hash_tbl[i] = idx;
+
+	bkt = HashClnt(rule->private_ip);
+	clnt_prev[idx] = NAT_SLOT_NONE;
+	clnt_next[idx] = clnt_head[bkt];
+	if(clnt_head[bkt] != NAT_SLOT_NONE)
+	{
+		clnt_prev[clnt_head[bkt]] = idx;
+	}
+	clnt_head[bkt] = idx;
+
+	return idx;
+}
+
+/* Drop cache slot idx from all indexes and return it to the free pool */
+void NatApp::FreeEntry(int idx)
+{
+	uint32_t i, j, n, home;
+	int32_t last, pos;
+
+	/* backward shift deletion keeps probe chains without tombstones */
+	for(i = HashTuple(&cache[idx]) & hash_mask, n = 0; hash_tbl[i] != idx;
+		i = (i + 1) & hash_mask, n++)
+	{
+		if(hash_tbl[i] == NAT_SLOT_NONE || n > hash_mask)
+		{
+			IPACMERR("cache slot %d missing from tuple index\n", idx);
+			assert(0);
+			break;
+		}
+	}
+	if(hash_tbl[i] == idx)
+	{
+		j = i;
+		while(1)
+		{
+			j = (j + 1) & hash_mask;
+			if(hash_tbl[j] == NAT_SLOT_NONE)
+			{
+				break;
+			}
+			home = HashTuple(&cache[hash_tbl[j]]) & hash_mask;
+			/* move j into the hole at i unless its home lies in (i, j] */
+			if(((j - home) & hash_mask) >= ((j - i) & hash_mask))
+			{
+				hash_tbl[i] = hash_tbl[j];
+				i = j;
+			}
+		}
+		hash_tbl[i] = NAT_SLOT_NONE;
+	}
+
+	if(clnt_prev[idx] != NAT_SLOT_NONE)
+	{
+		clnt_next[clnt_prev[idx]] = clnt_next[idx];
+	}
+	else
+	{
+		clnt_head[HashClnt(cache[idx].private_ip)] = clnt_next[idx];
+	}
+	if(clnt_next[idx] != NAT_SLOT_NONE)
+	{
+		clnt_prev[clnt_next[idx]] = clnt_prev[idx];
+	}
+	clnt_next[idx] = NAT_SLOT_NONE;
+	clnt_prev[idx] = NAT_SLOT_NONE;
+
+	memset(&cache[idx], 0, sizeof(cache[idx]));
+
+	/* swap idx with the last used slot */
+	curCnt--;
+	pos = slot_pos[idx];
+	last = slot_order[curCnt];
+	slot_order[pos] = last;
+	slot_pos[last] = pos;
+	slot_order[curCnt] = idx;
+	slot_pos[idx] = curCnt;
+}
+
 /* Check for duplicate entries */
 bool NatApp::ChkForDup(const nat_table_entry *rule)
 {
-	int cnt = 0;
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
 
-	for(; cnt < max_entries; cnt++)
+	if(FindEntry(rule) != NAT_SLOT_NONE)
 	{
-		if(cache[cnt].private_ip == rule->private_ip &&
-			 cache[cnt].target_ip == rule->target_ip &&
-			 cache[cnt].private_port ==  rule->private_port  &&
-			 cache[cnt].target_port == rule->target_port &&
-			 cache[cnt].protocol == rule->protocol)
-		{
-			log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
-			rule->target_port,"Duplicate Rule\n");
-			return true;
-		}
+		log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
+		rule->target_port,"Duplicate Rule\n");
+		return true;
 	}
 
 	return false;
@@ -362,53 +583,45 @@ int NatApp::DeleteEntry(const nat_table_entry *rule)
 	int cnt = 0;
 	int ret = 0;
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
+	NatCacheGuard guard(&cache_lock);
 
 	log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
 	rule->target_port,"for deletion\n");
 
 
-	for(; cnt < max_entries; cnt++)
+	cnt = FindEntry(rule);
+	if(cnt != NAT_SLOT_NONE)
 	{
-		if(cache[cnt].private_ip == rule->private_ip &&
-			 cache[cnt].target_ip == rule->target_ip &&
-			 cache[cnt].private_port ==  rule->private_port  &&
-			 cache[cnt].target_port == rule->target_port &&
-			 cache[cnt].protocol == rule->protocol)
+		if(cache[cnt].enabled == true)
 		{
-
-			if(cache[cnt].enabled == true)
+			/* send connections del info to pcie modem first */
+			if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
 			{
-				/* send connections del info to pcie modem first */
-				if ((CtList->backhaul_mode == Q6_MHI_WAN) && (cache[cnt].dst_nat == true || cache[cnt].protocol == IPPROTO_TCP) && (cache[cnt].rule_id > 0))
+				ret = DelConnection(cache[cnt].rule_id);
+				if(ret)
 				{
-					ret = DelConnection(cache[cnt].rule_id);
-					if(ret)
-					{
-						IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
-					}
-					else
-					{
-						/* save the rule id for deletion */
-						cache[cnt].rule_id = 0;
-					}
+					IPACMERR("unable to del Connection to pcie modem: %d\n", ret);
 				}
-
-				if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
+				else
 				{
-					IPACMERR("%s() %d deletion failed\n", __FUNCTION__, __LINE__);
+					/* save the rule id for deletion */
+					cache[cnt].rule_id = 0;
 				}
-
-				IPACMDBG_H("Deleted Nat entry(%d) Successfully\n", cnt);
 			}
-			else
+
+			if(ipa_nat_del_ipv4_rule(nat_table_hdl, cache[cnt].rule_hdl) < 0)
 			{
-				IPACMDBG_H("Deleted Nat entry(%d) only from cache\n", cnt);
+				IPACMERR("%s() %d deletion failed\n", __FUNCTION__, __LINE__);
 			}
 
-			memset(&cache[cnt], 0, sizeof(cache[cnt]));
-			curCnt--;
-			break;
+			IPACMDBG_H("Deleted Nat entry(%d) Successfully\n", cnt);
+		}
+		else
+		{
+			IPACMDBG_H("Deleted Nat entry(%d) only from cache\n", cnt);
 		}
+
+		FreeEntry(cnt);
 	}
 
 	return 0;
@@ -422,6 +635,7 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 	int ret = 0;
 
 	IPACMDBG("%s() %d\n", __FUNCTION__, __LINE__);
+	NatCacheGuard guard(&cache_lock);
 
 	CHK_TBL_HDL();
 	log_nat(rule->protocol,rule->private_ip,rule->target_ip,rule->private_port,\
@@ -445,19 +659,8 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 
 	if(!ChkForDup(rule))
 	{
-		for(; cnt < max_entries; cnt++)
-		{
-			if(cache[cnt].private_ip == 0 &&
-				 cache[cnt].target_ip == 0 &&
-				 cache[cnt].private_port == 0  &&
-				 cache[cnt].target_port == 0 &&
-				 cache[cnt].protocol == 0)
-			{
-				break;
-			}
-		}
-
-		if(max_entries == cnt)
+		cnt = AllocEntry(rule);
+		if(cnt == NAT_SLOT_NONE)
 		{
 			IPACMERR("Error: Unable to add, reached maximum rules\n");
 			return -1;
@@ -485,6 +688,7 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 				if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
 				{
 					IPACMERR("unable to add the rule\n");
+					FreeEntry(cnt);
 					return -1;
 				}
 
@@ -506,15 +710,9 @@ int NatApp::AddEntry(const nat_table_entry *rule)
 					}
 				}
 			}
-			cache[cnt].private_ip = rule->private_ip;
-			cache[cnt].target_ip = rule->target_ip;
-			cache[cnt].target_port = rule->target_port;
-			cache[cnt].private_port = rule->private_port;
-			cache[cnt].protocol = rule->protocol;
 			cache[cnt].timestamp = 0;
 			cache[cnt].public_port = rule->public_port;
 			cache[cnt].dst_nat = rule->dst_nat;
-			curCnt++;
 		}
 
 	}
@@ -796,7 +994,7 @@ void NatApp::UpdateCTUdpTs(nat_table_entry *rule, uint32_t new_ts)
 
 void NatApp::UpdateUDPTimeStamp()
 {
-	int cnt;
+	int cnt, pos;
 	uint32_t ts;
 	bool read_to = false;
 	bool keep_awake;
@@ -814,8 +1012,24 @@ void NatApp::UpdateUDPTimeStamp()
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	pthread_mutex_lock(&cache_lock);
+	pos = curCnt - 1;
+	pthread_mutex_unlock(&cache_lock);
+
+	/*
+	 * walk backwards, UpdateCTUdpTs() may delete the current entry. The
+	 * lock is taken per entry so conntrack events are not held off for
+	 * the whole walk, entries freed meanwhile shrink curCnt below pos.
+	 */
+	for(; pos >= 0; pos--)
 	{
+		NatCacheGuard guard(&cache_lock);
+
+		if(pos >= curCnt)
+		{
+			continue;
+		}
+		cnt = slot_order[pos];
 		ts = 0;
 		if(cache[cnt].enabled == true &&
 		   (cache[cnt].private_ip != cache[cnt].public_ip))
@@ -855,6 +1069,55 @@ void NatApp::UpdateUDPTimeStamp()
 	}
 }
 
+void NatApp::DumpHashHist(const char *name, const uint32_t *hist)
+{
+	IPACMDBG_H("%-26s %u %u %u %u %u %u %u %u+\n", name,
+		hist[0], hist[1], hist[2], hist[3],
+		hist[4], hist[5], hist[6], hist[7]);
+}
+
+/* Log how evenly the IPA's dst_hash/src_hash spread the current rules */
+void NatApp::DumpHashStats()
+{
+	ipa_nat_hash_stats nat_stats, idx_stats;
+	bool keep_awake;
+	int ret;
+
+	if(nat_table_hdl == 0)
+	{
+		return;
+	}
+
+	keep_awake = ( max_entries && SRAM_IN_USE() && ipa_nat_is_sram_supported() );
+
+	if ( keep_awake && ipa_nat_vote_clock(IPA_APP_CLK_VOTE) != 0 )
+	{
+		IPACMERR("Voting clock on failed\n");
+		return;
+	}
+
+	ret = ipa_nat_get_hash_stats(nat_table_hdl, &nat_stats, &idx_stats);
+
+	if ( keep_awake && ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != 0 )
+	{
+		IPACMERR("Voting clock off failed\n");
+	}
+
+	if(ret)
+	{
+		IPACMERR("unable to get nat hash stats Error: %d\n", ret);
+		return;
+	}
+
+	IPACMDBG_H("NAT hash stats for %d entries, records 1 2 3 4 5 6 7 8+\n", curCnt);
+	DumpHashHist("dst_hash chain_len", nat_stats.chain_len);
+	DumpHashHist("dst_hash lookup_probes", nat_stats.lookup_probes);
+	DumpHashHist("dst_hash insert_probes", nat_stats.insert_probes);
+	DumpHashHist("src_hash chain_len", idx_stats.chain_len);
+	DumpHashHist("src_hash lookup_probes", idx_stats.lookup_probes);
+	DumpHashHist("src_hash insert_probes", idx_stats.insert_probes);
+}
+
 bool NatApp::isAlgPort(uint8_t proto, uint16_t port)
 {
 	int cnt;
@@ -888,8 +1151,9 @@ bool NatApp::isPwrSaveIf(uint32_t ip_addr)
 
 int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 {
-	int cnt, ret;
+	int cnt, ret, next;
 	IPACMDBG_H("Received IP address: 0x%x\n", client_lan_ip);
+	NatCacheGuard guard(&cache_lock);
 
 	if(client_lan_ip == INVALID_IP_ADDR)
 	{
@@ -916,8 +1180,9 @@ int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	for(cnt = clnt_head[HashClnt(client_lan_ip)]; cnt != NAT_SLOT_NONE; cnt = next)
 	{
+		next = clnt_next[cnt];
 		if(cache[cnt].private_ip == client_lan_ip &&
 			 cache[cnt].enabled == true)
 		{
@@ -952,10 +1217,11 @@ int NatApp::UpdatePwrSaveIf(uint32_t client_lan_ip)
 
 int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 {
-	int cnt, ret;
+	int cnt, ret, next;
 	ipa_nat_ipv4_rule nat_rule;
 
 	IPACMDBG_H("Received ip address: 0x%x\n", client_lan_ip);
+	NatCacheGuard guard(&cache_lock);
 
 	if(client_lan_ip == INVALID_IP_ADDR)
 	{
@@ -972,8 +1238,9 @@ int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	for(cnt = clnt_head[HashClnt(client_lan_ip)]; cnt != NAT_SLOT_NONE; cnt = next)
 	{
+		next = clnt_next[cnt];
 		IPACMDBG("cache (%d): enable %d, ip 0x%x\n", cnt, cache[cnt].enabled, cache[cnt].private_ip);
 
 		if(cache[cnt].private_ip == client_lan_ip &&
@@ -990,8 +1257,7 @@ int NatApp::ResetPwrSaveIf(uint32_t client_lan_ip)
 			if(ipa_nat_add_ipv4_rule(nat_table_hdl, &nat_rule, &cache[cnt].rule_hdl) < 0)
 			{
 				IPACMERR("unable to add the rule delete from cache\n");
-				memset(&cache[cnt], 0, sizeof(cache[cnt]));
-				curCnt--;
+				FreeEntry(cnt);
 				continue;
 			}
 			cache[cnt].enabled = true;
@@ -1044,6 +1310,7 @@ void NatApp::AddTempEntry(const nat_table_entry *new_entry)
 	iptodot("Target IP", new_entry->target_ip);
 	IPACMDBG("Private Port: %d\t Target Port: %d\t", new_entry->private_port, new_entry->target_port);
 	IPACMDBG("protocolcol: %d\n", new_entry->protocol);
+	NatCacheGuard guard(&cache_lock);
 
 	if(isAlgPort(new_entry->protocol, new_entry->private_port) ||
 		 isAlgPort(new_entry->protocol, new_entry->target_port))
@@ -1094,6 +1361,7 @@ void NatApp::DeleteTempEntry(const nat_table_entry *entry)
 	iptodot("Target IP", entry->target_ip);
 	IPACMDBG("Private Port: %d\t Target Port: %d\n", entry->private_port, entry->target_port);
 	IPACMDBG("protocol: %d\n", entry->protocol);
+	NatCacheGuard guard(&cache_lock);
 
 	for(cnt=0; cnt<MAX_TEMP_ENTRIES; cnt++)
 	{
@@ -1121,6 +1389,7 @@ void NatApp::FlushTempEntries(uint32_t ip_addr, bool isAdd,
 
 	IPACMDBG_H("Received below with isAdd:%d ", isAdd);
 	iptodot("IP Address: ", ip_addr);
+	NatCacheGuard guard(&cache_lock);
 
 	for(cnt=0; cnt<MAX_TEMP_ENTRIES; cnt++)
 	{
@@ -1156,8 +1425,9 @@ void NatApp::FlushTempEntries(uint32_t ip_addr, bool isAdd,
 
 int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 {
-	int cnt, tmp = 0, ret;
+	int cnt, tmp = 0, ret, next;
 	IPACMDBG_H("Received IP address: 0x%x\n", ip_addr);
+	NatCacheGuard guard(&cache_lock);
 
 	if(ip_addr == INVALID_IP_ADDR)
 	{
@@ -1175,8 +1445,9 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 		}
 	}
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	for(cnt = clnt_head[HashClnt(ip_addr)]; cnt != NAT_SLOT_NONE; cnt = next)
 	{
+		next = clnt_next[cnt];
 		if(cache[cnt].private_ip == ip_addr)
 		{
 			if(cache[cnt].enabled == true)
@@ -1218,8 +1489,10 @@ int NatApp::DelEntriesOnClntDiscon(uint32_t ip_addr)
 
 int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 {
-	int cnt, tmp = curCnt, ret;
+	int cnt, pos, tmp, ret;
 	IPACMDBG_H("Received IP address: 0x%x\n", ip_addr);
+	NatCacheGuard guard(&cache_lock);
+	tmp = curCnt;
 
 	if(ip_addr == INVALID_IP_ADDR)
 	{
@@ -1228,8 +1501,10 @@ int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 	}
 
 
-	for(cnt = 0; cnt < max_entries; cnt++)
+	/* walk backwards, FreeEntry() moves the last used slot into place */
+	for(pos = curCnt - 1; pos >= 0; pos--)
 	{
+		cnt = slot_order[pos];
 		if(cache[cnt].target_ip == ip_addr)
 		{
 			if(cache[cnt].enabled == true)
@@ -1256,8 +1531,7 @@ int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 				}
 			}
 
-			memset(&cache[cnt], 0, sizeof(cache[cnt]));
-			curCnt--;
+			FreeEntry(cnt);
 		}
 	}
 
@@ -1268,6 +1542,7 @@ int NatApp::DelEntriesOnSTAClntDiscon(uint32_t ip_addr)
 void NatApp::CacheEntry(const nat_table_entry *rule)
 {
 	int cnt;
+	NatCacheGuard guard(&cache_lock);
 
 	if(rule->private_ip == 0 ||
 		 rule->target_ip == 0 ||
@@ -1281,19 +1556,8 @@ void NatApp::CacheEntry(const nat_table_entry *rule)
 
 	if(!ChkForDup(rule))
 	{
-		for(cnt=0; cnt < max_entries; cnt++)
-		{
-			if(cache[cnt].private_ip == 0 &&
-				 cache[cnt].target_ip == 0 &&
-				 cache[cnt].private_port == 0  &&
-				 cache[cnt].target_port == 0 &&
-				 cache[cnt].protocol == 0)
-			{
-				break;
-			}
-		}
-
-		if(max_entries == cnt)
+		cnt = AllocEntry(rule);
+		if(cnt == NAT_SLOT_NONE)
 		{
 			IPACMERR("Error: Unable to add, reached maximum rules\n");
 			return;
@@ -1302,16 +1566,10 @@ void NatApp::CacheEntry(const nat_table_entry *rule)
 		{
 			cache[cnt].enabled = false;
 			cache[cnt].rule_hdl = 0;
-			cache[cnt].private_ip = rule->private_ip;
-			cache[cnt].target_ip = rule->target_ip;
-			cache[cnt].target_port = rule->target_port;
-			cache[cnt].private_port = rule->private_port;
-			cache[cnt].protocol = rule->protocol;
 			cache[cnt].timestamp = 0;
 			cache[cnt].public_port = rule->public_port;
 			cache[cnt].public_ip = rule->public_ip;
 			cache[cnt].dst_nat = rule->dst_nat;
-			curCnt++;
 		}
 
 	}
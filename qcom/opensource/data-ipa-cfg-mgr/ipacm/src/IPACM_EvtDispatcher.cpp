@@ -38,24 +38,39 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include <string.h>
 #include <pthread.h>
+#include <time.h>
 #include <IPACM_EvtDispatcher.h>
 #include <IPACM_Neighbor.h>
 #include "IPACM_CmdQueue.h"
 #include "IPACM_Defs.h"
+#include "IPACM_Iface.h"
+#include "IPACM_RuleTxn.h"
 
 
-extern pthread_mutex_t mutex;
-extern pthread_cond_t  cond_var;
-
-cmd_evts *IPACM_EvtDispatcher::head = NULL;
+cmd_evts_list IPACM_EvtDispatcher::subscribers[IPACM_EVENT_MAX];
+int IPACM_EvtDispatcher::dispatch_depth = 0;
+bool IPACM_EvtDispatcher::has_stale = false;
 extern uint32_t ipacm_event_stats[IPACM_EVENT_MAX];
+extern uint64_t ipacm_event_dispatch_us[IPACM_EVENT_MAX];
+extern uint32_t ipacm_event_dispatch_max_us[IPACM_EVENT_MAX];
+extern uint64_t ipacm_event_rule_ioctls[IPACM_EVENT_MAX];
+extern uint64_t ipacm_event_commits_saved[IPACM_EVENT_MAX];
+extern uint64_t ipacm_event_commits_failed[IPACM_EVENT_MAX];
+
+static uint64_t ipacm_evt_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
 int IPACM_EvtDispatcher::PostEvt
 (
 	 ipacm_cmd_q_data *data
 )
 {
-	Message *item = NULL;
+	cmd_t evt;
 	MessageQueue *MsgQueue = NULL;
 
 	if(data->event < IPA_EXTERNAL_EVENT_MAX)
@@ -74,41 +89,13 @@ int IPACM_EvtDispatcher::PostEvt
 		return IPACM_FAILURE;
 	}
 
-	item = new Message();
-	if(item == NULL)
-	{
-		IPACMERR("unable to create new message item\n");
-		return IPACM_FAILURE;
-	}
-
-	item->evt.callback_ptr = IPACM_EvtDispatcher::ProcessEvt;
-	memcpy(&item->evt.data, data, sizeof(ipacm_cmd_q_data));
+	evt.callback_ptr = IPACM_EvtDispatcher::ProcessEvt;
+	memcpy(&evt.data, data, sizeof(ipacm_cmd_q_data));
 
-	if(pthread_mutex_lock(&mutex) != 0)
+	IPACMDBG("Enqueing event %d\n", data->event);
+	if(MsgQueue->enqueue(&evt) != IPACM_SUCCESS)
 	{
-		IPACMERR("unable to lock the mutex\n");
-		return IPACM_FAILURE;
-	}
-
-	IPACMDBG("Enqueing item\n");
-	MsgQueue->enqueue(item);
-	IPACMDBG("Enqueued item %pK\n", item);
-
-	if(pthread_cond_signal(&cond_var) != 0)
-	{
-		IPACMDBG("unable to lock the mutex\n");
-		/* Release the mutex before you return failure */
-		if(pthread_mutex_unlock(&mutex) != 0)
-		{
-			IPACMERR("unable to unlock the mutex\n");
-			return IPACM_FAILURE;
-		}
-		return IPACM_FAILURE;
-	}
-
-	if(pthread_mutex_unlock(&mutex) != 0)
-	{
-		IPACMERR("unable to unlock the mutex\n");
+		IPACMERR("unable to enqueue event %d\n", data->event);
 		return IPACM_FAILURE;
 	}
 
@@ -117,28 +104,91 @@ int IPACM_EvtDispatcher::PostEvt
 
 void IPACM_EvtDispatcher::ProcessEvt(ipacm_cmd_q_data *data)
 {
+	cmd_evts *tmp;
+	IPACM_Listener *obj;
+	uint64_t start_us, cb_us;
+	const char *eventName;
+	ipacm_rule_txn_stats txn_stats;
 
-	cmd_evts *tmp = head, tmp1;
-
-	if(head == NULL)
+	if(data->event >= IPACM_EVENT_MAX)
 	{
-		IPACMDBG("Queue is empty\n");
+		IPACMERR("invalid event %d\n", data->event);
 	}
-
-	while(tmp != NULL)
+	else
 	{
-	        memcpy(&tmp1, tmp, sizeof(tmp1));
-		if(data->event == tmp1.event)
+		if(subscribers[data->event].head == NULL)
+		{
+			IPACMDBG("No listener for event %d\n", data->event);
+		}
+
+		/* listeners may (de)register from within their callback, new nodes
+		 * are appended at the tail and removed ones are only tombstoned */
+		dispatch_depth++;
+		/* all listeners of one event share a single flt/rt commit per ip family */
+		IPACM_RuleTxn::begin();
+		for(tmp = subscribers[data->event].head; tmp != NULL; tmp = tmp->next)
 		{
+			obj = tmp->obj;
+			if(obj == NULL)
+			{
+				continue;
+			}
+
 			ipacm_event_stats[data->event]++;
-			tmp1.obj->event_callback(data->event, data->evt_data);
+			start_us = ipacm_evt_now_us();
+			obj->event_callback(data->event, data->evt_data);
+			cb_us = ipacm_evt_now_us() - start_us;
+
+			ipacm_event_dispatch_us[data->event] += cb_us;
+			if(cb_us > ipacm_event_dispatch_max_us[data->event])
+			{
+				ipacm_event_dispatch_max_us[data->event] = (uint32_t)cb_us;
+			}
+			if(cb_us > IPACM_EVT_SLOW_DISPATCH_US)
+			{
+				eventName = IPACM_Iface::ipacmcfg->getEventName(data->event);
+				IPACMDBG_H("slow listener %pK for event %s: %llu us (avg %llu us)\n",
+					obj, (eventName != NULL) ? eventName : "unknown",
+					(unsigned long long)cb_us,
+					(unsigned long long)(ipacm_event_dispatch_us[data->event] /
+						ipacm_event_stats[data->event]));
+			}
 			IPACMDBG(" Find matched registered events\n");
 		}
-	        tmp = tmp1.next;
+		memset(&txn_stats, 0, sizeof(txn_stats));
+		IPACM_RuleTxn::end(&txn_stats);
+		ipacm_event_rule_ioctls[data->event] += txn_stats.rule_ioctls;
+		if(txn_stats.commits_failed > 0)
+		{
+			/* the listeners were told their Commit() succeeded */
+			ipacm_event_commits_failed[data->event] += txn_stats.commits_failed;
+			eventName = IPACM_Iface::ipacmcfg->getEventName(data->event);
+			IPACMERR("event %s: %u held back commits failed (total %llu)\n",
+				(eventName != NULL) ? eventName : "unknown",
+				txn_stats.commits_failed,
+				(unsigned long long)ipacm_event_commits_failed[data->event]);
+		}
+		if(txn_stats.commits_requested > txn_stats.commits_issued)
+		{
+			ipacm_event_commits_saved[data->event] +=
+				txn_stats.commits_requested - txn_stats.commits_issued;
+			eventName = IPACM_Iface::ipacmcfg->getEventName(data->event);
+			IPACMDBG_H("event %s: %u rule ioctls, %u commits issued for %u requested (total saved %llu)\n",
+				(eventName != NULL) ? eventName : "unknown",
+				txn_stats.rule_ioctls, txn_stats.commits_issued,
+				txn_stats.commits_requested,
+				(unsigned long long)ipacm_event_commits_saved[data->event]);
+		}
+		dispatch_depth--;
+
+		if(dispatch_depth == 0 && has_stale)
+		{
+			purge_stale();
+		}
 	}
 
 	IPACMDBG(" Finished process events\n");
-			
+
 	if(data->evt_data != NULL)
 	{
 		IPACMDBG("free the event:%d data: %pK\n", data->event, data->evt_data);
@@ -149,7 +199,13 @@ void IPACM_EvtDispatcher::ProcessEvt(ipacm_cmd_q_data *data)
 
 int IPACM_EvtDispatcher::registr(ipa_cm_event_id event, IPACM_Listener *obj)
 {
-	cmd_evts *tmp = head,*nw;
+	cmd_evts *nw;
+
+	if(event >= IPACM_EVENT_MAX)
+	{
+		IPACMERR("invalid event %d\n", event);
+		return IPACM_FAILURE;
+	}
 
 	nw = (cmd_evts *)malloc(sizeof(cmd_evts));
 	if(nw != NULL)
@@ -163,52 +219,78 @@ int IPACM_EvtDispatcher::registr(ipa_cm_event_id event, IPACM_Listener *obj)
 		return IPACM_FAILURE;
 	}
 
-	if(head == NULL)
+	if(subscribers[event].head == NULL)
 	{
-		head = nw;
+		subscribers[event].head = nw;
 	}
 	else
 	{
-		while(tmp->next)
-		{
-			tmp = tmp->next;
-		}
-		tmp->next = nw;
+		subscribers[event].tail->next = nw;
 	}
+	subscribers[event].tail = nw;
 	return IPACM_SUCCESS;
 }
 
-
-int IPACM_EvtDispatcher::deregistr(IPACM_Listener *param)
+void IPACM_EvtDispatcher::purge_stale(void)
 {
-	cmd_evts *tmp = head,*tmp1,*prev = head;
+	cmd_evts *tmp, *prev, *tmp1;
+	int evt;
 
-	while(tmp != NULL)
+	for(evt = 0; evt < IPACM_EVENT_MAX; evt++)
 	{
-		if(tmp->obj == param)
+		prev = NULL;
+		tmp = subscribers[evt].head;
+		while(tmp != NULL)
 		{
-			tmp1 = tmp;
-			if(tmp == head)
-			{
-				head = head->next;
-			}
-			else if(tmp->next == NULL)
+			if(tmp->obj == NULL)
 			{
-				prev->next = NULL;
+				tmp1 = tmp;
+				if(prev == NULL)
+				{
+					subscribers[evt].head = tmp->next;
+				}
+				else
+				{
+					prev->next = tmp->next;
+				}
+				if(subscribers[evt].tail == tmp)
+				{
+					subscribers[evt].tail = prev;
+				}
+				tmp = tmp->next;
+				free(tmp1);
 			}
 			else
 			{
-				prev->next = tmp->next;
+				prev = tmp;
+				tmp = tmp->next;
 			}
-
-			tmp = tmp->next;
-			free(tmp1);
 		}
-		else
+	}
+	has_stale = false;
+}
+
+int IPACM_EvtDispatcher::deregistr(IPACM_Listener *param)
+{
+	cmd_evts *tmp;
+	int evt;
+
+	/* tombstone first, nodes may still be referenced by an ongoing walk */
+	for(evt = 0; evt < IPACM_EVENT_MAX; evt++)
+	{
+		for(tmp = subscribers[evt].head; tmp != NULL; tmp = tmp->next)
 		{
-			prev = tmp;
-			tmp = tmp->next;
+			if(tmp->obj == param)
+			{
+				tmp->obj = NULL;
+				has_stale = true;
+			}
 		}
 	}
+
+	if(dispatch_depth == 0 && has_stale)
+	{
+		purge_stale();
+	}
 	return IPACM_SUCCESS;
 }
@@ -81,6 +81,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
 #include <IPACM_Log.h>
 #include "IPACM_Defs.h"
 #include "IPACM_Iface.h"
+#include "IPACM_RuleTxn.h"
 
 
 const char *IPACM_Filtering::DEVICE_NAME = "/dev/ipa";
@@ -122,7 +123,7 @@ bool IPACM_Filtering::AddFilteringRule(struct ipa_ioc_add_flt_rule const *ruleTa
 				ruleTable->rules[cnt].rule.attrib.attrib_mask);
 	}
 
-	retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE, ruleTable);
+	retval = ipacm_rule_txn_ioctl(fd, IPA_IOC_ADD_FLT_RULE, IPACM_RULE_TXN_FLT, ruleTable);
 	if (retval != 0)
 	{
 		IPACMERR("Failed adding Filtering rule %pK\n", ruleTable);
@@ -168,7 +169,7 @@ bool IPACM_Filtering::AddFilteringRule_v2(struct ipa_ioc_add_flt_rule_v2 const *
 				((struct ipa_flt_rule_add_v2  *)ruleTable->rules)[cnt].rule.attrib.attrib_mask);
 	}
 
-	retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE_V2, ruleTable);
+	retval = ipacm_rule_txn_ioctl(fd, IPA_IOC_ADD_FLT_RULE_V2, IPACM_RULE_TXN_FLT, ruleTable);
 	if (retval != 0)
 	{
 		for (cnt = 0; cnt < ruleTable->num_rules; cnt++)
@@ -266,7 +267,7 @@ bool IPACM_Filtering::AddFilteringRule_hw_index(struct ipa_ioc_add_flt_rule *rul
 			&flt_rule_entry, sizeof(flt_rule_entry));
 	}
 
-	retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE_V2, ruleTable_v2);
+	retval = ipacm_rule_txn_ioctl(fd, IPA_IOC_ADD_FLT_RULE_V2, IPACM_RULE_TXN_FLT, ruleTable_v2);
 	if (retval != 0)
 	{
 		IPACMERR("Failed adding Filtering rule %pK\n", ruleTable_v2);
@@ -383,7 +384,7 @@ bool IPACM_Filtering::AddFilteringRuleAfter_hw_index(struct ipa_ioc_add_flt_rule
 				&flt_rule_entry, sizeof(flt_rule_entry));
 		}
 
-		retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE_AFTER_V2, ruleTable_v2);
+		retval = ipacm_rule_txn_ioctl(fd, IPA_IOC_ADD_FLT_RULE_AFTER_V2, IPACM_RULE_TXN_FLT, ruleTable_v2);
 		if (retval != 0)
 		{
 			IPACMERR("Failed adding Filtering rule %pK\n", ruleTable_v2);
@@ -445,7 +446,7 @@ bool IPACM_Filtering::AddFilteringRuleAfter(struct ipa_ioc_add_flt_rule_after co
 		IPACMDBG("End point: %d\n", ruleTable->ep);
 		IPACMDBG("commit value: %d\n", ruleTable->commit);
 
-		retval = ioctl(fd, IPA_IOC_ADD_FLT_RULE_AFTER, ruleTable);
+		retval = ipacm_rule_txn_ioctl(fd, IPA_IOC_ADD_FLT_RULE_AFTER, IPACM_RULE_TXN_FLT, ruleTable);
 
 		for (int cnt = 0; cnt<ruleTable->num_rules; cnt++)
 		{
@@ -475,7 +476,7 @@ bool IPACM_Filtering::DeleteFilteringRule(struct ipa_ioc_del_flt_rule *ruleTable
 {
 	int retval = 0;
 
-	retval = ioctl(fd, IPA_IOC_DEL_FLT_RULE, ruleTable);
+	retval = ipacm_rule_txn_ioctl(fd, IPA_IOC_DEL_FLT_RULE, IPACM_RULE_TXN_FLT, ruleTable);
 	if (retval != 0)
 	{
 		IPACMERR("Failed deleting Filtering rule %pK\n", ruleTable);
@@ -490,6 +491,12 @@ bool IPACM_Filtering::Commit(enum ipa_ip_type ip)
 {
 	int retval = 0;
 
+	if (IPACM_RuleTxn::defer_commit(IPACM_RULE_TXN_FLT, ip))
+	{
+		IPACMDBG("Filtering commit held back by rule transaction.\n");
+		return true;
+	}
+
 	retval = ioctl(fd, IPA_IOC_COMMIT_FLT, ip);
 	if (retval != 0)
 	{
@@ -1090,7 +1097,7 @@ bool IPACM_Filtering::ModifyFilteringRule(struct ipa_ioc_mdfy_flt_rule* ruleTabl
 		IPACMDBG("Filter rule:%d attrib mask: 0x%x\n", i, ruleTable->rules[i].rule.attrib.attrib_mask);
 	}
 
-	ret = ioctl(fd, IPA_IOC_MDFY_FLT_RULE, ruleTable);
+	ret = ipacm_rule_txn_ioctl(fd, IPA_IOC_MDFY_FLT_RULE, IPACM_RULE_TXN_FLT, ruleTable);
 
 	for (i = 0; i < ruleTable->num_rules; i++)
 	{
@@ -34,6 +34,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "IPACM_Header.h"
 #include "IPACM_Log.h"
+#include "IPACM_RuleTxn.h"
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -84,6 +85,8 @@ bool IPACM_Header::AddHeader(struct ipa_ioc_add_hdr *pHeaderTableToAdd)
 bool IPACM_Header::DeleteHeader(struct ipa_ioc_del_hdr *pHeaderTableToDelete)
 {
 	int nRetVal = 0;
+	//routing rules held back by a transaction may still point at it in HW
+	IPACM_RuleTxn::flush();
 	//call the Driver ioctl in order to remove header
 	nRetVal = ioctl(m_fd, IPA_IOC_DEL_HDR, pHeaderTableToDelete);
 	IPACMDBG("return value: %d\n", nRetVal);
@@ -224,6 +227,7 @@ bool IPACM_Header::DeleteHeaderProcCtx(uint32_t hdl)
 	pHeaderTable->num_hdls = 1;
 	pHeaderTable->hdl[0].hdl = hdl;
 
+	IPACM_RuleTxn::flush();
 	ret = ioctl(m_fd, IPA_IOC_DEL_HDR_PROC_CTX, pHeaderTable);
 	if(ret != 0)
 	{
@@ -41,6 +41,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include "IPACM_LanToLan.h"
 #include "IPACM_Wlan.h"
+#include "IPACM_RuleTxn.h"
 
 #define __stringify(x...) #x
 
@@ -1007,6 +1008,8 @@ void IPACM_LanToLan_Iface::add_all_inter_interface_client_flt_rule(ipa_ip_type i
 	list<peer_iface_info>::iterator it_iface;
 	list<client_info>::iterator it_client;
 
+	/* one commit for all clients x peers */
+	IPACM_RuleTxn::begin();
 	for(it_iface = m_peer_iface_info.begin(); it_iface != m_peer_iface_info.end(); it_iface++)
 	{
 		IPACMDBG_H("Add flt rules for clients of interface %s.\n", it_iface->peer->get_iface_pointer()->dev_name);
@@ -1015,6 +1018,7 @@ void IPACM_LanToLan_Iface::add_all_inter_interface_client_flt_rule(ipa_ip_type i
 			add_client_flt_rule(&(*it_iface), &(*it_client), iptype);
 		}
 	}
+	IPACM_RuleTxn::end(NULL);
 	return;
 }
 
@@ -48,6 +48,11 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <linux/if.h>
 #include <sys/un.h>
 #include <errno.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <IPACM_Defs.h>
 
 /* start IPACMDIAG socket*/
@@ -100,3 +105,503 @@ void ipacm_log_send( void * user_data)
 	}
 	return;
 }
+
+/* log ring */
+static ipacm_log_ring_hdr_t *ipacm_log_ring = NULL;
+static pthread_mutex_t ipacm_log_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t ipacm_log_ring_retry_ns = 0;
+
+#define IPACM_LOG_RING_RETRY_NS 1000000000ULL /* ring file not there yet */
+#define IPACM_LOG_RING_REC_MAX (sizeof(ipacm_log_ring_rec_t) + \
+	IPACM_LOG_RING_MAX_ARGS * (8 + IPACM_LOG_RING_MAX_STR))
+
+static size_t ipacm_log_ring_file_size(void)
+{
+	return sizeof(ipacm_log_ring_hdr_t) +
+		IPACM_LOG_RING_MAX_FMT * sizeof(ipacm_log_ring_fmt_t) +
+		IPACM_LOG_RING_HEAP_SIZE + IPACM_LOG_RING_SIZE;
+}
+
+static inline ipacm_log_ring_fmt_t *ipacm_log_ring_fmts(ipacm_log_ring_hdr_t *ring)
+{
+	return (ipacm_log_ring_fmt_t *)(ring + 1);
+}
+
+static inline char *ipacm_log_ring_heap(ipacm_log_ring_hdr_t *ring)
+{
+	return (char *)(ipacm_log_ring_fmts(ring) + ring->max_fmt);
+}
+
+static inline uint8_t *ipacm_log_ring_data(ipacm_log_ring_hdr_t *ring)
+{
+	return (uint8_t *)ipacm_log_ring_heap(ring) + ring->heap_size;
+}
+
+static uint64_t ipacm_log_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int ipacm_log_ring_init(const char *path, int create)
+{
+	ipacm_log_ring_hdr_t *ring;
+	size_t size = ipacm_log_ring_file_size();
+	int fd;
+
+	fd = open(path, create ? (O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC) : (O_RDWR | O_CLOEXEC), 0660);
+	if(fd < 0)
+	{
+		return IPACM_FAILURE;
+	}
+	if(create && ftruncate(fd, size) < 0)
+	{
+		close(fd);
+		return IPACM_FAILURE;
+	}
+
+	ring = (ipacm_log_ring_hdr_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(ring == MAP_FAILED)
+	{
+		return IPACM_FAILURE;
+	}
+
+	if(create)
+	{
+		ring->version = IPACM_LOG_RING_VERSION;
+		ring->ring_size = IPACM_LOG_RING_SIZE;
+		ring->max_fmt = IPACM_LOG_RING_MAX_FMT;
+		ring->heap_size = IPACM_LOG_RING_HEAP_SIZE;
+		__atomic_store_n(&ring->magic, IPACM_LOG_RING_MAGIC, __ATOMIC_RELEASE);
+	}
+	else if(__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != IPACM_LOG_RING_MAGIC ||
+		ring->version != IPACM_LOG_RING_VERSION ||
+		ring->ring_size != IPACM_LOG_RING_SIZE ||
+		ring->max_fmt != IPACM_LOG_RING_MAX_FMT ||
+		ring->heap_size != IPACM_LOG_RING_HEAP_SIZE)
+	{
+		munmap(ring, size);
+		return IPACM_FAILURE;
+	}
+
+	__atomic_store_n(&ipacm_log_ring, ring, __ATOMIC_RELEASE);
+	return IPACM_SUCCESS;
+}
+
+ipacm_log_ring_hdr_t *ipacm_log_ring_get(void)
+{
+	ipacm_log_ring_hdr_t *ring = __atomic_load_n(&ipacm_log_ring, __ATOMIC_ACQUIRE);
+	uint64_t now;
+
+	if(ring != NULL)
+	{
+		return ring;
+	}
+
+	/* /data may not be mounted yet, retry once in a while */
+	if(pthread_mutex_trylock(&ipacm_log_ring_lock) != 0)
+	{
+		return NULL;
+	}
+	now = ipacm_log_now_ns();
+	if(ipacm_log_ring == NULL && now >= ipacm_log_ring_retry_ns)
+	{
+		if(ipacm_log_ring_init(IPACMLOG_RING_FILE, 1) != IPACM_SUCCESS)
+		{
+			ipacm_log_ring_retry_ns = now + IPACM_LOG_RING_RETRY_NS;
+		}
+	}
+	pthread_mutex_unlock(&ipacm_log_ring_lock);
+
+	return __atomic_load_n(&ipacm_log_ring, __ATOMIC_ACQUIRE);
+}
+
+/* returns the argument count, -1 if the format can't be stored in binary */
+static int ipacm_log_parse_fmt(const char *fmt, uint8_t *kind)
+{
+	int nargs = 0, lng;
+
+	while(*fmt != '\0')
+	{
+		if(*fmt++ != '%')
+		{
+			continue;
+		}
+		if(*fmt == '%')
+		{
+			fmt++;
+			continue;
+		}
+		while(*fmt != '\0' && strchr("-+ #0123456789.", *fmt) != NULL)
+		{
+			fmt++;
+		}
+		if(*fmt == '*')
+		{
+			return -1;
+		}
+
+		lng = 0;
+		while(*fmt != '\0' && strchr("hlzjtL", *fmt) != NULL)
+		{
+			if(*fmt == 'l' || *fmt == 'z' || *fmt == 't')
+			{
+				lng++;
+			}
+			else if(*fmt == 'j')
+			{
+				lng = 2;
+			}
+			else if(*fmt == 'L')
+			{
+				return -1;
+			}
+			fmt++;
+		}
+
+		if(nargs == IPACM_LOG_RING_MAX_ARGS || *fmt == '\0')
+		{
+			return -1;
+		}
+		switch(*fmt++)
+		{
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+				kind[nargs++] = (lng == 0) ? IPACM_LOG_ARG_INT :
+					(lng == 1) ? IPACM_LOG_ARG_LONG : IPACM_LOG_ARG_LLONG;
+				break;
+			case 'p':
+				kind[nargs++] = IPACM_LOG_ARG_PTR;
+				break;
+			case 's':
+				kind[nargs++] = IPACM_LOG_ARG_STR;
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				kind[nargs++] = IPACM_LOG_ARG_DBL;
+				break;
+			default:
+				return -1;
+		}
+	}
+	return nargs;
+}
+
+static uint32_t ipacm_log_ring_str(ipacm_log_ring_hdr_t *ring, const char *a, const char *b)
+{
+	size_t la = strlen(a), lb = (b != NULL) ? strlen(b) : 0;
+	uint32_t off;
+
+	off = __atomic_fetch_add(&ring->heap_used, (uint32_t)(la + lb + 1), __ATOMIC_RELAXED);
+	if(off + la + lb + 1 > ring->heap_size)
+	{
+		return UINT32_MAX;
+	}
+	memcpy(ipacm_log_ring_heap(ring) + off, a, la);
+	if(lb)
+	{
+		memcpy(ipacm_log_ring_heap(ring) + off + la, b, lb);
+	}
+	ipacm_log_ring_heap(ring)[off + la + lb] = '\0';
+	return off;
+}
+
+static int ipacm_log_ring_register(ipacm_log_ring_hdr_t *ring, const char *prefix,
+	const char *file, int line, const char *func, const char *fmt)
+{
+	ipacm_log_ring_fmt_t *ent;
+	uint8_t kind[IPACM_LOG_RING_MAX_ARGS];
+	const char *base;
+	uint32_t id;
+	int nargs;
+
+	nargs = ipacm_log_parse_fmt(fmt, kind);
+	if(nargs < 0)
+	{
+		return IPACM_LOG_RING_TEXT;
+	}
+
+	id = __atomic_fetch_add(&ring->fmt_count, 1, __ATOMIC_RELAXED);
+	if(id >= ring->max_fmt)
+	{
+		return IPACM_LOG_RING_TEXT;
+	}
+	ent = &ipacm_log_ring_fmts(ring)[id];
+
+	base = strrchr(file, '/');
+	ent->line = line;
+	ent->file_off = ipacm_log_ring_str(ring, (base != NULL) ? base + 1 : file, NULL);
+	ent->func_off = ipacm_log_ring_str(ring, func, NULL);
+	ent->fmt_off = ipacm_log_ring_str(ring, prefix, fmt);
+	if(ent->file_off == UINT32_MAX || ent->func_off == UINT32_MAX || ent->fmt_off == UINT32_MAX)
+	{
+		return IPACM_LOG_RING_TEXT;
+	}
+	ent->nargs = nargs;
+	memcpy(ent->kind, kind, nargs);
+	__atomic_store_n(&ent->valid, 1, __ATOMIC_RELEASE);
+
+	return (int)id;
+}
+
+/* lock free multi producer reservation, 0 if the ring is full */
+static uint8_t *ipacm_log_ring_reserve(ipacm_log_ring_hdr_t *ring, uint32_t len)
+{
+	uint64_t head, tail, pos, pad;
+	ipacm_log_ring_rec_t *rec;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	do
+	{
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		pos = head & (ring->ring_size - 1);
+		/* records never wrap, pad up to the end instead */
+		pad = (pos + len > ring->ring_size) ? ring->ring_size - pos : 0;
+		if(head + pad + len - tail > ring->ring_size)
+		{
+			__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+	} while(!__atomic_compare_exchange_n(&ring->head, &head, head + pad + len,
+		true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	if(pad)
+	{
+		rec = (ipacm_log_ring_rec_t *)(ipacm_log_ring_data(ring) + pos);
+		__atomic_store_n(&rec->len, (uint32_t)pad | IPACM_LOG_RING_PAD, __ATOMIC_RELEASE);
+		pos = 0;
+	}
+	return ipacm_log_ring_data(ring) + pos;
+}
+
+static void ipacm_log_text(const char *prefix, const char *file, int line,
+	const char *func, const char *fmt, va_list ap)
+{
+	char buf[MAX_BUF_LEN];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "%s%s:%d %s() ", prefix, file, line, func);
+	if(len > 0 && len < (int)sizeof(buf))
+	{
+		vsnprintf(buf + len, sizeof(buf) - len, fmt, ap);
+	}
+	ipacm_log_send(buf);
+}
+
+void ipacm_log_ring_write(int *fmt_id, const char *prefix, const char *file,
+	int line, const char *func, const char *fmt, ...)
+{
+	ipacm_log_ring_hdr_t *ring;
+	ipacm_log_ring_fmt_t *ent;
+	uint64_t buf[IPACM_LOG_RING_REC_MAX / 8];
+	ipacm_log_ring_rec_t *rec = (ipacm_log_ring_rec_t *)buf;
+	uint64_t *arg = rec->args;
+	const char *str;
+	uint8_t *dst;
+	size_t slen;
+	int id, i;
+	va_list ap;
+
+	ring = ipacm_log_ring_get();
+	id = __atomic_load_n(fmt_id, __ATOMIC_RELAXED);
+	if(ring != NULL && id == IPACM_LOG_RING_UNREGISTERED)
+	{
+		/* racing threads may both register a site, that only costs an entry */
+		id = ipacm_log_ring_register(ring, prefix, file, line, func, fmt);
+		__atomic_store_n(fmt_id, id, __ATOMIC_RELAXED);
+	}
+
+	va_start(ap, fmt);
+	if(ring == NULL || id < 0)
+	{
+		ipacm_log_text(prefix, file, line, func, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
+	ent = &ipacm_log_ring_fmts(ring)[id];
+	for(i = 0; i < ent->nargs; i++)
+	{
+		switch(ent->kind[i])
+		{
+			case IPACM_LOG_ARG_INT:
+				*arg++ = (uint64_t)va_arg(ap, int);
+				break;
+			case IPACM_LOG_ARG_LONG:
+				*arg++ = (uint64_t)va_arg(ap, long);
+				break;
+			case IPACM_LOG_ARG_LLONG:
+				*arg++ = (uint64_t)va_arg(ap, long long);
+				break;
+			case IPACM_LOG_ARG_PTR:
+				*arg++ = (uint64_t)(uintptr_t)va_arg(ap, void *);
+				break;
+			case IPACM_LOG_ARG_DBL:
+				{
+					double d = va_arg(ap, double);
+					memcpy(arg++, &d, sizeof(d));
+				}
+				break;
+			case IPACM_LOG_ARG_STR:
+				str = va_arg(ap, const char *);
+				if(str == NULL)
+				{
+					str = "(null)";
+				}
+				slen = strnlen(str, IPACM_LOG_RING_MAX_STR);
+				*arg++ = slen;
+				if(slen)
+				{
+					arg[(slen - 1) / 8] = 0;
+				}
+				memcpy(arg, str, slen);
+				arg += (slen + 7) / 8;
+				break;
+		}
+	}
+	va_end(ap);
+
+	rec->fmt_id = id;
+	rec->ts_ns = ipacm_log_now_ns();
+	rec->len = (uint32_t)((uint8_t *)arg - (uint8_t *)rec);
+
+	dst = ipacm_log_ring_reserve(ring, rec->len);
+	if(dst == NULL)
+	{
+		return;
+	}
+	memcpy(dst + sizeof(rec->len), (uint8_t *)rec + sizeof(rec->len), rec->len - sizeof(rec->len));
+	__atomic_store_n(&((ipacm_log_ring_rec_t *)dst)->len, rec->len, __ATOMIC_RELEASE);
+	return;
+}
+
+/* print one argument with its own conversion spec */
+static void ipacm_log_fmt_arg(char *out, size_t size, const char *spec, uint8_t kind,
+	const uint64_t *arg)
+{
+	char str[IPACM_LOG_RING_MAX_STR + 1];
+	double d;
+
+	switch(kind)
+	{
+		case IPACM_LOG_ARG_INT:
+			snprintf(out, size, spec, (int)arg[0]);
+			break;
+		case IPACM_LOG_ARG_LONG:
+			snprintf(out, size, spec, (long)arg[0]);
+			break;
+		case IPACM_LOG_ARG_LLONG:
+			snprintf(out, size, spec, (long long)arg[0]);
+			break;
+		case IPACM_LOG_ARG_PTR:
+			snprintf(out, size, spec, (void *)(uintptr_t)arg[0]);
+			break;
+		case IPACM_LOG_ARG_DBL:
+			memcpy(&d, arg, sizeof(d));
+			snprintf(out, size, spec, d);
+			break;
+		case IPACM_LOG_ARG_STR:
+			memcpy(str, &arg[1], arg[0]);
+			str[arg[0]] = '\0';
+			snprintf(out, size, spec, str);
+			break;
+	}
+}
+
+static void ipacm_log_ring_print(ipacm_log_ring_hdr_t *ring, const ipacm_log_ring_rec_t *rec, FILE *out)
+{
+	const ipacm_log_ring_fmt_t *ent;
+	const char *heap = ipacm_log_ring_heap(ring), *fmt, *conv;
+	const uint64_t *arg = rec->args;
+	char line[512], spec[32];
+	size_t len = 0;
+	int i = 0;
+
+	if(rec->fmt_id >= ring->max_fmt ||
+		!__atomic_load_n(&ipacm_log_ring_fmts(ring)[rec->fmt_id].valid, __ATOMIC_ACQUIRE))
+	{
+		fprintf(out, "[%llu] unknown format %u\n", (unsigned long long)rec->ts_ns, rec->fmt_id);
+		return;
+	}
+	ent = &ipacm_log_ring_fmts(ring)[rec->fmt_id];
+
+	/* the location goes after the prefix, as in the text log */
+	fmt = heap + ent->fmt_off;
+	if(strncmp(fmt, "ERROR: ", 7) == 0)
+	{
+		len = snprintf(line, sizeof(line), "ERROR: ");
+		fmt += 7;
+	}
+	len += snprintf(line + len, sizeof(line) - len, "%s:%u %s() ",
+		heap + ent->file_off, ent->line, heap + ent->func_off);
+	if(len >= sizeof(line))
+	{
+		len = sizeof(line) - 1;
+	}
+
+	while(*fmt != '\0' && len < sizeof(line) - 1)
+	{
+		if(*fmt != '%' || fmt[1] == '%')
+		{
+			line[len++] = *fmt;
+			fmt += (*fmt == '%') ? 2 : 1;
+			continue;
+		}
+		conv = fmt + 1 + strspn(fmt + 1, "-+ #0123456789.hlzjt");
+		if(i >= ent->nargs || (size_t)(conv - fmt + 2) > sizeof(spec))
+		{
+			break;
+		}
+		memcpy(spec, fmt, conv - fmt + 1);
+		spec[conv - fmt + 1] = '\0';
+		ipacm_log_fmt_arg(line + len, sizeof(line) - len, spec, ent->kind[i], arg);
+		len += strlen(line + len);
+		arg += (ent->kind[i] == IPACM_LOG_ARG_STR) ? 1 + (arg[0] + 7) / 8 : 1;
+		fmt = conv + 1;
+		i++;
+	}
+	line[len] = '\0';
+
+	fprintf(out, "[%llu.%06llu] %s", (unsigned long long)(rec->ts_ns / 1000000000ULL),
+		(unsigned long long)(rec->ts_ns % 1000000000ULL) / 1000, line);
+	if(len == 0 || line[len - 1] != '\n')
+	{
+		fputc('\n', out);
+	}
+}
+
+int ipacm_log_ring_drain(ipacm_log_ring_hdr_t *ring, FILE *out)
+{
+	ipacm_log_ring_rec_t *rec;
+	uint64_t tail, head;
+	uint32_t len;
+	int cnt = 0;
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	while(tail < head)
+	{
+		rec = (ipacm_log_ring_rec_t *)(ipacm_log_ring_data(ring) + (tail & (ring->ring_size - 1)));
+		len = __atomic_load_n(&rec->len, __ATOMIC_ACQUIRE);
+		if(len == 0)
+		{
+			/* still being written */
+			break;
+		}
+		if(!(len & IPACM_LOG_RING_PAD))
+		{
+			if(out != NULL)
+			{
+				ipacm_log_ring_print(ring, rec, out);
+			}
+			cnt++;
+		}
+		len &= ~IPACM_LOG_RING_PAD;
+		/* a later record may start anywhere in here, so clear it */
+		memset(rec, 0, len);
+		tail += len;
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+	return cnt;
+}
@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_LogReader.cpp
+
+	@brief
+	Reader for the IPACM binary log ring, formats the records ipacm wrote
+	and reports the ones dropped on a full ring. With -b it instead
+	measures the per event cost of the logging paths.
+
+*/
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "IPACM_Log.h"
+#include "IPACM_Defs.h"
+
+#define IPACM_LOG_READER_POLL_US 100000
+
+#ifdef FEATURE_IPA_ANDROID
+#define IPACM_LOG_BENCH_DIR "/data/local/tmp/"
+#else
+#define IPACM_LOG_BENCH_DIR "/tmp/"
+#endif
+
+/* logs per simulated event, about what a client add costs */
+#define IPACM_LOG_BENCH_LOGS 8
+
+enum
+{
+	BENCH_OFF,
+	BENCH_SOCKET,
+	BENCH_RING,
+	BENCH_MAX
+};
+
+static const char *bench_name[BENCH_MAX] = { "off", "socket", "ring" };
+
+static int bench_sock = -1;
+static struct sockaddr_un bench_addr;
+static volatile int bench_done;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* the text path IPACMDBG_H took before the ring, minus the printf */
+#define BENCH_LOG(mode, fmt, ...) \
+	if(mode == BENCH_SOCKET) \
+	{ \
+		char buf[MAX_BUF_LEN]; \
+		memset(buf, 0, MAX_BUF_LEN); \
+		snprintf(buf, MAX_BUF_LEN, "%s:%d %s() " fmt, __FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__); \
+		sendto(bench_sock, buf, MAX_BUF_LEN, 0, (struct sockaddr *)&bench_addr, sizeof(bench_addr)); \
+	} \
+	else if(mode == BENCH_RING) \
+	{ \
+		IPACM_LOG_RING("", fmt, ##__VA_ARGS__); \
+	}
+
+static uint32_t bench_event(int mode, uint32_t i)
+{
+	uint32_t sum = i, k;
+	uint8_t mac[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, (uint8_t)i };
+
+	BENCH_LOG(mode, "Received IPA_WLAN_CLIENT_ADD_EVENT_EX for %s\n", "wlan0");
+	BENCH_LOG(mode, "client mac %02x:%02x:%02x:%02x:%02x:%02x\n",
+		mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+	for(k = 0; k < IPACM_LOG_BENCH_LOGS - 4; k++)
+	{
+		sum = sum * 31 + k;
+		BENCH_LOG(mode, "Adding rule %d, hdl 0x%x, ip type %d\n", k, sum, k & 1);
+	}
+	BENCH_LOG(mode, "Added %u rules for client %p\n", k, &sum);
+	BENCH_LOG(mode, "IP type: %d Number of rules: %d commit value: %d\n", 0, (int)k, 1);
+
+	return sum;
+}
+
+/* consume only, formatting is the reader's cost and off the hot path */
+static void *bench_drain(void *arg)
+{
+	int mode = *(int *)arg;
+	char buf[MAX_BUF_LEN];
+	int cnt;
+
+	while(!bench_done)
+	{
+		cnt = 0;
+		if(mode == BENCH_SOCKET)
+		{
+			while(recv(bench_sock, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+			{
+				cnt++;
+			}
+		}
+		else if(mode == BENCH_RING)
+		{
+			cnt = ipacm_log_ring_drain(ipacm_log_ring_get(), NULL);
+		}
+		if(cnt == 0)
+		{
+			usleep(100);
+		}
+	}
+	return NULL;
+}
+
+static int bench(uint32_t events)
+{
+	char ring_path[] = IPACM_LOG_BENCH_DIR "ipacm_log_ring_bench";
+	uint64_t start, ns[BENCH_MAX], dropped = 0;
+	volatile uint32_t sink = 0;
+	pthread_t drainer;
+	int mode, rcv;
+	uint32_t i;
+
+	bench_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	rcv = socket(AF_UNIX, SOCK_DGRAM, 0);
+	memset(&bench_addr, 0, sizeof(bench_addr));
+	bench_addr.sun_family = AF_UNIX;
+	snprintf(bench_addr.sun_path, sizeof(bench_addr.sun_path), "%sipacm_log_bench_sock", IPACM_LOG_BENCH_DIR);
+	unlink(bench_addr.sun_path);
+	if(bench_sock < 0 || rcv < 0 ||
+		bind(rcv, (struct sockaddr *)&bench_addr, sizeof(bench_addr)) < 0)
+	{
+		perror("bench socket");
+		return -1;
+	}
+	close(bench_sock);
+	bench_sock = rcv;
+
+	if(ipacm_log_ring_init(ring_path, 1) != IPACM_SUCCESS)
+	{
+		perror("bench ring");
+		return -1;
+	}
+
+	for(mode = BENCH_OFF; mode < BENCH_MAX; mode++)
+	{
+		bench_done = 0;
+		pthread_create(&drainer, NULL, bench_drain, &mode);
+		start = now_ns();
+		for(i = 0; i < events; i++)
+		{
+			sink += bench_event(mode, i);
+		}
+		ns[mode] = now_ns() - start;
+		bench_done = 1;
+		pthread_join(drainer, NULL);
+	}
+	dropped = __atomic_load_n(&ipacm_log_ring_get()->dropped, __ATOMIC_RELAXED);
+
+	printf("%u events, %d logs each\n", events, IPACM_LOG_BENCH_LOGS);
+	for(mode = BENCH_OFF; mode < BENCH_MAX; mode++)
+	{
+		printf("%-8s %8llu ns/event\n", bench_name[mode],
+			(unsigned long long)(ns[mode] / events));
+	}
+	printf("ring dropped %llu records\n", (unsigned long long)dropped);
+
+	close(bench_sock);
+	unlink(bench_addr.sun_path);
+	unlink(ring_path);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-f ring_file] [-1] [-b events]\n"
+		"  -f  ring file, default %s\n"
+		"  -1  print what is in the ring and exit\n"
+		"  -b  benchmark per event logging cost instead\n",
+		prog, IPACMLOG_RING_FILE);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = IPACMLOG_RING_FILE;
+	ipacm_log_ring_hdr_t *ring;
+	uint64_t dropped = 0;
+	int once = 0, opt;
+
+	while((opt = getopt(argc, argv, "f:1b:h")) != -1)
+	{
+		switch(opt)
+		{
+			case 'f':
+				path = optarg;
+				break;
+			case '1':
+				once = 1;
+				break;
+			case 'b':
+				return bench(strtoul(optarg, NULL, 0) ? strtoul(optarg, NULL, 0) : 100000);
+			default:
+				usage(argv[0]);
+				return (opt == 'h') ? 0 : -1;
+		}
+	}
+
+	if(ipacm_log_ring_init(path, 0) != IPACM_SUCCESS)
+	{
+		fprintf(stderr, "unable to map log ring %s\n", path);
+		return -1;
+	}
+	ring = ipacm_log_ring_get();
+
+	do
+	{
+		ipacm_log_ring_drain(ring, stdout);
+		if(__atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) != dropped)
+		{
+			printf("*** %llu records dropped\n",
+				(unsigned long long)(__atomic_load_n(&ring->dropped, __ATOMIC_RELAXED) - dropped));
+			dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+		}
+		fflush(stdout);
+		if(!once)
+		{
+			usleep(IPACM_LOG_READER_POLL_US);
+		}
+	} while(!once);
+
+	return 0;
+}
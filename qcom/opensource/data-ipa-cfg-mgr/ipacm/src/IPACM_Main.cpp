@@ -137,6 +137,11 @@ typedef uint32_t in_addr_t;
 #define IPA_DRIVER_WLAN_BUF_LEN     (IPA_DRIVER_PIPE_STATS_EVENT_SIZE + IPA_DRIVER_WLAN_META_MSG)
 
 uint32_t ipacm_event_stats[IPACM_EVENT_MAX];
+uint64_t ipacm_event_dispatch_us[IPACM_EVENT_MAX];
+uint32_t ipacm_event_dispatch_max_us[IPACM_EVENT_MAX];
+uint64_t ipacm_event_rule_ioctls[IPACM_EVENT_MAX];
+uint64_t ipacm_event_commits_saved[IPACM_EVENT_MAX];
+uint64_t ipacm_event_commits_failed[IPACM_EVENT_MAX];
 bool ipacm_logging = true;
 
 void ipa_is_ipacm_running(void);
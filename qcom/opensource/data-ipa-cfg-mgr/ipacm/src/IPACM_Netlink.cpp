@@ -71,10 +71,12 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 	Skylar Chang
 
 */
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <netinet/in.h>
+#include <linux/filter.h>
 #ifndef in_addr_t
 typedef uint32_t in_addr_t;
 #endif
@@ -86,6 +88,32 @@ typedef uint32_t in_addr_t;
 
 int ipa_get_if_name(char *if_name, int if_index);
 int find_mask(int ip_v4_last, int *mask_value);
+static int ipa_get_if_index(const char *if_name, int *if_index);
+
+/* receive buffers reused for every batch, only the listener thread reads */
+static struct
+{
+	struct mmsghdr      msgs[IPA_NL_RECV_BATCH];
+	struct iovec        iov[IPA_NL_RECV_BATCH];
+	struct sockaddr_nl  addr[IPA_NL_RECV_BATCH];
+	char                buf[IPA_NL_RECV_BATCH][IPA_NL_MSG_MAX_LEN];
+	ipa_nl_msg_t        nlmsg;
+} ipa_nl_arena;
+
+/*
+ * ipa_nl_stats is only touched by the listener thread. It copies the
+ * counters to ipa_nl_stats_pub once the socket is drained, readers take
+ * that copy under the lock.
+ */
+static ipa_nl_stats_t ipa_nl_stats;
+static ipa_nl_stats_t ipa_nl_stats_pub;
+static pthread_mutex_t ipa_nl_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline int ipa_nl_post_evt(ipacm_cmd_q_data *evt_data)
+{
+	ipa_nl_stats.events_posted++;
+	return IPACM_EvtDispatcher::PostEvt(evt_data);
+}
 
 #ifdef FEATURE_IPA_ANDROID
 
@@ -149,6 +177,80 @@ int find_mask(int ip_v4_last, int *mask_value);
                     (unsigned char)(ip_addr >> 16) ,                        \
                     (unsigned char)(ip_addr >> 24));
 
+/* Attach a socket filter dropping rtnetlink messages that
+   ipa_nl_decode_nlmsg would ignore anyway, so they are never queued to
+   user space:
+   - message types other than link, addr, neigh and route add/del
+   - routes which are not unicast routes of the main table
+   - link, addr and neigh messages on the loopback interface
+   - AF_BRIDGE link messages on Android
+   Only the first message of a datagram is inspected. Multicast
+   notifications carry one message per datagram. */
+static int ipa_nl_attach_filter
+(
+	 int fd
+	 )
+{
+	int lo_index = 0;
+	struct sock_fprog prog;
+
+	if(ipa_get_if_index("lo", &lo_index) != IPACM_SUCCESS)
+	{
+		lo_index = 0;
+	}
+
+	/* BPF loads are big endian, nlmsghdr and the rtnetlink headers are host order */
+	struct sock_filter code[] =
+	{
+		/* 0: nlmsg_type */
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS, offsetof(struct nlmsghdr, nlmsg_type)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWROUTE), 7, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELROUTE), 6, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWLINK), 9, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELLINK), 8, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWADDR), 9, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELADDR), 8, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWNEIGH), 7, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELNEIGH), 6, 9),
+		/* 9: route, rtm_type and rtm_table */
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_type)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, RTN_UNICAST, 0, 7),
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_table)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, RT_TABLE_MAIN, 4, 5),
+		/* 13: link, ifi_family */
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NLMSG_HDRLEN + offsetof(struct ifinfomsg, ifi_family)),
+#ifdef FEATURE_IPA_ANDROID
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AF_BRIDGE, 3, 0),
+#else
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AF_BRIDGE, 0, 0),
+#endif
+		/* 15: link, addr and neigh, interface index */
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NLMSG_HDRLEN + offsetof(struct ifinfomsg, ifi_index)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl((uint32_t)lo_index), 1, 0),
+		/* 17: accept, 18: drop */
+		BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+
+	/* the index load above relies on these sharing the ifinfomsg layout */
+	static_assert(offsetof(struct ifaddrmsg, ifa_index) == offsetof(struct ifinfomsg, ifi_index),
+		"ifaddrmsg index offset");
+	static_assert(offsetof(struct ndmsg, ndm_ifindex) == offsetof(struct ifinfomsg, ifi_index),
+		"ndmsg index offset");
+
+	prog.len = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+
+	if(setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+	{
+		IPACMERR("Failed to attach netlink socket filter (%d), receiving unfiltered\n", errno);
+		return IPACM_FAILURE;
+	}
+
+	IPACMDBG_H("Attached netlink socket filter, loopback index %d\n", lo_index);
+	return IPACM_SUCCESS;
+}
+
 /* Opens a netlink socket*/
 static int ipa_nl_open_socket
 (
@@ -185,6 +287,11 @@ static int ipa_nl_open_socket
     IPACMERR("Error setting socket opts\n");
 	}
 
+	if(protocol == NETLINK_ROUTE)
+	{
+		ipa_nl_attach_filter(*p_sk_fd);
+	}
+
 	/* Initialize socket addresses to null */
 	memset(p_sk_addr_loc, 0, sizeof(struct sockaddr_nl));
 
@@ -287,172 +394,6 @@ static int ipa_nl_sock_listener_start
 	return IPACM_SUCCESS;
 }
 
-/* allocate memory for ipa_nl__msg */
-static struct msghdr* ipa_nl_alloc_msg
-(
-	 uint32_t msglen
-	 )
-{
-	unsigned char *buf = NULL;
-	struct sockaddr_nl *nladdr = NULL;
-	struct iovec *iov = NULL;
-	struct msghdr *msgh = NULL;
-
-	if(IPA_NL_MSG_MAX_LEN < msglen)
-	{
-		IPACMERR("Netlink message exceeds maximum length\n");
-		return NULL;
-	}
-
-	msgh = (struct msghdr *)malloc(sizeof(struct msghdr));
-	if(msgh == NULL)
-	{
-		IPACMERR("Failed malloc for msghdr\n");
-		return NULL;
-	}
-
-	nladdr = (struct sockaddr_nl *)malloc(sizeof(struct sockaddr_nl));
-	if(nladdr == NULL)
-	{
-		IPACMERR("Failed malloc for sockaddr\n");
-		free(msgh);
-		return NULL;
-	}
-
-	iov = (struct iovec *)malloc(sizeof(struct iovec));
-	if(iov == NULL)
-	{
-		PERROR("Failed malloc for iovec");
-		free(nladdr);
-		free(msgh);
-		return NULL;
-	}
-
-	buf = (unsigned char *)malloc(msglen);
-	if(buf == NULL)
-	{
-		IPACMERR("Failed malloc for mglen\n");
-		free(iov);
-		free(nladdr);
-		free(msgh);
-		return NULL;
-	}
-
-	memset(nladdr, 0, sizeof(struct sockaddr_nl));
-	nladdr->nl_family = AF_NETLINK;
-
-	memset(msgh, 0x0, sizeof(struct msghdr));
-	msgh->msg_name = nladdr;
-	msgh->msg_namelen = sizeof(struct sockaddr_nl);
-	msgh->msg_iov = iov;
-	msgh->msg_iovlen = 1;
-
-	memset(iov, 0x0, sizeof(struct iovec));
-	iov->iov_base = buf;
-	iov->iov_len = msglen;
-
-	return msgh;
-}
-
-/* release IPA message */
-static void ipa_nl_release_msg
-(
-	 struct msghdr *msgh
-	 )
-{
-	unsigned char *buf = NULL;
-	struct sockaddr_nl *nladdr = NULL;
-	struct iovec *iov = NULL;
-
-	if(NULL == msgh)
-	{
-		return;
-	}
-
-	nladdr = (struct sockaddr_nl *)msgh->msg_name;
-	iov = msgh->msg_iov;
-	if(msgh->msg_iov)
-	{
-		buf = (unsigned char *)msgh->msg_iov->iov_base;
-	}
-
-	if(buf)
-	{
-	free(buf);
-	}
-	if(iov)
-	{
-	free(iov);
-	}
-	if(nladdr)
-	{
-	free(nladdr);
-	}
-	if(msgh)
-	{
-	free(msgh);
-	}
-	return;
-}
-
-/* receive and process nl message */
-static int ipa_nl_recv
-(
-	 int              fd,
-	 struct msghdr **msg_pptr,
-	 unsigned int  *msglen_ptr
-	 )
-{
-	struct msghdr *msgh = NULL;
-	int rmsgl;
-
-	msgh = ipa_nl_alloc_msg(IPA_NL_MSG_MAX_LEN);
-	if(NULL == msgh)
-	{
-		IPACMERR("Failed to allocate NL message\n");
-		goto error;
-	}
-
-
-	/* Receive message over the socket */
-	rmsgl = recvmsg(fd, msgh, 0);
-
-	/* Verify that something was read */
-	if(rmsgl <= 0)
-	{
-		PERROR("NL recv error");
-		goto error;
-	}
-
-	/* Verify that NL address length in the received message is expected value */
-	if(sizeof(struct sockaddr_nl) != msgh->msg_namelen)
-	{
-		IPACMERR("rcvd msg with namelen != sizeof sockaddr_nl\n");
-		goto error;
-	}
-
-	/* Verify that message was not truncated. This should not occur */
-	if(msgh->msg_flags & MSG_TRUNC)
-	{
-		IPACMERR("Rcvd msg truncated!\n");
-		goto error;
-	}
-
-	*msg_pptr    = msgh;
-	*msglen_ptr = rmsgl;
-
-	return IPACM_SUCCESS;
-
-/* An error occurred while receiving the message. Free all memory before
-				 returning. */
-error:
-	ipa_nl_release_msg(msgh);
-	*msg_pptr    = NULL;
-	*msglen_ptr  = 0;
-
-	return IPACM_FAILURE;
-}
-
 /* decode the rtm netlink message */
 static int ipa_nl_decode_rtm_link
 (
@@ -721,7 +662,7 @@ static int ipa_nl_decode_nlmsg
 										 data_fid->if_index);
 					}
 					evt_data.evt_data = data_fid;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 				}
 				/* Andorid platform will use events from usb-driver directly */
 #ifndef FEATURE_IPA_ANDROID
@@ -763,7 +704,7 @@ static int ipa_nl_decode_nlmsg
 					evt_data.evt_data = data_fid;
 					IPACMDBG_H("Posting usb IPA_USB_LINK_UP_EVENT with if index: %d\n",
 										 data_fid->if_index);
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
                 }
                 else if (!(msg_ptr->nl_link_info.metainfo.ifi_flags & IFF_LOWER_UP))
 				{
@@ -790,7 +731,7 @@ static int ipa_nl_decode_nlmsg
 					evt_data.evt_data = data_fid;
 					IPACMDBG_H("Posting usb IPA_LINK_DOWN_EVENT with if index: %d\n",
 										 data_fid->if_index);
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 				}
 #endif /* not defined(FEATURE_IPA_ANDROID)*/
 			}
@@ -845,7 +786,7 @@ static int ipa_nl_decode_nlmsg
 				IPACMDBG_H("posting IPA_LINK_DOWN_EVENT with if idnex:%d\n",
 								 data_fid->if_index);
 				evt_data.evt_data = data_fid;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 				/* finish command queue */
 			}
 			break;
@@ -911,7 +852,7 @@ static int ipa_nl_decode_nlmsg
 								 data_addr->ipv4_addr);
 				}
 				evt_data.evt_data = data_addr;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 			}
 			break;
 
@@ -976,7 +917,7 @@ static int ipa_nl_decode_nlmsg
 								 data_addr->ipv4_addr);
 				}
 				evt_data.evt_data = data_addr;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 			}
 			break;
 
@@ -1039,7 +980,7 @@ static int ipa_nl_decode_nlmsg
 									 data_addr->ipv4_addr,
 									 data_addr->ipv4_addr_mask);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 
 				}
@@ -1099,7 +1040,7 @@ static int ipa_nl_decode_nlmsg
 						IPACMDBG("Posting IPA_ROUTE_ADD_EVENT with if index:%d, ipv6 address\n",
 										 data_addr->if_index);
 						evt_data.evt_data = data_addr;
-						IPACM_EvtDispatcher::PostEvt(&evt_data);
+						ipa_nl_post_evt(&evt_data);
 						/* finish command queue */
 
 					}
@@ -1134,7 +1075,7 @@ static int ipa_nl_decode_nlmsg
 										 data_addr->ipv4_addr_mask,
 										 data_addr->ipv4_addr_gw);
 						evt_data.evt_data = data_addr;
-						IPACM_EvtDispatcher::PostEvt(&evt_data);
+						ipa_nl_post_evt(&evt_data);
 						/* finish command queue */
 					}
 				}
@@ -1211,7 +1152,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG("Posting IPA_ROUTE_ADD_EVENT with if index:%d, ipv6 addr\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 				if(msg_ptr->nl_route_info.attr_info.param_mask & IPA_RTA_PARAM_GATEWAY)
@@ -1250,7 +1191,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG("posting IPA_ROUTE_ADD_EVENT with if index:%d, ipv6 address\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 			}
@@ -1304,7 +1245,7 @@ static int ipa_nl_decode_nlmsg
 									 data_addr->ipv4_addr,
 									 data_addr->ipv4_addr_mask);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 				else
@@ -1376,7 +1317,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG_H("Posting IPA_ROUTE_DEL_EVENT with if index:%d\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 			}
@@ -1463,7 +1404,7 @@ static int ipa_nl_decode_nlmsg
 					IPACMDBG_H("posting event IPA_ROUTE_DEL_EVENT with if index:%d, ipv4 address\n",
 									 data_addr->if_index);
 					evt_data.evt_data = data_addr;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 				}
 			}
@@ -1553,7 +1494,7 @@ static int ipa_nl_decode_nlmsg
 		    				 msg_ptr->nl_neigh_info.attr_info.local_addr.ss_family);
 			}
 		    evt_data.evt_data = data_all;
-					IPACM_EvtDispatcher::PostEvt(&evt_data);
+					ipa_nl_post_evt(&evt_data);
 					/* finish command queue */
 			break;
 
@@ -1626,7 +1567,7 @@ static int ipa_nl_decode_nlmsg
  		                    data_all->if_index,
 		    				 msg_ptr->nl_neigh_info.attr_info.local_addr.ss_family);
 				evt_data.evt_data = data_all;
-				IPACM_EvtDispatcher::PostEvt(&evt_data);
+				ipa_nl_post_evt(&evt_data);
 				/* finish command queue */
 			break;
 
@@ -1642,66 +1583,178 @@ static int ipa_nl_decode_nlmsg
 }
 
 
-/*  Virtual function registered to receive incoming messages over the NETLINK routing socket*/
-int ipa_nl_recv_msg(int fd)
+/* decode every netlink message of one received datagram */
+static void ipa_nl_process_datagram
+(
+	 const char   *buffer,
+	 unsigned int  buflen
+	 )
 {
-	struct msghdr *msghdr = NULL;
-	struct iovec *iov = NULL;
-	unsigned int msglen = 0;
-	ipa_nl_msg_t *nlmsg = NULL;
+	struct nlmsghdr *nlh = (struct nlmsghdr *)buffer;
+	uint64_t posted;
 
-	nlmsg = (ipa_nl_msg_t *)malloc(sizeof(ipa_nl_msg_t));
-	if(NULL == nlmsg)
-	{
-		IPACMERR("Failed alloc of nlmsg \n");
-		goto error;
-	}
-	else
+	while(NLMSG_OK(nlh, buflen))
 	{
-		if(IPACM_SUCCESS != ipa_nl_recv(fd, &msghdr, &msglen))
+		ipa_nl_stats.msgs_received++;
+		posted = ipa_nl_stats.events_posted;
+
+		memset(&ipa_nl_arena.nlmsg, 0, sizeof(ipa_nl_arena.nlmsg));
+		if(IPACM_SUCCESS != ipa_nl_decode_nlmsg((char *)nlh, nlh->nlmsg_len, &ipa_nl_arena.nlmsg))
 		{
-			IPACMERR("Failed to receive nl message \n");
-			goto error;
+			IPACMERR("Failed to decode nl message type %d\n", nlh->nlmsg_type);
 		}
 
-		if(msghdr== NULL)
+		if(ipa_nl_stats.events_posted != posted)
+		{
+			ipa_nl_stats.msgs_dispatched++;
+		}
+		else
 		{
-			IPACMERR(" failed to get msghdr\n");
-			goto error;
+			ipa_nl_stats.msgs_filtered++;
 		}
+		nlh = NLMSG_NEXT(nlh, buflen);
+	}
+}
+
+/*  Virtual function registered to receive incoming messages over the NETLINK routing socket*/
+int ipa_nl_recv_msg(int fd)
+{
+	int i, num, ret = IPACM_SUCCESS;
+	uint64_t received;
+	struct msghdr *msgh;
 
-		iov = msghdr->msg_iov;
+	received = ipa_nl_stats.msgs_received;
+
+	for(i = 0; i < IPA_NL_RECV_BATCH; i++)
+	{
+		ipa_nl_arena.iov[i].iov_base = ipa_nl_arena.buf[i];
+		ipa_nl_arena.iov[i].iov_len = IPA_NL_MSG_MAX_LEN;
+	}
 
-		memset(nlmsg, 0, sizeof(ipa_nl_msg_t));
-		if(IPACM_SUCCESS != ipa_nl_decode_nlmsg((char *)iov->iov_base, msglen, nlmsg))
+	do
+	{
+		for(i = 0; i < IPA_NL_RECV_BATCH; i++)
 		{
-			IPACMERR("Failed to decode nl message \n");
-			goto error;
+			msgh = &ipa_nl_arena.msgs[i].msg_hdr;
+			memset(msgh, 0, sizeof(*msgh));
+			msgh->msg_name = &ipa_nl_arena.addr[i];
+			msgh->msg_namelen = sizeof(struct sockaddr_nl);
+			msgh->msg_iov = &ipa_nl_arena.iov[i];
+			msgh->msg_iovlen = 1;
 		}
-		/* Release NetLink message buffer */
-		if(msghdr)
+
+		/* drain whatever is queued, the listener select()s before calling us */
+		num = recvmmsg(fd, ipa_nl_arena.msgs, IPA_NL_RECV_BATCH, MSG_DONTWAIT, NULL);
+		if(num < 0)
 		{
-			ipa_nl_release_msg(msghdr);
+			if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				break;
+			}
+			ipa_nl_stats.recv_errors++;
+			if(errno == ENOBUFS)
+			{
+				/* socket overrun, messages were lost but the socket is still usable */
+				IPACMERR("NL socket overrun, netlink events lost\n");
+				num = IPA_NL_RECV_BATCH;
+				continue;
+			}
+			PERROR("NL recv error");
+			ret = IPACM_FAILURE;
+			break;
 		}
-		if(nlmsg)
+
+		ipa_nl_stats.recv_batches++;
+		for(i = 0; i < num; i++)
 		{
-			free(nlmsg);
+			msgh = &ipa_nl_arena.msgs[i].msg_hdr;
+
+			/* Verify that NL address length in the received message is expected value */
+			if(sizeof(struct sockaddr_nl) != msgh->msg_namelen)
+			{
+				IPACMERR("rcvd msg with namelen != sizeof sockaddr_nl\n");
+				ipa_nl_stats.recv_errors++;
+				continue;
+			}
+
+			/* Verify that message was not truncated. This should not occur */
+			if(msgh->msg_flags & MSG_TRUNC)
+			{
+				IPACMERR("Rcvd msg truncated!\n");
+				ipa_nl_stats.recv_errors++;
+				continue;
+			}
+
+			ipa_nl_process_datagram(ipa_nl_arena.buf[i], ipa_nl_arena.msgs[i].msg_len);
 		}
+	} while(num == IPA_NL_RECV_BATCH);
+
+	pthread_mutex_lock(&ipa_nl_stats_lock);
+	ipa_nl_stats_pub = ipa_nl_stats;
+	pthread_mutex_unlock(&ipa_nl_stats_lock);
+
+	if(ret != IPACM_SUCCESS)
+	{
+		return ret;
+	}
+
+	if(received / IPA_NL_STATS_LOG_INTERVAL !=
+		ipa_nl_stats.msgs_received / IPA_NL_STATS_LOG_INTERVAL)
+	{
+		IPACMDBG_H("netlink: %llu batches, %llu msgs received, %llu filtered, %llu dispatched (%llu events), %llu errors\n",
+			(unsigned long long)ipa_nl_stats.recv_batches,
+			(unsigned long long)ipa_nl_stats.msgs_received,
+			(unsigned long long)ipa_nl_stats.msgs_filtered,
+			(unsigned long long)ipa_nl_stats.msgs_dispatched,
+			(unsigned long long)ipa_nl_stats.events_posted,
+			(unsigned long long)ipa_nl_stats.recv_errors);
 	}
 
 	return IPACM_SUCCESS;
+}
+
+/* snapshot of the NetLink receive counters */
+void ipa_nl_get_stats(ipa_nl_stats_t *stats)
+{
+	if(stats == NULL)
+	{
+		return;
+	}
+	pthread_mutex_lock(&ipa_nl_stats_lock);
+	*stats = ipa_nl_stats_pub;
+	pthread_mutex_unlock(&ipa_nl_stats_lock);
+}
+
+/*  get ipa interface index */
+static int ipa_get_if_index
+(
+	 const char *if_name,
+	 int *if_index
+	 )
+{
+	int fd;
+	struct ifreq ifr;
 
-error:
-	if(msghdr)
+	if((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
 	{
-		ipa_nl_release_msg(msghdr);
+		IPACMERR("get interface index socket create failed \n");
+		return IPACM_FAILURE;
 	}
-	if(nlmsg)
+
+	memset(&ifr, 0, sizeof(struct ifreq));
+	(void)strlcpy(ifr.ifr_name, if_name, sizeof(ifr.ifr_name));
+
+	if(ioctl(fd, SIOCGIFINDEX, &ifr) < 0)
 	{
-		free(nlmsg);
+		IPACMERR("call_ioctl_on_dev: ioctl failed: interface %s\n", if_name);
+		close(fd);
+		return IPACM_FAILURE;
 	}
 
-	return IPACM_FAILURE;
+	*if_index = ifr.ifr_ifindex;
+	close(fd);
+
+	return IPACM_SUCCESS;
 }
 
 /*  get ipa interface name */
@@ -79,6 +79,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "IPACM_Routing.h"
 #include <IPACM_Log.h>
+#include "IPACM_RuleTxn.h"
 
 const char *IPACM_Routing::DEVICE_NAME = "/dev/ipa";
 
@@ -130,7 +131,7 @@ bool IPACM_Routing::AddRoutingRule(struct ipa_ioc_add_rt_rule *ruleTable)
 		return false;
 	}
 
-	retval = ioctl(m_fd, IPA_IOC_ADD_RT_RULE, ruleTable);
+	retval = ipacm_rule_txn_ioctl(m_fd, IPA_IOC_ADD_RT_RULE, IPACM_RULE_TXN_RT, ruleTable);
 	if (retval)
 	{
 		IPACMERR_LOG("Failed adding routing rule %p\n", ruleTable);
@@ -166,7 +167,7 @@ bool IPACM_Routing::AddRoutingRule(struct ipa_ioc_add_rt_rule_v2 *table) {
 		return false;
 	}
 
-	int retval = ioctl(m_fd, IPA_IOC_ADD_RT_RULE_V2, table);
+	int retval = ipacm_rule_txn_ioctl(m_fd, IPA_IOC_ADD_RT_RULE_V2, IPACM_RULE_TXN_RT, table);
 	if (retval) {
 		IPACMERR("Failed adding routing table %p\n", table);
 		return false;
@@ -246,7 +247,7 @@ bool IPACM_Routing::AddRoutingRule_hw_index(struct ipa_ioc_add_rt_rule *ruleTabl
 			&rt_rule_entry, sizeof(rt_rule_entry));
 	}
 
-	retval = ioctl(m_fd, IPA_IOC_ADD_RT_RULE_V2, ruleTable_v2);
+	retval = ipacm_rule_txn_ioctl(m_fd, IPA_IOC_ADD_RT_RULE_V2, IPACM_RULE_TXN_RT, ruleTable_v2);
 	if (retval != 0)
 	{
 		IPACMERR("Failed adding Routing rule %pK\n", ruleTable_v2);
@@ -295,7 +296,7 @@ bool IPACM_Routing::DeleteRoutingRule(struct ipa_ioc_del_rt_rule *ruleTable)
 
 	if (!DeviceNodeIsOpened()) return false;
 
-	retval = ioctl(m_fd, IPA_IOC_DEL_RT_RULE, ruleTable);
+	retval = ipacm_rule_txn_ioctl(m_fd, IPA_IOC_DEL_RT_RULE, IPACM_RULE_TXN_RT, ruleTable);
 	if (retval)
 	{
 		IPACMERR("Failed deleting routing rule table %p\n", ruleTable);
@@ -312,6 +313,12 @@ bool IPACM_Routing::Commit(enum ipa_ip_type ip)
 
 	if (!DeviceNodeIsOpened()) return false;
 
+	if (IPACM_RuleTxn::defer_commit(IPACM_RULE_TXN_RT, ip))
+	{
+		IPACMDBG("Routing commit held back by rule transaction.\n");
+		return true;
+	}
+
 	retval = ioctl(m_fd, IPA_IOC_COMMIT_RT, ip);
 	if (retval)
 	{
@@ -433,7 +440,7 @@ bool IPACM_Routing::ModifyRoutingRule(struct ipa_ioc_mdfy_rt_rule *mdfyRules)
 		return false;
 	}
 
-	retval = ioctl(m_fd, IPA_IOC_MDFY_RT_RULE, mdfyRules);
+	retval = ipacm_rule_txn_ioctl(m_fd, IPA_IOC_MDFY_RT_RULE, IPACM_RULE_TXN_RT, mdfyRules);
 	if (retval)
 	{
 		IPACMERR("Failed modifying routing rules %p\n", mdfyRules);
@@ -0,0 +1,181 @@
+/*
+Copyright (c) 2013, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+		* Redistributions of source code must retain the above copyright
+			notice, this list of conditions and the following disclaimer.
+		* Redistributions in binary form must reproduce the above
+			copyright notice, this list of conditions and the following
+			disclaimer in the documentation and/or other materials provided
+			with the distribution.
+		* Neither the name of The Linux Foundation nor the names of its
+			contributors may be used to endorse or promote products derived
+			from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/*!
+	@file
+	IPACM_RuleTxn.cpp
+
+	@brief
+	This file implements the filtering/routing rule transaction.
+
+*/
+#include <string.h>
+
+#include "IPACM_RuleTxn.h"
+#include "IPACM_Iface.h"
+#include <IPACM_Log.h>
+
+typedef struct
+{
+	int depth;
+	uint8_t dirty[IPACM_RULE_TXN_TBL_MAX]; /* bit per ipa_ip_type */
+	uint8_t deleted; /* bit per ipa_ip_type, rules were deleted */
+	ipacm_rule_txn_stats stats;
+} ipacm_rule_txn_state;
+
+static __thread ipacm_rule_txn_state txn;
+
+void IPACM_RuleTxn::begin(void)
+{
+	if(txn.depth++ == 0)
+	{
+		memset(txn.dirty, 0, sizeof(txn.dirty));
+		txn.deleted = 0;
+		memset(&txn.stats, 0, sizeof(txn.stats));
+	}
+}
+
+void IPACM_RuleTxn::end(ipacm_rule_txn_stats *stats)
+{
+	if(txn.depth <= 0)
+	{
+		IPACMERR("no open rule transaction\n");
+		return;
+	}
+
+	if(txn.depth > 1)
+	{
+		txn.depth--;
+		return;
+	}
+
+	flush();
+	txn.depth = 0;
+
+	if(stats != NULL)
+	{
+		*stats = txn.stats;
+	}
+}
+
+static bool commit_tbl(ipacm_rule_txn_tbl tbl, enum ipa_ip_type ip)
+{
+	bool ret;
+
+	if((txn.dirty[tbl] & (1 << ip)) == 0)
+	{
+		return true;
+	}
+
+	txn.stats.commits_issued++;
+	if(tbl == IPACM_RULE_TXN_RT)
+	{
+		ret = IPACM_Iface::m_routing.Commit(ip);
+	}
+	else
+	{
+		ret = IPACM_Iface::m_filtering.Commit(ip);
+	}
+
+	if(ret == false)
+	{
+		txn.stats.commits_failed++;
+		IPACMERR("failed committing held back %s rules, ip %d\n",
+			(tbl == IPACM_RULE_TXN_RT) ? "routing" : "filtering", ip);
+	}
+	return ret;
+}
+
+bool IPACM_RuleTxn::flush(void)
+{
+	int depth = txn.depth;
+	bool ret = true;
+	int ip;
+
+	/* the commits below must reach the driver */
+	txn.depth = 0;
+
+	for(ip = IPA_IP_v4; ip < IPA_IP_MAX; ip++)
+	{
+		if(txn.deleted & (1 << ip))
+		{
+			/* filtering first, so HW drops the filtering rules before the
+			 * routing tables they point at go away */
+			ret &= commit_tbl(IPACM_RULE_TXN_FLT, (enum ipa_ip_type)ip);
+			ret &= commit_tbl(IPACM_RULE_TXN_RT, (enum ipa_ip_type)ip);
+		}
+		else
+		{
+			/* routing first, new filtering rules may point at new routing tables */
+			ret &= commit_tbl(IPACM_RULE_TXN_RT, (enum ipa_ip_type)ip);
+			ret &= commit_tbl(IPACM_RULE_TXN_FLT, (enum ipa_ip_type)ip);
+		}
+	}
+	memset(txn.dirty, 0, sizeof(txn.dirty));
+	txn.deleted = 0;
+
+	txn.depth = depth;
+	return ret;
+}
+
+bool IPACM_RuleTxn::active(void)
+{
+	return txn.depth > 0;
+}
+
+uint8_t IPACM_RuleTxn::rule_op(ipacm_rule_txn_tbl tbl, enum ipa_ip_type ip, uint8_t commit, bool del)
+{
+	if(txn.depth == 0 || ip >= IPA_IP_MAX)
+	{
+		return commit;
+	}
+
+	txn.stats.rule_ioctls++;
+	if(del)
+	{
+		txn.deleted |= (1 << ip);
+	}
+	if(commit)
+	{
+		txn.stats.commits_requested++;
+		txn.dirty[tbl] |= (1 << ip);
+	}
+	return 0;
+}
+
+bool IPACM_RuleTxn::defer_commit(ipacm_rule_txn_tbl tbl, enum ipa_ip_type ip)
+{
+	if(txn.depth == 0 || ip >= IPA_IP_MAX)
+	{
+		return false;
+	}
+
+	txn.stats.commits_requested++;
+	txn.dirty[tbl] |= (1 << ip);
+	return true;
+}
@@ -72,8 +72,12 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <time.h>
 #ifndef in_addr_t
 typedef uint32_t in_addr_t;
 #endif
@@ -110,6 +114,70 @@ static int IPACM_filter_cfg_xml_parse_tree
 	 IPACM_filter_conf_t *config
 );
 
+/* Header of a cached, parsed XML config */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t data_size;
+	uint32_t reserved;
+	uint64_t xml_hash;                           /* hash of the XML content */
+	uint64_t data_hash;                          /* hash of the data that follows */
+} ipacm_xml_cache_hdr_t;
+
+/* Cached form of IPACM_conf_t, whose NAT table type points to a tag */
+typedef struct
+{
+	IPACM_conf_t config;
+	uint8_t nat_table_memtype;                   /* index into nat_memtype_tags + 1, 0 if none */
+} ipacm_cfg_cache_t;
+
+/* An XML file read into memory */
+typedef struct
+{
+	char *buf;
+	size_t len;
+	uint64_t hash;
+	struct timespec start;
+} ipacm_xml_file_t;
+
+static const char *nat_memtype_tags[] =
+{
+	DDR_TABLETYPE_TAG,
+	SRAM_TABLETYPE_TAG,
+	HYBRID_TABLETYPE_TAG
+};
+
+static int ipacm_xml_read_file
+(
+	 const char *xml_file,
+	 uint32_t data_size,
+	 ipacm_xml_file_t *file
+);
+
+static int ipacm_xml_cache_load
+(
+	 const char *xml_file,
+	 uint64_t xml_hash,
+	 void *data,
+	 uint32_t data_size
+);
+
+static void ipacm_xml_cache_store
+(
+	 const char *xml_file,
+	 uint64_t xml_hash,
+	 const void *data,
+	 uint32_t data_size
+);
+
+static void ipacm_xml_done
+(
+	 const char *xml_file,
+	 ipacm_xml_file_t *file,
+	 bool cached
+);
+
 /*Reads content (stored as child) of the element */
 static char* IPACM_read_content_element
 (
@@ -162,17 +230,220 @@ static int32_t IPACM_util_icmp_string
 	return ret;
 }
 
+/* 64-bit FNV-1a */
+static uint64_t ipacm_xml_hash(const void *data, size_t len, uint64_t hash)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (len--)
+	{
+		hash ^= *p++;
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+/* Reads the whole XML file into memory and hashes it, along with the
+   cache version and the size of the config it parses into */
+static int ipacm_xml_read_file(const char *xml_file, uint32_t data_size, ipacm_xml_file_t *file)
+{
+	struct stat st;
+	uint32_t key[2] = { IPACM_XML_CACHE_VERSION, data_size };
+	ssize_t n;
+	size_t off = 0;
+	int fd;
+
+	memset(file, 0, sizeof(*file));
+	clock_gettime(CLOCK_MONOTONIC, &file->start);
+
+	fd = open(xml_file, O_RDONLY);
+	if (fd < 0)
+	{
+		IPACMDBG_H("IPACM_xml_parse: unable to open %s: %s\n", xml_file, strerror(errno));
+		return IPACM_FAILURE;
+	}
+
+	if (fstat(fd, &st) < 0 || st.st_size <= 0 || st.st_size > IPACM_XML_MAX_FILESIZE)
+	{
+		IPACMERR("IPACM_xml_parse: bad size of %s\n", xml_file);
+		close(fd);
+		return IPACM_FAILURE;
+	}
+
+	file->len = st.st_size;
+	file->buf = (char *)malloc(file->len);
+	if (file->buf == NULL)
+	{
+		IPACMERR("IPACM_xml_parse: unable to allocate %zu bytes\n", file->len);
+		close(fd);
+		return IPACM_FAILURE;
+	}
+
+	while (off < file->len)
+	{
+		n = read(fd, file->buf + off, file->len - off);
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+				continue;
+			IPACMERR("IPACM_xml_parse: unable to read %s\n", xml_file);
+			close(fd);
+			free(file->buf);
+			file->buf = NULL;
+			return IPACM_FAILURE;
+		}
+		off += n;
+	}
+	close(fd);
+
+	file->hash = ipacm_xml_hash(key, sizeof(key), 0xCBF29CE484222325ULL);
+	file->hash = ipacm_xml_hash(file->buf, file->len, file->hash);
+	return IPACM_SUCCESS;
+}
+
+static void ipacm_xml_cache_path(const char *xml_file, char *path, size_t size)
+{
+	const char *name = strrchr(xml_file, '/');
+
+	snprintf(path, size, "%s%s.bin", IPACM_XML_CACHE_DIR, (name) ? name + 1 : xml_file);
+}
+
+/* Copies the cached config into data if it was parsed from XML content with xml_hash */
+static int ipacm_xml_cache_load(const char *xml_file, uint64_t xml_hash, void *data, uint32_t data_size)
+{
+	char path[IPA_MAX_FILE_LEN];
+	const ipacm_xml_cache_hdr_t *hdr;
+	size_t map_len = sizeof(ipacm_xml_cache_hdr_t) + data_size;
+	struct stat st;
+	void *map;
+	int fd, ret = IPACM_FAILURE;
+
+	ipacm_xml_cache_path(xml_file, path, sizeof(path));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return IPACM_FAILURE;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size != map_len)
+	{
+		close(fd);
+		return IPACM_FAILURE;
+	}
+
+	map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		IPACMERR("unable to map %s: %s\n", path, strerror(errno));
+		return IPACM_FAILURE;
+	}
+
+	hdr = (const ipacm_xml_cache_hdr_t *)map;
+	if (hdr->magic == IPACM_XML_CACHE_MAGIC &&
+		hdr->version == IPACM_XML_CACHE_VERSION &&
+		hdr->data_size == data_size &&
+		hdr->xml_hash == xml_hash &&
+		hdr->data_hash == ipacm_xml_hash(hdr + 1, data_size, xml_hash))
+	{
+		memcpy(data, hdr + 1, data_size);
+		ret = IPACM_SUCCESS;
+	}
+	else
+	{
+		IPACMDBG_H("%s is stale, %s will be parsed\n", path, xml_file);
+	}
+
+	munmap(map, map_len);
+	return ret;
+}
+
+/* Writes the parsed config to a temporary file and renames it over the cache */
+static void ipacm_xml_cache_store(const char *xml_file, uint64_t xml_hash, const void *data, uint32_t data_size)
+{
+	char path[IPA_MAX_FILE_LEN], tmp_path[IPA_MAX_FILE_LEN + 4];
+	ipacm_xml_cache_hdr_t hdr;
+	bool ok;
+	int fd;
+
+	if (mkdir(IPACM_XML_CACHE_DIR, 0700) < 0 && errno != EEXIST)
+	{
+		IPACMERR("unable to create %s: %s\n", IPACM_XML_CACHE_DIR, strerror(errno));
+		return;
+	}
+
+	ipacm_xml_cache_path(xml_file, path, sizeof(path));
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = IPACM_XML_CACHE_MAGIC;
+	hdr.version = IPACM_XML_CACHE_VERSION;
+	hdr.data_size = data_size;
+	hdr.xml_hash = xml_hash;
+	hdr.data_hash = ipacm_xml_hash(data, data_size, xml_hash);
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+	{
+		IPACMERR("unable to create %s: %s\n", tmp_path, strerror(errno));
+		return;
+	}
+
+	ok = (write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+		write(fd, data, data_size) == (ssize_t)data_size);
+	close(fd);
+
+	if (!ok || rename(tmp_path, path) < 0)
+	{
+		IPACMERR("unable to write %s: %s\n", path, strerror(errno));
+		unlink(tmp_path);
+	}
+}
+
+/* Logs how long reading the config took, and frees the XML content */
+static void ipacm_xml_done(const char *xml_file, ipacm_xml_file_t *file, bool cached)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	IPACMDBG_H("%s %s in %ld us\n", xml_file, (cached) ? "loaded from cache" : "parsed",
+		(long)((end.tv_sec - file->start.tv_sec) * 1000000 +
+		(end.tv_nsec - file->start.tv_nsec) / 1000));
+
+	free(file->buf);
+	file->buf = NULL;
+}
+
 /* This function read IPACM XML and populate the IPA CM Cfg */
 int ipacm_read_cfg_xml(char *xml_file, IPACM_conf_t *config)
 {
 	xmlDocPtr doc = NULL;
 	xmlNode* root = NULL;
+	ipacm_xml_file_t file;
+	ipacm_cfg_cache_t cache;
+	uint8_t i;
 	int ret_val = IPACM_SUCCESS;
 
+	if (ipacm_xml_read_file(xml_file, sizeof(cache), &file) != IPACM_SUCCESS)
+	{
+		return IPACM_FAILURE;
+	}
+
+	/* Skip parsing when the content is the same as last time */
+	if (ipacm_xml_cache_load(xml_file, file.hash, &cache, sizeof(cache)) == IPACM_SUCCESS &&
+		cache.nat_table_memtype <= sizeof(nat_memtype_tags) / sizeof(nat_memtype_tags[0]))
+	{
+		*config = cache.config;
+		config->nat_table_memtype =
+			(cache.nat_table_memtype) ? nat_memtype_tags[cache.nat_table_memtype - 1] : NULL;
+		ipacm_xml_done(xml_file, &file, true);
+		return IPACM_SUCCESS;
+	}
+
 	/* Invoke the XML parser and obtain the parse tree */
-	doc = xmlReadFile(xml_file, "UTF-8", XML_PARSE_NOBLANKS);
+	doc = xmlReadMemory(file.buf, file.len, xml_file, "UTF-8", XML_PARSE_NOBLANKS);
 	if (doc == NULL) {
 		IPACMDBG_H("IPACM_xml_parse: libxml returned parse error!\n");
+		ipacm_xml_done(xml_file, &file, false);
 		return IPACM_FAILURE;
 	}
 
@@ -188,9 +459,24 @@ int ipacm_read_cfg_xml(char *xml_file, IPACM_conf_t *config)
 	{
 		IPACMDBG_H("IPACM_xml_parse: ipacm_cfg_xml_parse_tree returned parse error!\n");
 	}
+	else
+	{
+		memset(&cache, 0, sizeof(cache));
+		cache.config = *config;
+		cache.config.nat_table_memtype = NULL;
+		for (i = 0; i < sizeof(nat_memtype_tags) / sizeof(nat_memtype_tags[0]); i++)
+		{
+			if (config->nat_table_memtype == nat_memtype_tags[i])
+			{
+				cache.nat_table_memtype = i + 1;
+			}
+		}
+		ipacm_xml_cache_store(xml_file, file.hash, &cache, sizeof(cache));
+	}
 
 	/* Free up the libxml's parse tree */
 	xmlFreeDoc(doc);
+	ipacm_xml_done(xml_file, &file, false);
 
 	return ret_val;
 }
@@ -531,15 +817,32 @@ int IPACM_read_firewall_xml(char *xml_file, IPACM_firewall_conf_t *config)
 {
 	xmlDocPtr doc = NULL;
 	xmlNode* root = NULL;
+	ipacm_xml_file_t file;
+	char config_file[IPA_MAX_FILE_LEN];
 	int ret_val;
 
 	IPACM_ASSERT(xml_file != NULL);
 	IPACM_ASSERT(config != NULL);
 
+	if (ipacm_xml_read_file(xml_file, sizeof(*config), &file) != IPACM_SUCCESS)
+	{
+		return IPACM_FAILURE;
+	}
+
+	/* The cache holds what parsing into a zeroed config gives, as the callers do */
+	memcpy(config_file, config->firewall_config_file, sizeof(config_file));
+	if (ipacm_xml_cache_load(xml_file, file.hash, config, sizeof(*config)) == IPACM_SUCCESS)
+	{
+		memcpy(config->firewall_config_file, config_file, sizeof(config_file));
+		ipacm_xml_done(config_file, &file, true);
+		return IPACM_SUCCESS;
+	}
+
 	/* invoke the XML parser and obtain the parse tree */
-	doc = xmlReadFile(xml_file, "UTF-8", XML_PARSE_NOBLANKS);
+	doc = xmlReadMemory(file.buf, file.len, xml_file, "UTF-8", XML_PARSE_NOBLANKS);
 	if (doc == NULL) {
 		IPACMDBG_H("IPACM_xml_parse: libxml returned parse error\n");
+		ipacm_xml_done(xml_file, &file, false);
 		return IPACM_FAILURE;
 	}
 	/*get the root of the tree*/
@@ -552,9 +855,14 @@ int IPACM_read_firewall_xml(char *xml_file, IPACM_firewall_conf_t *config)
 	{
 		IPACMDBG_H("IPACM_xml_parse: ipacm_firewall_xml_parse_tree returned parse error!\n");
 	}
+	else
+	{
+		ipacm_xml_cache_store(xml_file, file.hash, config, sizeof(*config));
+	}
 
 	/* free the tree */
 	xmlFreeDoc(doc);
+	ipacm_xml_done(xml_file, &file, false);
 
 	return ret_val;
 }
@@ -1268,15 +1576,29 @@ int IPACM_read_filter_cfg_xml(char *xml_file, IPACM_filter_conf_t *config)
 {
 	xmlDocPtr doc = NULL;
 	xmlNode* root = NULL;
+	ipacm_xml_file_t file;
 	int ret_val;
 
 	IPACM_ASSERT(xml_file != NULL);
 	IPACM_ASSERT(config != NULL);
 
+	if (ipacm_xml_read_file(xml_file, sizeof(*config), &file) != IPACM_SUCCESS)
+	{
+		return IPACM_FAILURE;
+	}
+
+	/* The cache holds what parsing into a zeroed config gives, as the callers do */
+	if (ipacm_xml_cache_load(xml_file, file.hash, config, sizeof(*config)) == IPACM_SUCCESS)
+	{
+		ipacm_xml_done(xml_file, &file, true);
+		return IPACM_SUCCESS;
+	}
+
 	/* invoke the XML parser and obtain the parse tree */
-	doc = xmlReadFile(xml_file, "UTF-8", XML_PARSE_NOBLANKS);
+	doc = xmlReadMemory(file.buf, file.len, xml_file, "UTF-8", XML_PARSE_NOBLANKS);
 	if (doc == NULL) {
 		IPACMDBG_H("IPACM_xml_parse: libxml returned parse error\n");
+		ipacm_xml_done(xml_file, &file, false);
 		return IPACM_FAILURE;
 	}
 	/*get the root of the tree*/
@@ -1289,9 +1611,14 @@ int IPACM_read_filter_cfg_xml(char *xml_file, IPACM_filter_conf_t *config)
 	{
 		IPACMDBG_H("IPACM_xml_parse: IPACM_filter_cfg_xml_parse_tree returned parse error!\n");
 	}
+	else
+	{
+		ipacm_xml_cache_store(xml_file, file.hash, config, sizeof(*config));
+	}
 
 	/* free the tree */
 	xmlFreeDoc(doc);
+	ipacm_xml_done(xml_file, &file, false);
 
 	return ret_val;
 }
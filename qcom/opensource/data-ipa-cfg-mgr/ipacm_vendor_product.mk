@@ -6,6 +6,7 @@ ifneq ($(TARGET_BOARD_SUFFIX),_gvmq)
 IPACM_DATA += IPACM_cfg.xml
 IPACM_DATA += IPACM_Filter_cfg.xml
 IPACM_DATA += ipacm
+IPACM_DATA += ipacm_log_reader
 IPACM_DATA += ipacm.rc
 endif
 endif
@@ -9,6 +9,7 @@
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <linux/uaccess.h>
+#include <linux/msm_gsi.h>
 #include <linux/version.h>
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0))
 #include <linux/dma-map-ops.h>
@@ -37,7 +38,12 @@
 
 #define IPA_NAT_MAX_NUM_OF_INIT_CMD_DESC 4
 #define IPA_IPV6CT_MAX_NUM_OF_INIT_CMD_DESC 3
-#define IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC 5
+/*
+ * Coalescing close + NOP + up to 18 table DMA entries, so that user
+ * space may commit a batch of rule updates with a single ioctl. Must
+ * not exceed IPA_SEND_MAX_DESC, which bounds every ipa3_send_cmd()
+ */
+#define IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC 20
 
 /*
  * The base table max entries is limited by index into table 13 bits number.
@@ -1943,8 +1949,8 @@ int ipa3_table_dma_cmd(
 	enum ipahal_imm_cmd_name cmd_name = IPA_IMM_CMD_NAT_DMA;
 
 	struct ipahal_imm_cmd_table_dma cmd;
-	struct ipahal_imm_cmd_pyld *cmd_pyld[IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC];
-	struct ipa3_desc desc[IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC];
+	struct ipahal_imm_cmd_pyld **cmd_pyld = NULL;
+	struct ipa3_desc *desc = NULL;
 
 	uint8_t cnt, num_cmd = 0;
 
@@ -1953,6 +1959,7 @@ int ipa3_table_dma_cmd(
 	struct ipahal_reg_valmask valmask;
 	struct ipahal_imm_cmd_register_write reg_write_coal_close;
 	int max_dma_table_cmds = IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC;
+	const struct ipa_gsi_ep_config *gsi_ep_cfg;
 
 	IPADBG("In\n");
 
@@ -1975,8 +1982,6 @@ int ipa3_table_dma_cmd(
 	IPADBG("nmi(%s)\n", ipa3_nat_mem_in_as_str(dma->mem_type));
 
 	memset(&cmd, 0, sizeof(cmd));
-	memset(cmd_pyld, 0, sizeof(cmd_pyld));
-	memset(desc, 0, sizeof(desc));
 
 	/**
 	 * We use a descriptor for closing coalsceing endpoint
@@ -1987,6 +1992,22 @@ int ipa3_table_dma_cmd(
 	if (ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_COAL_CONS) != -1)
 		max_dma_table_cmds -= 1;
 
+	/*
+	 * The command pipe chains no more descriptors than its TLV depth
+	 * less the prefetch threshold, see ipa3_send()
+	 */
+	gsi_ep_cfg = ipa3_get_gsi_ep_info(IPA_CLIENT_APPS_CMD_PROD);
+	if (gsi_ep_cfg) {
+		int max_desc = gsi_ep_cfg->ipa_if_tlv;
+
+		if (gsi_ep_cfg->prefetch_mode == GSI_SMART_PRE_FETCH ||
+			gsi_ep_cfg->prefetch_mode == GSI_FREE_PRE_FETCH)
+			max_desc -= gsi_ep_cfg->prefetch_threshold;
+
+		max_dma_table_cmds -= IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC -
+			min(max_desc, IPA_MAX_NUM_OF_TABLE_DMA_CMD_DESC);
+	}
+
 	if (!dma->entries || dma->entries > (max_dma_table_cmds - 1)) {
 		IPAERR_RL("Invalid number of entries %d\n",
 			dma->entries);
@@ -2006,6 +2027,18 @@ int ipa3_table_dma_cmd(
 		}
 	}
 
+	/*
+	 * Room for the DMA entries plus the NOP and coal close ICs
+	 */
+	cmd_pyld = kcalloc(dma->entries + 2, sizeof(*cmd_pyld), GFP_KERNEL);
+	desc = kcalloc(dma->entries + 2, sizeof(*desc), GFP_KERNEL);
+
+	if (!cmd_pyld || !desc) {
+		IPAERR("Failed to allocate table_dma descriptors\n");
+		result = -ENOMEM;
+		goto bail;
+	}
+
 	/* IC to close the coal frame before HPS Clear if coal is enabled */
 	if (ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_COAL_CONS) != -1
 		&& !ipa3_ctx->ulso_wa) {
@@ -2089,6 +2122,9 @@ destroy_imm_cmd:
 		ipahal_destroy_imm_cmd(cmd_pyld[cnt]);
 
 bail:
+	kfree(desc);
+	kfree(cmd_pyld);
+
 	IPADBG("Out\n");
 
 	return result;
@@ -77,6 +77,18 @@ typedef struct {
 	uint8_t  protocol;
 } ipa_ipv6ct_rule;
 
+/**
+ * struct ipa_ipv6ct_prefix - To hold an IPv6 prefix
+ * @ipv6_lsb: IPv6 address LSB
+ * @ipv6_msb: IPv6 address MSB
+ * @len: prefix length in bits (0 - 128)
+ */
+typedef struct {
+	uint64_t ipv6_lsb;
+	uint64_t ipv6_msb;
+	uint8_t  len;
+} ipa_ipv6ct_prefix;
+
 /**
  * ipa_ipv6ct_add_tbl() - create IPv6CT table
  * @number_of_entries: [in] number of IPv6CT entries
@@ -121,6 +133,50 @@ int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule,
  */
 int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle);
 
+/**
+ * ipa_ipv6ct_add_rules() - to insert a number of new IPv6CT rules
+ * @table_handle: [in] handle of IPv6CT table
+ * @user_rules: [in] array of new rules
+ * @num_rules: [in] number of rules in user_rules
+ * @rule_handles: [out] array receiving the handle of each rule
+ *
+ * Like ipa_ipv6ct_add_rule() for each rule, but with the table updates
+ * for many rules posted to the IPA in one DMA command. On failure, the
+ * handle of every rule that wasn't added is zero.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_add_rules(uint32_t table_handle, const ipa_ipv6ct_rule* user_rules,
+	uint16_t num_rules, uint32_t* rule_handles);
+
+/**
+ * ipa_ipv6ct_del_rules() - to delete a number of IPv6CT rules
+ * @table_handle: [in] handle of IPv6CT table
+ * @rule_handles: [in] array of IPv6CT rule handles
+ * @num_rules: [in] number of handles in rule_handles
+ *
+ * Like ipa_ipv6ct_del_rule() for each rule, but with the table updates
+ * for many rules posted to the IPA in one DMA command
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_del_rules(uint32_t table_handle, const uint32_t* rule_handles, uint16_t num_rules);
+
+/**
+ * ipa_ipv6ct_flush_by_prefix() - to delete the IPv6CT rules of a prefix
+ * @table_handle: [in] handle of IPv6CT table
+ * @prefix: [in] prefix to flush
+ * @num_deleted: [out] number of rules deleted, may be NULL
+ *
+ * To delete every rule whose source or destination address is within
+ * prefix, eg. when the WAN IPv6 prefix changes. The rule handles of
+ * the deleted rules are no longer valid.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_ipv6ct_flush_by_prefix(uint32_t table_handle, const ipa_ipv6ct_prefix* prefix,
+	uint32_t* num_deleted);
+
 /**
  * ipa_ipv6ct_query_timestamp() - to query timestamp
  * @table_handle: [in] handle of IPv6CT table
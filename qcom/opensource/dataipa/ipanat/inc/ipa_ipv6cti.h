@@ -47,6 +47,13 @@
 #define IPA_IPV6CT_INVALID_PROTO_FIELD_VALUE 0xFF00
 #define IPA_IPV6CT_INVALID_PROTO_FIELD_CMP   0xFF
 
+/*
+ * Upper bound on the table DMA entries posted in one command by the
+ * bulk APIs. The driver sends at most IPA_SEND_MAX_DESC descriptors,
+ * two of which are its NOP and coalescing close
+ */
+#define IPA_IPV6CT_BULK_MAX_DMA_ENTRIES 18
+
 typedef enum
 {
 	IPA_IPV6CT_TABLE_FLAGS,
@@ -168,6 +168,28 @@ int ipa_nat_add_ipv4_rule(uint32_t table_handle,
 int ipa_nat_del_ipv4_rule(uint32_t table_handle,
 				uint32_t rule_handle);
 
+/**
+ * ipa_nat_set_batch_mode() - to batch ipv4 nat rule adds and deletes
+ * @max_rules: [in] rule adds/deletes per DMA commit, 0 or 1 to disable
+ * @max_delay_ms: [in] longest a queued add/delete waits for its commit
+ *
+ * Lets independent rule adds and deletes share one DMA command to the
+ * IPA instead of one each. A rule handle returned while batching is
+ * valid at once, but the IPA uses the rule only after the batch is
+ * committed, at the latest max_delay_ms later.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_batch_mode(uint16_t max_rules,
+				uint32_t max_delay_ms);
+
+/**
+ * ipa_nat_flush_batch() - to commit queued ipv4 nat rule updates
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_flush_batch(void);
+
 
 /**
  * ipa_nat_query_timestamp() - to query timestamp
@@ -249,6 +271,39 @@ int ipa_nat_dealloc_pdn(uint8_t pdn_index);
  */
 void ipa_nat_dump_ipv4_table(uint32_t tbl_hdl);
 
+/**
+ * struct ipa_nat_hash_stats - Bucket chain histograms of one table
+ * @chain_len: chains (ie. used base slots) by number of records
+ * @lookup_probes: rules by records the IPA reads to find them
+ * @insert_probes: rule adds since table creation or clear, by the
+ *                 records the IPA reads to find the added rule
+ *
+ * Element n counts n + 1 records and the last element everything
+ * longer.
+ */
+#define IPA_NAT_HASH_HIST_BUCKETS 8
+
+typedef struct {
+	uint32_t chain_len[IPA_NAT_HASH_HIST_BUCKETS];
+	uint32_t lookup_probes[IPA_NAT_HASH_HIST_BUCKETS];
+	uint32_t insert_probes[IPA_NAT_HASH_HIST_BUCKETS];
+} ipa_nat_hash_stats;
+
+/**
+ * ipa_nat_get_hash_stats() - to get hash quality histograms
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @nat_stats: [out] histograms of the NAT table (dst_hash)
+ * @idx_stats: [out] histograms of the index table (src_hash)
+ *
+ * In HYBRID mode, the table currently in use is reported.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_get_hash_stats(
+	uint32_t            tbl_hdl,
+	ipa_nat_hash_stats* nat_stats,
+	ipa_nat_hash_stats* idx_stats);
+
 /**
  * ipa_nat_vote_clock() - used for voting clock
  * @vote_type: [in] desired vote type
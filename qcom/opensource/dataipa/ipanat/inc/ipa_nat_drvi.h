@@ -270,6 +270,11 @@ struct ipa_nat_ip4_table_cache {
 	ipa_table index_table;
 	struct ipa_nat_indx_tbl_meta_info *index_expn_table_meta;
 	ipa_table_dma_cmd_helper table_dma_cmd_helpers[IPA_NAT_TABLE_DMA_CMD_MAX];
+	/*
+	 * Base table slots (one bit each) of batched adds the IPA refused
+	 * after their rule handle was returned to the caller
+	 */
+	uint32_t failed_add_map[IPA_TABLE_MAP_WORDS];
 };
 
 struct ipa_nat_cache {
@@ -351,8 +356,13 @@ typedef struct
 	uint32_t min_chain_len;
 	uint32_t max_chain_len;
 	float    avg_chain_len;
+	ipa_nat_hash_stats hash;
 } ipa_nati_tbl_stats;
 
+#if IPA_NAT_HASH_HIST_BUCKETS != IPA_TABLE_HIST_BUCKETS
+#error "ipa_nat_hash_stats and ipa_table histograms differ in size"
+#endif
+
 int ipa_nati_ipv4_tbl_stats(
 	uint32_t            tbl_hdl,
 	ipa_nati_tbl_stats* nat_stats_ptr,
@@ -361,6 +371,21 @@ int ipa_nati_ipv4_tbl_stats(
 int ipa_nati_vote_clock(
 	enum ipa_app_clock_vote_type vote_type );
 
+/*
+ * Upper bound on the table DMA entries carried by one batched commit.
+ * Must not exceed what the kernel takes per IPA_IOC_TABLE_DMA_CMD,
+ * which is IPA_SEND_MAX_DESC less its NOP and coalescing close.
+ * Every queued add or delete costs two entries.
+ */
+#define IPA_NAT_BATCH_MAX_DMA_ENTRIES 18
+#define IPA_NAT_BATCH_MAX_RULES       (IPA_NAT_BATCH_MAX_DMA_ENTRIES / 2)
+
+int ipa_nati_set_batch_mode(
+	uint16_t max_rules,
+	uint32_t max_delay_ms);
+
+int ipa_nati_flush_batch(void);
+
 int ipa_NATI_add_ipv4_tbl(
 	enum ipa3_nat_mem_in nmi,
 	uint32_t             public_ip_addr,
@@ -398,6 +423,19 @@ int ipa_NATI_del_ipv4_rule(
 	uint32_t tbl_hdl,
 	uint32_t rule_hdl);
 
+int ipa_NATI_add_ipv4_rule_deferred(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl);
+
+int ipa_NATI_del_ipv4_rule_deferred(
+	uint32_t tbl_hdl,
+	uint32_t rule_hdl);
+
+int ipa_NATI_flush_batch(void);
+
+bool ipa_NATI_batch_pending(void);
+
 int ipa_NATI_post_ipv4_init_cmd(
 	uint32_t tbl_hdl );
 
@@ -58,7 +58,7 @@ typedef enum
 } ipa_which_map;
 
 #define VALID_IPA_USE_MAP(w) \
-	( (w) >= MAP_NUM_00 || (w) < MAP_NUM_MAX )
+	( (w) >= MAP_NUM_00 && (w) < MAP_NUM_MAX )
 
 /* KEEP THE FOLLOWING IN SYNC WITH ABOVE. */
 static inline const char* ipa_which_map_as_str(
@@ -79,6 +79,14 @@ static inline const char* ipa_which_map_as_str(
 	return "???";
 }
 
+/*
+ * Make room for num_entries keys up front, so that later adds do not
+ * need to allocate
+ */
+int ipa_nat_map_reserve(
+	ipa_which_map which,
+	uint32_t      num_entries );
+
 int ipa_nat_map_add(
 	ipa_which_map which,
 	uint32_t      key,
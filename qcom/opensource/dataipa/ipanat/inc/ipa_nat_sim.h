@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef IPA_NAT_SIM_H
+#define IPA_NAT_SIM_H
+
+#ifndef FEATURE_IPA_NAT_SIM
+#error "The simulated IPA device is for test builds only"
+#endif
+
+#include "ipa_nat_utils.h"
+
+#include <stdint.h>
+
+/*
+ * A memory backed stand in for the IPA driver. It implements the
+ * ioctls used by the NAT and IPv6CT code (table allocation, init,
+ * table DMA, PDN, clock vote, ...) and applies table DMA commands to
+ * the table memory the way the IPA would, so that the library and
+ * its tests can be run on a plain Linux host.
+ *
+ * Only built into the tests (FEATURE_IPA_NAT_SIM), never into the
+ * library. Select it with ipa_dev_ops_set(&ipa_nat_sim_dev_ops).
+ */
+extern const ipa_dev_ops ipa_nat_sim_dev_ops;
+
+/*
+ * Bytes of SRAM offered for the NAT table. The default matches the
+ * targets' nat_tbl_size and can be overridden via the environment
+ * variable below. Zero means no SRAM.
+ */
+#define IPA_NAT_SIM_SRAM_SIZE_ENV  "IPA_NAT_SIM_SRAM_SIZE"
+#define IPA_NAT_SIM_DFLT_SRAM_SIZE 0xD00
+
+/*
+ * Largest number of entries accepted in one IPA_IOC_TABLE_DMA_CMD,
+ * same as the driver with the coalescing close in use
+ */
+#define IPA_NAT_SIM_MAX_DMA_ENTRIES 18
+
+typedef struct
+{
+	uint64_t ioctls;
+	uint64_t ioctl_errs;
+	uint64_t dma_cmds;        /* IPA_IOC_TABLE_DMA_CMD calls applied */
+	uint64_t dma_entries;     /* entries across all of the above */
+	uint32_t max_dma_entries; /* most entries in any one command */
+} ipa_nat_sim_stats;
+
+void ipa_nat_sim_get_stats(
+	ipa_nat_sim_stats* stats_ptr);
+
+void ipa_nat_sim_clear_stats(void);
+
+/*
+ * Refuse the next num_cmds IPA_IOC_TABLE_DMA_CMD calls, as the real
+ * driver does when it can't post the command
+ */
+void ipa_nat_sim_fail_dma(
+	uint32_t num_cmds);
+
+#endif /* IPA_NAT_SIM_H */
@@ -68,6 +68,7 @@
 #include <string.h>
 #include <syslog.h>
 #include <time.h>
+#include <sys/types.h>
 #include <linux/msm_ipa.h>
 
 #ifndef FALSE
@@ -108,6 +109,42 @@ typedef struct
 	enum ipa_hw_type ver;
 } ipa_descriptor;
 
+/*
+ * Every call the library makes on the IPA driver (ie. /dev/ipa and
+ * the NAT/IPv6CT table devices) goes through one of these, so that
+ * the device can be swapped for a simulated one (see ipa_nat_sim.h)
+ * when running off target.
+ */
+typedef struct
+{
+	const char* name;
+	int   (*open)(const char* path, int flags);
+	int   (*close)(int fd);
+	int   (*ioctl)(int fd, unsigned long req, unsigned long arg);
+	void* (*mmap)(void* addr, size_t len, int prot, int flags, int fd, off_t off);
+	int   (*munmap)(void* addr, size_t len);
+} ipa_dev_ops;
+
+const ipa_dev_ops* ipa_dev_ops_get(void);
+
+/*
+ * Only allowed while no ipa_descriptor is open. NULL selects the
+ * real device.
+ */
+int ipa_dev_ops_set(
+	const ipa_dev_ops* ops_ptr);
+
+#define IPA_DEV_OPEN(p, f) \
+	( ipa_dev_ops_get()->open((p), (f)) )
+#define IPA_DEV_CLOSE(fd) \
+	( ipa_dev_ops_get()->close(fd) )
+#define IPA_DEV_IOCTL(fd, req, arg) \
+	( ipa_dev_ops_get()->ioctl((fd), (req), (unsigned long) (arg)) )
+#define IPA_DEV_MMAP(a, l, p, f, fd, o) \
+	( ipa_dev_ops_get()->mmap((a), (l), (p), (f), (fd), (o)) )
+#define IPA_DEV_MUNMAP(a, l) \
+	( ipa_dev_ops_get()->munmap((a), (l)) )
+
 ipa_descriptor* ipa_descriptor_open(void);
 
 void ipa_descriptor_close(
@@ -35,6 +35,24 @@
 
 #define IPA_TABLE_MAX_ENTRIES 5120
 
+#define IPA_TABLE_MAP_WORD_BITS 32
+#define IPA_TABLE_MAP_WORDS \
+	( (IPA_TABLE_MAX_ENTRIES + IPA_TABLE_MAP_WORD_BITS - 1) / IPA_TABLE_MAP_WORD_BITS )
+
+/*
+ * Probe and chain length histograms: bucket n counts n + 1 records,
+ * the last bucket also counts everything longer
+ */
+#define IPA_TABLE_HIST_BUCKETS 8
+
+#undef  IPA_TABLE_HIST_ADD
+#define IPA_TABLE_HIST_ADD(hist, n) \
+	( (hist)[ ((n) < IPA_TABLE_HIST_BUCKETS) ? (n) - 1 : IPA_TABLE_HIST_BUCKETS - 1 ]++ )
+
+#undef  IPA_TABLE_HIST_SUB
+#define IPA_TABLE_HIST_SUB(hist, n) \
+	( (hist)[ ((n) < IPA_TABLE_HIST_BUCKETS) ? (n) - 1 : IPA_TABLE_HIST_BUCKETS - 1 ]-- )
+
 #define IPA_TABLE_INVALID_ENTRY 0x0
 
 #undef  VALID_INDEX
@@ -176,6 +194,20 @@ typedef struct
 
 	void*                      meta;
 	int                        meta_entry_size;
+
+	/*
+	 * Occupied expansion slots (one bit each) and the lowest map
+	 * word that may still hold a free one
+	 */
+	uint32_t                   expn_used_map[IPA_TABLE_MAP_WORDS];
+	uint16_t                   expn_free_hint;
+
+	/*
+	 * Inserts since the last reset, by the number of records the
+	 * IPA reads to reach the new entry (ie. its place in the chain)
+	 */
+	uint32_t                   insert_probes[IPA_TABLE_HIST_BUCKETS];
+	uint16_t                   last_insert_probes;
 } ipa_table;
 
 typedef struct
@@ -188,6 +220,8 @@ typedef struct
 
 	uint16_t next_index;
 	void*    next_entry;
+
+	uint16_t hops; /* links followed by ipa_table_iterator_end() */
 } ipa_table_iterator;
 
 
@@ -236,6 +270,10 @@ void ipa_table_erase_entry(
 	ipa_table* table,
 	uint16_t   index);
 
+void ipa_table_undo_add_entry(
+	ipa_table* table,
+	uint16_t   index);
+
 int ipa_table_get_entry(
 	ipa_table* table,
 	uint32_t   entry_handle,
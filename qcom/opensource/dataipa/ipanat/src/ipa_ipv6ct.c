@@ -83,6 +83,8 @@ static int ipa_ipv6ct_post_init_cmd(ipa_ipv6ct_table* ipv6ct_table, uint8_t tbl_
 static int ipa_ipv6ct_post_dma_cmd(struct ipa_ioc_nat_dma_cmd* cmd);
 static uint16_t ipa_ipv6ct_hash(const ipa_ipv6ct_rule* rule, uint16_t size);
 static uint16_t ipa_ipv6ct_xor_segments(uint64_t num);
+static uint16_t ipa_ipv6ct_entry_hash(const ipa_ipv6ct_hw_entry* entry, uint16_t size);
+static void ipa_ipv6ct_del_rule_finish(ipa_ipv6ct_table* ipv6ct_table, ipa_table_iterator* table_iterator);
 
 static int table_entry_is_valid(void* entry);
 static uint16_t table_entry_get_next_index(void* entry);
@@ -96,6 +98,9 @@ static uint16_t table_entry_get_delete_head_dma_command_data(void* head, void* n
 static ipa_ipv6ct ipv6ct;
 static pthread_mutex_t ipv6ct_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* Lowered if the driver takes fewer DMA entries per command */
+static uint8_t bulk_max_dma = IPA_IPV6CT_BULK_MAX_DMA_ENTRIES;
+
 static ipa_table_entry_interface entry_interface =
 {
 	table_entry_is_valid,
@@ -323,7 +328,7 @@ int ipa_ipv6ct_add_rule(uint32_t table_handle, const ipa_ipv6ct_rule* user_rule,
 	return 0;
 
 bail:
-	ipa_table_erase_entry(&ipv6ct_table->table, new_entry_index);
+	ipa_table_undo_add_entry(&ipv6ct_table->table, new_entry_index);
 unlock:
 	if (pthread_mutex_unlock(&ipv6ct_mutex))
 		IPAERR("unable to unlock the ipv6ct mutex\n");
@@ -401,13 +406,7 @@ int ipa_ipv6ct_del_rule(uint32_t table_handle, uint32_t rule_handle)
 		goto unlock;
 	}
 
-	if (!ipa_table_iterator_is_head_with_tail(&table_iterator))
-	{
-		/* The entry can be deleted */
-		uint8_t is_prev_empty = (table_iterator.prev_entry != NULL &&
-			((ipa_ipv6ct_hw_entry*)table_iterator.prev_entry)->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP);
-		ipa_table_delete_entry(&ipv6ct_table->table, &table_iterator, is_prev_empty);
-	}
+	ipa_ipv6ct_del_rule_finish(ipv6ct_table, &table_iterator);
 
 unlock:
 	if (pthread_mutex_unlock(&ipv6ct_mutex))
@@ -420,6 +419,18 @@ unlock:
 	return ret;
 }
 
+/* The software part of a delete, once its DMA command has been posted */
+static void ipa_ipv6ct_del_rule_finish(ipa_ipv6ct_table* ipv6ct_table, ipa_table_iterator* table_iterator)
+{
+	if (!ipa_table_iterator_is_head_with_tail(table_iterator))
+	{
+		/* The entry can be deleted */
+		uint8_t is_prev_empty = (table_iterator->prev_entry != NULL &&
+			((ipa_ipv6ct_hw_entry*)table_iterator->prev_entry)->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP);
+		ipa_table_delete_entry(&ipv6ct_table->table, table_iterator, is_prev_empty);
+	}
+}
+
 int ipa_ipv6ct_query_timestamp(uint32_t table_handle, uint32_t rule_handle, uint32_t* time_stamp)
 {
 	int ret;
@@ -478,6 +489,508 @@ unlock:
 	return ret;
 }
 
+/*
+ * Bulk rule adds and deletes
+ *
+ * The table DMA entries of many adds and deletes are gathered into one
+ * command. Since enable bits and next_index links only change once the
+ * command lands, software can't see a queued op when it walks a chain.
+ * Hence only one op per chain (ie. per base table slot) is queued at a
+ * time; an op on a chain that already has one posts the command first.
+ */
+typedef struct
+{
+	bool is_del;
+	bool failed;
+	uint8_t first_dma;
+	uint8_t num_dma;
+	uint32_t rule_idx;
+	ipa_table_iterator table_iterator; /* for adds only curr_index is set */
+} ipa_ipv6ct_bulk_op;
+
+typedef struct
+{
+	ipa_ipv6ct_table* ipv6ct_table;
+	uint32_t* rule_handles; /* handles returned by a bulk add */
+	uint8_t* busy_chains;   /* bitmap of base table slots with a queued op */
+	uint32_t num_done;
+	uint16_t num_ops;
+	ipa_ipv6ct_bulk_op ops[IPA_IPV6CT_BULK_MAX_DMA_ENTRIES];
+	union
+	{
+		struct ipa_ioc_nat_dma_cmd cmd;
+		char buf[sizeof(struct ipa_ioc_nat_dma_cmd) +
+			(IPA_IPV6CT_BULK_MAX_DMA_ENTRIES * sizeof(struct ipa_ioc_nat_dma_one))];
+	} dma;
+} ipa_ipv6ct_bulk;
+
+static ipa_ipv6ct_bulk* ipa_ipv6ct_bulk_create(ipa_ipv6ct_table* ipv6ct_table, uint32_t* rule_handles)
+{
+	ipa_ipv6ct_bulk* bulk;
+
+	bulk = calloc(1, sizeof(ipa_ipv6ct_bulk));
+	if (bulk == NULL)
+		return NULL;
+
+	bulk->busy_chains = calloc(ipv6ct_table->table.table_entries / 8 + 1, 1);
+	if (bulk->busy_chains == NULL)
+	{
+		free(bulk);
+		return NULL;
+	}
+
+	bulk->ipv6ct_table = ipv6ct_table;
+	bulk->rule_handles = rule_handles;
+
+	return bulk;
+}
+
+static void ipa_ipv6ct_bulk_destroy(ipa_ipv6ct_bulk* bulk)
+{
+	free(bulk->busy_chains);
+	free(bulk);
+}
+
+/**
+ * ipa_ipv6ct_bulk_commit() - posts the queued ops of a bulk operation
+ * @bulk: [in] the bulk operation
+ *
+ * If the command fails, the ops are posted one at a time to find the
+ * ones the driver won't take. Adds that fail are erased and their
+ * handle zeroed; the software cleanup of deletes is done for those
+ * that went through.
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+static int ipa_ipv6ct_bulk_commit(ipa_ipv6ct_bulk* bulk)
+{
+	ipa_table* table = &bulk->ipv6ct_table->table;
+	struct ipa_ioc_nat_dma_cmd* bcmd = &bulk->dma.cmd;
+	uint16_t i, failed = 0;
+	int ret;
+
+	if (!bulk->num_ops)
+		return 0;
+
+	IPADBG("posting %d ops with %d DMA entries\n", bulk->num_ops, bcmd->entries);
+
+	ret = ipa_ipv6ct_post_dma_cmd(bcmd);
+	if (ret)
+	{
+		uint32_t cmd_sz = sizeof(struct ipa_ioc_nat_dma_cmd) +
+			(IPA_MAX_DMA_ENTRIES_FOR_ADD * sizeof(struct ipa_ioc_nat_dma_one));
+		char cmd_buf[cmd_sz];
+		struct ipa_ioc_nat_dma_cmd* cmd = (struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+
+		IPAERR("bulk dma command of %d ops failed, posting one at a time\n", bulk->num_ops);
+
+		for (i = 0; i < bulk->num_ops; i++)
+		{
+			ipa_ipv6ct_bulk_op* op = &bulk->ops[i];
+
+			memset(cmd_buf, 0, sizeof(cmd_buf));
+			cmd->entries = op->num_dma;
+			memcpy(cmd->dma, &bcmd->dma[op->first_dma], op->num_dma * sizeof(struct ipa_ioc_nat_dma_one));
+
+			op->failed = (ipa_ipv6ct_post_dma_cmd(cmd) != 0);
+			failed += op->failed;
+		}
+
+		if (!failed)
+		{
+			/* Each op went through on its own, so the driver takes fewer entries per command */
+			bulk_max_dma = (bulk_max_dma / 2 > IPA_MAX_DMA_ENTRIES_FOR_ADD) ?
+				bulk_max_dma / 2 : IPA_MAX_DMA_ENTRIES_FOR_ADD;
+			IPAERR("lowering bulk DMA entries per command to %d\n", bulk_max_dma);
+		}
+
+		ret = (failed) ? -EIO : 0;
+	}
+
+	for (i = 0; i < bulk->num_ops; i++)
+	{
+		ipa_ipv6ct_bulk_op* op = &bulk->ops[i];
+
+		if (op->failed)
+		{
+			IPAERR("unable to %s IPV6CT entry %d\n", (op->is_del) ? "delete" : "add",
+				op->table_iterator.curr_index);
+
+			if (!op->is_del)
+			{
+				ipa_table_erase_entry(table, op->table_iterator.curr_index);
+				bulk->rule_handles[op->rule_idx] = 0;
+			}
+			continue;
+		}
+
+		if (op->is_del)
+			ipa_ipv6ct_del_rule_finish(bulk->ipv6ct_table, &op->table_iterator);
+
+		++bulk->num_done;
+	}
+
+	bulk->num_ops = 0;
+	bcmd->entries = 0;
+	memset(bulk->busy_chains, 0, table->table_entries / 8 + 1);
+
+	return ret;
+}
+
+/**
+ * ipa_ipv6ct_bulk_reserve() - makes room for an op on a chain
+ * @bulk: [in] the bulk operation
+ * @head_index: [in] base table slot of the op's chain
+ *
+ * Posts the queued ops first when the chain already has one, or when
+ * the command has no room left for another op.
+ *
+ * Returns:	0  On Success, negative if posting the queued ops failed
+ */
+static int ipa_ipv6ct_bulk_reserve(ipa_ipv6ct_bulk* bulk, uint16_t head_index)
+{
+	if ((bulk->busy_chains[head_index / 8] & (1 << (head_index % 8))) ||
+		bulk->dma.cmd.entries + IPA_MAX_DMA_ENTRIES_FOR_ADD > bulk_max_dma)
+	{
+		return ipa_ipv6ct_bulk_commit(bulk);
+	}
+
+	return 0;
+}
+
+static void ipa_ipv6ct_bulk_queue(ipa_ipv6ct_bulk* bulk, uint16_t head_index, bool is_del,
+	uint32_t rule_idx, uint8_t first_dma, ipa_table_iterator* table_iterator)
+{
+	ipa_ipv6ct_bulk_op* op = &bulk->ops[bulk->num_ops++];
+
+	op->is_del = is_del;
+	op->failed = false;
+	op->first_dma = first_dma;
+	op->num_dma = bulk->dma.cmd.entries - first_dma;
+	op->rule_idx = rule_idx;
+	op->table_iterator = *table_iterator;
+
+	bulk->busy_chains[head_index / 8] |= 1 << (head_index % 8);
+}
+
+static int ipa_ipv6ct_bulk_del(ipa_ipv6ct_table* ipv6ct_table, const uint32_t* rule_handles,
+	uint32_t num_rules, uint32_t* num_deleted)
+{
+	uint16_t size = ipv6ct_table->table.table_entries - 1;
+	ipa_ipv6ct_bulk* bulk;
+	ipa_table_iterator table_iterator;
+	ipa_ipv6ct_hw_entry* entry;
+	uint16_t index, head_index;
+	uint8_t first_dma;
+	uint32_t i;
+	int ret = 0, res;
+
+	bulk = ipa_ipv6ct_bulk_create(ipv6ct_table, NULL);
+	if (bulk == NULL)
+	{
+		IPAERR("unable to allocate bulk delete of %d rules\n", num_rules);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_rules; i++)
+	{
+		if (ipa_table_get_entry(&ipv6ct_table->table, rule_handles[i], (void**)&entry, &index))
+		{
+			IPAERR("unable to retrive the entry with handle=%d\n", rule_handles[i]);
+			ret = (ret) ? ret : -EINVAL;
+			continue;
+		}
+
+		head_index = ipa_ipv6ct_entry_hash(entry, size);
+
+		res = ipa_ipv6ct_bulk_reserve(bulk, head_index);
+		ret = (ret) ? ret : res;
+
+		/* The entry may have been deleted by the ops just posted, eg. a duplicate handle */
+		if (!table_entry_is_valid(entry))
+		{
+			IPAERR("entry with handle=%d is already deleted\n", rule_handles[i]);
+			ret = (ret) ? ret : -EINVAL;
+			continue;
+		}
+
+		res = ipa_table_iterator_init(&table_iterator, &ipv6ct_table->table, entry, index);
+		if (res)
+		{
+			IPAERR("unable to create iterator which points to the entry index=%d\n", index);
+			ret = (ret) ? ret : res;
+			continue;
+		}
+
+		first_dma = bulk->dma.cmd.entries;
+		ipa_table_create_delete_command(&ipv6ct_table->table, &bulk->dma.cmd, &table_iterator);
+		ipa_ipv6ct_bulk_queue(bulk, head_index, true, i, first_dma, &table_iterator);
+	}
+
+	res = ipa_ipv6ct_bulk_commit(bulk);
+	ret = (ret) ? ret : res;
+
+	if (num_deleted)
+		*num_deleted = bulk->num_done;
+
+	IPADBG("deleted %d of %d rules\n", bulk->num_done, num_rules);
+
+	ipa_ipv6ct_bulk_destroy(bulk);
+	return ret;
+}
+
+/* Validates the table handle and takes ipv6ct_mutex */
+static int ipa_ipv6ct_bulk_lock_table(uint32_t table_handle, ipa_ipv6ct_table** ipv6ct_table)
+{
+	if (ipv6ct.ipa_desc == NULL || ipv6ct.ipa_desc->ver < IPA_HW_v4_0)
+	{
+		IPAERR("IPv6 connection tracking isn't supported\n");
+		return -EINVAL;
+	}
+
+	if (table_handle == IPA_TABLE_INVALID_ENTRY || table_handle > IPA_IPV6CT_MAX_TBLS)
+	{
+		IPAERR("invalid table handle %d passed\n", table_handle);
+		return -EINVAL;
+	}
+
+	if (pthread_mutex_lock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to lock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	*ipv6ct_table = &ipv6ct.tables[table_handle - 1];
+	if (!(*ipv6ct_table)->mem_desc.valid)
+	{
+		IPAERR("invalid table handle %d\n", table_handle);
+		if (pthread_mutex_unlock(&ipv6ct_mutex))
+			IPAERR("unable to unlock the ipv6ct mutex\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int ipa_ipv6ct_add_rules(uint32_t table_handle, const ipa_ipv6ct_rule* user_rules,
+	uint16_t num_rules, uint32_t* rule_handles)
+{
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_ipv6ct_bulk* bulk;
+	ipa_table_iterator table_iterator;
+	uint16_t i, new_entry_index, head_index;
+	uint8_t first_dma;
+	int ret, res;
+
+	IPADBG("\n");
+
+	if (user_rules == NULL || rule_handles == NULL || num_rules == 0)
+	{
+		IPAERR("Invalid parameters user_rules=%pK rule_handles=%pK num_rules=%d\n",
+			user_rules, rule_handles, num_rules);
+		return -EINVAL;
+	}
+
+	memset(rule_handles, 0, num_rules * sizeof(uint32_t));
+
+	for (i = 0; i < num_rules; i++)
+	{
+		if (user_rules[i].protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+		{
+			IPAERR("invalid parameter protocol=%d in rule %d\n", user_rules[i].protocol, i);
+			return -EINVAL;
+		}
+	}
+
+	ret = ipa_ipv6ct_bulk_lock_table(table_handle, &ipv6ct_table);
+	if (ret)
+		return ret;
+
+	bulk = ipa_ipv6ct_bulk_create(ipv6ct_table, rule_handles);
+	if (bulk == NULL)
+	{
+		IPAERR("unable to allocate bulk add of %d rules\n", num_rules);
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	memset(&table_iterator, 0, sizeof(table_iterator));
+
+	for (i = 0; i < num_rules; i++)
+	{
+		head_index = ipa_ipv6ct_hash(&user_rules[i], ipv6ct_table->table.table_entries - 1);
+
+		res = ipa_ipv6ct_bulk_reserve(bulk, head_index);
+		ret = (ret) ? ret : res;
+
+		new_entry_index = head_index;
+		first_dma = bulk->dma.cmd.entries;
+
+		res = ipa_table_add_entry(&ipv6ct_table->table, (void*)&user_rules[i], &new_entry_index,
+			&rule_handles[i], &bulk->dma.cmd);
+		if (res)
+		{
+			/* Most likely the table is full, so don't bother with the rest */
+			IPAERR("failed to add a new IPV6CT entry, %d of %d rules added\n", i, num_rules);
+			rule_handles[i] = 0;
+			bulk->dma.cmd.entries = first_dma;
+			ret = (ret) ? ret : res;
+			break;
+		}
+
+		table_iterator.curr_index = new_entry_index;
+		ipa_ipv6ct_bulk_queue(bulk, head_index, false, i, first_dma, &table_iterator);
+	}
+
+	res = ipa_ipv6ct_bulk_commit(bulk);
+	ret = (ret) ? ret : res;
+
+	IPADBG("added %d of %d rules\n", bulk->num_done, num_rules);
+
+	ipa_ipv6ct_bulk_destroy(bulk);
+
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+int ipa_ipv6ct_del_rules(uint32_t table_handle, const uint32_t* rule_handles, uint16_t num_rules)
+{
+	ipa_ipv6ct_table* ipv6ct_table;
+	int ret;
+
+	IPADBG("\n");
+
+	if (rule_handles == NULL || num_rules == 0)
+	{
+		IPAERR("Invalid parameters rule_handles=%pK num_rules=%d\n", rule_handles, num_rules);
+		return -EINVAL;
+	}
+
+	ret = ipa_ipv6ct_bulk_lock_table(table_handle, &ipv6ct_table);
+	if (ret)
+		return ret;
+
+	ret = ipa_ipv6ct_bulk_del(ipv6ct_table, rule_handles, num_rules, NULL);
+
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
+typedef struct
+{
+	uint64_t msb;
+	uint64_t lsb;
+	uint64_t msb_mask;
+	uint64_t lsb_mask;
+	uint32_t* rule_handles;
+	uint32_t num_rules;
+	uint32_t max_rules;
+} ipa_ipv6ct_prefix_walk;
+
+static bool ipa_ipv6ct_prefix_match(const ipa_ipv6ct_prefix_walk* walk, uint64_t msb, uint64_t lsb)
+{
+	return !((msb ^ walk->msb) & walk->msb_mask) && !((lsb ^ walk->lsb) & walk->lsb_mask);
+}
+
+static int ipa_ipv6ct_prefix_walk_cb(ipa_table* table_ptr, uint32_t rule_hdl, void* record_ptr,
+	uint16_t record_index, void* meta_record_ptr, uint16_t meta_record_index, void* arb_data_ptr)
+{
+	ipa_ipv6ct_hw_entry* entry = (ipa_ipv6ct_hw_entry*)record_ptr;
+	ipa_ipv6ct_prefix_walk* walk = (ipa_ipv6ct_prefix_walk*)arb_data_ptr;
+
+	/* Skip the heads which are deleted but still hold a chain */
+	if (entry->protocol == IPA_IPV6CT_INVALID_PROTO_FIELD_CMP)
+		return 0;
+
+	if (walk->num_rules < walk->max_rules &&
+		(ipa_ipv6ct_prefix_match(walk, entry->src_ipv6_msb, entry->src_ipv6_lsb) ||
+		 ipa_ipv6ct_prefix_match(walk, entry->dest_ipv6_msb, entry->dest_ipv6_lsb)))
+	{
+		walk->rule_handles[walk->num_rules++] = rule_hdl;
+	}
+
+	return 0;
+}
+
+int ipa_ipv6ct_flush_by_prefix(uint32_t table_handle, const ipa_ipv6ct_prefix* prefix,
+	uint32_t* num_deleted)
+{
+	ipa_ipv6ct_table* ipv6ct_table;
+	ipa_ipv6ct_prefix_walk walk;
+	int ret;
+
+	IPADBG("\n");
+
+	if (num_deleted)
+		*num_deleted = 0;
+
+	if (prefix == NULL || prefix->len > 128)
+	{
+		IPAERR("Invalid parameters prefix=%pK len=%d\n", prefix, (prefix) ? prefix->len : 0);
+		return -EINVAL;
+	}
+
+	memset(&walk, 0, sizeof(walk));
+	walk.msb = prefix->ipv6_msb;
+	walk.lsb = prefix->ipv6_lsb;
+	walk.msb_mask = (prefix->len >= 64) ? ~0ULL : (prefix->len) ? ~0ULL << (64 - prefix->len) : 0;
+	walk.lsb_mask = (prefix->len > 64) ? ~0ULL << (128 - prefix->len) : 0;
+
+	ret = ipa_ipv6ct_bulk_lock_table(table_handle, &ipv6ct_table);
+	if (ret)
+		return ret;
+
+	walk.max_rules = ipv6ct_table->table.cur_tbl_cnt + ipv6ct_table->table.cur_expn_tbl_cnt;
+	if (!walk.max_rules)
+		goto unlock;
+
+	walk.rule_handles = malloc(walk.max_rules * sizeof(uint32_t));
+	if (walk.rule_handles == NULL)
+	{
+		IPAERR("unable to allocate %d rule handles\n", walk.max_rules);
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	ret = ipa_table_walk(&ipv6ct_table->table, 0, WHEN_SLOT_FILLED, ipa_ipv6ct_prefix_walk_cb, &walk);
+	if (ret)
+	{
+		IPAERR("unable to walk IPV6CT table with handle=%d\n", table_handle);
+		goto bail;
+	}
+
+	IPADBG("%d rules within prefix 0x%llx:0x%llx/%d\n", walk.num_rules,
+		(unsigned long long)prefix->ipv6_msb, (unsigned long long)prefix->ipv6_lsb, prefix->len);
+
+	if (walk.num_rules)
+		ret = ipa_ipv6ct_bulk_del(ipv6ct_table, walk.rule_handles, walk.num_rules, num_deleted);
+
+bail:
+	free(walk.rule_handles);
+unlock:
+	if (pthread_mutex_unlock(&ipv6ct_mutex))
+	{
+		IPAERR("unable to unlock the ipv6ct mutex\n");
+		return (ret) ? ret : -EPERM;
+	}
+
+	IPADBG("return\n");
+	return ret;
+}
+
 /**
 * ipv6ct_hash() - Find the index into ipv6ct table
 * @rule: [in] an IPv6CT rule
@@ -524,6 +1037,23 @@ static uint16_t ipa_ipv6ct_hash(const ipa_ipv6ct_rule* rule, uint16_t size)
 	return hash;
 }
 
+/* The hash of an entry, ie. the base table slot heading its chain */
+static uint16_t ipa_ipv6ct_entry_hash(const ipa_ipv6ct_hw_entry* entry, uint16_t size)
+{
+	ipa_ipv6ct_rule rule;
+
+	memset(&rule, 0, sizeof(rule));
+	rule.src_ipv6_lsb = entry->src_ipv6_lsb;
+	rule.src_ipv6_msb = entry->src_ipv6_msb;
+	rule.dest_ipv6_lsb = entry->dest_ipv6_lsb;
+	rule.dest_ipv6_msb = entry->dest_ipv6_msb;
+	rule.src_port = entry->src_port;
+	rule.dest_port = entry->dest_port;
+	rule.protocol = entry->protocol;
+
+	return ipa_ipv6ct_hash(&rule, size);
+}
+
 static uint16_t ipa_ipv6ct_xor_segments(uint64_t num)
 {
 	const uint64_t mask = 0xffff;
@@ -823,7 +1353,7 @@ static int ipa_ipv6ct_post_init_cmd(ipa_ipv6ct_table* ipv6ct_table, uint8_t tbl_
 	cmd.table_entries = ipv6ct_table->table.table_entries - 1;
 	cmd.expn_table_entries = ipv6ct_table->table.expn_table_entries;
 
-	ret = ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_INIT_IPV6CT_TABLE, &cmd);
+	ret = IPA_DEV_IOCTL(ipv6ct.ipa_desc->fd, IPA_IOC_INIT_IPV6CT_TABLE, &cmd);
 	if (ret)
 	{
 		IPAERR("unable to post init cmd Error: %d IPA fd %d\n", ret, ipv6ct.ipa_desc->fd);
@@ -840,7 +1370,7 @@ static int ipa_ipv6ct_post_dma_cmd(struct ipa_ioc_nat_dma_cmd* cmd)
 
 	cmd->mem_type = IPA_NAT_MEM_IN_DDR;
 
-	if (ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd))
+	if (IPA_DEV_IOCTL(ipv6ct.ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd))
 	{
 		IPAERR("ioctl (IPA_IOC_TABLE_DMA_CMD) on fd %d has failed\n",
 			   ipv6ct.ipa_desc->fd);
@@ -900,7 +1430,7 @@ int ipa_ipv6ct_add_uc_act_entry(union ipa_ioc_uc_activation_entry *u)
 {
 	IPADBG("\n");
 
-	if(ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_ADD_UC_ACT_ENTRY, u))
+	if(IPA_DEV_IOCTL(ipv6ct.ipa_desc->fd, IPA_IOC_ADD_UC_ACT_ENTRY, u))
 	{
 		IPAERR("ioctl (IPA_IOC_ADD_UC_ACT_ENTRY) on fd %d has failed\n",
 			ipv6ct.ipa_desc->fd);
@@ -921,7 +1451,7 @@ int ipa_ipv6ct_del_uc_act_entry(uint16_t index)
 {
 	IPADBG("\n");
 
-	if(ioctl(ipv6ct.ipa_desc->fd, IPA_IOC_DEL_UC_ACT_ENTRY, index))
+	if(IPA_DEV_IOCTL(ipv6ct.ipa_desc->fd, IPA_IOC_DEL_UC_ACT_ENTRY, index))
 	{
 		IPAERR("ioctl (IPA_IOC_DEL_UC_ACT_ENTRY) on fd %d has failed\n",
 			ipv6ct.ipa_desc->fd);
@@ -75,7 +75,7 @@ static int AllocateMemory(
 
 	memset(&desc->nat_sram_info, 0, sizeof(desc->nat_sram_info));
 
-	ret = ioctl(
+	ret = IPA_DEV_IOCTL(
 		ipa_fd,
 		IPA_IOC_GET_NAT_IN_SRAM_INFO,
 		&desc->nat_sram_info);
@@ -109,7 +109,7 @@ static int AllocateMemory(
 
 	cmd.size = desc->orig_rqst_size;
 
-	ret = ioctl(ipa_fd, desc->allocate_ioctl_num, &cmd);
+	ret = IPA_DEV_IOCTL(ipa_fd, desc->allocate_ioctl_num, &cmd);
 
 	if (ret)
 	{
@@ -153,7 +153,7 @@ static int MapMemory(
 	strlcpy(device_full_path + ipa_dev_dir_path_len,
 			desc->name, IPA_RESOURCE_NAME_MAX - ipa_dev_dir_path_len);
 
-	device_fd = open(device_full_path, O_RDWR);
+	device_fd = IPA_DEV_OPEN(device_full_path, O_RDWR);
 
 	if (device_fd < 0)
 	{
@@ -190,7 +190,7 @@ static int MapMemory(
 		desc->orig_rqst_size;
 
 	desc->mmap_addr = desc->base_addr =
-		(void* )mmap(
+		(void* )IPA_DEV_MMAP(
 			NULL,
 			desc->mmap_size,
 			PROT_READ | PROT_WRITE,
@@ -200,7 +200,7 @@ static int MapMemory(
 #else
 	IPADBG("user space r3pc\n");
 	desc->mmap_addr = desc->base_addr =
-		(void *) mmap(
+		(void *) IPA_DEV_MMAP(
 			(caddr_t)0,
 			IPA_DEVICE_MMAP_MEM_SIZE,
 			PROT_READ | PROT_WRITE,
@@ -229,7 +229,7 @@ static int MapMemory(
 		   (long unsigned int) desc->base_addr);
 
 close:
-	if (close(device_fd))
+	if (IPA_DEV_CLOSE(device_fd))
 	{
 		IPAERR("unable to close the file descriptor for %s\n", desc->name);
 		ret = -EINVAL;
@@ -259,7 +259,7 @@ static int DeallocateMemory(
 		IPA_NAT_MEM_IN_SRAM       :
 		IPA_NAT_MEM_IN_DDR;
 
-	ret = ioctl(ipa_fd, desc->delete_ioctl_num, &cmd);
+	ret = IPA_DEV_IOCTL(ipa_fd, desc->delete_ioctl_num, &cmd);
 
 	if (ret)
 	{
@@ -349,9 +349,9 @@ int ipa_mem_descriptor_delete(
 	desc->valid = FALSE;
 
 #ifndef IPA_ON_R3PC
-	munmap(desc->mmap_addr, desc->mmap_size);
+	IPA_DEV_MUNMAP(desc->mmap_addr, desc->mmap_size);
 #else
-	munmap(desc->mmap_addr, IPA_DEVICE_MMAP_MEM_SIZE);
+	IPA_DEV_MUNMAP(desc->mmap_addr, IPA_DEVICE_MMAP_MEM_SIZE);
 #endif
 
 	ret = DeallocateMemory(desc, ipa_fd);
@@ -169,6 +169,41 @@ int ipa_nat_del_ipv4_rule(
 	return 0;
 }
 
+/**
+ * ipa_nat_set_batch_mode() - to batch ipv4 nat rule adds and deletes
+ * @max_rules: [in] rule adds/deletes per DMA commit, 0 or 1 to disable
+ * @max_delay_ms: [in] longest a queued add/delete waits for its commit
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_set_batch_mode(
+	uint16_t max_rules,
+	uint32_t max_delay_ms)
+{
+	if (max_rules > IPA_NAT_BATCH_MAX_RULES) {
+		IPAERR("Invalid max_rules %u, limit %u\n",
+			   max_rules, IPA_NAT_BATCH_MAX_RULES);
+		return -EINVAL;
+	}
+
+	if (max_rules > 1 && max_delay_ms == 0) {
+		IPAERR("A delay bound is required when batching\n");
+		return -EINVAL;
+	}
+
+	return ipa_nati_set_batch_mode(max_rules, max_delay_ms);
+}
+
+/**
+ * ipa_nat_flush_batch() - to commit queued ipv4 nat rule updates
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_flush_batch(void)
+{
+	return ipa_nati_flush_batch();
+}
+
 /**
  * ipa_nat_query_timestamp() - to query timestamp
  * @table_handle: [in] handle of ipv4 nat table
@@ -330,6 +365,40 @@ int ipa_nat_dealloc_pdn(
 	return ipa_nati_dealloc_pdn(pdn_index);
 }
 
+/**
+ * ipa_nat_get_hash_stats() - to get hash quality histograms
+ * @tbl_hdl: [in] handle of ipv4 nat table
+ * @nat_stats: [out] histograms of the NAT table (dst_hash)
+ * @idx_stats: [out] histograms of the index table (src_hash)
+ *
+ * Returns:	0  On Success, negative on failure
+ */
+int ipa_nat_get_hash_stats(
+	uint32_t            tbl_hdl,
+	ipa_nat_hash_stats* nat_stats,
+	ipa_nat_hash_stats* idx_stats)
+{
+	ipa_nati_tbl_stats nstats, istats;
+	int ret;
+
+	if ( ! VALID_TBL_HDL(tbl_hdl) || ! nat_stats || ! idx_stats )
+	{
+		IPAERR("Invalid parameters tbl_hdl=0x%x nat_stats=%pK idx_stats=%pK\n",
+			   tbl_hdl, nat_stats, idx_stats);
+		return -EINVAL;
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+
+	if ( ret == 0 )
+	{
+		*nat_stats = nstats.hash;
+		*idx_stats = istats.hash;
+	}
+
+	return ret;
+}
+
 /**
  * ipa_nat_vote_clock() - used for voting clock
  * @vote_type: [in] desired vote type
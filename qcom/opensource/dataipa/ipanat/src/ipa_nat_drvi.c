@@ -38,6 +38,8 @@
 #include <netinet/in.h>
 #include <errno.h>
 #include <pthread.h>
+#include <signal.h>
+#include <time.h>
 #include <unistd.h>
 #include <linux/msm_ipa.h>
 
@@ -789,7 +791,7 @@ static int ipa_nati_create_table(
 	base_addr = nat_table->mem_desc.base_addr;
 
 #ifdef IPA_ON_R3PC
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd,
+	ret = IPA_DEV_IOCTL(nat_cache_ptr->ipa_desc->fd,
 				IPA_IOC_GET_NAT_OFFSET,
 				&nat_mem_offset);
 	if (ret) {
@@ -807,6 +809,8 @@ static int ipa_nati_create_table(
 	ipa_table_reset(&nat_table->table);
 	ipa_table_reset(&nat_table->index_table);
 
+	memset(nat_table->failed_add_map, 0, sizeof(nat_table->failed_add_map));
+
 	ipa_nati_create_table_dma_cmd_helpers(nat_table, table_index);
 
 	goto done;
@@ -900,7 +904,7 @@ static int ipa_nati_post_ipv4_init_cmd(
 
 	IPADBG("%s\n", ipa_ioc_v4_nat_init_as_str(&cmd, buf, sizeof(buf)));
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_V4_INIT_NAT, &cmd);
+	ret = IPA_DEV_IOCTL(nat_cache_ptr->ipa_desc->fd, IPA_IOC_V4_INIT_NAT, &cmd);
 
 	if (ret) {
 		IPAERR("unable to post init cmd Error: %d IPA fd %d\n",
@@ -1091,7 +1095,7 @@ static int ipa_nati_post_ipv4_dma_cmd(
 
 	IPADBG("%s\n", prep_ioc_nat_dma_cmd_4print(cmd, buf, sizeof(buf)));
 
-	if (ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd)) {
+	if (IPA_DEV_IOCTL(nat_cache_ptr->ipa_desc->fd, IPA_IOC_TABLE_DMA_CMD, cmd)) {
 		IPAERR("ioctl (IPA_IOC_TABLE_DMA_CMD) on fd %d has failed\n",
 			   nat_cache_ptr->ipa_desc->fd);
 		ret = -EIO;
@@ -1106,6 +1110,308 @@ bail:
 	return ret;
 }
 
+/*
+ * ----------------------------------------------------------------------------
+ * Private helpers for batching rule adds and deletes
+ * ----------------------------------------------------------------------------
+ *
+ * When batch mode is on, rule adds and deletes coming from the state
+ * machine have their table DMA entries accumulated in nati_batch
+ * rather than posted one ioctl at a time. The batch is committed with
+ * one IPA_IOC_TABLE_DMA_CMD when it reaches max_rules, when the oldest
+ * queued op is older than max_delay_ms, or on any other state machine
+ * trigger.
+ *
+ * Because rule enable bits and next_index links only change when the
+ * DMA lands, software can't see queued ops through the tables. Only
+ * ops that are independent of each other are queued:
+ *
+ *   - adds that land in an empty base slot of both the rule and index
+ *     tables (ie. head inserts, two DMA entries)
+ *
+ *   - deletes of entries that aren't a head with a tail in either
+ *     table (two DMA entries)
+ *
+ *   - and whose slots (including prev/next neighbours for deletes)
+ *     aren't touched by any op already queued
+ *
+ * Anything else commits the batch first, then proceeds as before.
+ * The software cleanup for a queued delete runs after its commit.
+ */
+typedef struct
+{
+	struct ipa_nat_ip4_table_cache* nat_table;
+	bool                            is_del;
+	bool                            failed;
+	uint8_t                         first_dma;
+	uint8_t                         num_dma;
+	/*
+	 * For adds, only curr_index is set in each iterator
+	 */
+	ipa_table_iterator              table_iterator;
+	ipa_table_iterator              index_table_iterator;
+} nati_batch_op;
+
+static struct
+{
+	uint16_t              max_rules;
+	uint32_t              max_delay_ms;
+	uint8_t               max_dma;
+
+	struct ipa_nat_cache* nat_cache_ptr;
+	uint16_t              num_ops;
+	uint64_t              first_op_ms;
+	nati_batch_op         ops[IPA_NAT_BATCH_MAX_RULES];
+
+	timer_t               timer;
+	bool                  timer_created;
+
+	uint32_t              commits;
+	uint32_t              ops_committed;
+	uint32_t              ops_failed;
+
+	union
+	{
+		struct ipa_ioc_nat_dma_cmd cmd;
+		char buf[sizeof(struct ipa_ioc_nat_dma_cmd) +
+				 (IPA_NAT_BATCH_MAX_DMA_ENTRIES *
+				  sizeof(struct ipa_ioc_nat_dma_one))];
+	} dma;
+} nati_batch;
+
+static void ipa_nati_del_ipv4_rule_finish(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	ipa_table_iterator*             table_iterator,
+	ipa_table_iterator*             index_table_iterator);
+
+static bool ipa_nati_batch_iter_has(
+	ipa_table_iterator* iterator,
+	uint16_t            index)
+{
+	return
+		VALID_INDEX(index) &&
+		(iterator->curr_index == index ||
+		 iterator->prev_index == index ||
+		 iterator->next_index == index);
+}
+
+/*
+ * Does any queued op read or write slot index of table?
+ */
+static bool ipa_nati_batch_touches(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	ipa_table*                      table,
+	uint16_t                        index)
+{
+	uint16_t i;
+
+	for ( i = 0; i < nati_batch.num_ops; i++ )
+	{
+		nati_batch_op* op = &nati_batch.ops[i];
+
+		if ( op->nat_table != nat_table )
+			continue;
+
+		if ( table == &nat_table->table &&
+			 ipa_nati_batch_iter_has(&op->table_iterator, index) )
+			return true;
+
+		if ( table == &nat_table->index_table &&
+			 ipa_nati_batch_iter_has(&op->index_table_iterator, index) )
+			return true;
+	}
+
+	return false;
+}
+
+static bool ipa_nati_batch_iter_is_free(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	ipa_table*                      table,
+	ipa_table_iterator*             iterator)
+{
+	return
+		! ipa_nati_batch_touches(nat_table, table, iterator->prev_index) &&
+		! ipa_nati_batch_touches(nat_table, table, iterator->curr_index) &&
+		! ipa_nati_batch_touches(nat_table, table, iterator->next_index);
+}
+
+/*
+ * A batched add the IPA refused already had its rule handle returned,
+ * so its slots can't go back to the free pool: a later add could take
+ * them and the owner's delete of the old handle would remove the new
+ * rule. Park the base record as a dead head instead (enabled, but with
+ * a protocol the IPA never matches, as a delete of a head with a tail
+ * leaves it) with its index record pointing at it, until the owner
+ * deletes the handle, which then fails.
+ */
+static void ipa_nati_park_failed_add(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	uint16_t                        index,
+	uint16_t                        index_tbl_index)
+{
+	struct ipa_nat_rule* rule =
+		(struct ipa_nat_rule*) GOTO_REC(&nat_table->table, index);
+	struct ipa_nat_indx_tbl_rule* index_rule =
+		(struct ipa_nat_indx_tbl_rule*)
+		GOTO_REC(&nat_table->index_table, index_tbl_index);
+
+	rule->protocol = IPA_NAT_INVALID_PROTO_FIELD_VALUE_IN_RULE;
+	rule->enable   = IPA_NAT_FLAG_ENABLE_BIT;
+
+	index_rule->tbl_entry = index;
+
+	nat_table->failed_add_map[index / IPA_TABLE_MAP_WORD_BITS] |=
+		1U << (index % IPA_TABLE_MAP_WORD_BITS);
+}
+
+static bool ipa_nati_is_failed_add(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	uint16_t                        index)
+{
+	return
+		index < nat_table->table.table_entries &&
+		(nat_table->failed_add_map[index / IPA_TABLE_MAP_WORD_BITS] &
+		 (1U << (index % IPA_TABLE_MAP_WORD_BITS)));
+}
+
+static void ipa_nati_batch_arm_timer(void)
+{
+	struct itimerspec its;
+
+	if ( ! nati_batch.timer_created || ! nati_batch.max_delay_ms )
+		return;
+
+	memset(&its, 0, sizeof(its));
+
+	its.it_value.tv_sec  = nati_batch.max_delay_ms / MILLIS_PER_SEC;
+	its.it_value.tv_nsec =
+		(nati_batch.max_delay_ms % MILLIS_PER_SEC) * (NANOS_PER_SEC / MILLIS_PER_SEC);
+
+	if ( timer_settime(nati_batch.timer, 0, &its, NULL) )
+		IPAERR("Unable to arm the batch timer: %s\n", strerror(errno));
+}
+
+static void ipa_nati_batch_disarm_timer(void)
+{
+	struct itimerspec its;
+
+	if ( ! nati_batch.timer_created )
+		return;
+
+	memset(&its, 0, sizeof(its));
+
+	timer_settime(nati_batch.timer, 0, &its, NULL);
+}
+
+/*
+ * Runs on its own thread; goes through the state machine so the
+ * mutex is taken and the clock voted like for any other trigger
+ */
+static void ipa_nati_batch_timer_cb(
+	union sigval sv)
+{
+	IPADBG("In\n");
+
+	(void) sv;
+
+	if ( ipa_nati_flush_batch() )
+		IPAERR("Timed commit of the NAT rule batch failed\n");
+
+	IPADBG("Out\n");
+}
+
+/*
+ * Queue the DMA entries of an add or delete that has passed the
+ * checks above. Caller holds nat_mutex.
+ */
+static int ipa_nati_batch_queue(
+	struct ipa_nat_cache*           nat_cache_ptr,
+	struct ipa_nat_ip4_table_cache* nat_table,
+	struct ipa_ioc_nat_dma_cmd*     cmd,
+	bool                            is_del,
+	ipa_table_iterator*             table_iterator,
+	ipa_table_iterator*             index_table_iterator)
+{
+	struct ipa_ioc_nat_dma_cmd* bcmd = &nati_batch.dma.cmd;
+	nati_batch_op*              op   = &nati_batch.ops[nati_batch.num_ops];
+
+	IPADBG("In\n");
+
+	if ( nati_batch.num_ops == 0 )
+	{
+		nati_batch.nat_cache_ptr = nat_cache_ptr;
+		bcmd->entries            = 0;
+
+		currTimeAs(TimeAsMilSecs, &nati_batch.first_op_ms);
+
+		ipa_nati_batch_arm_timer();
+	}
+
+	memset(op, 0, sizeof(*op));
+
+	op->nat_table            = nat_table;
+	op->is_del               = is_del;
+	op->first_dma            = bcmd->entries;
+	op->num_dma              = cmd->entries;
+	op->table_iterator       = *table_iterator;
+	op->index_table_iterator = *index_table_iterator;
+
+	memcpy(&bcmd->dma[bcmd->entries],
+		   cmd->dma,
+		   cmd->entries * sizeof(struct ipa_ioc_nat_dma_one));
+
+	bcmd->entries += cmd->entries;
+
+	nati_batch.num_ops++;
+
+	IPADBG("Queued %s, %u ops with %u DMA entries pending\n",
+		   (is_del) ? "delete" : "add",
+		   nati_batch.num_ops,
+		   bcmd->entries);
+
+	if ( nati_batch.num_ops >= nati_batch.max_rules ||
+		 bcmd->entries + MAX_DMA_ENTRIES_FOR_ADD > nati_batch.max_dma )
+	{
+		IPADBG("Batch full\n");
+		ipa_NATI_flush_batch();
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
+
+/*
+ * Decide whether a new op may be queued. If it can't, or the batch is
+ * older than max_delay_ms, what is queued is committed first so that
+ * the op sees the tables as the IPA does.
+ */
+static bool ipa_nati_batch_admit(
+	struct ipa_nat_cache* nat_cache_ptr,
+	bool                  independent)
+{
+	uint64_t now;
+
+	if ( nati_batch.num_ops == 0 )
+		return independent;
+
+	if ( ! independent || nati_batch.nat_cache_ptr != nat_cache_ptr )
+	{
+		ipa_NATI_flush_batch();
+		return false;
+	}
+
+	currTimeAs(TimeAsMilSecs, &now);
+
+	if ( now - nati_batch.first_op_ms >= nati_batch.max_delay_ms )
+	{
+		IPADBG("Batch aged out\n");
+		ipa_NATI_flush_batch();
+	}
+
+	return true;
+}
+
 /*
  * ----------------------------------------------------------------------------
  * API functions exposed to the upper layers
@@ -1134,7 +1440,7 @@ int ipa_nati_modify_pdn(
 	if (entry->public_ip == 0)
 		IPADBG("PDN %d public ip will be set  to 0\n", entry->pdn_index);
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd, IPA_IOC_NAT_MODIFY_PDN, entry);
+	ret = IPA_DEV_IOCTL(nat_cache_ptr->ipa_desc->fd, IPA_IOC_NAT_MODIFY_PDN, entry);
 
 	if ( ret ) {
 		IPAERR("unable to call modify pdn icotl\nindex %d, ip 0x%X, src_metdata 0x%X, dst_metadata 0x%X IPA fd %d\n",
@@ -1624,10 +1930,11 @@ bail:
 	return ret;
 }
 
-int ipa_NATI_add_ipv4_rule(
+static int ipa_nati_add_ipv4_rule_common(
 	uint32_t                 tbl_hdl,
 	const ipa_nat_ipv4_rule* clnt_rule,
-	uint32_t*                rule_hdl)
+	uint32_t*                rule_hdl,
+	bool                     may_defer)
 {
 	uint32_t cmd_sz =
 		sizeof(struct ipa_ioc_nat_dma_cmd) +
@@ -1644,6 +1951,7 @@ int ipa_NATI_add_ipv4_rule(
 	uint16_t new_entry_index;
 	uint16_t new_index_tbl_entry_index;
 	uint32_t new_entry_handle;
+	bool     defer = false;
 	char     buf[1024];
 
 	int ret = 0;
@@ -1738,18 +2046,6 @@ int ipa_NATI_add_ipv4_rule(
 		nat_table->table.table_entries - 1);
 	}
 
-	ret = ipa_table_add_entry(
-		&nat_table->table,
-		(void*) clnt_rule,
-		&new_entry_index,
-		&new_entry_handle,
-		cmd);
-
-	if (ret) {
-		IPAERR("Failed to add a new NAT entry\n");
-		goto unlock;
-	}
-
 	/* dst_only */
 	if (clnt_rule->dst_only) {
 		new_index_tbl_entry_index =
@@ -1773,6 +2069,42 @@ int ipa_NATI_add_ipv4_rule(
 				 clnt_rule->protocol,
 				 nat_table->table.table_entries - 1);
 	}
+
+	if ( may_defer && nati_batch.max_rules )
+	{
+		/*
+		 * Only head inserts into slots no queued op touches can wait
+		 * for the batch commit
+		 */
+		bool head_insert =
+			! nat_table->table.entry_interface->entry_is_valid(
+				GOTO_REC(&nat_table->table, new_entry_index)) &&
+			! nat_table->index_table.entry_interface->entry_is_valid(
+				GOTO_REC(&nat_table->index_table, new_index_tbl_entry_index)) &&
+			! ipa_nati_batch_touches(
+				nat_table, &nat_table->table, new_entry_index) &&
+			! ipa_nati_batch_touches(
+				nat_table, &nat_table->index_table, new_index_tbl_entry_index);
+
+		defer = ipa_nati_batch_admit(nat_cache_ptr, head_insert);
+	}
+	else if ( nati_batch.num_ops )
+	{
+		ipa_NATI_flush_batch();
+	}
+
+	ret = ipa_table_add_entry(
+		&nat_table->table,
+		(void*) clnt_rule,
+		&new_entry_index,
+		&new_entry_handle,
+		cmd);
+
+	if (ret) {
+		IPAERR("Failed to add a new NAT entry\n");
+		goto unlock;
+	}
+
 	ret = ipa_table_add_entry(
 		&nat_table->index_table,
 		(void*) &new_entry_index,
@@ -1809,7 +2141,25 @@ int ipa_NATI_add_ipv4_rule(
 		   new_entry_handle,
 		   prep_nat_rule_4print(rule, buf, sizeof(buf)));
 
-	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+	if ( defer )
+	{
+		ipa_table_iterator table_iterator;
+		ipa_table_iterator index_table_iterator;
+
+		memset(&table_iterator, 0, sizeof(table_iterator));
+		memset(&index_table_iterator, 0, sizeof(index_table_iterator));
+
+		table_iterator.curr_index       = new_entry_index;
+		index_table_iterator.curr_index = new_index_tbl_entry_index;
+
+		ret = ipa_nati_batch_queue(
+			nat_cache_ptr, nat_table, cmd, false,
+			&table_iterator, &index_table_iterator);
+	}
+	else
+	{
+		ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
+	}
 
 	if (ret) {
 		IPAERR("unable to post dma command\n");
@@ -1829,10 +2179,10 @@ int ipa_NATI_add_ipv4_rule(
 	goto done;
 
 bail:
-	ipa_table_erase_entry(&nat_table->index_table, new_index_tbl_entry_index);
+	ipa_table_undo_add_entry(&nat_table->index_table, new_index_tbl_entry_index);
 
 fail_add_index_entry:
-	ipa_table_erase_entry(&nat_table->table, new_entry_index);
+	ipa_table_undo_add_entry(&nat_table->table, new_entry_index);
 
 unlock:
 	if (pthread_mutex_unlock(&nat_mutex))
@@ -1843,9 +2193,58 @@ done:
 	return ret;
 }
 
-int ipa_NATI_del_ipv4_rule(
+int ipa_NATI_add_ipv4_rule(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl)
+{
+	return ipa_nati_add_ipv4_rule_common(tbl_hdl, clnt_rule, rule_hdl, false);
+}
+
+int ipa_NATI_add_ipv4_rule_deferred(
+	uint32_t                 tbl_hdl,
+	const ipa_nat_ipv4_rule* clnt_rule,
+	uint32_t*                rule_hdl)
+{
+	return ipa_nati_add_ipv4_rule_common(tbl_hdl, clnt_rule, rule_hdl, true);
+}
+
+static void ipa_nati_del_ipv4_rule_finish(
+	struct ipa_nat_ip4_table_cache* nat_table,
+	ipa_table_iterator*             table_iterator,
+	ipa_table_iterator*             index_table_iterator)
+{
+	IPADBG("In\n");
+
+	if (! ipa_table_iterator_is_head_with_tail(table_iterator)) {
+		/* The entry can be deleted */
+		uint8_t is_prev_empty =
+			(table_iterator->prev_entry != NULL &&
+			 ((struct ipa_nat_rule*)table_iterator->prev_entry)->protocol ==
+			 IPAHAL_NAT_INVALID_PROTOCOL &&
+			 ! ipa_nati_is_failed_add(nat_table, table_iterator->prev_index));
+
+		ipa_table_delete_entry(
+			&nat_table->table, table_iterator, is_prev_empty);
+	}
+
+	ipa_table_delete_entry(
+		&nat_table->index_table,
+		index_table_iterator,
+		FALSE);
+
+	if (index_table_iterator->curr_index >= nat_table->index_table.table_entries)
+		nat_table->index_expn_table_meta[
+			index_table_iterator->curr_index - nat_table->index_table.table_entries].
+			prev_index = IPA_TABLE_INVALID_ENTRY;
+
+	IPADBG("Out\n");
+}
+
+static int ipa_nati_del_ipv4_rule_common(
 	uint32_t tbl_hdl,
-	uint32_t rule_hdl )
+	uint32_t rule_hdl,
+	bool     may_defer)
 {
 	uint32_t cmd_sz =
 		sizeof(struct ipa_ioc_nat_dma_cmd) +
@@ -1864,6 +2263,8 @@ int ipa_NATI_del_ipv4_rule(
 	ipa_table_iterator index_table_iterator;
 
 	uint16_t index;
+	bool     defer = false;
+	bool     failed_add = false;
 	char     buf[1024];
 	int      ret = 0;
 
@@ -1910,10 +2311,34 @@ int ipa_NATI_del_ipv4_rule(
 		goto unlock;
 	}
 
+	/*
+	 * The add behind this handle never reached the IPA, so clean up
+	 * its parked slots right away and fail the delete
+	 */
+	failed_add = ipa_nati_is_failed_add(nat_table, index);
+
+	if ( failed_add )
+	{
+		IPAERR("rule_hdl(0x%08X) belongs to an add the IPA refused\n",
+			   rule_hdl);
+		may_defer = false;
+	}
+
+	/*
+	 * A rule whose add or neighbour's delete is still queued isn't
+	 * what the tables say yet
+	 */
+	if ( ! (may_defer && nati_batch.max_rules) ||
+		 ipa_nati_batch_touches(nat_table, &nat_table->table, index) )
+	{
+		ipa_NATI_flush_batch();
+	}
+
 	IPADBG("rule_hdl(0x%08X) -> %s\n",
 		   rule_hdl,
 		   prep_nat_rule_4print(table_rule, buf, sizeof(buf)));
 
+build_iterators:
 	ret = ipa_table_iterator_init(
 		&table_iterator,
 		&nat_table->table,
@@ -1953,6 +2378,30 @@ int ipa_NATI_del_ipv4_rule(
 		goto unlock;
 	}
 
+	if ( may_defer && nati_batch.max_rules )
+	{
+		bool independent =
+			! ipa_table_iterator_is_head_with_tail(&table_iterator) &&
+			! ipa_table_iterator_is_head_with_tail(&index_table_iterator) &&
+			ipa_nati_batch_iter_is_free(
+				nat_table, &nat_table->table, &table_iterator) &&
+			ipa_nati_batch_iter_is_free(
+				nat_table, &nat_table->index_table, &index_table_iterator);
+
+		if ( ! independent && nati_batch.num_ops )
+		{
+			/*
+			 * Neighbours change when the batch commits, so walk
+			 * the chains again afterwards
+			 */
+			ipa_NATI_flush_batch();
+			index = table_iterator.curr_index;
+			goto build_iterators;
+		}
+
+		defer = ipa_nati_batch_admit(nat_cache_ptr, independent);
+	}
+
 	ipa_table_create_delete_command(
 		&nat_table->index_table,
 		cmd,
@@ -1981,6 +2430,18 @@ int ipa_NATI_del_ipv4_rule(
 		cmd,
 		&table_iterator);
 
+	if ( defer )
+	{
+		/*
+		 * Software cleanup runs once the batch is committed
+		 */
+		ret = ipa_nati_batch_queue(
+			nat_cache_ptr, nat_table, cmd, true,
+			&table_iterator, &index_table_iterator);
+
+		goto unlock;
+	}
+
 	ret = ipa_nati_post_ipv4_dma_cmd(nat_cache_ptr, cmd);
 
 	if (ret) {
@@ -1988,26 +2449,18 @@ int ipa_NATI_del_ipv4_rule(
 		goto unlock;
 	}
 
-	if (! ipa_table_iterator_is_head_with_tail(&table_iterator)) {
-		/* The entry can be deleted */
-		uint8_t is_prev_empty =
-			(table_iterator.prev_entry != NULL &&
-			 ((struct ipa_nat_rule*)table_iterator.prev_entry)->protocol ==
-			 IPAHAL_NAT_INVALID_PROTOCOL);
+	ipa_nati_del_ipv4_rule_finish(
+		nat_table, &table_iterator, &index_table_iterator);
 
-		ipa_table_delete_entry(
-			&nat_table->table, &table_iterator, is_prev_empty);
-	}
+	if ( failed_add )
+	{
+		index = table_iterator.curr_index;
 
-	ipa_table_delete_entry(
-		&nat_table->index_table,
-		&index_table_iterator,
-		FALSE);
+		nat_table->failed_add_map[index / IPA_TABLE_MAP_WORD_BITS] &=
+			~(1U << (index % IPA_TABLE_MAP_WORD_BITS));
 
-	if (index_table_iterator.curr_index >= nat_table->index_table.table_entries)
-		nat_table->index_expn_table_meta[
-			index_table_iterator.curr_index - nat_table->index_table.table_entries].
-			prev_index = IPA_TABLE_INVALID_ENTRY;
+		ret = -EIO;
+	}
 
 unlock:
 	if (pthread_mutex_unlock(&nat_mutex)) {
@@ -2021,6 +2474,236 @@ done:
 	return ret;
 }
 
+int ipa_NATI_del_ipv4_rule(
+	uint32_t tbl_hdl,
+	uint32_t rule_hdl )
+{
+	return ipa_nati_del_ipv4_rule_common(tbl_hdl, rule_hdl, false);
+}
+
+int ipa_NATI_del_ipv4_rule_deferred(
+	uint32_t tbl_hdl,
+	uint32_t rule_hdl )
+{
+	return ipa_nati_del_ipv4_rule_common(tbl_hdl, rule_hdl, true);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * Batched rule commit
+ * ----------------------------------------------------------------------------
+ */
+int ipa_nati_set_batch_mode(
+	uint16_t max_rules,
+	uint32_t max_delay_ms)
+{
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if ( max_rules > IPA_NAT_BATCH_MAX_RULES ||
+		 (max_rules > 1 && max_delay_ms == 0) )
+	{
+		IPAERR("Bad arg: max_rules(%u) max_delay_ms(%u)\n",
+			   max_rules, max_delay_ms);
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	/*
+	 * Commit whatever is queued under the old settings
+	 */
+	ret = ipa_nati_flush_batch();
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	if ( max_rules > 1 && ! nati_batch.timer_created )
+	{
+		struct sigevent sev;
+
+		memset(&sev, 0, sizeof(sev));
+
+		sev.sigev_notify          = SIGEV_THREAD;
+		sev.sigev_notify_function = ipa_nati_batch_timer_cb;
+
+		if ( timer_create(CLOCK_MONOTONIC, &sev, &nati_batch.timer) )
+		{
+			IPAERR("Unable to create the batch timer: %s\n", strerror(errno));
+			ret = -EIO;
+			goto unlock;
+		}
+
+		nati_batch.timer_created = true;
+	}
+
+	nati_batch.max_rules    = (max_rules > 1) ? max_rules : 0;
+	nati_batch.max_delay_ms = max_delay_ms;
+	nati_batch.max_dma      = IPA_NAT_BATCH_MAX_DMA_ENTRIES;
+
+	IPADBG("Batch mode %s: max_rules(%u) max_delay_ms(%u)\n",
+		   (nati_batch.max_rules) ? "on" : "off",
+		   nati_batch.max_rules,
+		   nati_batch.max_delay_ms);
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
+bool ipa_NATI_batch_pending(void)
+{
+	return nati_batch.num_ops != 0;
+}
+
+int ipa_NATI_flush_batch(void)
+{
+	struct ipa_ioc_nat_dma_cmd* bcmd = &nati_batch.dma.cmd;
+	uint16_t num_ops, i;
+	int ret = 0;
+
+	IPADBG("In\n");
+
+	if (pthread_mutex_lock(&nat_mutex)) {
+		IPAERR("unable to lock the nat mutex\n");
+		ret = -EINVAL;
+		goto bail;
+	}
+
+	num_ops = nati_batch.num_ops;
+
+	if ( num_ops == 0 )
+	{
+		goto unlock;
+	}
+
+	ipa_nati_batch_disarm_timer();
+
+	IPADBG("Committing %u ops with %u DMA entries\n", num_ops, bcmd->entries);
+
+	ret = ipa_nati_post_ipv4_dma_cmd(nati_batch.nat_cache_ptr, bcmd);
+
+	if ( ret )
+	{
+		/*
+		 * The ops are independent of each other, so commit them one
+		 * at a time to find which one the kernel won't take
+		 */
+		uint32_t cmd_sz =
+			sizeof(struct ipa_ioc_nat_dma_cmd) +
+			(MAX_DMA_ENTRIES_FOR_ADD * sizeof(struct ipa_ioc_nat_dma_one));
+		char cmd_buf[cmd_sz];
+		struct ipa_ioc_nat_dma_cmd* cmd =
+			(struct ipa_ioc_nat_dma_cmd*) cmd_buf;
+		uint16_t failed = 0;
+
+		IPAERR("Batched commit of %u ops failed, retrying one at a time\n",
+			   num_ops);
+
+		for ( i = 0; i < num_ops; i++ )
+		{
+			nati_batch_op* op = &nati_batch.ops[i];
+
+			memset(cmd_buf, 0, sizeof(cmd_buf));
+
+			cmd->entries = op->num_dma;
+
+			memcpy(cmd->dma,
+				   &bcmd->dma[op->first_dma],
+				   op->num_dma * sizeof(struct ipa_ioc_nat_dma_one));
+
+			op->failed =
+				(ipa_nati_post_ipv4_dma_cmd(nati_batch.nat_cache_ptr, cmd) != 0);
+
+			failed += op->failed;
+		}
+
+		if ( failed == 0 )
+		{
+			/*
+			 * Each op went through on its own, so the kernel caps the
+			 * DMA entries per command below ours
+			 */
+			nati_batch.max_dma =
+				max(MAX_DMA_ENTRIES_FOR_ADD, nati_batch.max_dma / 2);
+
+			IPAERR("Lowering DMA entries per batch to %u\n",
+				   nati_batch.max_dma);
+		}
+
+		ret = (failed) ? -EIO : 0;
+	}
+
+	for ( i = 0; i < num_ops; i++ )
+	{
+		nati_batch_op* op = &nati_batch.ops[i];
+
+		if ( op->failed )
+		{
+			IPAERR("Unable to commit %s of entry %u in NAT table\n",
+				   (op->is_del) ? "delete" : "add",
+				   op->table_iterator.curr_index);
+
+			nati_batch.ops_failed++;
+
+			if ( ! op->is_del )
+			{
+				ipa_nati_park_failed_add(
+					op->nat_table,
+					op->table_iterator.curr_index,
+					op->index_table_iterator.curr_index);
+			}
+
+			continue;
+		}
+
+		if ( op->is_del )
+		{
+			ipa_nati_del_ipv4_rule_finish(
+				op->nat_table,
+				&op->table_iterator,
+				&op->index_table_iterator);
+		}
+	}
+
+	nati_batch.num_ops = 0;
+	bcmd->entries      = 0;
+
+	nati_batch.commits++;
+	nati_batch.ops_committed += num_ops;
+
+	IPADBG("commits(%u) ops_committed(%u) ops_failed(%u)\n",
+		   nati_batch.commits,
+		   nati_batch.ops_committed,
+		   nati_batch.ops_failed);
+
+unlock:
+	if (pthread_mutex_unlock(&nat_mutex)) {
+		IPAERR("unable to unlock the nat mutex\n");
+		ret = (ret) ? ret : -EPERM;
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 /*
  * ----------------------------------------------------------------------------
  * New function to get sram size.
@@ -2053,7 +2736,7 @@ int ipa_nati_get_sram_size(
 
 	memset(&nat_sram_info, 0, sizeof(nat_sram_info));
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd,
+	ret = IPA_DEV_IOCTL(nat_cache_ptr->ipa_desc->fd,
 				IPA_IOC_GET_NAT_IN_SRAM_INFO,
 				&nat_sram_info);
 
@@ -2260,6 +2943,8 @@ int ipa_NATI_clear_ipv4_tbl(
 	nat_table->index_table.cur_tbl_cnt =
 		nat_table->index_table.cur_expn_tbl_cnt = 0;
 
+	memset(nat_table->failed_add_map, 0, sizeof(nat_table->failed_add_map));
+
 unlock:
 	if (pthread_mutex_unlock(&nat_mutex)) {
 		IPAERR("unable to unlock the nat mutex\n");
@@ -2435,6 +3120,7 @@ static int gen_chain_stats(
 	uint16_t             rule_index;
 
 	uint32_t             chain_len = 0;
+	uint32_t             hist_len, probes;
 
 	BREAK_RULE_HDL(table_ptr, rule_hdl, nmi, is_expn_tbl, rule_index);
 
@@ -2478,6 +3164,20 @@ static int gen_chain_stats(
 		}
 	}
 
+	/*
+	 * Unlike the figures below, the histograms count lone heads
+	 * too. Every record in a chain costs the IPA one more read than
+	 * the one before it...
+	 */
+	hist_len = (chain_len) ? chain_len : 1;
+
+	IPA_TABLE_HIST_ADD(csh_ptr->stats_ptr->hash.chain_len, hist_len);
+
+	for ( probes = 1; probes <= hist_len; probes++ )
+	{
+		IPA_TABLE_HIST_ADD(csh_ptr->stats_ptr->hash.lookup_probes, probes);
+	}
+
 	if ( chain_len )
 	{
 		csh_ptr->stats_ptr->tot_chains += 1;
@@ -2578,6 +3278,10 @@ int ipa_NATI_ipv4_tbl_stats(
 	nat_stats_ptr->tot_base_ents_filled = ipa_tbl_ptr->cur_tbl_cnt;
 	nat_stats_ptr->tot_expn_ents_filled = ipa_tbl_ptr->cur_expn_tbl_cnt;
 
+	memcpy(nat_stats_ptr->hash.insert_probes,
+		   ipa_tbl_ptr->insert_probes,
+		   sizeof(nat_stats_ptr->hash.insert_probes));
+
 	memset(&csh, 0, sizeof(chain_stat_help));
 
 	csh.which     = USE_NAT_TABLE;
@@ -2614,6 +3318,10 @@ int ipa_NATI_ipv4_tbl_stats(
 	idx_stats_ptr->tot_base_ents_filled = ipa_tbl_ptr->cur_tbl_cnt;
 	idx_stats_ptr->tot_expn_ents_filled = ipa_tbl_ptr->cur_expn_tbl_cnt;
 
+	memcpy(idx_stats_ptr->hash.insert_probes,
+		   ipa_tbl_ptr->insert_probes,
+		   sizeof(idx_stats_ptr->hash.insert_probes));
+
 	memset(&csh, 0, sizeof(chain_stat_help));
 
 	csh.which     = USE_INDEX_TABLE;
@@ -2669,7 +3377,7 @@ int ipa_nati_vote_clock(
 		}
 	}
 
-	ret = ioctl(nat_cache_ptr->ipa_desc->fd,
+	ret = IPA_DEV_IOCTL(nat_cache_ptr->ipa_desc->fd,
 				IPA_IOC_APP_CLOCK_VOTE,
 				vote_type);
 
@@ -26,25 +26,122 @@
  * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-#include <map>
-#include <iterator>
+#include <stdlib.h>
+#include <string.h>
 
 #include "ipa_nat_utils.h"
 
 #include "ipa_nat_map.h"
 
-static std::map<uint32_t, uint32_t> map_array[MAP_NUM_MAX];
+/*
+ * Each map is an open addressing hash table with linear probing.
+ * Slots live in one flat array whose size is a power of two, and
+ * deletions shift later members of the probe run back into the hole
+ * (ie. no tombstones), so that probe runs stay short under churn.
+ *
+ * Storage is only (re)allocated by ipa_nat_map_reserve(), or by
+ * ipa_nat_map_add() when a map outgrows its reservation. Lookups and
+ * deletes never allocate, and ipa_nat_map_clear() keeps the storage
+ * for the next table.
+ */
+typedef struct
+{
+	uint32_t key;
+	uint32_t val;
+	uint32_t used;
+} ipa_nat_map_slot;
+
+typedef struct
+{
+	ipa_nat_map_slot* slots;
+	uint32_t          mask;  /* number of slots - 1 */
+	uint32_t          count;
+} ipa_nat_flat_map;
+
+#define MAP_MIN_SLOTS 64
+
+/*
+ * Keep the load factor at or below 1/2 when reserving, and grow
+ * when an add would take it over 3/4
+ */
+#define MAP_SLOTS_FOR(n) ((n) * 2)
+#define MAP_OVER_LOAD(m) ( ((m)->count + 1) * 4 > ((m)->mask + 1) * 3 )
+
+static ipa_nat_flat_map map_array[MAP_NUM_MAX];
+
+static inline uint32_t map_hash(
+	const ipa_nat_flat_map* map,
+	uint32_t                key )
+{
+	return (key * 0x9E3779B1U) & map->mask;
+}
+
+/*
+ * Returns the slot holding key, or the empty slot that ends its
+ * probe run when not present
+ */
+static inline uint32_t map_probe(
+	const ipa_nat_flat_map* map,
+	uint32_t                key )
+{
+	uint32_t i = map_hash(map, key);
+
+	while ( map->slots[i].used && map->slots[i].key != key )
+	{
+		i = (i + 1) & map->mask;
+	}
+
+	return i;
+}
+
+static int map_rehash(
+	ipa_nat_flat_map* map,
+	uint32_t          num_slots )
+{
+	ipa_nat_map_slot* old_slots = map->slots;
+	uint32_t          old_size  = (old_slots) ? map->mask + 1 : 0;
+	uint32_t          size      = MAP_MIN_SLOTS;
+	uint32_t          i, j;
+
+	while ( size < num_slots )
+	{
+		size <<= 1;
+	}
+
+	map->slots = (ipa_nat_map_slot*) calloc(size, sizeof(ipa_nat_map_slot));
+
+	if ( ! map->slots )
+	{
+		IPAERR("Unable to allocate %u map slots\n", size);
+		map->slots = old_slots;
+		return -1;
+	}
+
+	map->mask = size - 1;
+
+	for ( i = 0; i < old_size; i++ )
+	{
+		if ( old_slots[i].used )
+		{
+			j = map_probe(map, old_slots[i].key);
+			map->slots[j] = old_slots[i];
+		}
+	}
+
+	free(old_slots);
+
+	return 0;
+}
 
 /******************************************************************************/
 
-int ipa_nat_map_add(
+int ipa_nat_map_reserve(
 	ipa_which_map which,
-	uint32_t      key,
-	uint32_t      val )
+	uint32_t      num_entries )
 {
-	int ret_val = 0;
+	ipa_nat_flat_map* map;
 
-	std::pair<std::map<uint32_t, uint32_t>::iterator, bool> ret;
+	int ret_val = 0;
 
 	IPADBG("In\n");
 
@@ -55,23 +152,65 @@ int ipa_nat_map_add(
 		goto bail;
 	}
 
-	IPADBG("[%s] key(%u) -> val(%u)\n",
-		   ipa_which_map_as_str(which), key, val);
+	map = &map_array[which];
+
+	if ( ! map->slots || MAP_SLOTS_FOR(num_entries) > map->mask + 1 )
+	{
+		IPADBG("[%s] reserving for %u entries\n",
+			   ipa_which_map_as_str(which), num_entries);
+
+		ret_val = map_rehash(map, MAP_SLOTS_FOR(num_entries));
+	}
+
+bail:
+	IPADBG("Out\n");
+
+	return ret_val;
+}
+
+/******************************************************************************/
+
+int ipa_nat_map_add(
+	ipa_which_map which,
+	uint32_t      key,
+	uint32_t      val )
+{
+	ipa_nat_flat_map* map;
+	uint32_t          i;
+
+	if ( ! VALID_IPA_USE_MAP(which) )
+	{
+		IPAERR("Bad arg which(%u)\n", which);
+		return -1;
+	}
+
+	map = &map_array[which];
+
+	if ( ! map->slots || MAP_OVER_LOAD(map) )
+	{
+		if ( map_rehash(map, (map->slots) ? (map->mask + 1) * 2 : MAP_MIN_SLOTS) )
+		{
+			return -1;
+		}
+	}
 
-	ret = map_array[which].insert(std::pair<uint32_t, uint32_t>(key, val));
+	i = map_probe(map, key);
 
-	if ( ret.second == false )
+	if ( map->slots[i].used )
 	{
 		IPAERR("[%s] key(%u) already exists in map\n",
 			   ipa_which_map_as_str(which),
 			   key);
-		ret_val = -1;
+		return -1;
 	}
 
-bail:
-	IPADBG("Out\n");
+	map->slots[i].key  = key;
+	map->slots[i].val  = val;
+	map->slots[i].used = 1;
 
-	return ret_val;
+	map->count++;
+
+	return 0;
 }
 
 /******************************************************************************/
@@ -81,46 +220,31 @@ int ipa_nat_map_find(
 	uint32_t      key,
 	uint32_t*     val_ptr )
 {
-	int ret_val = 0;
-
-	std::map<uint32_t, uint32_t>::iterator it;
-
-	IPADBG("In\n");
+	ipa_nat_flat_map* map;
+	uint32_t          i;
 
 	if ( ! VALID_IPA_USE_MAP(which) )
 	{
 		IPAERR("Bad arg which(%u)\n", which);
-		ret_val = -1;
-		goto bail;
+		return -1;
 	}
 
-	IPADBG("[%s] key(%u)\n",
-		   ipa_which_map_as_str(which), key);
-
-	it = map_array[which].find(key);
+	map = &map_array[which];
 
-	if ( it == map_array[which].end() )
+	if ( ! map->slots || ! map->slots[i = map_probe(map, key)].used )
 	{
 		IPAERR("[%s] key(%u) not found in map\n",
 			   ipa_which_map_as_str(which),
 			   key);
-		ret_val = -1;
+		return -1;
 	}
-	else
+
+	if ( val_ptr )
 	{
-		if ( val_ptr )
-		{
-			*val_ptr = it->second;
-			IPADBG("[%s] key(%u) -> val(%u)\n",
-				   ipa_which_map_as_str(which),
-				   key, *val_ptr);
-		}
+		*val_ptr = map->slots[i].val;
 	}
 
-bail:
-	IPADBG("Out\n");
-
-	return ret_val;
+	return 0;
 }
 
 /******************************************************************************/
@@ -130,52 +254,57 @@ int ipa_nat_map_del(
 	uint32_t      key,
 	uint32_t*     val_ptr )
 {
-	int ret_val = 0;
-
-	std::map<uint32_t, uint32_t>::iterator it;
-
-	IPADBG("In\n");
+	ipa_nat_flat_map* map;
+	uint32_t          i, j, home;
 
 	if ( ! VALID_IPA_USE_MAP(which) )
 	{
 		IPAERR("Bad arg which(%u)\n", which);
-		ret_val = -1;
-		goto bail;
+		return -1;
 	}
 
-	IPADBG("[%s] key(%u)\n",
-		   ipa_which_map_as_str(which), key);
-
-	it = map_array[which].find(key);
+	map = &map_array[which];
 
-	if ( it == map_array[which].end() )
+	if ( ! map->slots || ! map->slots[i = map_probe(map, key)].used )
 	{
 		IPAERR("[%s] key(%u) not found in map\n",
 			   ipa_which_map_as_str(which),
 			   key);
-		ret_val = -1;
+		return -1;
+	}
+
+	if ( val_ptr )
+	{
+		*val_ptr = map->slots[i].val;
 	}
-	else
+
+	/*
+	 * Backward shift: pull each later member of the probe run into
+	 * the hole, unless its home slot lies cyclically in (i, j]
+	 */
+	for ( j = (i + 1) & map->mask; map->slots[j].used; j = (j + 1) & map->mask )
 	{
-		if ( val_ptr )
+		home = map_hash(map, map->slots[j].key);
+
+		if ( ((j - home) & map->mask) >= ((j - i) & map->mask) )
 		{
-			*val_ptr = it->second;
-			IPADBG("[%s] key(%u) -> val(%u)\n",
-				   ipa_which_map_as_str(which),
-				   key, *val_ptr);
+			map->slots[i] = map->slots[j];
+			i = j;
 		}
-		map_array[which].erase(it);
 	}
 
-bail:
-	IPADBG("Out\n");
+	map->slots[i].used = 0;
 
-	return ret_val;
+	map->count--;
+
+	return 0;
 }
 
 int ipa_nat_map_clear(
 	ipa_which_map which )
 {
+	ipa_nat_flat_map* map;
+
 	int ret_val = 0;
 
 	IPADBG("In\n");
@@ -187,7 +316,14 @@ int ipa_nat_map_clear(
 		goto bail;
 	}
 
-	map_array[which].clear();
+	map = &map_array[which];
+
+	if ( map->slots )
+	{
+		memset(map->slots, 0, (map->mask + 1) * sizeof(ipa_nat_map_slot));
+	}
+
+	map->count = 0;
 
 bail:
 	IPADBG("Out\n");
@@ -198,7 +334,8 @@ bail:
 int ipa_nat_map_dump(
 	ipa_which_map which )
 {
-	std::map<uint32_t, uint32_t>::iterator it;
+	ipa_nat_flat_map* map;
+	uint32_t          i;
 
 	int ret_val = 0;
 
@@ -211,17 +348,20 @@ int ipa_nat_map_dump(
 		goto bail;
 	}
 
-	printf("Dumping: %s\n", ipa_which_map_as_str(which));
+	map = &map_array[which];
 
-	for ( it  = map_array[which].begin();
-		  it != map_array[which].end();
-		  it++ )
+	printf("Dumping: %s (%u entries)\n", ipa_which_map_as_str(which), map->count);
+
+	for ( i = 0; map->slots && i <= map->mask; i++ )
 	{
-		printf("  Key[%u|0x%08X] -> Value[%u|0x%08X]\n",
-			   it->first,
-			   it->first,
-			   it->second,
-			   it->second);
+		if ( map->slots[i].used )
+		{
+			printf("  Key[%u|0x%08X] -> Value[%u|0x%08X]\n",
+				   map->slots[i].key,
+				   map->slots[i].key,
+				   map->slots[i].val,
+				   map->slots[i].val);
+		}
 	}
 
 bail:
@@ -0,0 +1,706 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ipa_nat_sim.h"
+#include "ipa_nat_drv.h"
+#include "ipa_nat_drvi.h"
+#include "ipa_ipv6cti.h"
+
+#include <sys/mman.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define SIM_FD_BASE  0x5100
+#define SIM_MAX_FDS  16
+
+#define SIM_ROUNDUP(x, a) ( (((x) + (a) - 1) / (a)) * (a) )
+
+typedef enum
+{
+	SIM_FD_FREE       = 0,
+	SIM_FD_IPA        = 1,
+	SIM_FD_NAT_TBL    = 2,
+	SIM_FD_IPV6CT_TBL = 3,
+} sim_fd_kind;
+
+/*
+ * One allocated table memory area and, once its init command has
+ * been seen, where each table type lives inside of it
+ */
+typedef struct
+{
+	uint8_t* mem;
+	size_t   mem_size;
+	bool     mapped;
+	bool     hw_init;
+	uint32_t tbl_off[IPA_IPV6CT_EXPN_TBL + 1];
+	uint32_t tbl_size[IPA_IPV6CT_EXPN_TBL + 1];
+} sim_mem_loc;
+
+static struct
+{
+	pthread_mutex_t      lock;
+	sim_fd_kind          fds[SIM_MAX_FDS];
+	bool                 sram_compatible;
+	uint32_t             sram_size;
+	sim_mem_loc          nat[IPA_NAT_MEM_IN_MAX];
+	enum ipa3_nat_mem_in nat_last_alloc;
+	sim_mem_loc          ipv6ct;
+	uint32_t             pdn_ip[IPA_MAX_PDN_NUM + 1];
+	int                  clk_votes;
+	uint32_t             fail_dma;
+	ipa_nat_sim_stats    stats;
+} sim = {
+	.lock           = PTHREAD_MUTEX_INITIALIZER,
+	.nat_last_alloc = IPA_NAT_MEM_IN_MAX,
+};
+
+static bool sim_sram_size_set = false;
+
+static uint32_t sim_get_sram_size(void)
+{
+	const char* env;
+
+	if ( ! sim_sram_size_set )
+	{
+		env = getenv(IPA_NAT_SIM_SRAM_SIZE_ENV);
+
+		sim.sram_size =
+			( env ) ? (uint32_t) strtoul(env, NULL, 0) :
+			IPA_NAT_SIM_DFLT_SRAM_SIZE;
+
+		sim_sram_size_set = true;
+	}
+
+	return sim.sram_size;
+}
+
+static sim_fd_kind sim_fd_to_kind(
+	int fd )
+{
+	if ( fd < SIM_FD_BASE || fd >= SIM_FD_BASE + SIM_MAX_FDS )
+	{
+		return SIM_FD_FREE;
+	}
+
+	return sim.fds[fd - SIM_FD_BASE];
+}
+
+static int sim_open(
+	const char* path,
+	int         flags )
+{
+	const char* name = strrchr(path, '/');
+	sim_fd_kind kind;
+	int         i, ret = -1;
+
+	name = ( name ) ? name + 1 : path;
+
+	if ( ! strcmp(path, IPA_DEV_NAME) )
+	{
+		kind = SIM_FD_IPA;
+	}
+	else if ( ! strcmp(name, IPA_NAT_DEV_NAME) )
+	{
+		kind = SIM_FD_NAT_TBL;
+	}
+	else if ( ! strcmp(name, IPA_IPV6CT_DEV_NAME) )
+	{
+		kind = SIM_FD_IPV6CT_TBL;
+	}
+	else
+	{
+		IPAERR("No simulated device at %s\n", path);
+		errno = ENOENT;
+		return -1;
+	}
+
+	pthread_mutex_lock(&sim.lock);
+
+	for ( i = 0; i < SIM_MAX_FDS; i++ )
+	{
+		if ( sim.fds[i] == SIM_FD_FREE )
+		{
+			sim.fds[i] = kind;
+			ret = SIM_FD_BASE + i;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&sim.lock);
+
+	if ( ret < 0 )
+	{
+		errno = EMFILE;
+	}
+
+	IPADBG("%s -> fd(%d)\n", path, ret);
+
+	return ret;
+}
+
+static int sim_close(
+	int fd )
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&sim.lock);
+
+	if ( sim_fd_to_kind(fd) == SIM_FD_FREE )
+	{
+		errno = EBADF;
+		ret = -1;
+	}
+	else
+	{
+		sim.fds[fd - SIM_FD_BASE] = SIM_FD_FREE;
+	}
+
+	pthread_mutex_unlock(&sim.lock);
+
+	return ret;
+}
+
+static int sim_alloc_loc(
+	sim_mem_loc* loc_ptr,
+	size_t       size )
+{
+	void* mem;
+
+	if ( loc_ptr->mem )
+	{
+		IPAERR("Memory already allocated\n");
+		return -EPERM;
+	}
+
+	size = SIM_ROUNDUP(size, (size_t) getpagesize());
+
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if ( mem == MAP_FAILED )
+	{
+		IPAERR("Unable to get %zu bytes of table memory\n", size);
+		return -ENOMEM;
+	}
+
+	memset(loc_ptr, 0, sizeof(*loc_ptr));
+
+	loc_ptr->mem      = mem;
+	loc_ptr->mem_size = size;
+
+	return 0;
+}
+
+static int sim_free_loc(
+	sim_mem_loc* loc_ptr )
+{
+	if ( ! loc_ptr->mem )
+	{
+		IPAERR("Table memory not allocated\n");
+		return -EPERM;
+	}
+
+	munmap(loc_ptr->mem, loc_ptr->mem_size);
+
+	memset(loc_ptr, 0, sizeof(*loc_ptr));
+
+	return 0;
+}
+
+static int sim_alloc_nat_table(
+	struct ipa_ioc_nat_ipv6ct_table_alloc* alloc_ptr )
+{
+	enum ipa3_nat_mem_in nmi;
+	size_t               size;
+	int                  ret;
+
+	if ( ! alloc_ptr->size )
+	{
+		return -EPERM;
+	}
+
+	/*
+	 * Like the driver: SRAM is used when the app has asked about it
+	 * and the table fits, otherwise DDR
+	 */
+	if ( sim.sram_compatible && alloc_ptr->size <= sim_get_sram_size() )
+	{
+		nmi  = IPA_NAT_MEM_IN_SRAM;
+		size = sim_get_sram_size();
+	}
+	else
+	{
+		nmi  = IPA_NAT_MEM_IN_DDR;
+		size = alloc_ptr->size;
+	}
+
+	ret = sim_alloc_loc(&sim.nat[nmi], size);
+
+	if ( ret == 0 )
+	{
+		sim.nat_last_alloc = nmi;
+		alloc_ptr->offset  = 0;
+
+		IPADBG("NAT table of size(%zu) allocated in %s\n",
+			   alloc_ptr->size, ipa3_nat_mem_in_as_str(nmi));
+	}
+
+	return ret;
+}
+
+static int sim_init_nat_table(
+	struct ipa_ioc_v4_nat_init* init_ptr )
+{
+	sim_mem_loc* loc_ptr;
+	uint32_t     ents, expn_ents;
+
+	if ( ! IPA_VALID_NAT_MEM_IN(init_ptr->mem_type) || init_ptr->tbl_index )
+	{
+		return -EPERM;
+	}
+
+	loc_ptr = &sim.nat[init_ptr->mem_type];
+
+	if ( ! loc_ptr->mem )
+	{
+		IPAERR("Init of %s NAT table before allocation\n",
+			   ipa3_nat_mem_in_as_str(init_ptr->mem_type));
+		return -EPERM;
+	}
+
+	/*
+	 * table_entries arrives as size - 1 (see ipa_nati_post_ipv4_init_cmd)
+	 */
+	ents      = init_ptr->table_entries + 1;
+	expn_ents = init_ptr->expn_table_entries;
+
+	loc_ptr->tbl_off[IPA_NAT_BASE_TBL]        = init_ptr->ipv4_rules_offset;
+	loc_ptr->tbl_off[IPA_NAT_EXPN_TBL]        = init_ptr->expn_rules_offset;
+	loc_ptr->tbl_off[IPA_NAT_INDX_TBL]        = init_ptr->index_offset;
+	loc_ptr->tbl_off[IPA_NAT_INDEX_EXPN_TBL]  = init_ptr->index_expn_offset;
+
+	loc_ptr->tbl_size[IPA_NAT_BASE_TBL]       = ents * sizeof(struct ipa_nat_rule);
+	loc_ptr->tbl_size[IPA_NAT_EXPN_TBL]       = expn_ents * sizeof(struct ipa_nat_rule);
+	loc_ptr->tbl_size[IPA_NAT_INDX_TBL]       = ents * sizeof(struct ipa_nat_indx_tbl_rule);
+	loc_ptr->tbl_size[IPA_NAT_INDEX_EXPN_TBL] = expn_ents * sizeof(struct ipa_nat_indx_tbl_rule);
+
+	if ( loc_ptr->tbl_off[IPA_NAT_INDEX_EXPN_TBL] +
+		 loc_ptr->tbl_size[IPA_NAT_INDEX_EXPN_TBL] > loc_ptr->mem_size )
+	{
+		IPAERR("NAT table geometry exceeds its memory (%zu)\n",
+			   loc_ptr->mem_size);
+		return -EPERM;
+	}
+
+	loc_ptr->hw_init = true;
+
+	return 0;
+}
+
+static int sim_init_ipv6ct_table(
+	struct ipa_ioc_ipv6ct_init* init_ptr )
+{
+	sim_mem_loc* loc_ptr = &sim.ipv6ct;
+	uint32_t     ents, expn_ents;
+
+	if ( ! loc_ptr->mem || init_ptr->tbl_index )
+	{
+		return -EPERM;
+	}
+
+	ents      = init_ptr->table_entries + 1;
+	expn_ents = init_ptr->expn_table_entries;
+
+	loc_ptr->tbl_off[IPA_IPV6CT_BASE_TBL]  = init_ptr->base_table_offset;
+	loc_ptr->tbl_off[IPA_IPV6CT_EXPN_TBL]  = init_ptr->expn_table_offset;
+
+	loc_ptr->tbl_size[IPA_IPV6CT_BASE_TBL] = ents * sizeof(ipa_ipv6ct_hw_entry);
+	loc_ptr->tbl_size[IPA_IPV6CT_EXPN_TBL] = expn_ents * sizeof(ipa_ipv6ct_hw_entry);
+
+	if ( loc_ptr->tbl_off[IPA_IPV6CT_EXPN_TBL] +
+		 loc_ptr->tbl_size[IPA_IPV6CT_EXPN_TBL] > loc_ptr->mem_size )
+	{
+		IPAERR("IPv6CT table geometry exceeds its memory (%zu)\n",
+			   loc_ptr->mem_size);
+		return -EPERM;
+	}
+
+	loc_ptr->hw_init = true;
+
+	return 0;
+}
+
+/*
+ * Validate every entry first and only then apply them, so that a bad
+ * command leaves the tables untouched, as with the real driver
+ */
+static int sim_table_dma(
+	struct ipa_ioc_nat_dma_cmd* cmd_ptr )
+{
+	struct ipa_ioc_nat_dma_one* one_ptr;
+	sim_mem_loc*                loc_ptr;
+	enum ipa3_nat_mem_in        nmi;
+	uint8_t*                    addr[IPA_NAT_SIM_MAX_DMA_ENTRIES];
+	uint32_t                    i;
+
+	nmi = ( sim.sram_compatible ) ? cmd_ptr->mem_type : IPA_NAT_MEM_IN_DDR;
+
+	if ( ! IPA_VALID_NAT_MEM_IN(nmi) )
+	{
+		return -EPERM;
+	}
+
+	if ( ! cmd_ptr->entries || cmd_ptr->entries > IPA_NAT_SIM_MAX_DMA_ENTRIES )
+	{
+		IPAERR("Invalid number of entries %u\n", cmd_ptr->entries);
+		return -EPERM;
+	}
+
+	if ( sim.fail_dma )
+	{
+		sim.fail_dma--;
+		IPAERR("Refusing DMA command with %u entries\n", cmd_ptr->entries);
+		return -EIO;
+	}
+
+	for ( i = 0; i < cmd_ptr->entries; i++ )
+	{
+		one_ptr = &cmd_ptr->dma[i];
+
+		if ( one_ptr->table_index >= 1 || ! VALID_IPA_TABLE_DMA_TYPE(one_ptr->base_addr) )
+		{
+			IPAERR("Bad table_index(%u) or base_addr(%u) in entry %u\n",
+				   one_ptr->table_index, one_ptr->base_addr, i);
+			return -EPERM;
+		}
+
+		loc_ptr =
+			( one_ptr->base_addr >= IPA_IPV6CT_BASE_TBL ) ?
+			&sim.ipv6ct                                  :
+			&sim.nat[nmi];
+
+		if ( ! loc_ptr->hw_init )
+		{
+			IPAERR("Table DMA before table init in entry %u\n", i);
+			return -EPERM;
+		}
+
+		if ( one_ptr->offset + sizeof(uint16_t) >
+			 loc_ptr->tbl_size[one_ptr->base_addr] )
+		{
+			IPAERR("Invalid offset(%u) for base_addr(%u) in entry %u\n",
+				   one_ptr->offset, one_ptr->base_addr, i);
+			return -EPERM;
+		}
+
+		addr[i] =
+			loc_ptr->mem +
+			loc_ptr->tbl_off[one_ptr->base_addr] +
+			one_ptr->offset;
+	}
+
+	for ( i = 0; i < cmd_ptr->entries; i++ )
+	{
+		memcpy(addr[i], &cmd_ptr->dma[i].data, sizeof(uint16_t));
+	}
+
+	sim.stats.dma_cmds++;
+	sim.stats.dma_entries += cmd_ptr->entries;
+
+	if ( cmd_ptr->entries > sim.stats.max_dma_entries )
+	{
+		sim.stats.max_dma_entries = cmd_ptr->entries;
+	}
+
+	return 0;
+}
+
+static int sim_ioctl_locked(
+	sim_fd_kind   kind,
+	unsigned long req,
+	unsigned long arg )
+{
+	struct ipa_nat_in_sram_info*          sram_ptr;
+	struct ipa_ioc_nat_ipv6ct_table_del*  del_ptr;
+	struct ipa_ioc_nat_pdn_entry*         pdn_ptr;
+
+	if ( kind != SIM_FD_IPA )
+	{
+		return -ENOTTY;
+	}
+
+	switch ( req )
+	{
+	case IPA_IOC_GET_HW_VERSION:
+		*((enum ipa_hw_type*) arg) = IPA_HW_v4_5;
+		return 0;
+
+	case IPA_IOC_GET_NAT_IN_SRAM_INFO:
+		sram_ptr = (struct ipa_nat_in_sram_info*) arg;
+		memset(sram_ptr, 0, sizeof(*sram_ptr));
+		sram_ptr->sram_mem_available_for_nat = sim_get_sram_size();
+		sram_ptr->nat_table_offset_into_mmap = 0;
+		sram_ptr->best_nat_in_sram_size_rqst =
+			SIM_ROUNDUP(sim_get_sram_size(), (uint32_t) getpagesize());
+		sim.sram_compatible = true;
+		return 0;
+
+	case IPA_IOC_ALLOC_NAT_TABLE:
+		return sim_alloc_nat_table(
+			(struct ipa_ioc_nat_ipv6ct_table_alloc*) arg);
+
+	case IPA_IOC_ALLOC_IPV6CT_TABLE:
+		if ( ! ((struct ipa_ioc_nat_ipv6ct_table_alloc*) arg)->size )
+		{
+			return -EPERM;
+		}
+		((struct ipa_ioc_nat_ipv6ct_table_alloc*) arg)->offset = 0;
+		return sim_alloc_loc(
+			&sim.ipv6ct,
+			((struct ipa_ioc_nat_ipv6ct_table_alloc*) arg)->size);
+
+	case IPA_IOC_V4_INIT_NAT:
+		return sim_init_nat_table((struct ipa_ioc_v4_nat_init*) arg);
+
+	case IPA_IOC_INIT_IPV6CT_TABLE:
+		return sim_init_ipv6ct_table((struct ipa_ioc_ipv6ct_init*) arg);
+
+	case IPA_IOC_DEL_NAT_TABLE:
+		del_ptr = (struct ipa_ioc_nat_ipv6ct_table_del*) arg;
+		if ( del_ptr->table_index || ! IPA_VALID_NAT_MEM_IN(del_ptr->mem_type) )
+		{
+			return -EPERM;
+		}
+		return sim_free_loc(&sim.nat[del_ptr->mem_type]);
+
+	case IPA_IOC_DEL_IPV6CT_TABLE:
+		del_ptr = (struct ipa_ioc_nat_ipv6ct_table_del*) arg;
+		if ( del_ptr->table_index )
+		{
+			return -EPERM;
+		}
+		return sim_free_loc(&sim.ipv6ct);
+
+	case IPA_IOC_TABLE_DMA_CMD:
+		return sim_table_dma((struct ipa_ioc_nat_dma_cmd*) arg);
+
+	case IPA_IOC_NAT_MODIFY_PDN:
+		pdn_ptr = (struct ipa_ioc_nat_pdn_entry*) arg;
+		if ( pdn_ptr->pdn_index > IPA_MAX_PDN_NUM )
+		{
+			return -EPERM;
+		}
+		sim.pdn_ip[pdn_ptr->pdn_index] = pdn_ptr->public_ip;
+		return 0;
+
+	case IPA_IOC_APP_CLOCK_VOTE:
+		switch ( (enum ipa_app_clock_vote_type) arg )
+		{
+		case IPA_APP_CLK_VOTE:
+			sim.clk_votes++;
+			return 0;
+		case IPA_APP_CLK_DEVOTE:
+			if ( ! sim.clk_votes )
+			{
+				IPAERR("Clock devote without a vote\n");
+				return -EPERM;
+			}
+			sim.clk_votes--;
+			return 0;
+		case IPA_APP_CLK_RESET_VOTE:
+			sim.clk_votes = 0;
+			return 0;
+		default:
+			return -EINVAL;
+		}
+
+	case IPA_IOC_ADD_UC_ACT_ENTRY:
+	case IPA_IOC_DEL_UC_ACT_ENTRY:
+		return 0;
+
+#ifdef IPA_ON_R3PC
+	case IPA_IOC_GET_NAT_OFFSET:
+		*((uint32_t*) arg) = 0;
+		return 0;
+#endif
+
+	default:
+		break;
+	}
+
+	IPAERR("Unsupported ioctl(0x%lx)\n", req);
+
+	return -ENOTTY;
+}
+
+static int sim_ioctl(
+	int           fd,
+	unsigned long req,
+	unsigned long arg )
+{
+	int ret;
+
+	pthread_mutex_lock(&sim.lock);
+
+	sim.stats.ioctls++;
+
+	ret = sim_ioctl_locked(sim_fd_to_kind(fd), req, arg);
+
+	if ( ret )
+	{
+		sim.stats.ioctl_errs++;
+	}
+
+	pthread_mutex_unlock(&sim.lock);
+
+	/*
+	 * Like ioctl(2)
+	 */
+	if ( ret )
+	{
+		errno = -ret;
+		ret   = -1;
+	}
+
+	return ret;
+}
+
+static void* sim_mmap(
+	void*  addr,
+	size_t len,
+	int    prot,
+	int    flags,
+	int    fd,
+	off_t  off )
+{
+	sim_mem_loc* loc_ptr = NULL;
+	void*        ret     = MAP_FAILED;
+
+	pthread_mutex_lock(&sim.lock);
+
+	switch ( sim_fd_to_kind(fd) )
+	{
+	case SIM_FD_NAT_TBL:
+		if ( IPA_VALID_NAT_MEM_IN(sim.nat_last_alloc) )
+		{
+			loc_ptr = &sim.nat[sim.nat_last_alloc];
+		}
+		break;
+	case SIM_FD_IPV6CT_TBL:
+		loc_ptr = &sim.ipv6ct;
+		break;
+	default:
+		break;
+	}
+
+	if ( loc_ptr && loc_ptr->mem && ! loc_ptr->mapped && len <= loc_ptr->mem_size )
+	{
+		loc_ptr->mapped = true;
+		ret = loc_ptr->mem;
+	}
+	else
+	{
+		IPAERR("Can't map fd(%d) len(%zu)\n", fd, len);
+		errno = EINVAL;
+	}
+
+	pthread_mutex_unlock(&sim.lock);
+
+	return ret;
+}
+
+static int sim_munmap(
+	void*  addr,
+	size_t len )
+{
+	uint32_t i;
+	int      ret = -1;
+
+	pthread_mutex_lock(&sim.lock);
+
+	for ( i = 0; i < IPA_NAT_MEM_IN_MAX; i++ )
+	{
+		if ( sim.nat[i].mem == addr && sim.nat[i].mapped )
+		{
+			sim.nat[i].mapped = false;
+			ret = 0;
+		}
+	}
+
+	if ( sim.ipv6ct.mem == addr && sim.ipv6ct.mapped )
+	{
+		sim.ipv6ct.mapped = false;
+		ret = 0;
+	}
+
+	pthread_mutex_unlock(&sim.lock);
+
+	if ( ret )
+	{
+		errno = EINVAL;
+	}
+
+	return ret;
+}
+
+const ipa_dev_ops ipa_nat_sim_dev_ops = {
+	.name   = "simulated",
+	.open   = sim_open,
+	.close  = sim_close,
+	.ioctl  = sim_ioctl,
+	.mmap   = sim_mmap,
+	.munmap = sim_munmap,
+};
+
+void ipa_nat_sim_get_stats(
+	ipa_nat_sim_stats* stats_ptr)
+{
+	if ( stats_ptr )
+	{
+		pthread_mutex_lock(&sim.lock);
+		*stats_ptr = sim.stats;
+		pthread_mutex_unlock(&sim.lock);
+	}
+}
+
+void ipa_nat_sim_clear_stats(void)
+{
+	pthread_mutex_lock(&sim.lock);
+	memset(&sim.stats, 0, sizeof(sim.stats));
+	pthread_mutex_unlock(&sim.lock);
+}
+
+void ipa_nat_sim_fail_dma(
+	uint32_t num_cmds)
+{
+	pthread_mutex_lock(&sim.lock);
+	sim.fail_dma = num_cmds;
+	pthread_mutex_unlock(&sim.lock);
+}
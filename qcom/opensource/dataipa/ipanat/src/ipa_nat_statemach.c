@@ -461,6 +461,19 @@ int ipa_nati_query_timestamp(
 	return ret;
 }
 
+int ipa_nati_flush_batch(void)
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_nati_statemach(&nati_obj, NATI_TRIG_FLUSH_BATCH, 0);
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 int ipa_nat_switch_to(
 	enum ipa3_nat_mem_in nmi,
 	bool                 hold_state )
@@ -596,7 +609,13 @@ int ipa_nat_switch_to(
 	ret = 0;
 
 unlock:
-	ret = give_mutex();
+	/*
+	 * Don't let a successful unlock hide an earlier failure
+	 */
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EINVAL;
+	}
 
 bail:
 	IPADBG("Out\n");
@@ -954,6 +973,8 @@ static int _smAddDdrTbl(
 	uint16_t  number_of_entries = (uint16_t)  args[1];
 	uint32_t* tbl_hdl_ptr       = (uint32_t*) args[2];
 
+	uint32_t  tbl_hdl;
+
 	int ret;
 
 	IPADBG("In\n");
@@ -961,14 +982,20 @@ static int _smAddDdrTbl(
 	IPADBG("public_ip_addr(0x%08X) number_of_entries(%u) tbl_hdl_ptr(%p)\n",
 		   public_ip_addr, number_of_entries, tbl_hdl_ptr);
 
+	/*
+	 * Only record the handle on success, so that a refused add
+	 * doesn't orphan a table that already exists...
+	 */
 	ret = ipa_NATI_add_ipv4_tbl(
 		IPA_NAT_MEM_IN_DDR,
 		public_ip_addr,
 		number_of_entries,
-		&nati_obj_ptr->ddr_tbl_hdl);
+		&tbl_hdl);
 
 	if ( ret == 0 )
 	{
+		nati_obj_ptr->ddr_tbl_hdl = tbl_hdl;
+
 		*tbl_hdl_ptr = nati_obj_ptr->ddr_tbl_hdl;
 
 		IPADBG("DDR table creation successful: tbl_hdl(0x%08X)\n",
@@ -1013,6 +1040,8 @@ static int _smAddSramTbl(
 
 	uint32_t  sram_size = 0;
 
+	uint32_t  tbl_hdl;
+
 	int ret;
 
 	IPADBG("In\n");
@@ -1053,7 +1082,7 @@ static int _smAddSramTbl(
 				IPA_NAT_MEM_IN_SRAM,
 				public_ip_addr,
 				nati_obj_ptr->tot_slots_in_sram,
-				&nati_obj_ptr->sram_tbl_hdl);
+				&tbl_hdl);
 
 			if ( ipa_nat_vote_clock(IPA_APP_CLK_DEVOTE) != 0 )
 			{
@@ -1062,6 +1091,8 @@ static int _smAddSramTbl(
 
 			if ( ret == 0 )
 			{
+				nati_obj_ptr->sram_tbl_hdl = tbl_hdl;
+
 				*tbl_hdl_ptr = nati_obj_ptr->sram_tbl_hdl;
 
 				IPADBG("SRAM table creation successful: tbl_hdl(0x%08X)\n",
@@ -1114,18 +1145,22 @@ static int _smAddSramAndDdrTbl(
 
 	IPADBG("In\n");
 
-	nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
-	nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
-
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].orig2new_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].new2orig_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].orig2new_map);
-	ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].new2orig_map);
-
 	ret = _smAddSramTbl(nati_obj_ptr, trigger, arb_data_ptr);
 
 	if ( ret == 0 )
 	{
+		/*
+		 * Only reset the bookkeeping once we know we own a new
+		 * table; a refused add must leave the live one intact...
+		 */
+		nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
+		nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
+
+		ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].orig2new_map);
+		ipa_nat_map_clear(nati_obj_ptr->map_pairs[SRAM_SUB].new2orig_map);
+		ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].orig2new_map);
+		ipa_nat_map_clear(nati_obj_ptr->map_pairs[DDR_SUB].new2orig_map);
+
 		if ( nati_obj_ptr->tot_slots_in_sram >= number_of_entries )
 		{
 			/*
@@ -1147,6 +1182,23 @@ static int _smAddSramAndDdrTbl(
 				(arb_t*) &tbl_hdl,  /* to protect app's table handle above */
 			};
 
+			/*
+			 * Size the handle maps up front, so that rule adds and
+			 * migrations do not need to grow them...
+			 */
+			ipa_nat_map_reserve(
+				nati_obj_ptr->map_pairs[SRAM_SUB].orig2new_map,
+				nati_obj_ptr->tot_slots_in_sram);
+			ipa_nat_map_reserve(
+				nati_obj_ptr->map_pairs[SRAM_SUB].new2orig_map,
+				nati_obj_ptr->tot_slots_in_sram);
+			ipa_nat_map_reserve(
+				nati_obj_ptr->map_pairs[DDR_SUB].orig2new_map,
+				number_of_entries);
+			ipa_nat_map_reserve(
+				nati_obj_ptr->map_pairs[DDR_SUB].new2orig_map,
+				number_of_entries);
+
 			ret = _smAddDdrTbl(nati_obj_ptr, trigger, new_args);
 
 			if ( ret == 0 )
@@ -1169,6 +1221,9 @@ static int _smAddSramAndDdrTbl(
 
 		if ( ret == 0 )
 		{
+			nati_obj_ptr->tot_rules_in_table[SRAM_SUB] = 0;
+			nati_obj_ptr->tot_rules_in_table[DDR_SUB]  = 0;
+
 			SET_NATIOBJ_STATE(nati_obj_ptr, NATI_STATE_DDR_ONLY);
 		}
 	}
@@ -1586,7 +1641,7 @@ static int _smAddRuleToTbl(
 
 	clnt_rule->redirect = clnt_rule->enable = clnt_rule->time_stamp = 0;
 
-	ret = ipa_NATI_add_ipv4_rule(tbl_hdl, clnt_rule, rule_hdl);
+	ret = ipa_NATI_add_ipv4_rule_deferred(tbl_hdl, clnt_rule, rule_hdl);
 
 	if ( ret == 0 )
 	{
@@ -1640,7 +1695,7 @@ static int _smDelRuleFromTbl(
 
 	IPADBG("tbl_hdl(0x%08X) rule_hdl(%u)\n", tbl_hdl, rule_hdl);
 
-	ret = ipa_NATI_del_ipv4_rule(tbl_hdl, rule_hdl);
+	ret = ipa_NATI_del_ipv4_rule_deferred(tbl_hdl, rule_hdl);
 
 	if ( ret == 0 )
 	{
@@ -2083,6 +2138,15 @@ static int _smSwitchFromDdrToSram(
 		else
 		{
 			sw_stats_ptr->fail += 1;
+
+			/*
+			 * DDR still holds every rule, SRAM only some, so go back
+			 * to DDR rather than lose the rest...
+			 */
+			if ( ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_DDR, 0) )
+			{
+				IPAERR("Unable to go back to DDR after failed switch\n");
+			}
 		}
 
 		IPADBG("Transistion pass/fail counts (DDR to SRAM) PASS: %u FAIL: %u\n",
@@ -2253,6 +2317,15 @@ static int _smSwitchFromSramToDdr(
 		else
 		{
 			sw_stats_ptr->fail += 1;
+
+			/*
+			 * SRAM still holds every rule, DDR only some, so go back
+			 * to SRAM rather than lose the rest...
+			 */
+			if ( ipa_nati_statemach(nati_obj_ptr, NATI_TRIG_GOTO_SRAM, 0) )
+			{
+				IPAERR("Unable to go back to SRAM after failed switch\n");
+			}
 		}
 
 		IPADBG("Transistion pass/fail counts (SRAM to DDR) PASS: %u FAIL: %u\n",
@@ -2447,6 +2520,42 @@ static int _smGetTmStmpHybrid(
 	return ret;
 }
 
+/******************************************************************************/
+/*
+ * FUNCTION: _smFlushBatch
+ *
+ * PARAMS:
+ *
+ *   nati_obj_ptr (IN) A pointer to an initialized nati object
+ *
+ *   trigger      (IN) The trigger to run through the state machine
+ *
+ *   arb_data_ptr (IN) Whatever you like
+ *
+ * DESCRIPTION:
+ *
+ *   Commit any rule adds and deletes queued in batch mode.
+ *
+ * RETURNS:
+ *
+ *   zero on success, otherwise non-zero
+ */
+static int _smFlushBatch(
+	ipa_nati_obj*    nati_obj_ptr,
+	ipa_nati_trigger trigger,
+	arb_t*           arb_data_ptr )
+{
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_NATI_flush_batch();
+
+	IPADBG("Out\n");
+
+	return ret;
+}
+
 /******************************************************************************/
 /*
  * The following table relates a nati object's state and a transition
@@ -2468,6 +2577,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_GET_TSTAMP, _smUndef ),
+		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_FLUSH_BATCH, _smFlushBatch ),
 		SM_ROW( NATI_STATE_NULL,       NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2484,6 +2594,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_GET_TSTAMP, _smGetTmStmp ),
+		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_FLUSH_BATCH, _smFlushBatch ),
 		SM_ROW( NATI_STATE_DDR_ONLY,   NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2500,6 +2611,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_GET_TSTAMP, _smGetTmStmp ),
+		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_FLUSH_BATCH, _smFlushBatch ),
 		SM_ROW( NATI_STATE_SRAM_ONLY,  NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2516,6 +2628,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GOTO_DDR,   _smGoToDdr ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GOTO_SRAM,  _smGoToSram ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_FLUSH_BATCH, _smFlushBatch ),
 		SM_ROW( NATI_STATE_HYBRID,     NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2532,6 +2645,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GOTO_DDR,   _smGoToDdr ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GOTO_SRAM,  _smGoToSram ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_GET_TSTAMP, _smGetTmStmpHybrid ),
+		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_FLUSH_BATCH, _smFlushBatch ),
 		SM_ROW( NATI_STATE_HYBRID_DDR, NATI_TRIG_LAST,       _smUndef ),
 	},
 
@@ -2548,6 +2662,7 @@ _state_mach_tbl[NATI_STATE_LAST+1][NATI_TRIG_LAST+1] =
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GOTO_DDR,   _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GOTO_SRAM,  _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_GET_TSTAMP, _smUndef ),
+		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_FLUSH_BATCH, _smUndef ),
 		SM_ROW( NATI_STATE_LAST,       NATI_TRIG_LAST,       _smUndef ),
 	},
 };
@@ -2617,7 +2732,8 @@ int ipa_nati_statemach(
 	const char* ts_ptr  = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].trigger_as_str;
 	const char* cbs_ptr = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].sm_cb_as_str;
 
-	bool vote = false;
+	bool vote  = false;
+	bool flush = false;
 
 	int ret;
 
@@ -2632,7 +2748,17 @@ int ipa_nati_statemach(
 
 	IPADBG("STATE(%s) TRIGGER(%s) CB(%s)\n", ss_ptr, ts_ptr, cbs_ptr);
 
-	vote = VOTE_REQUIRED(trigger);
+	/*
+	 * Rule adds and deletes may be queued in batch mode. Anything
+	 * else looks at or rearranges the tables, so commit them first.
+	 */
+	flush = ipa_NATI_batch_pending() &&
+		trigger != NATI_TRIG_ADD_RULE &&
+		trigger != NATI_TRIG_DEL_RULE &&
+		trigger != NATI_TRIG_GET_TSTAMP &&
+		trigger != NATI_TRIG_FLUSH_BATCH;
+
+	vote = VOTE_REQUIRED(trigger) || (flush && SRAM_CURRENTLY_ACTIVE());
 
 	if ( vote )
 	{
@@ -2647,6 +2773,11 @@ int ipa_nati_statemach(
 		}
 	}
 
+	if ( flush )
+	{
+		ipa_NATI_flush_batch();
+	}
+
 	ret = _state_mach_tbl[nati_obj_ptr->curr_state][trigger].sm_cb(
 		nati_obj_ptr, trigger, arb_data_ptr);
 
@@ -2662,7 +2793,13 @@ int ipa_nati_statemach(
 	}
 
 unlock:
-	ret = give_mutex();
+	/*
+	 * Don't let a successful unlock hide an earlier failure
+	 */
+	if ( give_mutex() != 0 && ret == 0 )
+	{
+		ret = -EINVAL;
+	}
 
 bail:
 	IPADBG("Out\n");
@@ -28,6 +28,7 @@
  */
 #include "ipa_nat_utils.h"
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -54,6 +55,66 @@ size_t strlcpy(char* dst, const char* src, size_t size)
 }
 #endif
 
+static int real_dev_open(
+	const char* path,
+	int         flags )
+{
+	return open(path, flags);
+}
+
+static int real_dev_ioctl(
+	int           fd,
+	unsigned long req,
+	unsigned long arg )
+{
+	return ioctl(fd, req, arg);
+}
+
+static const ipa_dev_ops real_dev_ops = {
+	.name   = "real",
+	.open   = real_dev_open,
+	.close  = close,
+	.ioctl  = real_dev_ioctl,
+	.mmap   = mmap,
+	.munmap = munmap,
+};
+
+static const ipa_dev_ops* dev_ops_ptr = NULL;
+
+/*
+ * Number of ipa_descriptors currently open through dev_ops_ptr
+ */
+static int num_open_desc = 0;
+
+const ipa_dev_ops* ipa_dev_ops_get(void)
+{
+	if ( ! dev_ops_ptr )
+	{
+		dev_ops_ptr = &real_dev_ops;
+
+		IPADBG("Using %s IPA device\n", dev_ops_ptr->name);
+	}
+
+	return dev_ops_ptr;
+}
+
+int ipa_dev_ops_set(
+	const ipa_dev_ops* ops_ptr)
+{
+	if ( __atomic_load_n(&num_open_desc, __ATOMIC_SEQ_CST) )
+	{
+		IPAERR("Can't switch IPA device with %d descriptor(s) open\n",
+			   num_open_desc);
+		return -EBUSY;
+	}
+
+	dev_ops_ptr = ( ops_ptr ) ? ops_ptr : &real_dev_ops;
+
+	IPADBG("Using %s IPA device\n", dev_ops_ptr->name);
+
+	return 0;
+}
+
 ipa_descriptor* ipa_descriptor_open(void)
 {
 	ipa_descriptor* desc_ptr;
@@ -69,7 +130,7 @@ ipa_descriptor* ipa_descriptor_open(void)
 		goto bail;
 	}
 
-	desc_ptr->fd = open(IPA_DEV_NAME, O_RDONLY);
+	desc_ptr->fd = IPA_DEV_OPEN(IPA_DEV_NAME, O_RDONLY);
 
 	if (desc_ptr->fd < 0)
 	{
@@ -77,7 +138,9 @@ ipa_descriptor* ipa_descriptor_open(void)
 		goto free;
 	}
 
-	res = ioctl(desc_ptr->fd, IPA_IOC_GET_HW_VERSION, &desc_ptr->ver);
+	__atomic_add_fetch(&num_open_desc, 1, __ATOMIC_SEQ_CST);
+
+	res = IPA_DEV_IOCTL(desc_ptr->fd, IPA_IOC_GET_HW_VERSION, &desc_ptr->ver);
 
 	if (res == 0)
 	{
@@ -110,7 +173,9 @@ void ipa_descriptor_close(
 	{
 		if ( desc_ptr->fd >= 0)
 		{
-			close(desc_ptr->fd);
+			IPA_DEV_CLOSE(desc_ptr->fd);
+
+			__atomic_sub_fetch(&num_open_desc, 1, __ATOMIC_SEQ_CST);
 		}
 		free(desc_ptr);
 	}
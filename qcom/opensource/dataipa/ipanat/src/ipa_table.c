@@ -59,12 +59,18 @@ static int InsertTail(
 	void*                       rec_ptr,       /* occupied record at index below */
 	uint16_t*                   rec_index_ptr, /* pointer to index of record above */
 	void*                       user_data,
-	struct ipa_ioc_nat_dma_cmd* cmd );
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint16_t*                   probes_ptr );  /* records read to reach the new one */
 
 static uint16_t MakeEntryHdl(
 	ipa_table* tbl,
 	uint16_t   tbl_entry );
 
+static void ExpnSlotSet(
+	ipa_table* table,
+	uint16_t   index,
+	bool       used );
+
 static int FindExpnTblFreeEntry(
 	ipa_table* table,
 	void**     free_entry,
@@ -217,6 +223,12 @@ void ipa_table_reset(
 	for (i = 0; i < tot; i++)
 		table->expn_table_addr[i] = '\0';
 
+	memset(table->expn_used_map, 0, sizeof(table->expn_used_map));
+	table->expn_free_hint = 0;
+
+	memset(table->insert_probes, 0, sizeof(table->insert_probes));
+	table->last_insert_probes = 0;
+
 	IPADBG("Out\n");
 }
 
@@ -227,7 +239,8 @@ int ipa_table_add_entry(
 	uint32_t*  rule_hdl,
 	struct ipa_ioc_nat_dma_cmd* cmd )
 {
-	void* rec_ptr;
+	void*    rec_ptr;
+	uint16_t probes = 1;
 	int ret = 0, occupied;
 
 	IPADBG("In\n");
@@ -247,12 +260,15 @@ int ipa_table_add_entry(
 	else
 	{
 		IPADBG("Collision (in %s) ... will probe for open slot\n", table->name);
-		ret = InsertTail(table, rec_ptr, rec_index_ptr, user_data, cmd);
+		ret = InsertTail(table, rec_ptr, rec_index_ptr, user_data, cmd, &probes);
 	}
 
 	if (ret)
 		goto bail;
 
+	IPA_TABLE_HIST_ADD(table->insert_probes, probes);
+	table->last_insert_probes = probes;
+
 	IPADBG("New Entry Index %u in %s\n", *rec_index_ptr, table->name);
 
 	if ( rule_hdl ) {
@@ -405,6 +421,29 @@ void ipa_table_erase_entry(
 	else
 	{
 		--table->cur_expn_tbl_cnt;
+
+		ExpnSlotSet(table, index, false);
+	}
+
+	IPADBG("Out\n");
+}
+
+/*
+ * Rolls back the most recent ipa_table_add_entry() on the table,
+ * including its count in insert_probes
+ */
+void ipa_table_undo_add_entry(
+	ipa_table* table,
+	uint16_t   index)
+{
+	IPADBG("In\n");
+
+	ipa_table_erase_entry(table, index);
+
+	if ( table->last_insert_probes )
+	{
+		IPA_TABLE_HIST_SUB(table->insert_probes, table->last_insert_probes);
+		table->last_insert_probes = 0;
 	}
 
 	IPADBG("Out\n");
@@ -737,6 +776,8 @@ int ipa_table_iterator_end(
 
 		iterator->prev_index = next_index;
 		iterator->prev_entry = GOTO_REC(table_ptr, next_index);
+
+		iterator->hops++;
 	}
 
 	if ( found_end )
@@ -815,7 +856,8 @@ static int InsertTail(
 	void*                       rec_ptr,       /* occupied record at index below */
 	uint16_t*                   rec_index_ptr, /* pointer to index of record above */
 	void*                       user_data,
-	struct ipa_ioc_nat_dma_cmd* cmd )
+	struct ipa_ioc_nat_dma_cmd* cmd,
+	uint16_t*                   probes_ptr )   /* records read to reach the new one */
 {
 	bool is_index_tbl = (table->meta) ? true : false;
 
@@ -841,6 +883,11 @@ static int InsertTail(
 		goto bail;
 	}
 
+	/*
+	 * The head, each record followed from it, and the new one
+	 */
+	*probes_ptr = iterator.hops + 2;
+
 	/*
 	 * The most important side effect of the following is to set the
 	 * iterator's curr_index and curr_entry with the next available
@@ -919,6 +966,8 @@ static int InsertTail(
 
 	++table->cur_expn_tbl_cnt;
 
+	ExpnSlotSet(table, iterator.curr_index, true);
+
 	*rec_index_ptr = iterator.curr_index;
 
 bail:
@@ -974,21 +1023,40 @@ static uint16_t MakeEntryHdl(
 	return entry_hdl;
 }
 
-static int mt_slot(
-	ipa_table*      table_ptr,
-	uint32_t        rule_hdl,
-	void*           record_ptr,
-	uint16_t        record_index,
-	void*           meta_record_ptr,
-	uint16_t        meta_record_index,
-	void*           arb_data_ptr )
+/*
+ * Expansion slot bookkeeping. One bit per expansion slot is kept in
+ * table->expn_used_map (set means occupied), so that finding a free
+ * slot does not require walking the expansion table itself.
+ */
+static void ExpnSlotSet(
+	ipa_table* table,
+	uint16_t   index,
+	bool       used )
 {
-	IPADBG("%s: Empty expansion slot: (%u) in table of size: (%u)\n",
-		   table_ptr->name,
-		   record_index,
-		   table_ptr->tot_tbl_ents);
+	uint16_t slot, word;
 
-	return record_index;
+	if ( index < table->table_entries ||
+		 index >= table->table_entries + table->expn_table_entries )
+	{
+		return;
+	}
+
+	slot = index - table->table_entries;
+	word = slot / IPA_TABLE_MAP_WORD_BITS;
+
+	if ( used )
+	{
+		table->expn_used_map[word] |= (1U << (slot % IPA_TABLE_MAP_WORD_BITS));
+	}
+	else
+	{
+		table->expn_used_map[word] &= ~(1U << (slot % IPA_TABLE_MAP_WORD_BITS));
+
+		if ( word < table->expn_free_hint )
+		{
+			table->expn_free_hint = word;
+		}
+	}
 }
 
 /*
@@ -999,6 +1067,9 @@ static int FindExpnTblFreeEntry(
 	void**     free_entry,
 	uint16_t*  entry_index )
 {
+	uint16_t words, word, slot;
+	uint32_t free_bits;
+
 	int ret;
 
 	IPADBG("In\n");
@@ -1015,44 +1086,55 @@ static int FindExpnTblFreeEntry(
 	*entry_index = 0;
 	*free_entry  = NULL;
 
+	ret = -1;
+
 	/*
-	 * The following will start walk at expansion slots
-	 * (ie. just after table->table_entries)...
+	 * All words below expn_free_hint are known to be full, hence
+	 * the search picks up from there and yields the lowest free
+	 * slot, just as a walk from the start of the expansion table
+	 * would...
 	 */
-	ret = ipa_table_walk(table, table->table_entries, WHEN_SLOT_EMPTY, mt_slot, 0);
+	words = (table->expn_table_entries + IPA_TABLE_MAP_WORD_BITS - 1) /
+		IPA_TABLE_MAP_WORD_BITS;
 
-	if ( ret > 0 )
+	for ( word = table->expn_free_hint; word < words; word++ )
 	{
-		*entry_index = (uint16_t) ret;
+		free_bits = ~table->expn_used_map[word];
+
+		if ( free_bits )
+		{
+			slot = word * IPA_TABLE_MAP_WORD_BITS + __builtin_ctz(free_bits);
+
+			if ( slot < table->expn_table_entries )
+			{
+				*entry_index = table->table_entries + slot;
+				ret = 0;
+			}
 
+			break;
+		}
+	}
+
+	table->expn_free_hint = word;
+
+	if ( ret == 0 )
+	{
 		*free_entry = GOTO_REC(table, *entry_index);
 
 		IPADBG("%s: entry_index val (%u) free_entry val (%p)\n",
 			   table->name,
 			   *entry_index,
 			   *free_entry);
-
-		ret = 0;
 	}
 	else
 	{
-		if ( ret < 0 )
-		{
-			IPAERR("%s: While searching table for emtpy slot\n",
-				   table->name);
-		}
-		else
-		{
-			IPADBG("%s: No empty slots (ie. expansion table full): "
-				   "BASE (avail/used): (%u/%u) EXPN (avail/used): (%u/%u)\n",
-				   table->name,
-				   table->table_entries,
-				   table->cur_tbl_cnt,
-				   table->expn_table_entries,
-				   table->cur_expn_tbl_cnt);
-		}
-
-		ret = -1;
+		IPADBG("%s: No empty slots (ie. expansion table full): "
+			   "BASE (avail/used): (%u/%u) EXPN (avail/used): (%u/%u)\n",
+			   table->name,
+			   table->table_entries,
+			   table->cur_tbl_cnt,
+			   table->expn_table_entries,
+			   table->cur_expn_tbl_cnt);
 	}
 
 bail:
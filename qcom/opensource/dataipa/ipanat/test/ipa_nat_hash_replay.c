@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_hash_replay.c
+
+	@brief
+	Offline replay of a 5-tuple trace against the IPA's NAT hashes
+	(dst_hash() for the NAT table, src_hash() for the index table)
+	and some alternatives, reporting the chain lengths and probe
+	counts each would produce in a table of the given size.
+
+	The IPA computes the hash in hardware, so an alternative can
+	only be used when the hardware does the same; this tool is for
+	measuring how far from ideal the deployed one is on real traffic.
+
+	Trace format, one flow per line ('#' starts a comment):
+
+	  proto private_ip private_port target_ip target_port public_ip public_port
+
+	with dotted quad addresses and decimal ports and protocol.
+*/
+/*=========================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <arpa/inet.h>
+
+#define HIST_BUCKETS    8
+#define DFLT_BASE_SLOTS 1024
+
+typedef struct
+{
+	uint32_t private_ip;
+	uint32_t target_ip;
+	uint32_t public_ip;
+	uint16_t private_port;
+	uint16_t target_port;
+	uint16_t public_port;
+	uint8_t  proto;
+} flow_t;
+
+/*
+ * Every hash returns a full 32 bit value, reduced to a slot below
+ */
+typedef uint32_t (*hash_func)(const uint32_t* words, int num_words);
+
+typedef struct
+{
+	const char* name;
+	hash_func   func;
+} hash_desc;
+
+/*
+ * The IPA's hash: XOR of all 16 bit halves of the key (see dst_hash()
+ * and src_hash() in ipa_nat_drvi.c)
+ */
+static uint32_t xor_fold_hash(
+	const uint32_t* words,
+	int             num_words)
+{
+	uint32_t hash = 0;
+	int      i;
+
+	for ( i = 0; i < num_words; i++ )
+	{
+		hash ^= (words[i] & 0xFFFF) ^ (words[i] >> 16);
+	}
+
+	return hash;
+}
+
+static uint32_t rotl32(
+	uint32_t x,
+	int      r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+/*
+ * Bob Jenkins' lookup3 final mix over the key, as the kernel's jhash
+ */
+static uint32_t jhash_hash(
+	const uint32_t* words,
+	int             num_words)
+{
+	uint32_t a, b, c;
+	int      i;
+
+	a = b = c = 0xDEADBEEF + ((uint32_t) num_words << 2);
+
+	for ( i = 0; i < num_words; i += 3 )
+	{
+		a += words[i];
+		b += (i + 1 < num_words) ? words[i + 1] : 0;
+		c += (i + 2 < num_words) ? words[i + 2] : 0;
+
+		c ^= b; c -= rotl32(b, 14);
+		a ^= c; a -= rotl32(c, 11);
+		b ^= a; b -= rotl32(a, 25);
+		c ^= b; c -= rotl32(b, 16);
+		a ^= c; a -= rotl32(c, 4);
+		b ^= a; b -= rotl32(a, 14);
+		c ^= b; c -= rotl32(b, 24);
+	}
+
+	return c;
+}
+
+/*
+ * MurmurHash3 (x86_32) over the key words
+ */
+static uint32_t murmur3_hash(
+	const uint32_t* words,
+	int             num_words)
+{
+	uint32_t h = 0, k;
+	int      i;
+
+	for ( i = 0; i < num_words; i++ )
+	{
+		k  = words[i] * 0xCC9E2D51;
+		k  = rotl32(k, 15) * 0x1B873593;
+		h ^= k;
+		h  = rotl32(h, 13) * 5 + 0xE6546B64;
+	}
+
+	h ^= (uint32_t) num_words << 2;
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/*
+ * CRC32C (Castagnoli), bitwise
+ */
+static uint32_t crc32c_hash(
+	const uint32_t* words,
+	int             num_words)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	int      i, bit;
+
+	for ( i = 0; i < num_words; i++ )
+	{
+		crc ^= words[i];
+
+		for ( bit = 0; bit < 32; bit++ )
+		{
+			crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+		}
+	}
+
+	return ~crc;
+}
+
+static const hash_desc hashes[] =
+{
+	{ "ipa",     xor_fold_hash },
+	{ "jhash",   jhash_hash    },
+	{ "murmur3", murmur3_hash  },
+	{ "crc32c",  crc32c_hash   },
+};
+
+#undef array_sz
+#define array_sz(a) (sizeof(a) / sizeof((a)[0]))
+
+/*
+ * Build the key words the way the IPA does for each table. The NAT
+ * table is looked up on the downlink (target, public), the index
+ * table on the uplink (private, target).
+ */
+static int dst_key(
+	const flow_t* f,
+	int           with_public_ip,
+	uint32_t*     words)
+{
+	int n = 0;
+
+	words[n++] = f->target_ip;
+	words[n++] = f->target_port;
+	words[n++] = f->public_port;
+	words[n++] = f->proto;
+
+	if ( with_public_ip )
+	{
+		words[n++] = f->public_ip;
+	}
+
+	return n;
+}
+
+static int src_key(
+	const flow_t* f,
+	uint32_t*     words)
+{
+	int n = 0;
+
+	words[n++] = f->private_ip;
+	words[n++] = f->private_port;
+	words[n++] = f->target_ip;
+	words[n++] = f->target_port;
+	words[n++] = f->proto;
+
+	return n;
+}
+
+/*
+ * As in the IPA, slot zero is never used, hence a hash of zero maps
+ * to the last slot
+ */
+static uint16_t to_slot(
+	uint32_t hash,
+	uint16_t base_slots)
+{
+	uint16_t slot = hash & (base_slots - 1);
+
+	return (slot) ? slot : base_slots - 1;
+}
+
+static void hist_add(
+	uint32_t* hist,
+	uint32_t  n)
+{
+	hist[ (n < HIST_BUCKETS) ? n - 1 : HIST_BUCKETS - 1 ]++;
+}
+
+static void replay(
+	const char*   table,
+	const hash_desc* hd,
+	const flow_t* flows,
+	uint32_t      num_flows,
+	uint16_t      base_slots,
+	int           is_dst,
+	int           with_public_ip,
+	uint16_t*     chain)
+{
+	uint32_t words[8];
+	uint32_t chain_hist[HIST_BUCKETS];
+	uint32_t probe_hist[HIST_BUCKETS];
+	uint64_t tot_probes = 0;
+	uint32_t used = 0, max_len = 0;
+	uint32_t i;
+	int      n;
+
+	memset(chain, 0, base_slots * sizeof(uint16_t));
+	memset(chain_hist, 0, sizeof(chain_hist));
+	memset(probe_hist, 0, sizeof(probe_hist));
+
+	for ( i = 0; i < num_flows; i++ )
+	{
+		uint16_t slot;
+
+		n = (is_dst) ?
+			dst_key(&flows[i], with_public_ip, words) :
+			src_key(&flows[i], words);
+
+		slot = to_slot(hd->func(words, n), base_slots);
+
+		/*
+		 * A new flow lands at the end of its chain, so that is
+		 * also how many records the IPA reads to find it
+		 */
+		chain[slot]++;
+
+		hist_add(probe_hist, chain[slot]);
+
+		tot_probes += chain[slot];
+
+		if ( chain[slot] == 1 )
+		{
+			used++;
+		}
+
+		if ( chain[slot] > max_len )
+		{
+			max_len = chain[slot];
+		}
+	}
+
+	for ( i = 1; i < base_slots; i++ )
+	{
+		if ( chain[i] )
+		{
+			hist_add(chain_hist, chain[i]);
+		}
+	}
+
+	printf("%s %-8s flows(%u) slots_used(%u/%u) expn_needed(%u) "
+		   "avg_probes(%.3f) max_chain(%u)\n",
+		   table, hd->name,
+		   num_flows, used, base_slots - 1,
+		   num_flows - used,
+		   (num_flows) ? (double) tot_probes / num_flows : 0.0,
+		   max_len);
+
+	printf("  chain_len     %7u %7u %7u %7u %7u %7u %7u %7u+\n",
+		   chain_hist[0], chain_hist[1], chain_hist[2], chain_hist[3],
+		   chain_hist[4], chain_hist[5], chain_hist[6], chain_hist[7]);
+
+	printf("  lookup_probes %7u %7u %7u %7u %7u %7u %7u %7u+\n",
+		   probe_hist[0], probe_hist[1], probe_hist[2], probe_hist[3],
+		   probe_hist[4], probe_hist[5], probe_hist[6], probe_hist[7]);
+}
+
+static int parse_flow(
+	char*   line,
+	flow_t* f)
+{
+	char     pri[64], tgt[64], pub[64];
+	unsigned proto, pri_port, tgt_port, pub_port;
+	struct in_addr a;
+
+	if ( sscanf(line, "%u %63s %u %63s %u %63s %u",
+				&proto, pri, &pri_port, tgt, &tgt_port, pub, &pub_port) != 7 )
+	{
+		return -1;
+	}
+
+	memset(f, 0, sizeof(*f));
+
+	if ( ! inet_aton(pri, &a) ) return -1;
+	f->private_ip = ntohl(a.s_addr);
+
+	if ( ! inet_aton(tgt, &a) ) return -1;
+	f->target_ip = ntohl(a.s_addr);
+
+	if ( ! inet_aton(pub, &a) ) return -1;
+	f->public_ip = ntohl(a.s_addr);
+
+	f->proto        = proto;
+	f->private_port = pri_port;
+	f->target_port  = tgt_port;
+	f->public_port  = pub_port;
+
+	return 0;
+}
+
+static void usage(
+	const char* prog)
+{
+	fprintf(stderr,
+			"Usage: %s [-b slots] [-3] [trace_file]\n"
+			"  -b slots  Base table slots, a power of 2 (default %u)\n"
+			"  -3        Pre IPA v4.0 dst_hash (public ip not hashed)\n"
+			"  The trace is read from stdin when no file is given\n",
+			prog, DFLT_BASE_SLOTS);
+}
+
+int main(
+	int   argc,
+	char* argv[])
+{
+	FILE*     fp = stdin;
+	flow_t*   flows = NULL;
+	uint16_t* chain = NULL;
+	uint32_t  num_flows = 0, max_flows = 0, line_no = 0;
+	unsigned  base_slots = DFLT_BASE_SLOTS;
+	int       with_public_ip = 1;
+	char      line[512];
+	size_t    i;
+	int       c;
+
+	while ( (c = getopt(argc, argv, "b:3h")) != -1 )
+	{
+		switch ( c )
+		{
+		case 'b':
+			base_slots = atoi(optarg);
+			break;
+		case '3':
+			with_public_ip = 0;
+			break;
+		default:
+			usage(basename(argv[0]));
+			return 1;
+		}
+	}
+
+	if ( base_slots < 2 || base_slots > 0x8000 || (base_slots & (base_slots - 1)) )
+	{
+		fprintf(stderr, "Illegal: -b %u\n", base_slots);
+		usage(basename(argv[0]));
+		return 1;
+	}
+
+	if ( optind < argc && ! (fp = fopen(argv[optind], "r")) )
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+
+	while ( fgets(line, sizeof(line), fp) )
+	{
+		char* p = line + strspn(line, " \t");
+
+		line_no++;
+
+		if ( *p == '#' || *p == '\n' || *p == '\0' )
+		{
+			continue;
+		}
+
+		if ( num_flows == max_flows )
+		{
+			flow_t* tmp;
+
+			max_flows = (max_flows) ? max_flows * 2 : 1024;
+
+			if ( ! (tmp = realloc(flows, max_flows * sizeof(flow_t))) )
+			{
+				fprintf(stderr, "Out of memory at %u flows\n", num_flows);
+				free(flows);
+				return 1;
+			}
+
+			flows = tmp;
+		}
+
+		if ( parse_flow(p, &flows[num_flows]) )
+		{
+			fprintf(stderr, "Skipping malformed line %u\n", line_no);
+			continue;
+		}
+
+		num_flows++;
+	}
+
+	if ( fp != stdin )
+	{
+		fclose(fp);
+	}
+
+	if ( ! (chain = calloc(base_slots, sizeof(uint16_t))) )
+	{
+		fprintf(stderr, "Out of memory\n");
+		free(flows);
+		return 1;
+	}
+
+	printf("Replaying %u flows into %u base slots, records 1 2 3 4 5 6 7 8+\n",
+		   num_flows, base_slots);
+
+	for ( i = 0; i < array_sz(hashes); i++ )
+	{
+		replay("NAT", &hashes[i], flows, num_flows, base_slots,
+			   1, with_public_ip, chain);
+	}
+
+	for ( i = 0; i < array_sz(hashes); i++ )
+	{
+		replay("IDX", &hashes[i], flows, num_flows, base_slots,
+			   0, 0, chain);
+	}
+
+	free(chain);
+	free(flows);
+
+	return 0;
+}
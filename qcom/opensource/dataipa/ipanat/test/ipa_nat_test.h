@@ -43,6 +43,7 @@
 
 #include "ipa_nat_drv.h"
 #include "ipa_nat_drvi.h"
+#include "ipa_nat_sim.h"
 
 #undef array_sz
 #define array_sz(a) \
@@ -177,4 +178,9 @@ int ipa_nat_test022(const char*, u32, int, u32, int, void*);
 int ipa_nat_test023(const char*, u32, int, u32, int, void*);
 int ipa_nat_test024(const char*, u32, int, u32, int, void*);
 int ipa_nat_test025(const char*, u32, int, u32, int, void*);
+int ipa_nat_test026(const char*, u32, int, u32, int, void*);
+int ipa_nat_test027(const char*, u32, int, u32, int, void*);
+int ipa_nat_test028(const char*, u32, int, u32, int, void*);
+int ipa_nat_test029(const char*, u32, int, u32, int, void*);
+int ipa_nat_test030(const char*, u32, int, u32, int, void*);
 int ipa_nat_test999(const char*, u32, int, u32, int, void*);
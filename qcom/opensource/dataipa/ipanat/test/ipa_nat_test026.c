@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test026.c
+
+	@brief
+	Note: Verify the following scenario:
+	1. Add random rules until the table is full, timing each add
+	2. Report average and worst add latency per occupancy decile
+	3. Delete all added rules
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_BUCKETS 10
+
+int ipa_nat_test026(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule  ipv4_rule;
+	u32*               rule_hdls = NULL;
+
+	ipa_nati_tbl_stats nstats, istats;
+
+	uint64_t           start, stop, delta;
+	uint64_t           tot_ns[NUM_BUCKETS];
+	uint64_t           max_ns[NUM_BUCKETS];
+	u32                cnt[NUM_BUCKETS];
+
+	u32                i, b, tot_added;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nati_clear_ipv4_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( ! nstats.tot_ents )
+	{
+		ret = -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	rule_hdls = calloc(nstats.tot_ents, sizeof(u32));
+
+	if ( ! rule_hdls )
+	{
+		ret = -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	memset(tot_ns, 0, sizeof(tot_ns));
+	memset(max_ns, 0, sizeof(max_ns));
+	memset(cnt,    0, sizeof(cnt));
+
+	IPAINFO("Timing rule adds to %s table of size: (%u)\n",
+			ipa3_nat_mem_in_as_str(nstats.nmi),
+			nstats.tot_ents);
+
+	for ( tot_added = 0; tot_added < nstats.tot_ents; tot_added++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		currTimeAs(TimeAsNanSecs, &start);
+
+		ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[tot_added]);
+
+		currTimeAs(TimeAsNanSecs, &stop);
+
+		if ( ret )
+		{
+			/*
+			 * A full chain or expansion table is the expected way
+			 * out of here...
+			 */
+			IPADBG("Add %u failed with ret(%d), stopping\n", tot_added, ret);
+			break;
+		}
+
+		delta = stop - start;
+
+		b = (tot_added * NUM_BUCKETS) / nstats.tot_ents;
+
+		tot_ns[b] += delta;
+		cnt[b]++;
+
+		if ( delta > max_ns[b] )
+		{
+			max_ns[b] = delta;
+		}
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_ACTION(ret, tbl_hdl, goto bail);
+
+	IPAINFO("Added (%u) rules: NAT EXPN (%u/%u) IDX EXPN (%u/%u)\n",
+			tot_added,
+			nstats.tot_expn_ents_filled,
+			nstats.tot_expn_ents,
+			istats.tot_expn_ents_filled,
+			istats.tot_expn_ents);
+
+	for ( b = 0; b < NUM_BUCKETS; b++ )
+	{
+		if ( cnt[b] )
+		{
+			IPAINFO("Occupancy %3u%%-%3u%%: adds(%u) avg_ns(%llu) max_ns(%llu)\n",
+					b * (100 / NUM_BUCKETS),
+					(b + 1) * (100 / NUM_BUCKETS),
+					cnt[b],
+					(unsigned long long) (tot_ns[b] / cnt[b]),
+					(unsigned long long) max_ns[b]);
+		}
+	}
+
+bail:
+	ret = 0;
+
+	for ( i = 0; i < tot_added; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+
+		if ( ret )
+		{
+			IPAERR("Unable to delete rule_hdl(0x%08X)\n", rule_hdls[i]);
+			break;
+		}
+	}
+
+	free(rule_hdls);
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
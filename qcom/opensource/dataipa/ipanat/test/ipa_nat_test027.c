@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test027.c
+
+	@brief
+	Note: Verify the following scenario (simulated IPA only):
+	1. Add and delete rules one DMA command at a time
+	2. Add and delete the same number of rules in batch mode
+	3. Check that batching used fewer DMA commands for the same entries
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define NUM_RULES  16
+#define BATCH_SIZE 8
+
+static int add_del_rules(
+	u32                tbl_hdl,
+	u32*               tot_ptr,
+	ipa_nat_sim_stats* stats_ptr)
+{
+	ipa_nat_ipv4_rule ipv4_rule;
+	u32               rule_hdls[NUM_RULES];
+	u32               i, tot;
+
+	int ret = 0;
+
+	ipa_nat_sim_clear_stats();
+
+	for ( tot = 0; tot < NUM_RULES; tot++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[tot]) )
+		{
+			break;
+		}
+	}
+
+	for ( i = 0; i < tot && ret == 0; i++ )
+	{
+		ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]);
+	}
+
+	if ( ret == 0 )
+	{
+		ret = ipa_nat_flush_batch();
+	}
+
+	ipa_nat_sim_get_stats(stats_ptr);
+
+	*tot_ptr = tot;
+
+	return ret;
+}
+
+int ipa_nat_test027(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_sim_stats  single, batched;
+
+	u32                tot_single, tot_batched;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( ipa_dev_ops_get() != &ipa_nat_sim_dev_ops )
+	{
+		IPAINFO("Skipped, the DMA command counts come from the simulated IPA\n");
+		return 0;
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nati_clear_ipv4_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = add_del_rules(tbl_hdl, &tot_single, &single);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_set_batch_mode(BATCH_SIZE, 100);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = add_del_rules(tbl_hdl, &tot_batched, &batched);
+
+	ipa_nat_set_batch_mode(0, 0);
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("Unbatched: rules(%u) dma_cmds(%llu) dma_entries(%llu) max_entries(%u)\n",
+			tot_single,
+			(unsigned long long) single.dma_cmds,
+			(unsigned long long) single.dma_entries,
+			single.max_dma_entries);
+
+	IPAINFO("Batched:   rules(%u) dma_cmds(%llu) dma_entries(%llu) max_entries(%u)\n",
+			tot_batched,
+			(unsigned long long) batched.dma_cmds,
+			(unsigned long long) batched.dma_entries,
+			batched.max_dma_entries);
+
+	/*
+	 * Every add and delete needs at least one DMA command when not
+	 * batching, so batching a handful of them has to do better...
+	 */
+	if ( tot_batched > BATCH_SIZE && batched.dma_cmds >= single.dma_cmds )
+	{
+		ret = -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
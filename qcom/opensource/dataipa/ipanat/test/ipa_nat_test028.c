@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test028.c
+
+	@brief
+	Note: Verify the following scenario:
+	1. Add random rules to half of the table
+	2. Check that the hash histograms account for every rule and add
+	3. Delete all added rules and check that the chains are gone
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+static u32 hist_sum(
+	const uint32_t* hist)
+{
+	u32 i, tot = 0;
+
+	for ( i = 0; i < IPA_NAT_HASH_HIST_BUCKETS; i++ )
+	{
+		tot += hist[i];
+	}
+
+	return tot;
+}
+
+static void hist_show(
+	const char*     name,
+	const uint32_t* hist)
+{
+	IPAINFO("%-22s %6u %6u %6u %6u %6u %6u %6u %6u+\n",
+			name,
+			hist[0], hist[1], hist[2], hist[3],
+			hist[4], hist[5], hist[6], hist[7]);
+}
+
+int ipa_nat_test028(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule  ipv4_rule;
+	u32                rule_hdls[2048];
+
+	ipa_nati_tbl_stats nstats, istats;
+	ipa_nat_hash_stats nhash, ihash;
+
+	u32                i, tot, max;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nati_clear_ipv4_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	max = nstats.tot_ents / 2;
+
+	if ( max > array_sz(rule_hdls) )
+	{
+		max = array_sz(rule_hdls);
+	}
+
+	for ( tot = 0; tot < max; tot++ )
+	{
+		memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+		ipv4_rule.protocol     = IPPROTO_TCP;
+		ipv4_rule.public_port  = RAN_PORT;
+		ipv4_rule.target_ip    = RAN_ADDR;
+		ipv4_rule.target_port  = RAN_PORT;
+		ipv4_rule.private_ip   = RAN_ADDR;
+		ipv4_rule.private_port = RAN_PORT;
+
+		if ( ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdls[tot]) )
+		{
+			/*
+			 * A full chain or expansion table is fine here...
+			 */
+			break;
+		}
+	}
+
+	ret = ipa_nati_ipv4_tbl_stats(tbl_hdl, &nstats, &istats);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_get_hash_stats(tbl_hdl, &nhash, &ihash);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("Added (%u) rules to %s table, records per bucket: 1..8+\n",
+			tot, ipa3_nat_mem_in_as_str(nstats.nmi));
+
+	hist_show("NAT chain_len",      nhash.chain_len);
+	hist_show("NAT lookup_probes",  nhash.lookup_probes);
+	hist_show("NAT insert_probes",  nhash.insert_probes);
+	hist_show("IDX chain_len",      ihash.chain_len);
+	hist_show("IDX lookup_probes",  ihash.lookup_probes);
+	hist_show("IDX insert_probes",  ihash.insert_probes);
+
+	/*
+	 * Every used base slot heads one chain, every record is reached
+	 * by some number of probes and every add was accounted for...
+	 */
+	if ( hist_sum(nhash.chain_len) != nstats.tot_base_ents_filled ||
+		 hist_sum(ihash.chain_len) != istats.tot_base_ents_filled ||
+		 hist_sum(nhash.lookup_probes) !=
+		   nstats.tot_base_ents_filled + nstats.tot_expn_ents_filled ||
+		 hist_sum(ihash.lookup_probes) !=
+		   istats.tot_base_ents_filled + istats.tot_expn_ents_filled ||
+		 hist_sum(nhash.insert_probes) != tot ||
+		 hist_sum(ihash.insert_probes) != tot )
+	{
+		IPAERR("Histograms don't add up for (%u) rules\n", tot);
+		ret = -1;
+	}
+
+	for ( i = 0; i < tot; i++ )
+	{
+		if ( ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdls[i]) )
+		{
+			IPAERR("Unable to delete rule_hdl(0x%08X)\n", rule_hdls[i]);
+			ret = -1;
+			break;
+		}
+	}
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_get_hash_stats(tbl_hdl, &nhash, &ihash);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( hist_sum(nhash.chain_len) || hist_sum(ihash.chain_len) )
+	{
+		IPAERR("Chains left behind after deleting all rules\n");
+		ret = -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test029.c
+
+	@brief
+	Note: Verify the following scenario (IPv6CT):
+	1. Add a few thousand IPv6CT rules within one prefix
+	2. Move them to a new prefix one rule at a time (delete and add)
+	3. Move them back with ipa_ipv6ct_flush_by_prefix() and
+	   ipa_ipv6ct_add_rules()
+	4. Check that all rules moved each time, and report the time and
+	   DMA commands each migration took
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+#include "ipa_ipv6ct.h"
+
+#include <errno.h>
+
+#define NUM_V6_RULES   2000
+#define NUM_V6_ENTRIES 4000
+
+#define OLD_PREFIX_MSB 0x20010DB800010000ULL
+#define NEW_PREFIX_MSB 0x20010DB800020000ULL
+
+static ipa_ipv6ct_rule v6_rules[NUM_V6_RULES];
+static u32             v6_hdls[NUM_V6_RULES];
+
+static void make_rules(void)
+{
+	u32 i;
+
+	for ( i = 0; i < NUM_V6_RULES; i++ )
+	{
+		memset(&v6_rules[i], 0, sizeof(v6_rules[i]));
+
+		v6_rules[i].src_ipv6_msb       = OLD_PREFIX_MSB;
+		v6_rules[i].src_ipv6_lsb       = ((uint64_t) RAN_ADDR << 32) | RAN_ADDR;
+		v6_rules[i].dest_ipv6_msb      = 0x2A00145040000000ULL | RAN_ADDR;
+		v6_rules[i].dest_ipv6_lsb      = ((uint64_t) RAN_ADDR << 32) | RAN_ADDR;
+		v6_rules[i].src_port           = RAN_PORT;
+		v6_rules[i].dest_port          = RAN_PORT;
+		v6_rules[i].protocol           = (i & 1) ? IPPROTO_UDP : IPPROTO_TCP;
+		v6_rules[i].direction_settings = IPA_IPV6CT_DIRECTION_ALLOW_ALL;
+	}
+}
+
+static void set_prefix(
+	uint64_t msb)
+{
+	u32 i;
+
+	for ( i = 0; i < NUM_V6_RULES; i++ )
+	{
+		v6_rules[i].src_ipv6_msb = msb;
+	}
+}
+
+static void report(
+	const char*        name,
+	u32                num,
+	uint64_t                start_us,
+	ipa_nat_sim_stats* stats_ptr)
+{
+	uint64_t end_us;
+
+	currTimeAs(TimeAsMicSecs, &end_us);
+
+	ipa_nat_sim_get_stats(stats_ptr);
+
+	IPAINFO("%s: rules(%u) time(%llu us) dma_cmds(%llu) dma_entries(%llu)\n",
+			name,
+			num,
+			(unsigned long long) (end_us - start_us),
+			(unsigned long long) stats_ptr->dma_cmds,
+			(unsigned long long) stats_ptr->dma_entries);
+}
+
+int ipa_nat_test029(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	ipa_ipv6ct_prefix prefix;
+	ipa_nat_sim_stats single, bulk;
+	u32               v6_tbl_hdl, num, i;
+	uint64_t               start_us;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	ret = ipa_ipv6ct_add_tbl(NUM_V6_ENTRIES, &v6_tbl_hdl);
+
+	if ( ret == -EPERM )
+	{
+		IPAINFO("Skipped, IPv6CT isn't supported\n");
+		return 0;
+	}
+
+	CHECK_ERR(ret);
+
+	make_rules();
+
+	ret = ipa_ipv6ct_add_rules(v6_tbl_hdl, v6_rules, NUM_V6_RULES, v6_hdls);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	/*
+	 * Prefix change, one rule at a time...
+	 */
+	set_prefix(NEW_PREFIX_MSB);
+
+	ipa_nat_sim_clear_stats();
+
+	currTimeAs(TimeAsMicSecs, &start_us);
+
+	for ( i = 0; i < NUM_V6_RULES && ret == 0; i++ )
+	{
+		ret = ipa_ipv6ct_del_rule(v6_tbl_hdl, v6_hdls[i]);
+
+		if ( ret == 0 )
+		{
+			ret = ipa_ipv6ct_add_rule(v6_tbl_hdl, &v6_rules[i], &v6_hdls[i]);
+		}
+	}
+
+	report("One at a time", i, start_us, &single);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	/*
+	 * ...and back again in bulk
+	 */
+	set_prefix(OLD_PREFIX_MSB);
+
+	memset(&prefix, 0, sizeof(prefix));
+
+	prefix.ipv6_msb = NEW_PREFIX_MSB;
+	prefix.len      = 64;
+
+	ipa_nat_sim_clear_stats();
+
+	currTimeAs(TimeAsMicSecs, &start_us);
+
+	ret = ipa_ipv6ct_flush_by_prefix(v6_tbl_hdl, &prefix, &num);
+
+	if ( ret == 0 )
+	{
+		ret = ipa_ipv6ct_add_rules(v6_tbl_hdl, v6_rules, NUM_V6_RULES, v6_hdls);
+	}
+
+	report("Bulk", num, start_us, &bulk);
+
+	if ( ret )
+	{
+		goto bail;
+	}
+
+	if ( num != NUM_V6_RULES )
+	{
+		IPAERR("Flushed %u rules of %u\n", num, NUM_V6_RULES);
+		ret = -1;
+		goto bail;
+	}
+
+	/*
+	 * Nothing should be left in the new prefix...
+	 */
+	ret = ipa_ipv6ct_flush_by_prefix(v6_tbl_hdl, &prefix, &num);
+
+	if ( ret == 0 && num != 0 )
+	{
+		IPAERR("%u rules left in the new prefix\n", num);
+		ret = -1;
+	}
+
+	/*
+	 * ...and every rule added in bulk should be in the old one
+	 */
+	prefix.ipv6_msb = OLD_PREFIX_MSB;
+
+	if ( ret == 0 )
+	{
+		ret = ipa_ipv6ct_flush_by_prefix(v6_tbl_hdl, &prefix, &num);
+	}
+
+	if ( ret == 0 && num != NUM_V6_RULES )
+	{
+		IPAERR("Found %u rules of %u in the old prefix\n", num, NUM_V6_RULES);
+		ret = -1;
+	}
+
+	if ( ret == 0 &&
+		 ipa_dev_ops_get() == &ipa_nat_sim_dev_ops &&
+		 bulk.dma_cmds >= single.dma_cmds )
+	{
+		IPAERR("Bulk migration used more DMA commands than one at a time\n");
+		ret = -1;
+	}
+
+bail:
+	if ( ipa_ipv6ct_del_tbl(v6_tbl_hdl) && ret == 0 )
+	{
+		ret = -1;
+	}
+
+	CHECK_ERR(ret);
+
+	IPADBG("Out\n");
+
+	return 0;
+}
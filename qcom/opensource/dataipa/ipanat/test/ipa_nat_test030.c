@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*=========================================================================*/
+/*!
+	@file
+	ipa_nat_test030.c
+
+	@brief
+	Note: Verify the following scenario (simulated IPA only):
+	1. Queue a rule add in batch mode and have the IPA refuse the commit
+	2. Add the same rule again and check it doesn't get the first handle
+	3. Check that deleting the first handle fails and leaves the second
+	   rule alone
+*/
+/*=========================================================================*/
+
+#include "ipa_nat_test.h"
+
+#define BATCH_SIZE 8
+
+int ipa_nat_test030(
+	const char* nat_mem_type,
+	u32 pub_ip_add,
+	int total_entries,
+	u32 tbl_hdl,
+	int sep,
+	void* arb_data_ptr)
+{
+	int* tbl_hdl_ptr = (int*) arb_data_ptr;
+
+	ipa_nat_ipv4_rule ipv4_rule;
+	u32               failed_hdl, rule_hdl;
+
+	int ret;
+
+	IPADBG("In\n");
+
+	if ( ipa_dev_ops_get() != &ipa_nat_sim_dev_ops )
+	{
+		IPAINFO("Skipped, DMA failures are injected by the simulated IPA\n");
+		return 0;
+	}
+
+	if ( sep )
+	{
+		ret = ipa_nat_add_ipv4_tbl(pub_ip_add, nat_mem_type, total_entries, &tbl_hdl);
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	ret = ipa_nati_clear_ipv4_tbl(tbl_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	memset(&ipv4_rule, 0, sizeof(ipv4_rule));
+
+	ipv4_rule.protocol     = IPPROTO_TCP;
+	ipv4_rule.public_port  = RAN_PORT;
+	ipv4_rule.target_ip    = RAN_ADDR;
+	ipv4_rule.target_port  = RAN_PORT;
+	ipv4_rule.private_ip   = RAN_ADDR;
+	ipv4_rule.private_port = RAN_PORT;
+
+	ret = ipa_nat_set_batch_mode(BATCH_SIZE, 100);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &failed_hdl);
+
+	if ( ret == 0 )
+	{
+		/*
+		 * Both the batched command and the retry of the one op in it
+		 */
+		ipa_nat_sim_fail_dma(2);
+
+		ret = ( ipa_nat_flush_batch() ) ? 0 : -1;
+
+		ipa_nat_sim_fail_dma(0);
+	}
+
+	ipa_nat_set_batch_mode(0, 0);
+
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_add_ipv4_rule(tbl_hdl, &ipv4_rule, &rule_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	IPAINFO("Refused add rule_hdl(%u), re-added rule_hdl(%u)\n",
+			failed_hdl, rule_hdl);
+
+	/*
+	 * The refused add's slots must stay reserved until its handle
+	 * is deleted...
+	 */
+	if ( rule_hdl == failed_hdl )
+	{
+		ret = -1;
+		CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+	}
+
+	/*
+	 * ...and that delete must fail without touching the new rule
+	 */
+	ret = ( ipa_nat_del_ipv4_rule(tbl_hdl, failed_hdl) ) ? 0 : -1;
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	ret = ipa_nat_del_ipv4_rule(tbl_hdl, rule_hdl);
+	CHECK_ERR_TBL_STOP(ret, tbl_hdl);
+
+	if ( sep )
+	{
+		ret = ipa_nat_del_ipv4_tbl(tbl_hdl);
+		*tbl_hdl_ptr = 0;
+		CHECK_ERR(ret);
+	}
+
+	IPADBG("Out\n");
+
+	return 0;
+}
@@ -309,7 +309,7 @@ _dispUsage(
 	const char* progNamePtr )
 {
 	printf(
-		"Usage: %s [-d -r N -i N -e N -m mt]\n"
+		"Usage: %s [-d -r N -i N -e N -m mt -s]\n"
 		"Where:\n"
 		"  -d     Each test is discrete (create table, add rules, destroy table)\n"
 		"         If not specified, only one table create and destroy for all tests\n"
@@ -318,7 +318,8 @@ _dispUsage(
 		"  -e N   Where N is the number of entries in the NAT\n"
 		"  -m mt  Where mt is the type of memory to use for the NAT\n"
 		"         Legal mt's: DDR, SRAM, or HYBRID (ie. use SRAM and DDR)\n"
-		"  -g M-N Run tests M through N only\n",
+		"  -g M-N Run tests M through N only\n"
+		"  -s     Run against a simulated IPA device (ie. off target)\n",
 		progNamePtr);
 
 	fflush(stdout);
@@ -351,6 +352,11 @@ static NatTests nt_array[] = {
 	NAT_TEST_ENTRY(ipa_nat_test023, IPA_NAT_TEST_PRE_COND_TE, 0),
 	NAT_TEST_ENTRY(ipa_nat_test024, IPA_NAT_TEST_PRE_COND_TE, 0),
 	NAT_TEST_ENTRY(ipa_nat_test025, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test026, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test027, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test028, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test029, IPA_NAT_TEST_PRE_COND_TE, 0),
+	NAT_TEST_ENTRY(ipa_nat_test030, IPA_NAT_TEST_PRE_COND_TE, 0),
 	/*
 	 * Add new tests just above this comment. Keep the following two
 	 * at the end...
@@ -386,7 +392,7 @@ int main(
 
 	IPADBG("Testing user space nat driver\n");
 
-	while ( (c = getopt(argc, argv, "dr:i:e:m:h:g:?")) != -1 )
+	while ( (c = getopt(argc, argv, "dr:i:e:m:h:g:s?")) != -1 )
 	{
 		switch (c)
 		{
@@ -423,6 +429,13 @@ int main(
 				exit(0);
 			}
 			break;
+		case 's':
+			if ( ipa_dev_ops_set(&ipa_nat_sim_dev_ops) )
+			{
+				fprintf(stderr, "Unable to select the simulated device\n");
+				exit(0);
+			}
+			break;
 		case '?':
 		default:
 			_dispUsage(basename(argv[0]));
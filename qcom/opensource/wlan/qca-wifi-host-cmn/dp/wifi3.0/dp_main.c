@@ -584,6 +584,7 @@ static void dp_service_lmac_rings(void *arg)
 void dp_peer_mec_flush_entries(struct dp_soc *soc)
 {
 	unsigned int index;
+	struct dp_mec_hash_bin *bin;
 	struct dp_mec_entry *mecentry, *mecentry_next;
 
 	TAILQ_HEAD(, dp_mec_entry) free_list;
@@ -599,9 +600,10 @@ void dp_peer_mec_flush_entries(struct dp_soc *soc)
 		return;
 
 	qdf_spin_lock_bh(&soc->mec_lock);
-	for (index = 0; index <= soc->mec_hash.mask; index++) {
-		if (!TAILQ_EMPTY(&soc->mec_hash.bins[index])) {
-			TAILQ_FOREACH_SAFE(mecentry, &soc->mec_hash.bins[index],
+	for (index = 0; index < dp_peer_mec_hash_num_bins(soc); index++) {
+		bin = dp_peer_mec_hash_bin_get(soc, index);
+		if (!TAILQ_EMPTY(bin)) {
+			TAILQ_FOREACH_SAFE(mecentry, bin,
 					   hash_list_elem, mecentry_next) {
 			    dp_peer_mec_detach_entry(soc, mecentry, &free_list);
 			}
@@ -622,6 +624,7 @@ static void dp_print_mec_stats(struct dp_soc *soc)
 {
 	int i;
 	uint32_t index;
+	struct dp_mec_hash_bin *bin;
 	struct dp_mec_entry *mecentry = NULL, *mec_list;
 	uint32_t num_entries = 0;
 
@@ -639,15 +642,18 @@ static void dp_print_mec_stats(struct dp_soc *soc)
 	}
 
 	DP_PRINT_STATS("MEC Table:");
-	for (index = 0; index <= soc->mec_hash.mask; index++) {
+	for (index = 0; index < dp_peer_mec_hash_num_bins(soc); index++) {
 		qdf_spin_lock_bh(&soc->mec_lock);
-		if (TAILQ_EMPTY(&soc->mec_hash.bins[index])) {
+		bin = dp_peer_mec_hash_bin_get(soc, index);
+		if (!bin || TAILQ_EMPTY(bin)) {
 			qdf_spin_unlock_bh(&soc->mec_lock);
 			continue;
 		}
 
-		TAILQ_FOREACH(mecentry, &soc->mec_hash.bins[index],
-			      hash_list_elem) {
+		TAILQ_FOREACH(mecentry, bin, hash_list_elem) {
+			/* a resize during the walk can show an entry twice */
+			if (num_entries >= DP_PEER_MAX_MEC_ENTRY)
+				break;
 			qdf_mem_copy(&mec_list[num_entries], mecentry,
 				     sizeof(*mecentry));
 			num_entries++;
@@ -7876,6 +7882,18 @@ free_vdev:
 
 qdf_export_symbol(dp_vdev_unref_delete);
 
+/*
+ * dp_peer_free_rcu() - free a peer once lockless lookups are done with it
+ * @head: rcu head embedded in the peer
+ *
+ */
+static void dp_peer_free_rcu(qdf_rcu_head_t *head)
+{
+	struct dp_peer *peer = qdf_container_of(head, struct dp_peer, rcu);
+
+	qdf_mem_free(peer);
+}
+
 /*
  * dp_peer_unref_delete() - unref and delete peer
  * @peer_handle:    Datapath peer handle
@@ -7961,7 +7979,11 @@ void dp_peer_unref_delete(struct dp_peer *peer, enum dp_mod_id mod_id)
 		dp_monitor_peer_detach(soc, peer);
 
 		qdf_spinlock_destroy(&peer->peer_state_lock);
-		qdf_mem_free(peer);
+		/*
+		 * The hash and peer_id lookups find peers without a lock
+		 * and may still be looking at this one.
+		 */
+		qdf_call_rcu(&peer->rcu, dp_peer_free_rcu);
 
 		/*
 		 * Decrement ref count taken at peer create
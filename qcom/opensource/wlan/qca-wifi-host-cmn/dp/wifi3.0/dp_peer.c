@@ -212,6 +212,17 @@ static QDF_STATUS dp_peer_find_map_attach(struct dp_soc *soc)
 #define DP_AST_HASH_LOAD_MULT  2
 #define DP_AST_HASH_LOAD_SHIFT 0
 
+/* old bins moved on each add while an AST/MEC hash table is resized */
+#define DP_HASH_REHASH_ADD_STEP 4
+/* old bins moved per lock hold by the AST/MEC hash grow work */
+#define DP_HASH_REHASH_WORK_STEP 64
+/* bins an AST/MEC entry can be found in while its table is resized */
+#define DP_HASH_MAX_LOOKUP_BINS 2
+/* per-SoC debugfs dir, numbered in attach order */
+#define DP_SOC_DBGFS_DIR "dp_soc%u"
+/* debugfs file with the AST/MEC hash chain length stats */
+#define DP_HASH_STATS_DBGFS_FILE "dp_hash_stats"
+
 static inline uint32_t
 dp_peer_find_hash_index(struct dp_soc *soc,
 			union dp_align_mac_addr *mac_addr)
@@ -228,6 +239,135 @@ dp_peer_find_hash_index(struct dp_soc *soc,
 	return index;
 }
 
+/*
+ * The peer hash bins are walked without peer_hash_lock by
+ * dp_peer_find_hash_find(). Writers still serialize on the lock but link
+ * and unlink with the helpers below instead of TAILQ_INSERT_TAIL and
+ * TAILQ_REMOVE: a new peer is published only once its linkage is set up,
+ * and a removed peer keeps its next pointer so that a reader standing on
+ * it can carry on. The peer memory itself is freed after a grace period,
+ * see dp_peer_unref_delete().
+ *
+ * A peer reused from the inactive list is linked again without a grace
+ * period, which rewrites the next pointer a reader may be standing on.
+ * hash_gen changes on every link and unlink so that the reader notices
+ * and restarts the walk, see dp_peer_hash_bin_next().
+ */
+static inline void dp_peer_hash_bin_add_tail(struct dp_soc *soc,
+					     unsigned int index,
+					     struct dp_peer *peer)
+{
+	qdf_atomic_inc(&peer->hash_gen);
+	qdf_wmb();
+	TAILQ_NEXT(peer, hash_list_elem) = NULL;
+	peer->hash_list_elem.tqe_prev = soc->peer_hash.bins[index].tqh_last;
+	qdf_rcu_assign_pointer(*soc->peer_hash.bins[index].tqh_last, peer);
+	soc->peer_hash.bins[index].tqh_last =
+					&TAILQ_NEXT(peer, hash_list_elem);
+}
+
+static inline void dp_peer_hash_bin_remove(struct dp_soc *soc,
+					   unsigned int index,
+					   struct dp_peer *peer)
+{
+	struct dp_peer *next = TAILQ_NEXT(peer, hash_list_elem);
+
+	if (next)
+		next->hash_list_elem.tqe_prev = peer->hash_list_elem.tqe_prev;
+	else
+		soc->peer_hash.bins[index].tqh_last =
+					peer->hash_list_elem.tqe_prev;
+
+	qdf_rcu_assign_pointer(*peer->hash_list_elem.tqe_prev, next);
+	qdf_atomic_inc(&peer->hash_gen);
+}
+
+/*
+ * dp_peer_hash_bin_next() - step of a lockless hash bin walk
+ * @peer: current peer
+ * @gen: hash_gen of @peer, read when the walk reached it
+ * @next: next peer in the bin, or NULL at the end
+ *
+ * Called within the RCU read section the walk reached @peer in.
+ *
+ * return: false if @peer was linked or unlinked since, the walk restarts
+ */
+static inline bool dp_peer_hash_bin_next(struct dp_peer *peer, int32_t gen,
+					 struct dp_peer **next)
+{
+	*next = qdf_rcu_dereference(TAILQ_NEXT(peer, hash_list_elem));
+	qdf_rmb();
+
+	return qdf_atomic_read(&peer->hash_gen) == gen;
+}
+
+/*
+ * dp_peer_hash_bin_find() - lockless lookup of a link peer in a hash bin
+ * @soc: soc handle
+ * @index: hash bin index of @mac_addr
+ * @mac_addr: aligned peer mac address
+ * @vdev_id: vdev_id or DP_VDEV_ALL
+ * @mod_id: id of module requesting reference
+ *
+ * The peer is only known to be alive once the reference is taken, so the
+ * vdev is checked after that and the reference dropped again on mismatch,
+ * outside the RCU read section.
+ *
+ * return: referenced peer, or NULL
+ */
+static struct dp_peer *dp_peer_hash_bin_find(struct dp_soc *soc,
+					     unsigned int index,
+					     union dp_align_mac_addr *mac_addr,
+					     uint8_t vdev_id,
+					     enum dp_mod_id mod_id)
+{
+	struct dp_peer *peer, *next;
+	struct dp_peer *held = NULL;
+	int32_t gen;
+
+	qdf_rcu_read_lock();
+restart:
+	peer = qdf_rcu_dereference(TAILQ_FIRST(&soc->peer_hash.bins[index]));
+	while (peer) {
+		gen = qdf_atomic_read(&peer->hash_gen);
+		qdf_rmb();
+
+		if (dp_peer_find_mac_addr_cmp(mac_addr, &peer->mac_addr) ||
+		    dp_peer_get_ref(soc, peer, mod_id) != QDF_STATUS_SUCCESS)
+			goto step;
+
+		if (peer->vdev->vdev_id == vdev_id || vdev_id == DP_VDEV_ALL)
+			break;
+
+		/*
+		 * Wrong vdev. This may be the last reference, and the final
+		 * unref must not run in the read section, so leave it and
+		 * drop the reference held for the previous mismatch instead.
+		 * The one just taken keeps this peer alive until the walk
+		 * moves on from it, and only a peer that stayed linked the
+		 * whole time may be moved on from.
+		 */
+		qdf_rcu_read_unlock();
+		if (held)
+			dp_peer_unref_delete(held, mod_id);
+		held = peer;
+		qdf_rcu_read_lock();
+
+		if (!(gen & 1))
+			goto restart;
+step:
+		if (!dp_peer_hash_bin_next(peer, gen, &next))
+			goto restart;
+		peer = next;
+	}
+	qdf_rcu_read_unlock();
+
+	if (held)
+		dp_peer_unref_delete(held, mod_id);
+
+	return peer;
+}
+
 #ifdef WLAN_FEATURE_11BE_MLO
 /*
  * dp_peer_find_hash_detach() - cleanup memory for peer_hash table
@@ -317,8 +457,7 @@ void dp_peer_find_hash_add(struct dp_soc *soc, struct dp_peer *peer)
 		 * this ensures that if two entries with the same MAC address
 		 * are stored, the one added first will be found first.
 		 */
-		TAILQ_INSERT_TAIL(&soc->peer_hash.bins[index], peer,
-				  hash_list_elem);
+		dp_peer_hash_bin_add_tail(soc, index, peer);
 
 		qdf_spin_unlock_bh(&soc->peer_hash_lock);
 	} else if (peer->peer_type == CDP_MLD_PEER_TYPE) {
@@ -364,21 +503,9 @@ struct dp_peer *dp_peer_find_hash_find(struct dp_soc *soc,
 	}
 	/* search link peer table firstly */
 	index = dp_peer_find_hash_index(soc, mac_addr);
-	qdf_spin_lock_bh(&soc->peer_hash_lock);
-	TAILQ_FOREACH(peer, &soc->peer_hash.bins[index], hash_list_elem) {
-		if (dp_peer_find_mac_addr_cmp(mac_addr, &peer->mac_addr) == 0 &&
-		    ((peer->vdev->vdev_id == vdev_id) ||
-		     (vdev_id == DP_VDEV_ALL))) {
-			/* take peer reference before returning */
-			if (dp_peer_get_ref(soc, peer, mod_id) !=
-						QDF_STATUS_SUCCESS)
-				peer = NULL;
-
-			qdf_spin_unlock_bh(&soc->peer_hash_lock);
-			return peer;
-		}
-	}
-	qdf_spin_unlock_bh(&soc->peer_hash_lock);
+	peer = dp_peer_hash_bin_find(soc, index, mac_addr, vdev_id, mod_id);
+	if (peer)
+		return peer;
 
 	if (soc->arch_ops.mlo_peer_find_hash_find)
 		return soc->arch_ops.mlo_peer_find_hash_find(soc, peer_mac_addr,
@@ -417,8 +544,7 @@ void dp_peer_find_hash_remove(struct dp_soc *soc, struct dp_peer *peer)
 			}
 		}
 		QDF_ASSERT(found);
-		TAILQ_REMOVE(&soc->peer_hash.bins[index], peer,
-			     hash_list_elem);
+		dp_peer_hash_bin_remove(soc, index, peer);
 
 		dp_peer_unref_delete(peer, DP_MOD_ID_CONFIG);
 		qdf_spin_unlock_bh(&soc->peer_hash_lock);
@@ -528,7 +654,7 @@ void dp_peer_find_hash_add(struct dp_soc *soc, struct dp_peer *peer)
 	 * the same MAC address are stored, the one added first will be
 	 * found first.
 	 */
-	TAILQ_INSERT_TAIL(&soc->peer_hash.bins[index], peer, hash_list_elem);
+	dp_peer_hash_bin_add_tail(soc, index, peer);
 
 	qdf_spin_unlock_bh(&soc->peer_hash_lock);
 }
@@ -540,7 +666,6 @@ struct dp_peer *dp_peer_find_hash_find(
 {
 	union dp_align_mac_addr local_mac_addr_aligned, *mac_addr;
 	unsigned index;
-	struct dp_peer *peer;
 
 	if (!soc->peer_hash.bins)
 		return NULL;
@@ -554,22 +679,7 @@ struct dp_peer *dp_peer_find_hash_find(
 		mac_addr = &local_mac_addr_aligned;
 	}
 	index = dp_peer_find_hash_index(soc, mac_addr);
-	qdf_spin_lock_bh(&soc->peer_hash_lock);
-	TAILQ_FOREACH(peer, &soc->peer_hash.bins[index], hash_list_elem) {
-		if (dp_peer_find_mac_addr_cmp(mac_addr, &peer->mac_addr) == 0 &&
-		    ((peer->vdev->vdev_id == vdev_id) ||
-		     (vdev_id == DP_VDEV_ALL))) {
-			/* take peer reference before returning */
-			if (dp_peer_get_ref(soc, peer, mod_id) !=
-						QDF_STATUS_SUCCESS)
-				peer = NULL;
-
-			qdf_spin_unlock_bh(&soc->peer_hash_lock);
-			return peer;
-		}
-	}
-	qdf_spin_unlock_bh(&soc->peer_hash_lock);
-	return NULL; /* failure */
+	return dp_peer_hash_bin_find(soc, index, mac_addr, vdev_id, mod_id);
 }
 
 qdf_export_symbol(dp_peer_find_hash_find);
@@ -592,7 +702,7 @@ void dp_peer_find_hash_remove(struct dp_soc *soc, struct dp_peer *peer)
 		}
 	}
 	QDF_ASSERT(found);
-	TAILQ_REMOVE(&soc->peer_hash.bins[index], peer, hash_list_elem);
+	dp_peer_hash_bin_remove(soc, index, peer);
 
 	dp_peer_unref_delete(peer, DP_MOD_ID_CONFIG);
 	qdf_spin_unlock_bh(&soc->peer_hash_lock);
@@ -726,7 +836,7 @@ void dp_peer_find_id_to_obj_add(struct dp_soc *soc,
 	}
 
 	if (!soc->peer_id_to_obj_map[peer_id]) {
-		soc->peer_id_to_obj_map[peer_id] = peer;
+		qdf_rcu_assign_pointer(soc->peer_id_to_obj_map[peer_id], peer);
 	} else {
 		/* Peer map event came for peer_id which
 		 * is already mapped, this is not expected
@@ -751,41 +861,141 @@ void dp_peer_find_id_to_obj_remove(struct dp_soc *soc,
 
 	qdf_spin_lock_bh(&soc->peer_map_lock);
 	peer = soc->peer_id_to_obj_map[peer_id];
-	soc->peer_id_to_obj_map[peer_id] = NULL;
+	qdf_rcu_assign_pointer(soc->peer_id_to_obj_map[peer_id], NULL);
 	dp_peer_unref_delete(peer, DP_MOD_ID_CONFIG);
 	qdf_spin_unlock_bh(&soc->peer_map_lock);
 }
 
+/**
+ * struct dp_hash_chain_stats - chain length stats of an AST/MEC hash table
+ * @bins: number of bins walked, both tables included while resizing
+ * @used_bins: number of bins with at least one entry
+ * @entries: number of entries walked
+ * @max_chain: longest chain walked
+ */
+struct dp_hash_chain_stats {
+	uint32_t bins;
+	uint32_t used_bins;
+	uint32_t entries;
+	uint32_t max_chain;
+};
+
+/**
+ * dp_peer_hash_mac_index() - Fold a MAC address into an AST/MEC hash index
+ * @mac_addr: MAC address
+ * @idx_bits: index shift bits of the table
+ * @mask: mask of the table
+ *
+ * Return: hash index
+ */
+static inline uint32_t dp_peer_hash_mac_index(union dp_align_mac_addr *mac_addr,
+					      uint32_t idx_bits, uint32_t mask)
+{
+	uint32_t index;
+
+	index =
+		mac_addr->align2.bytes_ab ^
+		mac_addr->align2.bytes_cd ^
+		mac_addr->align2.bytes_ef;
+	index ^= index >> idx_bits;
+	index &= mask;
+	return index;
+}
+
+/**
+ * dp_peer_hash_need_grow() - Check if an AST/MEC hash table should grow
+ * @resize: resize state of the table
+ * @mask: mask of the current table
+ * @draining: an older table is still being drained
+ *
+ * A table is doubled once it holds more entries than bins, until it
+ * reaches its max size. Only one resize runs at a time.
+ *
+ * Return: true if the grow work has to be scheduled
+ */
+static inline bool dp_peer_hash_need_grow(struct dp_hash_resize *resize,
+					  uint32_t mask, bool draining)
+{
+	return resize->count > mask + 1 && mask < resize->max_mask &&
+	       !draining && !resize->grow_pending;
+}
+
+/**
+ * dp_peer_hash_chain_stats_add() - Account one bin in the chain stats
+ * @stats: chain stats
+ * @chain: number of entries in the bin
+ *
+ * Return: None
+ */
+static inline void
+dp_peer_hash_chain_stats_add(struct dp_hash_chain_stats *stats,
+			     uint32_t chain)
+{
+	stats->bins++;
+	if (!chain)
+		return;
+
+	stats->used_bins++;
+	stats->entries += chain;
+	if (chain > stats->max_chain)
+		stats->max_chain = chain;
+}
+
 #ifdef FEATURE_MEC
+/**
+ * dp_peer_mec_hash_bins_alloc() - Allocate and initialize MEC hash bins
+ * @hash_elems: number of bins
+ *
+ * Return: bins on success, NULL on failure
+ */
+static struct dp_mec_hash_bin *dp_peer_mec_hash_bins_alloc(uint32_t hash_elems)
+{
+	struct dp_mec_hash_bin *bins;
+	uint32_t i;
+
+	bins = qdf_mem_malloc(hash_elems * sizeof(*bins));
+	if (!bins)
+		return NULL;
+
+	for (i = 0; i < hash_elems; i++)
+		TAILQ_INIT(&bins[i]);
+
+	return bins;
+}
+
+static void dp_peer_mec_hash_grow_work(void *arg);
+
 /**
  * dp_peer_mec_hash_attach() - Allocate and initialize MEC Hash Table
  * @soc: SoC handle
  *
+ * The table starts at DP_PEER_MAX_MEC_IDX bins and grows on load, up to
+ * one bin per MEC entry.
+ *
  * Return: QDF_STATUS
  */
 QDF_STATUS dp_peer_mec_hash_attach(struct dp_soc *soc)
 {
-	int log2, hash_elems, i;
+	int log2, hash_elems;
 
 	log2 = dp_log2_ceil(DP_PEER_MAX_MEC_IDX);
 	hash_elems = 1 << log2;
 
 	soc->mec_hash.mask = hash_elems - 1;
 	soc->mec_hash.idx_bits = log2;
+	soc->mec_hash.resize.max_mask =
+		(1 << dp_log2_ceil(DP_PEER_MAX_MEC_ENTRY)) - 1;
 
-	dp_peer_info("%pK: max mec index: %d",
-		     soc, DP_PEER_MAX_MEC_IDX);
-
-	/* allocate an array of TAILQ mec object lists */
-	soc->mec_hash.bins = qdf_mem_malloc(hash_elems *
-					    sizeof(TAILQ_HEAD(anonymous_tail_q,
-							      dp_mec_entry)));
+	dp_peer_info("%pK: max mec index: %d, max mec hash_elems: %u",
+		     soc, DP_PEER_MAX_MEC_IDX,
+		     soc->mec_hash.resize.max_mask + 1);
 
+	soc->mec_hash.bins = dp_peer_mec_hash_bins_alloc(hash_elems);
 	if (!soc->mec_hash.bins)
 		return QDF_STATUS_E_NOMEM;
 
-	for (i = 0; i < hash_elems; i++)
-		TAILQ_INIT(&soc->mec_hash.bins[i]);
+	qdf_create_work(0, &soc->mec_hash.resize.work,
+			dp_peer_mec_hash_grow_work, soc);
 
 	return QDF_STATUS_SUCCESS;
 }
@@ -799,34 +1009,213 @@ QDF_STATUS dp_peer_mec_hash_attach(struct dp_soc *soc)
 static inline uint32_t dp_peer_mec_hash_index(struct dp_soc *soc,
 					      union dp_align_mac_addr *mac_addr)
 {
+	return dp_peer_hash_mac_index(mac_addr, soc->mec_hash.idx_bits,
+				      soc->mec_hash.mask);
+}
+
+/**
+ * dp_peer_mec_hash_bins_get() - Get the MEC hash bins a MAC address can be in
+ * @soc: SoC handle
+ * @mac_addr: MAC address
+ * @bins: filled with the bins to search, older entries first
+ *
+ * While the table is resized, an entry is either in its bin of the old
+ * table, as long as that bin has not been moved yet, or in its bin of the
+ * new table.
+ * It assumes caller has taken the mec_lock to protect the access to
+ * MEC hash table
+ *
+ * Return: number of bins filled
+ */
+static inline int
+dp_peer_mec_hash_bins_get(struct dp_soc *soc,
+			  union dp_align_mac_addr *mac_addr,
+			  struct dp_mec_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS])
+{
+	struct dp_hash_resize *resize = &soc->mec_hash.resize;
 	uint32_t index;
+	int nbins = 0;
 
-	index =
-		mac_addr->align2.bytes_ab ^
-		mac_addr->align2.bytes_cd ^
-		mac_addr->align2.bytes_ef;
-	index ^= index >> soc->mec_hash.idx_bits;
-	index &= soc->mec_hash.mask;
-	return index;
+	if (qdf_unlikely(soc->mec_hash.old_bins)) {
+		index = dp_peer_hash_mac_index(mac_addr, resize->old_idx_bits,
+					       resize->old_mask);
+		if (index >= resize->rehash_idx)
+			bins[nbins++] = &soc->mec_hash.old_bins[index];
+	}
+
+	index = dp_peer_mec_hash_index(soc, mac_addr);
+	bins[nbins++] = &soc->mec_hash.bins[index];
+
+	return nbins;
+}
+
+/**
+ * dp_peer_mec_hash_rehash() - Move MEC entries from the old to the new table
+ * @soc: SoC handle
+ * @nbins: number of old bins to move
+ *
+ * Each old bin is moved from its tail to the head of the new bins, so
+ * entries sharing a MAC address stay in the order they were added in.
+ * The old table is freed once its last bin is moved.
+ * It assumes caller has taken the mec_lock to protect the access to
+ * MEC hash table
+ *
+ * Return: None
+ */
+static void dp_peer_mec_hash_rehash(struct dp_soc *soc, uint32_t nbins)
+{
+	struct dp_hash_resize *resize = &soc->mec_hash.resize;
+	struct dp_mec_hash_bin *old_bin;
+	struct dp_mec_entry *mecentry;
+	uint32_t index;
+
+	if (qdf_likely(!soc->mec_hash.old_bins))
+		return;
+
+	while (nbins-- && resize->rehash_idx <= resize->old_mask) {
+		old_bin = &soc->mec_hash.old_bins[resize->rehash_idx++];
+		while ((mecentry = TAILQ_LAST(old_bin, dp_mec_hash_bin))) {
+			TAILQ_REMOVE(old_bin, mecentry, hash_list_elem);
+			index = dp_peer_mec_hash_index(soc,
+						       &mecentry->mac_addr);
+			TAILQ_INSERT_HEAD(&soc->mec_hash.bins[index], mecentry,
+					  hash_list_elem);
+		}
+	}
+
+	if (resize->rehash_idx > resize->old_mask) {
+		qdf_mem_free(soc->mec_hash.old_bins);
+		soc->mec_hash.old_bins = NULL;
+		resize->grow_cnt++;
+	}
+}
+
+/**
+ * dp_peer_mec_hash_grow_work() - Double the MEC hash table
+ * @arg: SoC handle
+ *
+ * The bigger table is allocated and installed here, outside the datapath.
+ * The entries are then moved a few bins per mec_lock hold, so MEC lookups
+ * and adds never wait behind a walk of the whole table.
+ *
+ * Return: None
+ */
+static void dp_peer_mec_hash_grow_work(void *arg)
+{
+	struct dp_soc *soc = (struct dp_soc *)arg;
+	struct dp_mec_hash_bin *bins;
+	uint32_t hash_elems;
+
+	/* the table size only changes in this work */
+	hash_elems = (soc->mec_hash.mask + 1) << 1;
+	bins = dp_peer_mec_hash_bins_alloc(hash_elems);
+
+	qdf_spin_lock_bh(&soc->mec_lock);
+	soc->mec_hash.resize.grow_pending = false;
+	if (!bins) {
+		qdf_spin_unlock_bh(&soc->mec_lock);
+		dp_peer_warn("%pK: fail to grow MEC hash to %u bins",
+			     soc, hash_elems);
+		return;
+	}
+
+	soc->mec_hash.old_bins = soc->mec_hash.bins;
+	soc->mec_hash.resize.old_mask = soc->mec_hash.mask;
+	soc->mec_hash.resize.old_idx_bits = soc->mec_hash.idx_bits;
+	soc->mec_hash.resize.rehash_idx = 0;
+	soc->mec_hash.bins = bins;
+	soc->mec_hash.mask = hash_elems - 1;
+	soc->mec_hash.idx_bits++;
+	qdf_spin_unlock_bh(&soc->mec_lock);
+
+	dp_peer_info("%pK: MEC hash grows to %u bins, entries: %u",
+		     soc, hash_elems, soc->mec_hash.resize.count);
+
+	do {
+		qdf_spin_lock_bh(&soc->mec_lock);
+		dp_peer_mec_hash_rehash(soc, DP_HASH_REHASH_WORK_STEP);
+		bins = soc->mec_hash.old_bins;
+		qdf_spin_unlock_bh(&soc->mec_lock);
+	} while (bins);
+}
+
+uint32_t dp_peer_mec_hash_num_bins(struct dp_soc *soc)
+{
+	uint32_t num_bins = soc->mec_hash.mask + 1;
+
+	if (soc->mec_hash.old_bins)
+		num_bins += soc->mec_hash.resize.old_mask + 1;
+
+	return num_bins;
 }
 
+struct dp_mec_hash_bin *dp_peer_mec_hash_bin_get(struct dp_soc *soc,
+						 uint32_t index)
+{
+	if (index <= soc->mec_hash.mask)
+		return &soc->mec_hash.bins[index];
+
+	index -= soc->mec_hash.mask + 1;
+	if (soc->mec_hash.old_bins && index <= soc->mec_hash.resize.old_mask)
+		return &soc->mec_hash.old_bins[index];
+
+	return NULL;
+}
+
+#if defined(FEATURE_AST) && defined(WLAN_DEBUGFS)
+/**
+ * dp_peer_mec_hash_chain_stats() - Get the MEC hash chain length stats
+ * @soc: SoC handle
+ * @stats: filled with the chain stats
+ *
+ * Return: None
+ */
+static void dp_peer_mec_hash_chain_stats(struct dp_soc *soc,
+					 struct dp_hash_chain_stats *stats)
+{
+	struct dp_mec_hash_bin *bin;
+	struct dp_mec_entry *mecentry;
+	uint32_t index, chain;
+
+	for (index = 0; index < dp_peer_mec_hash_num_bins(soc); index++) {
+		chain = 0;
+		qdf_spin_lock_bh(&soc->mec_lock);
+		bin = dp_peer_mec_hash_bin_get(soc, index);
+		if (!bin) {
+			qdf_spin_unlock_bh(&soc->mec_lock);
+			break;
+		}
+
+		TAILQ_FOREACH(mecentry, bin, hash_list_elem)
+			chain++;
+		qdf_spin_unlock_bh(&soc->mec_lock);
+
+		dp_peer_hash_chain_stats_add(stats, chain);
+	}
+}
+#endif
+
 struct dp_mec_entry *dp_peer_mec_hash_find_by_pdevid(struct dp_soc *soc,
 						     uint8_t pdev_id,
 						     uint8_t *mec_mac_addr)
 {
 	union dp_align_mac_addr local_mac_addr_aligned, *mac_addr;
-	uint32_t index;
+	struct dp_mec_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS];
 	struct dp_mec_entry *mecentry;
+	int i, nbins;
 
 	qdf_mem_copy(&local_mac_addr_aligned.raw[0],
 		     mec_mac_addr, QDF_MAC_ADDR_SIZE);
 	mac_addr = &local_mac_addr_aligned;
 
-	index = dp_peer_mec_hash_index(soc, mac_addr);
-	TAILQ_FOREACH(mecentry, &soc->mec_hash.bins[index], hash_list_elem) {
-		if ((pdev_id == mecentry->pdev_id) &&
-		    !dp_peer_find_mac_addr_cmp(mac_addr, &mecentry->mac_addr))
-			return mecentry;
+	nbins = dp_peer_mec_hash_bins_get(soc, mac_addr, bins);
+	for (i = 0; i < nbins; i++) {
+		TAILQ_FOREACH(mecentry, bins[i], hash_list_elem) {
+			if ((pdev_id == mecentry->pdev_id) &&
+			    !dp_peer_find_mac_addr_cmp(mac_addr,
+						       &mecentry->mac_addr))
+				return mecentry;
+		}
 	}
 
 	return NULL;
@@ -836,18 +1225,29 @@ struct dp_mec_entry *dp_peer_mec_hash_find_by_pdevid(struct dp_soc *soc,
  * dp_peer_mec_hash_add() - Add MEC entry into hash table
  * @soc: SoC handle
  *
- * This function adds the MEC entry into SoC MEC hash table
+ * This function adds the MEC entry into SoC MEC hash table. While the
+ * table is resized, a few more old bins are moved on each add.
  *
  * Return: None
  */
 static inline void dp_peer_mec_hash_add(struct dp_soc *soc,
 					struct dp_mec_entry *mecentry)
 {
+	struct dp_hash_resize *resize = &soc->mec_hash.resize;
 	uint32_t index;
 
-	index = dp_peer_mec_hash_index(soc, &mecentry->mac_addr);
 	qdf_spin_lock_bh(&soc->mec_lock);
+	dp_peer_mec_hash_rehash(soc, DP_HASH_REHASH_ADD_STEP);
+
+	index = dp_peer_mec_hash_index(soc, &mecentry->mac_addr);
 	TAILQ_INSERT_TAIL(&soc->mec_hash.bins[index], mecentry, hash_list_elem);
+	resize->count++;
+
+	if (dp_peer_hash_need_grow(resize, soc->mec_hash.mask,
+				   !!soc->mec_hash.old_bins)) {
+		resize->grow_pending = true;
+		qdf_sched_work(0, &resize->work);
+	}
 	qdf_spin_unlock_bh(&soc->mec_lock);
 }
 
@@ -912,12 +1312,30 @@ QDF_STATUS dp_peer_mec_add_entry(struct dp_soc *soc,
 void dp_peer_mec_detach_entry(struct dp_soc *soc, struct dp_mec_entry *mecentry,
 			      void *ptr)
 {
-	uint32_t index = dp_peer_mec_hash_index(soc, &mecentry->mac_addr);
+	struct dp_mec_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS];
+	struct dp_mec_hash_bin *bin;
+	struct dp_mec_entry *tmpentry;
+	int nbins;
 
 	TAILQ_HEAD(, dp_mec_entry) * free_list = ptr;
 
-	TAILQ_REMOVE(&soc->mec_hash.bins[index], mecentry,
-		     hash_list_elem);
+	/*
+	 * The entry is in the new table, unless it was added before the
+	 * resize started and its old bin has not been moved yet.
+	 */
+	nbins = dp_peer_mec_hash_bins_get(soc, &mecentry->mac_addr, bins);
+	bin = bins[nbins - 1];
+	if (nbins > 1) {
+		TAILQ_FOREACH(tmpentry, bins[0], hash_list_elem) {
+			if (tmpentry == mecentry) {
+				bin = bins[0];
+				break;
+			}
+		}
+	}
+
+	TAILQ_REMOVE(bin, mecentry, hash_list_elem);
+	soc->mec_hash.resize.count--;
 	TAILQ_INSERT_TAIL(free_list, mecentry, hash_list_elem);
 }
 
@@ -945,7 +1363,15 @@ void dp_peer_mec_free_list(struct dp_soc *soc, void *ptr)
  */
 void dp_peer_mec_hash_detach(struct dp_soc *soc)
 {
+	if (!soc->mec_hash.bins)
+		return;
+
+	qdf_flush_work(&soc->mec_hash.resize.work);
+	qdf_disable_work(&soc->mec_hash.resize.work);
+
 	dp_peer_mec_flush_entries(soc);
+	qdf_mem_free(soc->mec_hash.old_bins);
+	soc->mec_hash.old_bins = NULL;
 	qdf_mem_free(soc->mec_hash.bins);
 	soc->mec_hash.bins = NULL;
 }
@@ -971,39 +1397,67 @@ void dp_peer_mec_hash_detach(struct dp_soc *soc)
 #endif
 
 #ifdef FEATURE_AST
+/*
+ * dp_peer_ast_hash_bins_alloc() - Allocate and initialize AST hash bins
+ * @hash_elems: number of bins
+ *
+ * Return: bins on success, NULL on failure
+ */
+static struct dp_ast_hash_bin *dp_peer_ast_hash_bins_alloc(uint32_t hash_elems)
+{
+	struct dp_ast_hash_bin *bins;
+	uint32_t i;
+
+	bins = qdf_mem_malloc(hash_elems * sizeof(*bins));
+	if (!bins)
+		return NULL;
+
+	for (i = 0; i < hash_elems; i++)
+		TAILQ_INIT(&bins[i]);
+
+	return bins;
+}
+
+static void dp_peer_ast_hash_grow_work(void *arg);
+static void dp_peer_hash_stats_dbgfs_init(struct dp_soc *soc);
+static void dp_peer_hash_stats_dbgfs_deinit(struct dp_soc *soc);
+
 /*
  * dp_peer_ast_hash_attach() - Allocate and initialize AST Hash Table
  * @soc: SoC handle
  *
+ * The table starts at one bin per peer and grows on load, up to the size
+ * needed for max_ast_idx entries.
+ *
  * Return: QDF_STATUS
  */
 QDF_STATUS dp_peer_ast_hash_attach(struct dp_soc *soc)
 {
-	int i, hash_elems, log2;
+	int hash_elems, log2, max_log2;
 	unsigned int max_ast_idx = wlan_cfg_get_max_ast_idx(soc->wlan_cfg_ctx);
 
 	hash_elems = ((max_ast_idx * DP_AST_HASH_LOAD_MULT) >>
 		DP_AST_HASH_LOAD_SHIFT);
 
-	log2 = dp_log2_ceil(hash_elems);
+	max_log2 = dp_log2_ceil(hash_elems);
+	log2 = QDF_MIN(dp_log2_ceil(soc->max_peers), max_log2);
 	hash_elems = 1 << log2;
 
 	soc->ast_hash.mask = hash_elems - 1;
 	soc->ast_hash.idx_bits = log2;
+	soc->ast_hash.resize.max_mask = (1 << max_log2) - 1;
 
-	dp_peer_info("%pK: ast hash_elems: %d, max_ast_idx: %d",
-		     soc, hash_elems, max_ast_idx);
-
-	/* allocate an array of TAILQ peer object lists */
-	soc->ast_hash.bins = qdf_mem_malloc(
-		hash_elems * sizeof(TAILQ_HEAD(anonymous_tail_q,
-				dp_ast_entry)));
+	dp_peer_info("%pK: ast hash_elems: %d, max: %u, max_ast_idx: %d",
+		     soc, hash_elems, soc->ast_hash.resize.max_mask + 1,
+		     max_ast_idx);
 
+	soc->ast_hash.bins = dp_peer_ast_hash_bins_alloc(hash_elems);
 	if (!soc->ast_hash.bins)
 		return QDF_STATUS_E_NOMEM;
 
-	for (i = 0; i < hash_elems; i++)
-		TAILQ_INIT(&soc->ast_hash.bins[i]);
+	qdf_create_work(0, &soc->ast_hash.resize.work,
+			dp_peer_ast_hash_grow_work, soc);
+	dp_peer_hash_stats_dbgfs_init(soc);
 
 	return QDF_STATUS_SUCCESS;
 }
@@ -1035,6 +1489,185 @@ static inline void dp_peer_ast_cleanup(struct dp_soc *soc,
 	}
 }
 
+
+/*
+ * dp_peer_ast_hash_index() - Compute the AST hash from MAC address
+ * @soc: SoC handle
+ *
+ * Return: AST hash
+ */
+static inline uint32_t dp_peer_ast_hash_index(struct dp_soc *soc,
+	union dp_align_mac_addr *mac_addr)
+{
+	return dp_peer_hash_mac_index(mac_addr, soc->ast_hash.idx_bits,
+				      soc->ast_hash.mask);
+}
+
+/*
+ * dp_peer_ast_hash_bins_get() - Get the AST hash bins a MAC address can be in
+ * @soc: SoC handle
+ * @mac_addr: MAC address
+ * @bins: filled with the bins to search, older entries first
+ *
+ * While the table is resized, an entry is either in its bin of the old
+ * table, as long as that bin has not been moved yet, or in its bin of the
+ * new table. Searching the old bin first keeps the lookups returning the
+ * oldest of the entries sharing a MAC address, as before the resize.
+ * It assumes caller has taken the ast lock to protect the access to this table
+ *
+ * Return: number of bins filled
+ */
+static inline int
+dp_peer_ast_hash_bins_get(struct dp_soc *soc,
+			  union dp_align_mac_addr *mac_addr,
+			  struct dp_ast_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS])
+{
+	struct dp_hash_resize *resize = &soc->ast_hash.resize;
+	uint32_t index;
+	int nbins = 0;
+
+	if (qdf_unlikely(soc->ast_hash.old_bins)) {
+		index = dp_peer_hash_mac_index(mac_addr, resize->old_idx_bits,
+					       resize->old_mask);
+		if (index >= resize->rehash_idx)
+			bins[nbins++] = &soc->ast_hash.old_bins[index];
+	}
+
+	index = dp_peer_ast_hash_index(soc, mac_addr);
+	bins[nbins++] = &soc->ast_hash.bins[index];
+
+	return nbins;
+}
+
+/*
+ * dp_peer_ast_hash_rehash() - Move AST entries from the old to the new table
+ * @soc: SoC handle
+ * @nbins: number of old bins to move
+ *
+ * Each old bin is moved from its tail to the head of the new bins, so
+ * entries sharing a MAC address stay in the order they were added in.
+ * The old table is freed once its last bin is moved.
+ * It assumes caller has taken the ast lock to protect the access to this table
+ *
+ * Return: None
+ */
+static void dp_peer_ast_hash_rehash(struct dp_soc *soc, uint32_t nbins)
+{
+	struct dp_hash_resize *resize = &soc->ast_hash.resize;
+	struct dp_ast_hash_bin *old_bin;
+	struct dp_ast_entry *ase;
+	uint32_t index;
+
+	if (qdf_likely(!soc->ast_hash.old_bins))
+		return;
+
+	while (nbins-- && resize->rehash_idx <= resize->old_mask) {
+		old_bin = &soc->ast_hash.old_bins[resize->rehash_idx++];
+		while ((ase = TAILQ_LAST(old_bin, dp_ast_hash_bin))) {
+			TAILQ_REMOVE(old_bin, ase, hash_list_elem);
+			index = dp_peer_ast_hash_index(soc, &ase->mac_addr);
+			TAILQ_INSERT_HEAD(&soc->ast_hash.bins[index], ase,
+					  hash_list_elem);
+		}
+	}
+
+	if (resize->rehash_idx > resize->old_mask) {
+		qdf_mem_free(soc->ast_hash.old_bins);
+		soc->ast_hash.old_bins = NULL;
+		resize->grow_cnt++;
+	}
+}
+
+/*
+ * dp_peer_ast_hash_grow_work() - Double the AST hash table
+ * @arg: SoC handle
+ *
+ * The bigger table is allocated and installed here, outside the datapath.
+ * The entries are then moved a few bins per ast_lock hold, so AST lookups
+ * and adds never wait behind a walk of the whole table.
+ *
+ * Return: None
+ */
+static void dp_peer_ast_hash_grow_work(void *arg)
+{
+	struct dp_soc *soc = (struct dp_soc *)arg;
+	struct dp_ast_hash_bin *bins;
+	uint32_t hash_elems;
+
+	/* the table size only changes in this work */
+	hash_elems = (soc->ast_hash.mask + 1) << 1;
+	bins = dp_peer_ast_hash_bins_alloc(hash_elems);
+
+	qdf_spin_lock_bh(&soc->ast_lock);
+	soc->ast_hash.resize.grow_pending = false;
+	if (!bins) {
+		qdf_spin_unlock_bh(&soc->ast_lock);
+		dp_peer_warn("%pK: fail to grow AST hash to %u bins",
+			     soc, hash_elems);
+		return;
+	}
+
+	soc->ast_hash.old_bins = soc->ast_hash.bins;
+	soc->ast_hash.resize.old_mask = soc->ast_hash.mask;
+	soc->ast_hash.resize.old_idx_bits = soc->ast_hash.idx_bits;
+	soc->ast_hash.resize.rehash_idx = 0;
+	soc->ast_hash.bins = bins;
+	soc->ast_hash.mask = hash_elems - 1;
+	soc->ast_hash.idx_bits++;
+	qdf_spin_unlock_bh(&soc->ast_lock);
+
+	dp_peer_info("%pK: AST hash grows to %u bins, entries: %u",
+		     soc, hash_elems, soc->ast_hash.resize.count);
+
+	do {
+		qdf_spin_lock_bh(&soc->ast_lock);
+		dp_peer_ast_hash_rehash(soc, DP_HASH_REHASH_WORK_STEP);
+		bins = soc->ast_hash.old_bins;
+		qdf_spin_unlock_bh(&soc->ast_lock);
+	} while (bins);
+}
+
+#ifdef WLAN_DEBUGFS
+/*
+ * dp_peer_ast_hash_chain_stats() - Get the AST hash chain length stats
+ * @soc: SoC handle
+ * @stats: filled with the chain stats
+ *
+ * Return: None
+ */
+static void dp_peer_ast_hash_chain_stats(struct dp_soc *soc,
+					 struct dp_hash_chain_stats *stats)
+{
+	struct dp_ast_hash_bin *bin;
+	struct dp_ast_entry *ase;
+	uint32_t index, old_index, chain;
+
+	for (index = 0; ; index++) {
+		chain = 0;
+		qdf_spin_lock_bh(&soc->ast_lock);
+		bin = NULL;
+		if (index <= soc->ast_hash.mask) {
+			bin = &soc->ast_hash.bins[index];
+		} else if (soc->ast_hash.old_bins) {
+			old_index = index - (soc->ast_hash.mask + 1);
+			if (old_index <= soc->ast_hash.resize.old_mask)
+				bin = &soc->ast_hash.old_bins[old_index];
+		}
+
+		if (!bin) {
+			qdf_spin_unlock_bh(&soc->ast_lock);
+			break;
+		}
+
+		TAILQ_FOREACH(ase, bin, hash_list_elem)
+			chain++;
+		qdf_spin_unlock_bh(&soc->ast_lock);
+
+		dp_peer_hash_chain_stats_add(stats, chain);
+	}
+}
+#endif
+
 /*
  * dp_peer_ast_hash_detach() - Free AST Hash table
  * @soc: SoC handle
@@ -1046,15 +1679,17 @@ void dp_peer_ast_hash_detach(struct dp_soc *soc)
 	unsigned int index;
 	struct dp_ast_entry *ast, *ast_next;
 
-	if (!soc->ast_hash.mask)
-		return;
-
 	if (!soc->ast_hash.bins)
 		return;
 
+	dp_peer_hash_stats_dbgfs_deinit(soc);
+	qdf_flush_work(&soc->ast_hash.resize.work);
+	qdf_disable_work(&soc->ast_hash.resize.work);
+
 	dp_peer_debug("%pK: num_ast_entries: %u", soc, soc->num_ast_entries);
 
 	qdf_spin_lock_bh(&soc->ast_lock);
+	dp_peer_ast_hash_rehash(soc, soc->ast_hash.resize.old_mask + 1);
 	for (index = 0; index <= soc->ast_hash.mask; index++) {
 		if (!TAILQ_EMPTY(&soc->ast_hash.bins[index])) {
 			TAILQ_FOREACH_SAFE(ast, &soc->ast_hash.bins[index],
@@ -1063,6 +1698,7 @@ void dp_peer_ast_hash_detach(struct dp_soc *soc)
 					     hash_list_elem);
 				dp_peer_ast_cleanup(soc, ast);
 				soc->num_ast_entries--;
+				soc->ast_hash.resize.count--;
 				qdf_mem_free(ast);
 			}
 		}
@@ -1073,31 +1709,12 @@ void dp_peer_ast_hash_detach(struct dp_soc *soc)
 	soc->ast_hash.bins = NULL;
 }
 
-/*
- * dp_peer_ast_hash_index() - Compute the AST hash from MAC address
- * @soc: SoC handle
- *
- * Return: AST hash
- */
-static inline uint32_t dp_peer_ast_hash_index(struct dp_soc *soc,
-	union dp_align_mac_addr *mac_addr)
-{
-	uint32_t index;
-
-	index =
-		mac_addr->align2.bytes_ab ^
-		mac_addr->align2.bytes_cd ^
-		mac_addr->align2.bytes_ef;
-	index ^= index >> soc->ast_hash.idx_bits;
-	index &= soc->ast_hash.mask;
-	return index;
-}
-
 /*
  * dp_peer_ast_hash_add() - Add AST entry into hash table
  * @soc: SoC handle
  *
- * This function adds the AST entry into SoC AST hash table
+ * This function adds the AST entry into SoC AST hash table. While the
+ * table is resized, a few more old bins are moved on each add.
  * It assumes caller has taken the ast lock to protect the access to this table
  *
  * Return: None
@@ -1105,10 +1722,20 @@ static inline uint32_t dp_peer_ast_hash_index(struct dp_soc *soc,
 static inline void dp_peer_ast_hash_add(struct dp_soc *soc,
 		struct dp_ast_entry *ase)
 {
+	struct dp_hash_resize *resize = &soc->ast_hash.resize;
 	uint32_t index;
 
+	dp_peer_ast_hash_rehash(soc, DP_HASH_REHASH_ADD_STEP);
+
 	index = dp_peer_ast_hash_index(soc, &ase->mac_addr);
 	TAILQ_INSERT_TAIL(&soc->ast_hash.bins[index], ase, hash_list_elem);
+	resize->count++;
+
+	if (dp_peer_hash_need_grow(resize, soc->ast_hash.mask,
+				   !!soc->ast_hash.old_bins)) {
+		resize->grow_pending = true;
+		qdf_sched_work(0, &resize->work);
+	}
 }
 
 /*
@@ -1123,31 +1750,34 @@ static inline void dp_peer_ast_hash_add(struct dp_soc *soc,
 void dp_peer_ast_hash_remove(struct dp_soc *soc,
 			     struct dp_ast_entry *ase)
 {
-	unsigned index;
+	struct dp_ast_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS];
 	struct dp_ast_entry *tmpase;
+	int i, nbins;
 	int found = 0;
 
 	if (soc->ast_offload_support)
 		return;
 
-	index = dp_peer_ast_hash_index(soc, &ase->mac_addr);
-	/* Check if tail is not empty before delete*/
-	QDF_ASSERT(!TAILQ_EMPTY(&soc->ast_hash.bins[index]));
+	nbins = dp_peer_ast_hash_bins_get(soc, &ase->mac_addr, bins);
 
-	dp_peer_debug("ID: %u idx: %u mac_addr: " QDF_MAC_ADDR_FMT,
-		      ase->peer_id, index, QDF_MAC_ADDR_REF(ase->mac_addr.raw));
+	dp_peer_debug("ID: %u bins: %d mac_addr: " QDF_MAC_ADDR_FMT,
+		      ase->peer_id, nbins, QDF_MAC_ADDR_REF(ase->mac_addr.raw));
 
-	TAILQ_FOREACH(tmpase, &soc->ast_hash.bins[index], hash_list_elem) {
-		if (tmpase == ase) {
-			found = 1;
-			break;
+	for (i = 0; i < nbins && !found; i++) {
+		TAILQ_FOREACH(tmpase, bins[i], hash_list_elem) {
+			if (tmpase == ase) {
+				found = 1;
+				break;
+			}
 		}
 	}
 
 	QDF_ASSERT(found);
 
-	if (found)
-		TAILQ_REMOVE(&soc->ast_hash.bins[index], ase, hash_list_elem);
+	if (found) {
+		TAILQ_REMOVE(bins[i - 1], ase, hash_list_elem);
+		soc->ast_hash.resize.count--;
+	}
 }
 
 /*
@@ -1164,18 +1794,22 @@ struct dp_ast_entry *dp_peer_ast_hash_find_by_vdevid(struct dp_soc *soc,
 						     uint8_t vdev_id)
 {
 	union dp_align_mac_addr local_mac_addr_aligned, *mac_addr;
-	uint32_t index;
+	struct dp_ast_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS];
 	struct dp_ast_entry *ase;
+	int i, nbins;
 
 	qdf_mem_copy(&local_mac_addr_aligned.raw[0],
 		     ast_mac_addr, QDF_MAC_ADDR_SIZE);
 	mac_addr = &local_mac_addr_aligned;
 
-	index = dp_peer_ast_hash_index(soc, mac_addr);
-	TAILQ_FOREACH(ase, &soc->ast_hash.bins[index], hash_list_elem) {
-		if ((vdev_id == ase->vdev_id) &&
-		    !dp_peer_find_mac_addr_cmp(mac_addr, &ase->mac_addr)) {
-			return ase;
+	nbins = dp_peer_ast_hash_bins_get(soc, mac_addr, bins);
+	for (i = 0; i < nbins; i++) {
+		TAILQ_FOREACH(ase, bins[i], hash_list_elem) {
+			if ((vdev_id == ase->vdev_id) &&
+			    !dp_peer_find_mac_addr_cmp(mac_addr,
+						       &ase->mac_addr)) {
+				return ase;
+			}
 		}
 	}
 
@@ -1196,18 +1830,22 @@ struct dp_ast_entry *dp_peer_ast_hash_find_by_pdevid(struct dp_soc *soc,
 						     uint8_t pdev_id)
 {
 	union dp_align_mac_addr local_mac_addr_aligned, *mac_addr;
-	uint32_t index;
+	struct dp_ast_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS];
 	struct dp_ast_entry *ase;
+	int i, nbins;
 
 	qdf_mem_copy(&local_mac_addr_aligned.raw[0],
 		     ast_mac_addr, QDF_MAC_ADDR_SIZE);
 	mac_addr = &local_mac_addr_aligned;
 
-	index = dp_peer_ast_hash_index(soc, mac_addr);
-	TAILQ_FOREACH(ase, &soc->ast_hash.bins[index], hash_list_elem) {
-		if ((pdev_id == ase->pdev_id) &&
-		    !dp_peer_find_mac_addr_cmp(mac_addr, &ase->mac_addr)) {
-			return ase;
+	nbins = dp_peer_ast_hash_bins_get(soc, mac_addr, bins);
+	for (i = 0; i < nbins; i++) {
+		TAILQ_FOREACH(ase, bins[i], hash_list_elem) {
+			if ((pdev_id == ase->pdev_id) &&
+			    !dp_peer_find_mac_addr_cmp(mac_addr,
+						       &ase->mac_addr)) {
+				return ase;
+			}
 		}
 	}
 
@@ -1227,23 +1865,146 @@ struct dp_ast_entry *dp_peer_ast_hash_find_soc(struct dp_soc *soc,
 					       uint8_t *ast_mac_addr)
 {
 	union dp_align_mac_addr local_mac_addr_aligned, *mac_addr;
-	unsigned index;
+	struct dp_ast_hash_bin *bins[DP_HASH_MAX_LOOKUP_BINS];
 	struct dp_ast_entry *ase;
+	int i, nbins;
 
 	qdf_mem_copy(&local_mac_addr_aligned.raw[0],
 			ast_mac_addr, QDF_MAC_ADDR_SIZE);
 	mac_addr = &local_mac_addr_aligned;
 
-	index = dp_peer_ast_hash_index(soc, mac_addr);
-	TAILQ_FOREACH(ase, &soc->ast_hash.bins[index], hash_list_elem) {
-		if (dp_peer_find_mac_addr_cmp(mac_addr, &ase->mac_addr) == 0) {
-			return ase;
+	nbins = dp_peer_ast_hash_bins_get(soc, mac_addr, bins);
+	for (i = 0; i < nbins; i++) {
+		TAILQ_FOREACH(ase, bins[i], hash_list_elem) {
+			if (dp_peer_find_mac_addr_cmp(mac_addr,
+						      &ase->mac_addr) == 0) {
+				return ase;
+			}
 		}
 	}
 
 	return NULL;
 }
 
+#ifdef WLAN_DEBUGFS
+/*
+ * dp_peer_hash_stats_print() - Print the chain stats of an AST/MEC hash
+ * @file: debugfs file handle
+ * @name: name of the hash table
+ * @stats: chain stats of the table
+ * @resize: resize state of the table
+ *
+ * Return: None
+ */
+static void dp_peer_hash_stats_print(qdf_debugfs_file_t file,
+				     const char *name,
+				     struct dp_hash_chain_stats *stats,
+				     struct dp_hash_resize *resize)
+{
+	uint32_t avg = 0;
+
+	/* average length of the chains a lookup can land on, in 1/100 */
+	if (stats->used_bins)
+		avg = (stats->entries * 100) / stats->used_bins;
+
+	qdf_debugfs_printf(file, "%s hash:\n", name);
+	qdf_debugfs_printf(file, "  entries: %u\n", stats->entries);
+	qdf_debugfs_printf(file, "  bins: %u (max %u)\n",
+			   stats->bins, resize->max_mask + 1);
+	qdf_debugfs_printf(file, "  used bins: %u\n", stats->used_bins);
+	qdf_debugfs_printf(file, "  max chain: %u\n", stats->max_chain);
+	qdf_debugfs_printf(file, "  avg chain: %u.%02u\n",
+			   avg / 100, avg % 100);
+	qdf_debugfs_printf(file, "  grows: %u%s\n", resize->grow_cnt,
+			   resize->grow_pending ? " (pending)" : "");
+}
+
+/*
+ * dp_peer_hash_stats_show() - debugfs show of the AST and MEC hash stats
+ * @file: debugfs file handle
+ * @arg: SoC handle
+ *
+ * The tables are walked one bin per lock hold, so reading the stats does
+ * not stall the datapath, at the cost of a slightly inexact snapshot.
+ *
+ * Return: QDF_STATUS
+ */
+static QDF_STATUS dp_peer_hash_stats_show(qdf_debugfs_file_t file, void *arg)
+{
+	struct dp_soc *soc = (struct dp_soc *)arg;
+	struct dp_hash_chain_stats stats;
+
+	qdf_mem_zero(&stats, sizeof(stats));
+	dp_peer_ast_hash_chain_stats(soc, &stats);
+	dp_peer_hash_stats_print(file, "AST", &stats, &soc->ast_hash.resize);
+
+#ifdef FEATURE_MEC
+	if (!soc->mec_hash.bins)
+		return QDF_STATUS_SUCCESS;
+
+	qdf_mem_zero(&stats, sizeof(stats));
+	dp_peer_mec_hash_chain_stats(soc, &stats);
+	dp_peer_hash_stats_print(file, "MEC", &stats, &soc->mec_hash.resize);
+#endif
+
+	return QDF_STATUS_SUCCESS;
+}
+
+/*
+ * dp_peer_hash_stats_dbgfs_init() - Create the SoC debugfs dir with the
+ *                                   hash stats entry
+ * @soc: SoC handle
+ *
+ * Return: None
+ */
+static void dp_peer_hash_stats_dbgfs_init(struct dp_soc *soc)
+{
+	static qdf_atomic_t dp_soc_dbgfs_cnt;
+	char name[16];
+
+	qdf_snprint(name, sizeof(name), DP_SOC_DBGFS_DIR,
+		    qdf_atomic_inc_return(&dp_soc_dbgfs_cnt) - 1);
+	soc->dbgfs_dir = qdf_debugfs_create_dir(name, NULL);
+	if (!soc->dbgfs_dir) {
+		dp_peer_info("%pK: fail to create debugfs dir %s", soc, name);
+		return;
+	}
+
+	soc->hash_stats_fops.show = dp_peer_hash_stats_show;
+	soc->hash_stats_fops.write = NULL;
+	soc->hash_stats_fops.priv = soc;
+
+	soc->hash_stats_dentry =
+		qdf_debugfs_create_file(DP_HASH_STATS_DBGFS_FILE,
+					QDF_FILE_USR_READ, soc->dbgfs_dir,
+					&soc->hash_stats_fops);
+	if (!soc->hash_stats_dentry)
+		dp_peer_info("%pK: fail to create hash stats debugfs entry",
+			     soc);
+}
+
+/*
+ * dp_peer_hash_stats_dbgfs_deinit() - Remove the SoC debugfs dir
+ * @soc: SoC handle
+ *
+ * Return: None
+ */
+static void dp_peer_hash_stats_dbgfs_deinit(struct dp_soc *soc)
+{
+	qdf_debugfs_remove_dir_recursive(soc->dbgfs_dir);
+	soc->dbgfs_dir = NULL;
+	soc->hash_stats_dentry = NULL;
+}
+#else
+static void dp_peer_hash_stats_dbgfs_init(struct dp_soc *soc)
+{
+}
+
+static void dp_peer_hash_stats_dbgfs_deinit(struct dp_soc *soc)
+{
+}
+#endif
+
 /*
  * dp_peer_map_ast() - Map the ast entry with HW AST Index
  * @soc: SoC handle
@@ -2811,6 +3572,8 @@ void dp_rx_mlo_peer_unmap_handler(struct dp_soc *soc, uint16_t peer_id)
 void
 dp_peer_find_detach(struct dp_soc *soc)
 {
+	/* peers freed by dp_peer_unref_delete() may still be in flight */
+	qdf_rcu_barrier();
 	dp_soc_wds_detach(soc);
 	dp_peer_find_map_detach(soc);
 	dp_peer_find_hash_detach(soc);
@@ -2822,6 +3585,7 @@ dp_peer_find_detach(struct dp_soc *soc)
 void
 dp_peer_find_detach(struct dp_soc *soc)
 {
+	qdf_rcu_barrier();
 	dp_peer_find_map_detach(soc);
 	dp_peer_find_hash_detach(soc);
 }
@@ -114,16 +114,16 @@ __dp_peer_get_ref_by_id(struct dp_soc *soc,
 {
 	struct dp_peer *peer;
 
-	qdf_spin_lock_bh(&soc->peer_map_lock);
+	qdf_rcu_read_lock();
 	peer = (peer_id >= soc->max_peer_id) ? NULL :
-				soc->peer_id_to_obj_map[peer_id];
+			qdf_rcu_dereference(soc->peer_id_to_obj_map[peer_id]);
 	if (!peer ||
 	    (dp_peer_get_ref(soc, peer, mod_id) != QDF_STATUS_SUCCESS)) {
-		qdf_spin_unlock_bh(&soc->peer_map_lock);
+		qdf_rcu_read_unlock();
 		return NULL;
 	}
 
-	qdf_spin_unlock_bh(&soc->peer_map_lock);
+	qdf_rcu_read_unlock();
 	return peer;
 }
 
@@ -144,17 +144,17 @@ struct dp_peer *dp_peer_get_ref_by_id(struct dp_soc *soc,
 {
 	struct dp_peer *peer;
 
-	qdf_spin_lock_bh(&soc->peer_map_lock);
+	qdf_rcu_read_lock();
 	peer = (peer_id >= soc->max_peer_id) ? NULL :
-				soc->peer_id_to_obj_map[peer_id];
+			qdf_rcu_dereference(soc->peer_id_to_obj_map[peer_id]);
 
 	if (!peer || peer->peer_state >= DP_PEER_STATE_LOGICAL_DELETE ||
 	    (dp_peer_get_ref(soc, peer, mod_id) != QDF_STATUS_SUCCESS)) {
-		qdf_spin_unlock_bh(&soc->peer_map_lock);
+		qdf_rcu_read_unlock();
 		return NULL;
 	}
 
-	qdf_spin_unlock_bh(&soc->peer_map_lock);
+	qdf_rcu_read_unlock();
 
 	return peer;
 }
@@ -964,6 +964,32 @@ void dp_peer_mec_spinlock_destroy(struct dp_soc *soc);
  * Return: None
  */
 void dp_peer_mec_flush_entries(struct dp_soc *soc);
+
+/**
+ * dp_peer_mec_hash_num_bins() - Number of bins to walk in the MEC hash
+ * @soc: SoC handle
+ *
+ * While the MEC table is resized, the bins of the table being drained
+ * are counted after the bins of the new table.
+ *
+ * Return: number of bins
+ */
+uint32_t dp_peer_mec_hash_num_bins(struct dp_soc *soc);
+
+/**
+ * dp_peer_mec_hash_bin_get() - Get a MEC hash bin to walk
+ * @soc: SoC handle
+ * @index: bin index, below dp_peer_mec_hash_num_bins()
+ *
+ * An entry moved by a resize in the middle of a walk, which drops the
+ * mec_lock between bins, can be skipped or seen twice by that walk.
+ * It assumes caller has taken the mec_lock to protect the access to
+ * MEC hash table
+ *
+ * Return: MEC hash bin, NULL if the drained table was freed meanwhile
+ */
+struct dp_mec_hash_bin *dp_peer_mec_hash_bin_get(struct dp_soc *soc,
+						 uint32_t index);
 #else
 static inline void dp_peer_mec_spinlock_create(struct dp_soc *soc)
 {
@@ -85,19 +85,33 @@ static void
 dp_peer_age_mec_entries(struct dp_soc *soc)
 {
 	uint32_t index;
+	uint8_t round;
+	struct dp_mec_hash_bin *bin;
 	struct dp_mec_entry *mecentry, *mecentry_next;
 
 	TAILQ_HEAD(, dp_mec_entry) free_list;
 	TAILQ_INIT(&free_list);
 
-	for (index = 0; index <= soc->mec_hash.mask; index++) {
+	/* only this timer ages MEC entries */
+	round = ++soc->mec_hash.age_round;
+
+	for (index = 0; index < dp_peer_mec_hash_num_bins(soc); index++) {
 		qdf_spin_lock_bh(&soc->mec_lock);
+		bin = dp_peer_mec_hash_bin_get(soc, index);
 		/*
-		 * Expire MEC entry every n sec.
+		 * Expire MEC entry every n sec. A MEC hash resize meanwhile
+		 * can move an entry into a bin this pass has yet to visit,
+		 * or install a bigger table and shift the bin numbering. The
+		 * round marker keeps such an entry from being aged twice in
+		 * one pass. An entry skipped over is aged in the next pass.
 		 */
-		if (!TAILQ_EMPTY(&soc->mec_hash.bins[index])) {
-			TAILQ_FOREACH_SAFE(mecentry, &soc->mec_hash.bins[index],
+		if (bin && !TAILQ_EMPTY(bin)) {
+			TAILQ_FOREACH_SAFE(mecentry, bin,
 					   hash_list_elem, mecentry_next) {
+				if (mecentry->age_round == round)
+					continue;
+
+				mecentry->age_round = round;
 				if (mecentry->is_active) {
 					mecentry->is_active = FALSE;
 					continue;
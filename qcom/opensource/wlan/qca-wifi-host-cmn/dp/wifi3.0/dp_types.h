@@ -27,6 +27,7 @@
 #include <qdf_util.h>
 #include <qdf_list.h>
 #include <qdf_lro.h>
+#include <qdf_rcu.h>
 #include <queue.h>
 #include <htt_common.h>
 #include <htt.h>
@@ -1259,6 +1260,7 @@ struct dp_ast_entry {
  *             (used for aging out/expiry)
  * @pdev_id: pdev ID
  * @vdev_id: vdev ID
+ * @age_round: last MEC aging pass that visited this entry
  * @hash_list_elem: node in soc MEC hash list (mac address used as hash)
  */
 struct dp_mec_entry {
@@ -1266,10 +1268,38 @@ struct dp_mec_entry {
 	bool is_active;
 	uint8_t pdev_id;
 	uint8_t vdev_id;
+	uint8_t age_round;
 
 	TAILQ_ENTRY(dp_mec_entry) hash_list_elem;
 };
 
+/* AST and MEC hash bin list heads */
+TAILQ_HEAD(dp_ast_hash_bin, dp_ast_entry);
+TAILQ_HEAD(dp_mec_hash_bin, dp_mec_entry);
+
+/*
+ * dp_hash_resize
+ *
+ * @old_mask: mask of the table being drained, valid while old bins are set
+ * @old_idx_bits: index shift bits of the table being drained
+ * @rehash_idx: next bin of the table being drained to be moved
+ * @max_mask: mask of the biggest table the hash is allowed to grow to
+ * @count: number of entries in the hash, both tables included
+ * @grow_pending: grow work is scheduled and has not installed a table yet
+ * @grow_cnt: number of times the table has been doubled
+ * @work: allocates the bigger table outside the datapath
+ */
+struct dp_hash_resize {
+	uint32_t old_mask;
+	uint32_t old_idx_bits;
+	uint32_t rehash_idx;
+	uint32_t max_mask;
+	uint32_t count;
+	bool grow_pending;
+	uint32_t grow_cnt;
+	qdf_work_t work;
+};
+
 /* SOC level htt stats */
 struct htt_t2h_stats {
 	/* lock to protect htt_stats_msg update */
@@ -2072,8 +2102,17 @@ struct dp_soc {
 	struct {
 		unsigned mask;
 		unsigned idx_bits;
-		TAILQ_HEAD(, dp_ast_entry) * bins;
+		struct dp_ast_hash_bin *bins;
+		/* previous table, drained into bins while being resized */
+		struct dp_ast_hash_bin *old_bins;
+		struct dp_hash_resize resize;
 	} ast_hash;
+#ifdef WLAN_DEBUGFS
+	/* per-SoC debugfs dir, and its AST and MEC hash chain stats entry */
+	qdf_dentry_t dbgfs_dir;
+	qdf_dentry_t hash_stats_dentry;
+	struct qdf_debugfs_fops hash_stats_fops;
+#endif
 
 #ifdef DP_TX_HW_DESC_HISTORY
 	struct dp_tx_hw_desc_history *tx_hw_desc_history;
@@ -2266,7 +2305,13 @@ struct dp_soc {
 		/** @idx_bits: index to shift bits */
 		uint32_t idx_bits;
 		/** @bins: MEC table */
-		TAILQ_HEAD(, dp_mec_entry) * bins;
+		struct dp_mec_hash_bin *bins;
+		/** @old_bins: previous table, drained while being resized */
+		struct dp_mec_hash_bin *old_bins;
+		/** @resize: incremental resize state */
+		struct dp_hash_resize resize;
+		/** @age_round: current MEC aging pass */
+		uint8_t age_round;
 	} mec_hash;
 #endif
 
@@ -3377,8 +3422,12 @@ struct dp_peer {
 
 	/* node in the vdev's list of peers */
 	TAILQ_ENTRY(dp_peer) peer_list_elem;
-	/* node in the hash table bin's list of peers */
+	/* node in the hash table bin's list of peers, walked under RCU */
 	TAILQ_ENTRY(dp_peer) hash_list_elem;
+	/* bumped on every hash link and unlink, odd while linked */
+	qdf_atomic_t hash_gen;
+	/* defers the free until lockless hash lookups are done with it */
+	qdf_rcu_head_t rcu;
 
 	/* TID structures pointer */
 	struct dp_rx_tid *rx_tid;
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * DOC: qdf_rcu.h - Public APIs for read-copy-update protected data
+ */
+
+#ifndef __QDF_RCU_H
+#define __QDF_RCU_H
+
+#include "i_qdf_rcu.h"
+
+/**
+ * typedef qdf_rcu_head_t - opaque callback head for qdf_call_rcu()
+ */
+typedef __qdf_rcu_head_t qdf_rcu_head_t;
+
+/**
+ * qdf_rcu_read_lock() - enter an RCU read-side critical section
+ *
+ * Return: none
+ */
+#define qdf_rcu_read_lock() __qdf_rcu_read_lock()
+
+/**
+ * qdf_rcu_read_unlock() - leave an RCU read-side critical section
+ *
+ * Return: none
+ */
+#define qdf_rcu_read_unlock() __qdf_rcu_read_unlock()
+
+/**
+ * qdf_rcu_dereference() - load an RCU protected pointer for reading
+ * @ptr: the pointer to load, from within a read-side critical section
+ *
+ * Return: value of @ptr
+ */
+#define qdf_rcu_dereference(ptr) __qdf_rcu_dereference(ptr)
+
+/**
+ * qdf_rcu_assign_pointer() - publish a pointer to RCU readers
+ * @ptr: the RCU protected pointer to update
+ * @val: new value, fully initialized before this call
+ *
+ * Return: none
+ */
+#define qdf_rcu_assign_pointer(ptr, val) __qdf_rcu_assign_pointer(ptr, val)
+
+/**
+ * qdf_call_rcu() - run a callback once all current readers are done
+ * @head: qdf_rcu_head_t embedded in the object being retired
+ * @func: callback, invoked with @head from softirq context
+ *
+ * Return: none
+ */
+#define qdf_call_rcu(head, func) __qdf_call_rcu(head, func)
+
+/**
+ * qdf_rcu_barrier() - wait for all pending qdf_call_rcu() callbacks
+ *
+ * May sleep.
+ *
+ * Return: none
+ */
+#define qdf_rcu_barrier() __qdf_rcu_barrier()
+
+#endif /* __QDF_RCU_H */